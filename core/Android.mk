@@ -22,6 +22,8 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     MsgTask.cpp \
+    MsgProfiler.cpp \
+    MsgPool.cpp \
     LocApiBase.cpp \
     LocAdapterBase.cpp \
     ContextBase.cpp \
@@ -38,6 +40,8 @@ LOCAL_C_INCLUDES:= \
 LOCAL_COPY_HEADERS_TO:= libloc_core/
 LOCAL_COPY_HEADERS:= \
     MsgTask.h \
+    MsgProfiler.h \
+    MsgPool.h \
     LocApiBase.h \
     LocAdapterBase.h \
     ContextBase.h \
@@ -53,5 +57,49 @@ LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(CLEAR_VARS)
+
+## Benchmark of MsgTask throughput with logging on, not installed by default
+LOCAL_SRC_FILES := loc_msg_task_bench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+    libgps.utils \
+    libloc_core
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+LOCAL_MODULE := loc_msg_task_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+## Benchmark of MsgTask latency behind bulk work, not installed by default
+LOCAL_SRC_FILES := loc_msg_latency_bench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+    libgps.utils \
+    libloc_core
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+LOCAL_MODULE := loc_msg_latency_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
 endif # not BUILD_TINY_ANDROID
 endif # BOARD_VENDOR_QCOM_GPS_LOC_API_HARDWARE
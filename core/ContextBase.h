@@ -62,7 +62,7 @@ public:
                            unsigned long capabilities) {
         mLBSProxy->requestUlp(adapter, capabilities);
     }
-    inline void sendMsg(const LocMsg *msg) { getMsgTask()->sendMsg(msg); }
+    inline void sendMsg(const LocMsg *msg) { getMsgTask()->sendMsg(msg, mLocApi); }
 };
 
 } // namespace loc_core
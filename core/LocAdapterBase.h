@@ -61,12 +61,29 @@ public:
         return mEvtMask;
     }
 
+    // msgs of all adapters sharing a LocApi are kept in order with
+    // each other and with the LocApi's own msgs
     inline void sendMsg(const LocMsg* msg) const {
-        mMsgTask->sendMsg(msg);
+        mMsgTask->sendMsg(msg, mLocApi);
     }
 
     inline void sendMsg(const LocMsg* msg) {
-        mMsgTask->sendMsg(msg);
+        mMsgTask->sendMsg(msg, mLocApi);
+    }
+
+    // timed msgs run on the same worker as the other msgs of the adapter
+    inline MsgTask::tTimerId sendMsgDelayed(const LocMsg* msg,
+                                            uint32_t delayMs) const {
+        return mMsgTask->sendMsgDelayed(msg, delayMs, mLocApi);
+    }
+
+    inline MsgTask::tTimerId sendMsgPeriodic(const LocMsg* msg,
+                                             uint32_t periodMs) const {
+        return mMsgTask->sendMsgPeriodic(msg, periodMs, mLocApi);
+    }
+
+    inline void cancelMsg(MsgTask::tTimerId timerId) const {
+        mMsgTask->cancelMsg(timerId);
     }
 
     inline void updateEvtMask(LOC_API_ADAPTER_EVENT_MASK_T event,
@@ -30,6 +30,7 @@
 #define LOG_TAG "LocSvc_LocApiBase"
 
 #include <dlfcn.h>
+#include <string.h>
 #include <LocApiBase.h>
 #include <LocAdapterBase.h>
 #include <log_util.h>
@@ -40,6 +41,27 @@ namespace loc_core {
 #define TO_ALL_LOCADAPTERS(call) TO_ALL_ADAPTERS(mLocAdapters, (call))
 #define TO_1ST_HANDLING_LOCADAPTERS(call) TO_1ST_HANDLING_ADAPTER(mLocAdapters, (call))
 
+// LocApis built before gnss_sv_used_ids was added to GpsLocationExtended
+// report the shorter struct, which the adapters would copy past its end;
+// it is padded out into copy, without the field.
+static GpsLocationExtended& fullLocationExtended(GpsLocationExtended& ext,
+                                                 GpsLocationExtended& copy)
+{
+    if (ext.size >= sizeof(GpsLocationExtended)) {
+        return ext;
+    }
+    // the old struct can end before the padding ahead of the field
+    size_t length = offsetof(GpsLocationExtended, gnss_sv_used_ids);
+    if (ext.size > 0 && ext.size < length) {
+        length = ext.size;
+    }
+    memset(&copy, 0, sizeof(copy));
+    memcpy(&copy, &ext, length);
+    copy.size = sizeof(copy);
+    copy.flags &= ~GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA;
+    return copy;
+}
+
 int hexcode(char *hexstring, int string_size,
             const char *data, int data_size)
 {
@@ -92,6 +114,7 @@ struct LocSsrMsg : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocSsrMsg"; }
     inline virtual void proc() const {
         mLocApi->close();
         mLocApi->open(mLocApi->getEvtMask());
@@ -113,6 +136,7 @@ struct LocOpenMsg : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocOpenMsg"; }
     inline virtual void proc() const {
         mLocApi->open(mMask);
     }
@@ -161,8 +185,8 @@ void LocApiBase::addAdapter(LocAdapterBase* adapter)
     for (int i = 0; i < MAX_ADAPTERS && mLocAdapters[i] != adapter; i++) {
         if (mLocAdapters[i] == NULL) {
             mLocAdapters[i] = adapter;
-            mMsgTask->sendMsg(new LocOpenMsg(this,
-                                             (adapter->getEvtMask())));
+            sendMsg(new LocOpenMsg(this,
+                                   (adapter->getEvtMask())));
             break;
         }
     }
@@ -198,7 +222,7 @@ void LocApiBase::removeAdapter(LocAdapterBase* adapter)
                 close();
             } else {
                 // else we need to remove the bit
-                mMsgTask->sendMsg(new LocOpenMsg(this, getEvtMask()));
+                sendMsg(new LocOpenMsg(this, getEvtMask()));
             }
         }
     }
@@ -206,13 +230,13 @@ void LocApiBase::removeAdapter(LocAdapterBase* adapter)
 
 void LocApiBase::updateEvtMask()
 {
-    mMsgTask->sendMsg(new LocOpenMsg(this, getEvtMask()));
+    sendMsg(new LocOpenMsg(this, getEvtMask()));
 }
 
 void LocApiBase::handleEngineUpEvent()
 {
     // This will take care of renegotiating the loc handle
-    mMsgTask->sendMsg(new LocSsrMsg(this));
+    sendMsg(new LocSsrMsg(this));
 
     LocDualContext::injectFeatureConfig(mContext);
 
@@ -243,10 +267,12 @@ void LocApiBase::reportPosition(UlpLocation &location,
              location.gpsLocation.bearing, location.gpsLocation.accuracy,
              location.gpsLocation.timestamp, location.rawDataSize,
              location.rawData, status, loc_technology_mask);
+    GpsLocationExtended copy;
+    GpsLocationExtended& ext = fullLocationExtended(locationExtended, copy);
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportPosition(location,
-                                        locationExtended,
+                                        ext,
                                         locationExt,
                                         status,
                                         loc_technology_mask)
@@ -270,10 +296,12 @@ void LocApiBase::reportSv(GpsSvStatus &svStatus,
                  svStatus.sv_list[i].elevation,
                  svStatus.sv_list[i].azimuth);
     }
+    GpsLocationExtended copy;
+    GpsLocationExtended& ext = fullLocationExtended(locationExtended, copy);
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportSv(svStatus,
-                                     locationExtended,
+                                     ext,
                                      svExt)
     );
 }
@@ -98,7 +98,7 @@ protected:
 
 public:
     inline void sendMsg(const LocMsg* msg) const {
-        mMsgTask->sendMsg(msg);
+        mMsgTask->sendMsg(msg, this);
     }
 
     void addAdapter(LocAdapterBase* adapter);
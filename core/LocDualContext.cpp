@@ -62,12 +62,13 @@ const char* LocDualContext::mLocationHalName = "Loc_hal_worker";
 const char* LocDualContext::mLBSLibName = "liblbs_core.so";
 
 pthread_mutex_t LocDualContext::mGetLocContextMutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t LocDualContext::mMsgTaskWorkers = 1;
 
 const MsgTask* LocDualContext::getMsgTask(MsgTask::tCreate tCreator,
                                           const char* name)
 {
     if (NULL == mMsgTask) {
-        mMsgTask = new MsgTask(tCreator, name);
+        mMsgTask = new MsgTask(tCreator, name, mMsgTaskWorkers);
     }
     return mMsgTask;
 }
@@ -76,7 +77,7 @@ const MsgTask* LocDualContext::getMsgTask(MsgTask::tAssociate tAssociate,
                                           const char* name)
 {
     if (NULL == mMsgTask) {
-        mMsgTask = new MsgTask(tAssociate, name);
+        mMsgTask = new MsgTask(tAssociate, name, mMsgTaskWorkers);
     } else if (tAssociate) {
         mMsgTask->associate(tAssociate);
     }
@@ -46,6 +46,7 @@ class LocDualContext : public ContextBase {
     static const MsgTask* getMsgTask(MsgTask::tAssociate tAssociate,
                                      const char* name);
     static pthread_mutex_t mGetLocContextMutex;
+    static uint32_t mMsgTaskWorkers;
 
 protected:
     LocDualContext(const MsgTask* msgTask,
@@ -57,6 +58,13 @@ public:
     static const LOC_API_ADAPTER_EVENT_MASK_T mFgExclMask;
     static const LOC_API_ADAPTER_EVENT_MASK_T mBgExclMask;
     static const char* mLocationHalName;
+    // number of MsgTask worker threads, only heeded if set before
+    // the first context is created; each context's LocApi gets its
+    // msgs processed in order, and contexts run in parallel, so more
+    // than 1 only for users whose contexts share no unlocked state
+    inline static void setMsgTaskWorkers(uint32_t workers) {
+        mMsgTaskWorkers = workers;
+    }
 
     static ContextBase* getLocFgContext(MsgTask::tCreate tCreator,
                                         const char* name);
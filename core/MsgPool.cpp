@@ -0,0 +1,282 @@
+/* Copyright (c) 2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_MsgPool"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <new>
+#include <MsgPool.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+// free blocks are linked through their first word
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct ThreadCache {
+    FreeBlock* head[MSG_POOL_CLASSES];
+    uint32_t cnt[MSG_POOL_CLASSES];
+};
+
+struct Depot {
+    pthread_mutex_t lock;
+    FreeBlock* head;
+    uint32_t cnt;
+};
+
+static pthread_once_t sPoolOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t sCacheKey;
+static bool sCacheKeyValid = false;
+static Depot sDepot[MSG_POOL_CLASSES];
+static MsgPoolStats sStats[MSG_POOL_CLASSES];
+// blocks bigger than the largest class
+static uint32_t sOversized = 0;
+
+static inline int classOf(size_t size) {
+    int c = 0;
+    while (c < MSG_POOL_CLASSES && size > ((size_t)1 << (MSG_POOL_MIN_SHIFT + c))) {
+        c++;
+    }
+    return c < MSG_POOL_CLASSES ? c : -1;
+}
+
+// most blocks of class c a thread cache holds
+static inline uint32_t cacheCap(int c) {
+    uint32_t cap = MSG_POOL_CACHE_BYTES >> (MSG_POOL_MIN_SHIFT + c);
+    return cap < 4 ? 4 : (cap > 64 ? 64 : cap);
+}
+
+// most blocks of class c the depot holds, enough for a few caches
+// to hand over their overflow at once
+static inline uint32_t depotCap(int c) {
+    uint32_t cap = MSG_POOL_DEPOT_BYTES >> (MSG_POOL_MIN_SHIFT + c);
+    return cap < 2 * cacheCap(c) ? 2 * cacheCap(c) : cap;
+}
+
+// moves up to cnt blocks of class c from the depot into list,
+// and returns how many it moved
+static uint32_t depotTake(int c, FreeBlock** list, uint32_t cnt) {
+    Depot& depot = sDepot[c];
+    uint32_t n = 0;
+
+    pthread_mutex_lock(&depot.lock);
+    while (n < cnt && NULL != depot.head) {
+        FreeBlock* block = depot.head;
+        depot.head = block->next;
+        block->next = *list;
+        *list = block;
+        n++;
+    }
+    depot.cnt -= n;
+    pthread_mutex_unlock(&depot.lock);
+
+    return n;
+}
+
+// hands the first cnt blocks of list over to the depot, and those that
+// do not fit into it back to the heap
+static void depotPut(int c, FreeBlock** list, uint32_t cnt) {
+    if (0 == cnt) {
+        return;
+    }
+
+    FreeBlock* first = *list;
+    FreeBlock* last = first;
+    for (uint32_t n = 1; n < cnt; n++) {
+        last = last->next;
+    }
+    *list = last->next;
+    last->next = NULL;
+
+    Depot& depot = sDepot[c];
+    uint32_t cap = depotCap(c);
+    pthread_mutex_lock(&depot.lock);
+    uint32_t keep = depot.cnt < cap ? cap - depot.cnt : 0;
+    if (keep >= cnt) {
+        last->next = depot.head;
+        depot.head = first;
+        depot.cnt += cnt;
+        first = NULL;
+    } else {
+        for (; keep > 0; keep--) {
+            FreeBlock* block = first;
+            first = block->next;
+            block->next = depot.head;
+            depot.head = block;
+            depot.cnt++;
+        }
+    }
+    pthread_mutex_unlock(&depot.lock);
+
+    while (NULL != first) {
+        FreeBlock* block = first;
+        first = block->next;
+        __atomic_add_fetch(&sStats[c].trimmed, 1, __ATOMIC_RELAXED);
+        ::operator delete(block);
+    }
+}
+
+static void cacheDestroy(void* arg) {
+    ThreadCache* cache = (ThreadCache*)arg;
+    for (int c = 0; c < MSG_POOL_CLASSES; c++) {
+        depotPut(c, &cache->head[c], cache->cnt[c]);
+    }
+    free(cache);
+}
+
+static void poolInit() {
+    for (int c = 0; c < MSG_POOL_CLASSES; c++) {
+        pthread_mutex_init(&sDepot[c].lock, NULL);
+        sStats[c].size = (size_t)1 << (MSG_POOL_MIN_SHIFT + c);
+    }
+    sCacheKeyValid = (0 == pthread_key_create(&sCacheKey, cacheDestroy));
+}
+
+static ThreadCache* getCache() {
+    pthread_once(&sPoolOnce, poolInit);
+    if (!sCacheKeyValid) {
+        return NULL;
+    }
+
+    ThreadCache* cache = (ThreadCache*)pthread_getspecific(sCacheKey);
+    if (NULL == cache &&
+        NULL != (cache = (ThreadCache*)calloc(1, sizeof(ThreadCache))) &&
+        0 != pthread_setspecific(sCacheKey, cache)) {
+        free(cache);
+        cache = NULL;
+    }
+    return cache;
+}
+
+void* MsgPool::alloc(size_t size) {
+    int c = classOf(size);
+    if (c < 0) {
+        __atomic_add_fetch(&sOversized, 1, __ATOMIC_RELAXED);
+        return ::operator new(size);
+    }
+
+    ThreadCache* cache = getCache();
+    FreeBlock* block = NULL;
+    MsgPoolStats& stats = sStats[c];
+
+    if (NULL != cache) {
+        if (NULL == cache->head[c]) {
+            cache->cnt[c] += depotTake(c, &cache->head[c], cacheCap(c) / 2);
+        }
+        if (NULL != (block = cache->head[c])) {
+            cache->head[c] = block->next;
+            cache->cnt[c]--;
+        }
+    } else if (1 == depotTake(c, &block, 1)) {
+        // no cache for this thread, the depot still works
+        block->next = NULL;
+    }
+
+    if (NULL != block) {
+        __atomic_add_fetch(&stats.hits, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&stats.misses, 1, __ATOMIC_RELAXED);
+        block = (FreeBlock*)::operator new(stats.size);
+    }
+
+    uint32_t inUse = __atomic_add_fetch(&stats.inUse, 1, __ATOMIC_RELAXED);
+    uint32_t peak = __atomic_load_n(&stats.peak, __ATOMIC_RELAXED);
+    while (inUse > peak &&
+           !__atomic_compare_exchange_n(&stats.peak, &peak, inUse, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return block;
+}
+
+void MsgPool::dealloc(void* ptr, size_t size) {
+    int c = classOf(size);
+    if (NULL == ptr) {
+        return;
+    }
+    if (c < 0) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    ThreadCache* cache = getCache();
+    FreeBlock* block = (FreeBlock*)ptr;
+
+    __atomic_sub_fetch(&sStats[c].inUse, 1, __ATOMIC_RELAXED);
+    if (NULL != cache) {
+        block->next = cache->head[c];
+        cache->head[c] = block;
+        // keep half, so that the next few allocs and frees stay local
+        if (++cache->cnt[c] > cacheCap(c)) {
+            uint32_t cnt = cache->cnt[c] / 2;
+            depotPut(c, &cache->head[c], cnt);
+            cache->cnt[c] -= cnt;
+        }
+    } else {
+        depotPut(c, &block, 1);
+    }
+}
+
+int MsgPool::getStats(MsgPoolStats* stats, int maxCnt) {
+    pthread_once(&sPoolOnce, poolInit);
+
+    int cnt = 0;
+    for (; cnt < MSG_POOL_CLASSES && cnt < maxCnt; cnt++) {
+        stats[cnt].size = sStats[cnt].size;
+        stats[cnt].hits = __atomic_load_n(&sStats[cnt].hits, __ATOMIC_RELAXED);
+        stats[cnt].misses = __atomic_load_n(&sStats[cnt].misses, __ATOMIC_RELAXED);
+        stats[cnt].inUse = __atomic_load_n(&sStats[cnt].inUse, __ATOMIC_RELAXED);
+        stats[cnt].peak = __atomic_load_n(&sStats[cnt].peak, __ATOMIC_RELAXED);
+        stats[cnt].trimmed = __atomic_load_n(&sStats[cnt].trimmed,
+                                             __ATOMIC_RELAXED);
+    }
+    return cnt;
+}
+
+void MsgPool::dump() {
+    MsgPoolStats stats[MSG_POOL_CLASSES];
+    int cnt = getStats(stats, MSG_POOL_CLASSES);
+
+    for (int i = 0; i < cnt; i++) {
+        if (0 != stats[i].hits || 0 != stats[i].misses) {
+            LOC_LOGI("%u byte msgs: hits %u misses %u in use %u peak %u "
+                     "trimmed %u", (unsigned int)stats[i].size, stats[i].hits,
+                     stats[i].misses, stats[i].inUse, stats[i].peak,
+                     stats[i].trimmed);
+        }
+    }
+    if (0 != sOversized) {
+        LOC_LOGI("msgs over %u bytes: %u", (unsigned int)stats[cnt - 1].size,
+                 sOversized);
+    }
+}
+
+} // namespace loc_core
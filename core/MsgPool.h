@@ -0,0 +1,75 @@
+/* Copyright (c) 2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __MSG_POOL__
+#define __MSG_POOL__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace loc_core {
+
+// size classes are powers of two, 64 bytes up to 16KB
+#define MSG_POOL_MIN_SHIFT 6
+#define MSG_POOL_CLASSES 9
+// bytes of each size class a thread keeps to itself
+#define MSG_POOL_CACHE_BYTES (64 * 1024)
+// bytes of each size class the depot keeps, beyond which freed blocks
+// go back to the heap
+#define MSG_POOL_DEPOT_BYTES (128 * 1024)
+
+struct MsgPoolStats {
+    size_t size;
+    // served from a cache or the depot, vs. from the heap
+    uint32_t hits;
+    uint32_t misses;
+    // blocks handed out and not yet freed, and the most ever
+    uint32_t inUse;
+    uint32_t peak;
+    // blocks given back to the heap as the depot was full
+    uint32_t trimmed;
+};
+
+// Size class pools behind LocMsg's operator new / delete. Msgs are mostly
+// allocated on one thread and freed on another, so each thread keeps a
+// small cache per size class, trading batches of blocks with a central
+// depot when it runs dry or overflows. Blocks go back to the heap if
+// they are bigger than the largest class, or if the depot is full, so
+// that a burst of msgs does not keep its peak of memory for good.
+class MsgPool {
+public:
+    static void* alloc(size_t size);
+    static void dealloc(void* block, size_t size);
+    // fills in up to maxCnt stats, one per size class, returns how many
+    static int getStats(MsgPoolStats* stats, int maxCnt);
+    static void dump();
+};
+
+} // namespace loc_core
+
+#endif //__MSG_POOL__
@@ -0,0 +1,205 @@
+/* Copyright (c) 2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_MsgProfiler"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <MsgProfiler.h>
+#include <MsgTask.h>
+#include <MsgPool.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+static inline void raiseMax(uint32_t* max, uint64_t val) {
+    uint32_t v = val > UINT32_MAX ? UINT32_MAX : (uint32_t)val;
+    uint32_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (v > cur &&
+           !__atomic_compare_exchange_n(max, &cur, v, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static inline uint32_t bucketOf(uint64_t usec) {
+    uint32_t b = 0;
+    if (usec >> 32) {
+        b = 32;
+    } else if (usec) {
+        b = 31 - __builtin_clz((uint32_t)usec);
+    }
+    return b < LOC_MSG_PROFILE_BUCKETS ? b : LOC_MSG_PROFILE_BUCKETS - 1;
+}
+
+// upper bound, in usec, of the bucket the pct percentile falls into
+static uint64_t percentile(const uint32_t* hist, uint32_t count, uint32_t pct) {
+    uint64_t want = ((uint64_t)count * pct + 99) / 100;
+    uint64_t seen = 0;
+    uint32_t b = 0;
+    for (; b < LOC_MSG_PROFILE_BUCKETS - 1; b++) {
+        seen += hist[b];
+        if (seen >= want) {
+            break;
+        }
+    }
+    return (uint64_t)2 << b;
+}
+
+MsgProfiler::~MsgProfiler() {
+    free(mEntries);
+}
+
+uint64_t MsgProfiler::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void MsgProfiler::enable(uint32_t dumpInterval) {
+    mDumpInterval = dumpInterval;
+    if (!enabled()) {
+        Entry* entries = (Entry*)calloc(MSG_PROFILE_TYPES, sizeof(Entry));
+        if (NULL == entries) {
+            LOC_LOGE("%s] no memory for %d entries", __func__,
+                     MSG_PROFILE_TYPES);
+            return;
+        }
+        mLastDump = now();
+        __atomic_store_n(&mEntries, entries, __ATOMIC_RELEASE);
+    }
+    LOC_LOGI("%s] msg profiling on, dump interval %u sec", __func__,
+             dumpInterval);
+}
+
+MsgProfiler::Entry* MsgProfiler::lookup(const LocMsg* msg) {
+    // all instances of a class share the vtable, whose address
+    // makes for a type id that needs no RTTI
+    const void* type = *(const void* const*)msg;
+    uint32_t i = ((uintptr_t)type >> 3) % MSG_PROFILE_TYPES;
+
+    for (uint32_t n = 0; n < MSG_PROFILE_TYPES; n++) {
+        Entry* entry = &mEntries[i];
+        const void* cur = __atomic_load_n(&entry->type, __ATOMIC_ACQUIRE);
+        if (NULL == cur &&
+            __atomic_compare_exchange_n(&entry->type, &cur, type, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // claimed it, other workers may count into it already
+            const char* name = msg->name();
+            if (NULL != name) {
+                snprintf(entry->stats.name, LOC_MSG_PROFILE_NAME_LEN, "%s",
+                         name);
+            } else {
+                snprintf(entry->stats.name, LOC_MSG_PROFILE_NAME_LEN, "%p",
+                         type);
+            }
+            __atomic_store_n(&entry->ready, 1, __ATOMIC_RELEASE);
+            return entry;
+        }
+        if (type == cur) {
+            return entry;
+        }
+        i = (i + 1) % MSG_PROFILE_TYPES;
+    }
+    return NULL;
+}
+
+void MsgProfiler::record(const LocMsg* msg, uint64_t start, uint64_t end) {
+    Entry* entry = lookup(msg);
+    if (NULL == entry) {
+        __atomic_add_fetch(&mOverflow, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // msgs sent before profiling was turned on have no send time
+    uint64_t dwell = (0 != msg->mSendTime && start > msg->mSendTime) ?
+                     start - msg->mSendTime : 0;
+    uint64_t proc = end - start;
+    LocMsgProfileStats& stats = entry->stats;
+
+    // several workers may record into the same entry
+    __atomic_add_fetch(&stats.count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.dwell_total, dwell, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.dwell_hist[bucketOf(dwell)], 1, __ATOMIC_RELAXED);
+    raiseMax(&stats.dwell_max, dwell);
+    __atomic_add_fetch(&stats.proc_total, proc, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.proc_hist[bucketOf(proc)], 1, __ATOMIC_RELAXED);
+    raiseMax(&stats.proc_max, proc);
+
+    uint64_t last = __atomic_load_n(&mLastDump, __ATOMIC_RELAXED);
+    if (0 != mDumpInterval &&
+        end > last && end - last >= (uint64_t)mDumpInterval * 1000000 &&
+        // only the one worker that moves mLastDump on dumps
+        __atomic_compare_exchange_n(&mLastDump, &last, end, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        dump();
+    }
+}
+
+int MsgProfiler::getStats(LocMsgProfileStats* stats, int maxCnt) const {
+    const Entry* entries = __atomic_load_n(&mEntries, __ATOMIC_ACQUIRE);
+    if (NULL == entries) {
+        return -1;
+    }
+
+    int cnt = 0;
+    for (int i = 0; i < MSG_PROFILE_TYPES && cnt < maxCnt; i++) {
+        if (__atomic_load_n(&entries[i].ready, __ATOMIC_ACQUIRE)) {
+            memcpy(&stats[cnt++], &entries[i].stats, sizeof(*stats));
+        }
+    }
+    return cnt;
+}
+
+void MsgProfiler::dump() const {
+    LocMsgProfileStats stats[MSG_PROFILE_TYPES];
+    int cnt = getStats(stats, MSG_PROFILE_TYPES);
+
+    for (int i = 0; i < cnt; i++) {
+        const LocMsgProfileStats& s = stats[i];
+        if (0 == s.count) {
+            continue;
+        }
+        LOC_LOGI("%s: n %u, dwell avg %llu p99 <%llu max %u, "
+                 "proc avg %llu p99 <%llu max %u usec", s.name, s.count,
+                 (unsigned long long)(s.dwell_total / s.count),
+                 (unsigned long long)percentile(s.dwell_hist, s.count, 99),
+                 s.dwell_max,
+                 (unsigned long long)(s.proc_total / s.count),
+                 (unsigned long long)percentile(s.proc_hist, s.count, 99),
+                 s.proc_max);
+    }
+    if (0 != mOverflow) {
+        LOC_LOGW("%u msgs of types beyond the first %d not profiled",
+                 mOverflow, MSG_PROFILE_TYPES);
+    }
+    MsgPool::dump();
+}
+
+} // namespace loc_core
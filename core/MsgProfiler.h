@@ -0,0 +1,86 @@
+/* Copyright (c) 2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __MSG_PROFILER__
+#define __MSG_PROFILER__
+
+#include <stdint.h>
+#include <gps_extended_c.h>
+
+namespace loc_core {
+
+struct LocMsg;
+
+#define MSG_PROFILE_TYPES 64
+
+// Per msg type queue dwell and proc() time of a MsgTask. Samples are
+// recorded by the MsgTask worker threads, which share the profiler;
+// getStats() may be called from anywhere and gives a snapshot that
+// can be a sample or so off.
+class MsgProfiler {
+    struct Entry {
+        const void* type;
+        // set once stats.name is filled in
+        int ready;
+        LocMsgProfileStats stats;
+    };
+    // allocated by enable(), NULL as long as profiling is off
+    Entry* mEntries;
+    uint32_t mDumpInterval;
+    uint64_t mLastDump;
+    // samples of types that did not fit into mEntries
+    uint32_t mOverflow;
+    // worker threads still using the profiler
+    uint32_t mUsers;
+    Entry* lookup(const LocMsg* msg);
+public:
+    inline MsgProfiler() :
+        mEntries(NULL), mDumpInterval(0), mLastDump(0), mOverflow(0),
+        mUsers(0) {}
+    ~MsgProfiler();
+    inline void hold() { __atomic_add_fetch(&mUsers, 1, __ATOMIC_RELAXED); }
+    // true if the last user is gone, who is then to delete it
+    inline bool release() {
+        return 0 == __atomic_sub_fetch(&mUsers, 1, __ATOMIC_ACQ_REL);
+    }
+    // monotonic time in usec
+    static uint64_t now();
+    // starts profiling, dumping it every dumpInterval sec, if not 0
+    void enable(uint32_t dumpInterval);
+    inline bool enabled() const {
+        return NULL != __atomic_load_n(&mEntries, __ATOMIC_ACQUIRE);
+    }
+    // msg was taken off the Q at start, and proc() returned at end
+    void record(const LocMsg* msg, uint64_t start, uint64_t end);
+    int getStats(LocMsgProfileStats* stats, int maxCnt) const;
+    void dump() const;
+};
+
+} // namespace loc_core
+
+#endif //__MSG_PROFILER__
@@ -31,6 +31,9 @@
 
 #include <cutils/sched_policy.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
 #include <MsgTask.h>
 #include <msg_q.h>
 #include <log_util.h>
@@ -39,33 +42,352 @@
 namespace loc_core {
 
 #define MAX_TASK_COMM_LEN 15
+// max number of msgs taken off the Q per loop iteration, so that
+// an unblocked Q is noticed without draining everything first
+#define MAX_MSG_BATCH 16
+// set in the pending count of a sendMsgAfterInFlight() fence once one
+// of its fence msgs is disposed unprocessed
+#define FENCE_SKIPPED 0x80000000u
 
-static void LocMsgDestroy(void* msg) {
-    delete (LocMsg*)msg;
+// set on worker threads, whose sends must not block on a full Q
+static pthread_key_t sWorkerKey;
+static pthread_once_t sWorkerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void createWorkerKey() {
+    pthread_key_create(&sWorkerKey, NULL);
+}
+
+// sends no pending slot msg may be moved past, i.e. of every msg not
+// sent through a slot, counted by key; keys sharing a count only make a
+// slot replace its pending msg less often
+#define SLOT_BARRIER_KEYS 64
+static uint32_t sSlotBarriers[SLOT_BARRIER_KEYS];
+
+static inline uint32_t* slotBarriers(const void* key) {
+    uint32_t hash = (uint32_t)((uintptr_t)key >> 4) * 2654435761u;
+    return &sSlotBarriers[hash >> 26];
+}
+
+// the low bits of a timer id are the index of its worker
+#define TIMER_WORKER_BITS 3
+static uint32_t sTimerSeq = 0;
+
+// Deadline heap of the delayed and periodic msgs of one worker. It is
+// only ever touched by the worker thread, so it needs no locking.
+class MsgTimers {
+    struct Timer {
+        uint64_t deadline;      // usec, CLOCK_MONOTONIC
+        uint32_t period;        // msec, 0 if the msg is sent once
+        MsgTask::tTimerId id;
+        const LocMsg* msg;
+    };
+    Timer* mHeap;
+    uint32_t mCnt;
+    uint32_t mCap;
+    // the timer whose msg is being processed, out of the heap meanwhile
+    Timer mRunning;
+    bool mRunningCancelled;
+
+    inline bool earlier(uint32_t a, uint32_t b) const {
+        return mHeap[a].deadline < mHeap[b].deadline;
+    }
+    void swap(uint32_t a, uint32_t b) {
+        Timer t = mHeap[a];
+        mHeap[a] = mHeap[b];
+        mHeap[b] = t;
+    }
+    void siftUp(uint32_t i);
+    void siftDown(uint32_t i);
+    void push(const Timer& timer);
+    void removeAt(uint32_t i);
+public:
+    inline MsgTimers() : mHeap(NULL), mCnt(0), mCap(0),
+                         mRunningCancelled(false) {
+        mRunning.msg = NULL;
+    }
+    ~MsgTimers();
+    void arm(MsgTask::tTimerId id, const LocMsg* msg,
+             uint64_t deadline, uint32_t period);
+    void cancel(MsgTask::tTimerId id);
+    // msec until the next deadline, rounded up; -1 if there is none
+    int timeout(uint64_t now) const;
+    // takes out the msg of the earliest timer, if it is due by now
+    const LocMsg* takeDue(uint64_t now);
+    // once the msg of takeDue() has been processed
+    void done(uint64_t now);
+};
+
+MsgTimers::~MsgTimers() {
+    for (uint32_t i = 0; i < mCnt; i++) {
+        mHeap[i].msg->dispose();
+    }
+    free(mHeap);
+}
+
+void MsgTimers::siftUp(uint32_t i) {
+    while (i > 0 && earlier(i, (i - 1) / 2)) {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void MsgTimers::siftDown(uint32_t i) {
+    while (1) {
+        uint32_t min = i;
+        uint32_t left = 2 * i + 1;
+        if (left < mCnt && earlier(left, min)) {
+            min = left;
+        }
+        if (left + 1 < mCnt && earlier(left + 1, min)) {
+            min = left + 1;
+        }
+        if (min == i) {
+            break;
+        }
+        swap(i, min);
+        i = min;
+    }
+}
+
+void MsgTimers::push(const Timer& timer) {
+    if (mCnt == mCap) {
+        uint32_t cap = mCap ? mCap * 2 : 8;
+        Timer* heap = (Timer*)realloc(mHeap, cap * sizeof(Timer));
+        if (NULL == heap) {
+            LOC_LOGE("%s] no memory for timer %u", __func__, timer.id);
+            timer.msg->dispose();
+            return;
+        }
+        mHeap = heap;
+        mCap = cap;
+    }
+    mHeap[mCnt] = timer;
+    siftUp(mCnt++);
+}
+
+void MsgTimers::removeAt(uint32_t i) {
+    mHeap[i] = mHeap[--mCnt];
+    if (i < mCnt) {
+        siftDown(i);
+        siftUp(i);
+    }
+}
+
+void MsgTimers::arm(MsgTask::tTimerId id, const LocMsg* msg,
+                    uint64_t deadline, uint32_t period) {
+    Timer timer = { deadline, period, id, msg };
+    push(timer);
+}
+
+void MsgTimers::cancel(MsgTask::tTimerId id) {
+    if (NULL != mRunning.msg && mRunning.id == id) {
+        // cancelled from its own proc(), done() disposes it
+        mRunningCancelled = true;
+        return;
+    }
+    // there are few enough timers for a linear search
+    for (uint32_t i = 0; i < mCnt; i++) {
+        if (mHeap[i].id == id) {
+            const LocMsg* msg = mHeap[i].msg;
+            removeAt(i);
+            msg->dispose();
+            return;
+        }
+    }
+    LOC_LOGV("%s] timer %u already gone", __func__, id);
 }
 
-MsgTask::MsgTask(tCreate tCreator, const char* threadName) :
-    mQ(msg_q_init2()), mAssociator(NULL){
-    if (tCreator) {
-        tCreator(threadName, loopMain,
-                 (void*)new MsgTask(mQ, mAssociator));
+int MsgTimers::timeout(uint64_t now) const {
+    if (0 == mCnt) {
+        return -1;
+    }
+    if (mHeap[0].deadline <= now) {
+        return 0;
+    }
+    uint64_t msec = (mHeap[0].deadline - now + 999) / 1000;
+    return msec < INT_MAX ? (int)msec : INT_MAX;
+}
+
+const LocMsg* MsgTimers::takeDue(uint64_t now) {
+    if (0 == mCnt || mHeap[0].deadline > now) {
+        return NULL;
+    }
+    mRunning = mHeap[0];
+    mRunningCancelled = false;
+    removeAt(0);
+    // so that the profiled dwell of a timed msg is how late it runs
+    mRunning.msg->mSendTime = mRunning.deadline;
+    return mRunning.msg;
+}
+
+void MsgTimers::done(uint64_t now) {
+    if (0 == mRunning.period || mRunningCancelled) {
+        mRunning.msg->dispose();
     } else {
-        createPThread(threadName);
+        // keep to the period, unless the worker fell a whole one behind
+        mRunning.deadline += (uint64_t)mRunning.period * 1000;
+        if (mRunning.deadline <= now) {
+            mRunning.deadline = now + (uint64_t)mRunning.period * 1000;
+        }
+        push(mRunning);
+    }
+    mRunning.msg = NULL;
+}
+
+// carries a timer to the heap of the worker it belongs to
+struct LocTimerArmMsg : public LocMsg {
+    const MsgTask::tTimerId mId;
+    mutable const LocMsg* mMsg;
+    const uint64_t mDeadline;
+    const uint32_t mPeriod;
+    inline LocTimerArmMsg(MsgTask::tTimerId id, const LocMsg* msg,
+                          uint64_t deadline, uint32_t period) :
+        LocMsg(), mId(id), mMsg(msg), mDeadline(deadline), mPeriod(period) {}
+    inline virtual ~LocTimerArmMsg() {
+        // flushed before it got to the worker
+        if (NULL != mMsg) {
+            mMsg->dispose();
+        }
+    }
+    inline virtual const char* name() const { return "LocTimerArmMsg"; }
+    virtual void proc() const;
+};
+
+struct LocTimerCancelMsg : public LocMsg {
+    const MsgTask::tTimerId mId;
+    inline LocTimerCancelMsg(MsgTask::tTimerId id) : LocMsg(), mId(id) {}
+    inline virtual const char* name() const { return "LocTimerCancelMsg"; }
+    virtual void proc() const;
+};
+
+static void LocMsgDestroy(void* msg) {
+    const LocMsg* pending = ((LocMsg*)msg)->redeem();
+    if (NULL != pending) {
+        pending->dispose();
+    }
+}
+
+LocMsgSlot::~LocMsgSlot() {
+    const LocMsg* msg = redeem();
+    if (NULL != msg) {
+        msg->dispose();
     }
 }
 
-MsgTask::MsgTask(tAssociate tAssociator, const char* threadName) :
-    mQ(msg_q_init2()), mAssociator(tAssociator){
-    createPThread(threadName);
+const LocMsg* LocMsgSlot::offer(const LocMsg* msg, uint32_t barriers) {
+    uintptr_t val = (uintptr_t)msg | (msg->supersedable() ? 0 : SLOT_STICKY);
+    uintptr_t cur = __atomic_load_n(&mPending, __ATOMIC_ACQUIRE);
+
+    while (1) {
+        if (cur & SLOT_STICKY) {
+            // must not replace it, queue up behind it
+            return msg;
+        }
+        if (0 != cur &&
+            barriers != __atomic_load_n(&mBarriers, __ATOMIC_RELAXED)) {
+            // msgs sent since must stay behind the pending one, so msg
+            // cannot take its place; drop it, msg goes behind them
+            if (__atomic_compare_exchange_n(&mPending, &cur, SLOT_STICKY,
+                                            false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                LOC_LOGV("%s] msg %p dropped, %p queued behind msgs sent "
+                         "since", __func__, (void*)cur, msg);
+                ((const LocMsg*)cur)->dispose();
+                return msg;
+            }
+        } else if (__atomic_compare_exchange_n(&mPending, &cur, val, false,
+                                               __ATOMIC_ACQ_REL,
+                                               __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+
+    if (0 == cur) {
+        __atomic_store_n(&mBarriers, barriers, __ATOMIC_RELAXED);
+        return this;
+    }
+
+    LOC_LOGV("%s] msg %p superseded by %p", __func__, (void*)cur, msg);
+    ((const LocMsg*)cur)->dispose();
+    return NULL;
+}
+
+const LocMsg* LocMsgSlot::redeem() const {
+    uintptr_t cur = __atomic_exchange_n(&mPending, 0, __ATOMIC_ACQ_REL);
+    return (const LocMsg*)(cur & ~SLOT_STICKY);
+}
+
+void LocTimerArmMsg::proc() const {
+    MsgTask* worker = (MsgTask*)pthread_getspecific(sWorkerKey);
+    worker->mTimers->arm(mId, mMsg, mDeadline, mPeriod);
+    mMsg = NULL;
+}
+
+void LocTimerCancelMsg::proc() const {
+    MsgTask* worker = (MsgTask*)pthread_getspecific(sWorkerKey);
+    worker->mTimers->cancel(mId);
+}
+
+MsgTask::MsgTask(tCreate tCreator, const char* threadName, uint32_t workers) :
+    mWorkerCnt(workers), mAssociator(NULL), mProfiler(new MsgProfiler()),
+    mTimers(NULL){
+    startWorkers(tCreator, threadName);
+}
+
+MsgTask::MsgTask(tAssociate tAssociator, const char* threadName,
+                 uint32_t workers) :
+    mWorkerCnt(workers), mAssociator(tAssociator),
+    mProfiler(new MsgProfiler()), mTimers(NULL){
+    startWorkers(NULL, threadName);
 }
 
 inline
-MsgTask::MsgTask(const void* q, tAssociate associator) :
-    mQ(q), mAssociator(associator){
+MsgTask::MsgTask(const void* q, tAssociate associator,
+                 MsgProfiler* profiler) :
+    mWorkerCnt(1), mAssociator(associator), mProfiler(profiler),
+    mTimers(new MsgTimers()){
+    mQs[0] = q;
+    mProfiler->hold();
 }
 
 MsgTask::~MsgTask() {
-    msg_q_unblock((void*)mQ);
+    for (uint32_t i = 0; i < mWorkerCnt; i++) {
+        msg_q_unblock((void*)mQs[i]);
+    }
+    delete mTimers;
+}
+
+void MsgTask::startWorkers(tCreate tCreator, const char* threadName) {
+    pthread_once(&sWorkerKeyOnce, createWorkerKey);
+
+    if (mWorkerCnt < 1) {
+        mWorkerCnt = 1;
+    } else if (mWorkerCnt > MAX_MSG_TASK_WORKERS) {
+        LOC_LOGW("%s] %u workers asked for, %d at most", __func__,
+                 mWorkerCnt, MAX_MSG_TASK_WORKERS);
+        mWorkerCnt = MAX_MSG_TASK_WORKERS;
+    }
+
+    for (uint32_t i = 0; i < mWorkerCnt; i++) {
+        mQs[i] = msg_q_init2();
+        MsgTask* copy = new MsgTask(mQs[i], mAssociator, mProfiler);
+        char name[MAX_TASK_COMM_LEN+1];
+        const char* workerName = threadName;
+
+        if (i > 0 && NULL != threadName) {
+            // keep the index, even if the name has to be cut short
+            int len = snprintf(name, sizeof(name), "%u", i);
+            snprintf(name, sizeof(name), "%.*s%u",
+                     MAX_TASK_COMM_LEN - len, threadName, i);
+            workerName = name;
+        }
+
+        if (tCreator) {
+            tCreator(workerName, loopMain, (void*)copy);
+        } else {
+            createPThread(workerName, copy);
+        }
+    }
 }
 
 void MsgTask::associate(tAssociate tAssociator) const {
@@ -73,6 +395,7 @@ void MsgTask::associate(tAssociate tAssociator) const {
         tAssociate mAssociator;
         inline LocAssociateMsg(tAssociate associator) :
             LocMsg(), mAssociator(associator) {}
+        inline virtual const char* name() const { return "LocAssociateMsg"; }
         inline virtual void proc() const {
             if (mAssociator) {
                 LOC_LOGD("MsgTask::associate");
@@ -80,10 +403,91 @@ void MsgTask::associate(tAssociate tAssociator) const {
             }
         }
     };
-    sendMsg(new LocAssociateMsg(tAssociator));
+    // every worker thread has to be associated
+    for (uint32_t i = 0; i < mWorkerCnt; i++) {
+        post(mQs[i], new LocAssociateMsg(tAssociator), NULL,
+             MSG_Q_LINK_UNORDERED);
+    }
 }
 
-void MsgTask::createPThread(const char* threadName) {
+void MsgTask::sendMsgAfterInFlight(const LocMsg* msg) const {
+    // a worker only takes the next msg off its Q once done with the
+    // last, so one fence msg on every Q is enough
+    struct LocFenceMsg : public LocMsg {
+        const LocMsg* mMsg;
+        uint32_t* mPending;
+        mutable bool mDone;
+        inline LocFenceMsg(const LocMsg* msg, uint32_t* pending) :
+            LocMsg(), mMsg(msg), mPending(pending), mDone(false) {}
+        // a fence flushed or rejected with its Q never got past what was
+        // in flight there, so then the msg is only disposed
+        inline virtual ~LocFenceMsg() {
+            if (!mDone) {
+                __atomic_or_fetch(mPending, FENCE_SKIPPED, __ATOMIC_RELEASE);
+                countDown();
+            }
+        }
+        inline void countDown() const {
+            uint32_t left = __atomic_sub_fetch(mPending, 1, __ATOMIC_ACQ_REL);
+            if (0 == (left & ~FENCE_SKIPPED)) {
+                if (0 == left) {
+                    mMsg->proc();
+                } else {
+                    LOC_LOGW("MsgTask::sendMsgAfterInFlight] a fence was "
+                             "not processed, msg disposed unprocessed");
+                }
+                mMsg->dispose();
+                delete mPending;
+            }
+        }
+        inline virtual const char* name() const { return "LocFenceMsg"; }
+        inline virtual void proc() const {
+            mDone = true;
+            countDown();
+        }
+        // nothing queued matters, only what is in flight, so it
+        // need not wait its turn, not even behind msgs of its key
+        inline virtual msg_q_prio_type priority() const {
+            return eMSG_Q_PRIO_HIGH;
+        }
+    };
+
+    // fenced even with just the one worker, so that msg takes the same
+    // lane, and is disposed the same way if the fence goes unprocessed
+    uint32_t* pending = new uint32_t(mWorkerCnt);
+    for (uint32_t i = 0; i < mWorkerCnt; i++) {
+        post(mQs[i], new LocFenceMsg(msg, pending), NULL,
+             MSG_Q_LINK_UNORDERED);
+    }
+}
+
+void MsgTask::dumpProfile() const {
+    mProfiler->dump();
+
+    msg_q_stats_type stats;
+    for (uint32_t i = 0; i < mWorkerCnt; i++) {
+        if (getQueueStats(i, &stats)) {
+            LOC_LOGI("worker %u Q: %u queued, %u high water, %u dropped, "
+                     "%u rejected, %u blocked, %u overcommitted", i,
+                     stats.count, stats.high_water, stats.dropped,
+                     stats.rejected, stats.blocked, stats.overcommitted);
+        }
+    }
+}
+
+void MsgTask::setQueueCapacity(uint32_t capacity,
+                               msg_q_overflow_type policy) const {
+    for (uint32_t i = 0; i < mWorkerCnt; i++) {
+        msg_q_set_capacity((void*)mQs[i], capacity, policy);
+    }
+}
+
+bool MsgTask::getQueueStats(uint32_t worker, msg_q_stats_type* stats) const {
+    return worker < mWorkerCnt &&
+        eMSG_Q_SUCCESS == msg_q_get_stats((void*)mQs[worker], stats);
+}
+
+void MsgTask::createPThread(const char* threadName, MsgTask* copy) {
     pthread_attr_t attr;
     pthread_attr_init(&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
@@ -91,18 +495,139 @@ void MsgTask::createPThread(const char* threadName) {
     pthread_t tid;
     // create the thread here, then if successful
     // and a name is given, we set the thread name
-    if (!pthread_create(&tid, &attr, loopMain,
-                        (void*)new MsgTask(mQ, mAssociator)) &&
+    if (!pthread_create(&tid, &attr, loopMain, (void*)copy) &&
         NULL != threadName) {
         char lname[MAX_TASK_COMM_LEN+1];
-        memcpy(lname, threadName, MAX_TASK_COMM_LEN);
-        lname[MAX_TASK_COMM_LEN] = 0;
+        snprintf(lname, sizeof(lname), "%s", threadName);
         pthread_setname_np(tid, lname);
     }
 }
 
-void MsgTask::sendMsg(const LocMsg* msg) const {
-    msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
+inline uint32_t MsgTask::shard(const void* key) const {
+    if (NULL == key || 1 == mWorkerCnt) {
+        return 0;
+    }
+    // Fibonacci hashing of the pointer, whose low bits are all alike
+    uint32_t hash = (uint32_t)((uintptr_t)key >> 4) * 2654435761u;
+    return (hash >> 16) % mWorkerCnt;
+}
+
+void MsgTask::sendMsg(const LocMsg* msg, const void* key) const {
+    const void* msgKey = msg->orderKey();
+    if (NULL != msgKey) {
+        key = msgKey;
+    }
+    post(mQs[shard(key)], msg, key, 0);
+}
+
+MsgTask::tTimerId MsgTask::sendMsgDelayed(const LocMsg* msg, uint32_t delayMs,
+                                          const void* key) const {
+    return schedule(msg, delayMs, 0, key);
+}
+
+MsgTask::tTimerId MsgTask::sendMsgPeriodic(const LocMsg* msg,
+                                           uint32_t periodMs,
+                                           const void* key) const {
+    if (0 == periodMs) {
+        LOC_LOGE("%s] a period of 0 msec", __func__);
+        msg->dispose();
+        return 0;
+    }
+    return schedule(msg, periodMs, periodMs, key);
+}
+
+MsgTask::tTimerId MsgTask::schedule(const LocMsg* msg, uint32_t delayMs,
+                                    uint32_t periodMs,
+                                    const void* key) const {
+    const void* msgKey = msg->orderKey();
+    uint32_t worker = shard(NULL != msgKey ? msgKey : key);
+    uint64_t deadline = MsgProfiler::now() + (uint64_t)delayMs * 1000;
+    tTimerId id;
+
+    do {
+        id = (__atomic_add_fetch(&sTimerSeq, 1, __ATOMIC_RELAXED)
+              << TIMER_WORKER_BITS) | worker;
+    } while (0 == id);
+
+    // straight into the heap if this is the worker already, so that
+    // timed work a worker sets itself never takes a trip through its Q
+    MsgTask* self = (MsgTask*)pthread_getspecific(sWorkerKey);
+    if (NULL != self && self->mQs[0] == mQs[worker]) {
+        self->mTimers->arm(id, msg, deadline, periodMs);
+    } else {
+        post(mQs[worker], new LocTimerArmMsg(id, msg, deadline, periodMs),
+             NULL, MSG_Q_LINK_UNORDERED);
+    }
+    return id;
+}
+
+void MsgTask::cancelMsg(tTimerId timerId) const {
+    uint32_t worker = timerId & ((1 << TIMER_WORKER_BITS) - 1);
+    if (0 == timerId || worker >= mWorkerCnt) {
+        LOC_LOGE("%s] invalid timer %u", __func__, timerId);
+        return;
+    }
+
+    MsgTask* self = (MsgTask*)pthread_getspecific(sWorkerKey);
+    if (NULL != self && self->mQs[0] == mQs[worker]) {
+        self->mTimers->cancel(timerId);
+    } else {
+        // queued behind the msg arming it, so it cannot overtake it;
+        // both stay in the normal lane for that, whatever else is queued
+        post(mQs[worker], new LocTimerCancelMsg(timerId), NULL,
+             MSG_Q_LINK_UNORDERED);
+    }
+}
+
+void MsgTask::post(const void* q, const LocMsg* msg, const void* key,
+                   unsigned int flags) const {
+    msg_q_prio_type prio = msg->priority();
+    LocMsgSlot* slot = msg->supersedeKey();
+    if (NULL != pthread_getspecific(sWorkerKey)) {
+        flags |= MSG_Q_LINK_NOBLOCK;
+    }
+
+    if (mProfiler->enabled()) {
+        msg->mSendTime = MsgProfiler::now();
+    }
+
+    uint32_t* barriers = slotBarriers(key);
+    if (NULL == slot) {
+        __atomic_add_fetch(barriers, 1, __ATOMIC_ACQ_REL);
+    } else if (NULL == (msg = slot->offer(msg, __atomic_load_n(
+                                              barriers, __ATOMIC_ACQUIRE)))) {
+        // a pending msg has been replaced, it already holds a place in Q
+        return;
+    }
+
+    if (msg->overtakable()) {
+        flags |= MSG_Q_LINK_UNORDERED;
+    }
+
+    msg->mLink.msg_obj = (void*)msg;
+    msg->mLink.dealloc = LocMsgDestroy;
+    msg->mLink.order_key = key;
+    msg->mLink.prio = prio;
+    // dropping a slot would lose whatever gets offered to it next
+    msg->mLink.flags = (msg != slot && msg->droppable()) ?
+        flags | MSG_Q_LINK_DROPPABLE : flags;
+    if (eMSG_Q_SUCCESS != msg_q_snd_link((void*)q, &msg->mLink)) {
+        LocMsgDestroy((void*)msg);
+    }
+}
+
+// returns when proc() ended if profiling, for the next msg to start at
+inline uint64_t MsgTask::process(const LocMsg* msg, uint64_t start) const {
+    msg->log();
+    // there is where each individual msg handling is invoked
+    msg->proc();
+
+    if (0 != start) {
+        uint64_t end = MsgProfiler::now();
+        mProfiler->record(msg, start, end);
+        start = end;
+    }
+    return start;
 }
 
 void* MsgTask::loopMain(void* arg) {
@@ -110,33 +635,55 @@ void* MsgTask::loopMain(void* arg) {
 
     // make sure we do not run in background scheduling group
     set_sched_policy(gettid(), SP_FOREGROUND);
+    pthread_setspecific(sWorkerKey, copy);
 
     if (NULL != copy->mAssociator) {
         copy->mAssociator();
     }
 
-    LocMsg* msg;
-    int cnt = 0;
+    LocMsg* msgs[MAX_MSG_BATCH];
 
     while (1) {
-        LOC_LOGD("MsgTask::loop() %d listening ...\n", cnt++);
+        unsigned int cnt = 0;
+        // wait no longer than the next timer is due
+        int timeout = copy->mTimers->timeout(MsgProfiler::now());
+        msq_q_err_type result =
+            msg_q_rcv_all_timeout((void*)copy->mQs[0], (void **)msgs,
+                                  MAX_MSG_BATCH, &cnt, timeout);
 
-        msq_q_err_type result = msg_q_rcv((void*)copy->mQ, (void **)&msg);
-
-        if (eMSG_Q_SUCCESS != result) {
+        if (eMSG_Q_SUCCESS != result && eMSG_Q_TIMEOUT != result) {
             LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
                      loc_get_msg_q_status(result));
             // destroy the Q and exit
-            msg_q_destroy((void**)&(copy->mQ));
+            msg_q_destroy((void**)&(copy->mQs[0]));
+            if (copy->mProfiler->release()) {
+                delete copy->mProfiler;
+            }
             delete copy;
             return NULL;
         }
 
-        msg->log();
-        // there is where each individual msg handling is invoked
-        msg->proc();
+        // when profiling, the end of one proc() is taken as
+        // the start of the next, to save a clock read per msg
+        uint64_t start = copy->mProfiler->enabled() ? MsgProfiler::now() : 0;
 
-        delete msg;
+        // process the batch in the order it was sent in
+        for (unsigned int i = 0; i < cnt; i++) {
+            const LocMsg* msg = msgs[i]->redeem();
+            if (NULL != msg) {
+                start = copy->process(msg, start);
+                msg->dispose();
+            }
+        }
+
+        // then whatever timers are due, each batch, so that a busy Q
+        // cannot hold them off
+        uint64_t now = MsgProfiler::now();
+        const LocMsg* msg;
+        while (NULL != (msg = copy->mTimers->takeDue(now))) {
+            start = copy->process(msg, start);
+            copy->mTimers->done(now);
+        }
     }
 
     delete copy;
@@ -32,15 +32,101 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
 #include <pthread.h>
+#include <msg_q.h>
+#include <MsgProfiler.h>
+#include <MsgPool.h>
 
 namespace loc_core {
 
+// most worker threads a MsgTask can be sharded into
+#define MAX_MSG_TASK_WORKERS 8
+
+class LocMsgSlot;
+class MsgTimers;
+
 struct LocMsg {
-    inline LocMsg() {}
+    inline LocMsg() : mSendTime(0) {}
     inline virtual ~LocMsg() {}
+    // msgs are new'd on one thread and deleted on another for every
+    // report, so they come from the size class pools of MsgPool
+    inline static void* operator new(size_t size) {
+        return MsgPool::alloc(size);
+    }
+    inline static void operator delete(void* msg, size_t size) {
+        MsgPool::dealloc(msg, size);
+    }
     virtual void proc() const = 0;
     inline virtual void log() const {}
+    // type name in msg profiles, see MsgProfiler; types without one
+    // are told apart by their type id there
+    inline virtual const char* name() const { return NULL; }
+    // msgs that must not wait behind bulk work, e.g. fix start / stop
+    // and position delivery, can ask to be queued in the high lane. They
+    // still never overtake msgs sent earlier with the same key, e.g. of
+    // the same adapter, only those of other keys, and overtakable ones.
+    inline virtual msg_q_prio_type priority() const {
+        return eMSG_Q_PRIO_NORMAL;
+    }
+    // bulk msgs, e.g. XTRA data injection, can let high priority msgs
+    // sent after them with the same key overtake them, so that while
+    // queued they do not hold those back in the normal lane
+    inline virtual bool overtakable() const { return false; }
+    // msgs that only carry the latest value of something, e.g. SV status,
+    // can name a slot here; while one of them still waits in the Q, a
+    // newer one sent through the same slot takes its place. Not once
+    // another msg with the same key was sent after the pending one, e.g.
+    // a fix stop, which must not be overtaken; the pending one is then
+    // dropped, and the newer one queued behind that msg instead.
+    inline virtual LocMsgSlot* supersedeKey() const { return NULL; }
+    // a pending msg that returns false here is never replaced, and
+    // newer msgs with the same key queue up behind it instead
+    inline virtual bool supersedable() const { return true; }
+    // called by MsgTask once the msg has been processed or flushed
+    inline virtual void dispose() const { delete this; }
+    // the msg to be processed on behalf of what was taken off the Q;
+    // a slot hands out its pending msg, if there still is one
+    inline virtual const LocMsg* redeem() const { return this; }
+    // msgs with the same key are processed in the order they are sent,
+    // by the same worker; NULL leaves it to the key the sender gives.
+    inline virtual const void* orderKey() const { return NULL; }
+    // msgs that can be lost without harm, e.g. NMEA sentences, may be
+    // dropped to make room when a bounded Q is full, see
+    // MsgTask::setQueueCapacity(); a msg queued through a slot never is
+    inline virtual bool droppable() const { return false; }
+    // queue linkage, so that sending a msg needs no extra allocation
+    mutable msg_q_link mLink;
+    // when the msg was sent, only stamped while profiling
+    mutable uint64_t mSendTime;
+};
+
+// Latest value slot, see LocMsg::supersedeKey(). The slot itself is what
+// sits in the Q on behalf of the pending msg, so it must outlive any msg
+// sent through it, as the owner of the msgs (e.g. an adapter) does.
+class LocMsgSlot : public LocMsg {
+    // pending msg, with SLOT_STICKY set if it is not supersedable; just
+    // SLOT_STICKY while the slot is queued with its msg dropped
+    mutable uintptr_t mPending;
+    // barrier count of the key when the slot was queued
+    uint32_t mBarriers;
+    static const uintptr_t SLOT_STICKY = 0x1;
+    // the slot only ever gets redeemed, never processed itself
+    inline virtual void proc() const {}
+public:
+    inline LocMsgSlot() : LocMsg(), mPending(0), mBarriers(0) {}
+    virtual ~LocMsgSlot();
+    // puts msg in the slot and returns what is to be queued for it: the
+    // slot, if nothing was pending yet; msg itself, if the pending msg
+    // must not be replaced, or was dropped as msgs that must stay behind
+    // it were sent since, which barriers, the count of those sent with
+    // the key so far, tells; or NULL, if msg replaced the pending one.
+    const LocMsg* offer(const LocMsg* msg, uint32_t barriers);
+    // takes the pending msg out, after which the slot may get queued
+    // again by the next offer()
+    virtual const LocMsg* redeem() const;
+    // the slot is owned by whoever hands it out, e.g. an adapter
+    inline virtual void dispose() const {}
 };
 
 class MsgTask {
@@ -48,18 +134,76 @@ public:
     typedef void* (*tStart)(void*);
     typedef pthread_t (*tCreate)(const char* name, tStart start, void* arg);
     typedef int (*tAssociate)();
-    MsgTask(tCreate tCreator, const char* threadName);
-    MsgTask(tAssociate tAssociator, const char* threadName);
+    // handle of a delayed or periodic msg, never 0
+    typedef uint32_t tTimerId;
+    // workers beyond the first get the thread name with their index
+    // appended, e.g. Loc_hal_worker1
+    MsgTask(tCreate tCreator, const char* threadName, uint32_t workers = 1);
+    MsgTask(tAssociate tAssociator, const char* threadName,
+            uint32_t workers = 1);
     ~MsgTask();
-    void sendMsg(const LocMsg* msg) const;
+    // key orders msg against other msgs with the same key, unless the
+    // msg has its own LocMsg::orderKey(); a NULL key means worker 0
+    void sendMsg(const LocMsg* msg, const void* key = NULL) const;
+    // msg is processed once delayMs have passed, on the worker key maps
+    // to, and can be cancelled by the returned handle until then
+    tTimerId sendMsgDelayed(const LocMsg* msg, uint32_t delayMs,
+                            const void* key = NULL) const;
+    // msg is processed every periodMs, the first time after periodMs,
+    // and only disposed once cancelled or the MsgTask goes away
+    tTimerId sendMsgPeriodic(const LocMsg* msg, uint32_t periodMs,
+                             const void* key = NULL) const;
+    // disposes a delayed msg not processed yet, or stops a periodic one.
+    // On the worker the msg was sent to this takes effect at once, from
+    // anywhere else once the worker gets to it.
+    void cancelMsg(tTimerId timerId) const;
+    // msg is processed once every worker has finished the msg it was
+    // processing at the time of the call, e.g. to free what msgs may
+    // still be reading; on whichever worker gets there last. If that
+    // cannot be made sure of, e.g. as the MsgTask goes away first, msg
+    // is disposed without being processed.
+    void sendMsgAfterInFlight(const LocMsg* msg) const;
     void associate(tAssociate tAssociator) const;
+    inline uint32_t getWorkerCnt() const { return mWorkerCnt; }
+    // profiles queue dwell and proc() time per msg type, and logs
+    // the profile every dumpInterval sec, unless it is 0
+    inline void enableProfiling(uint32_t dumpInterval) const {
+        mProfiler->enable(dumpInterval);
+    }
+    // see LocMsgProfileInterface::get_stats()
+    inline int getProfile(LocMsgProfileStats* stats, int maxCnt) const {
+        return mProfiler->getStats(stats, maxCnt);
+    }
+    void dumpProfile() const;
+    // bounds every worker's Q to capacity msgs, 0 for unbounded, and
+    // sets what a send to a full Q does. Msgs sent from a worker thread
+    // are never blocked, as that could deadlock the workers.
+    void setQueueCapacity(uint32_t capacity, msg_q_overflow_type policy) const;
+    // false if there is no such worker
+    bool getQueueStats(uint32_t worker, msg_q_stats_type* stats) const;
 
 private:
-    const void* mQ;
+    // one Q per worker; a worker's copy only has its own
+    const void* mQs[MAX_MSG_TASK_WORKERS];
+    uint32_t mWorkerCnt;
     tAssociate mAssociator;
-    MsgTask(const void* q, tAssociate associator);
+    // shared with the workers' copies, the last of which deletes it
+    MsgProfiler* mProfiler;
+    // delayed and periodic msgs of a worker, only its copy has them
+    MsgTimers* mTimers;
+    MsgTask(const void* q, tAssociate associator, MsgProfiler* profiler);
+    void startWorkers(tCreate tCreator, const char* threadName);
     static void* loopMain(void* copy);
-    void createPThread(const char* name);
+    void createPThread(const char* name, MsgTask* copy);
+    uint32_t shard(const void* key) const;
+    tTimerId schedule(const LocMsg* msg, uint32_t delayMs, uint32_t periodMs,
+                      const void* key) const;
+    uint64_t process(const LocMsg* msg, uint64_t start) const;
+    friend struct LocTimerArmMsg;
+    friend struct LocTimerCancelMsg;
+    // key orders msg in q, see msg_q_link; flags are MSG_Q_LINK_* to add
+    void post(const void* q, const LocMsg* msg, const void* key,
+              unsigned int flags) const;
 };
 
 } // namespace loc_core
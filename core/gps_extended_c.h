@@ -254,6 +254,21 @@ typedef uint16_t GpsLocationExtendedFlags;
 #define GPS_LOCATION_EXTENDED_HAS_VERT_UNC 0x0010
 /** GpsLocationExtended has valid speed uncertainty */
 #define GPS_LOCATION_EXTENDED_HAS_SPEED_UNC 0x0020
+/** GpsLocationExtended has valid gnss_sv_used_ids */
+#define GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA 0x0040
+
+/** SVs of each constellation used in the fix, bit n set for
+    GPS PRN n+1, GLONASS 65+n, Galileo 301+n, BDS 201+n and
+    QZSS 193+n. LocApiRpc sets the GLONASS mask only; it knows no
+    other systems. A LocApi that sets none leaves the NMEA with the
+    GPS SVs of used_in_fix_mask. */
+typedef struct {
+    uint64_t gps_sv_used_ids_mask;
+    uint64_t glo_sv_used_ids_mask;
+    uint64_t gal_sv_used_ids_mask;
+    uint64_t bds_sv_used_ids_mask;
+    uint64_t qzss_sv_used_ids_mask;
+} GnssSvUsedInPosition;
 
 /** Represents gps location extended. */
 typedef struct {
@@ -275,6 +290,11 @@ typedef struct {
     float           vert_unc;
     /** speed uncertainty in m/s */
     float           speed_unc;
+    /** SVs used in the fix, beyond the GPS ones in used_in_fix_mask.
+        This grew the struct by 40 bytes: a LocApi built against the
+        older header sends a smaller size, and LocApiBase pads its
+        reports out without this field. */
+    GnssSvUsedInPosition gnss_sv_used_ids;
 } GpsLocationExtended;
 
 typedef struct GpsExtLocation_s {
@@ -411,6 +431,195 @@ typedef enum loc_api_adapter_msg_to_check_supported {
     LOC_API_ADAPTER_MESSAGE_MAX
 } LocCheckingMessagesID;
 
+/** Name of the MsgTask profiling extension, see LocMsgProfileInterface */
+#define LOC_MSG_PROFILE_INTERFACE "loc-msg-profile"
+/** Number of log2 histogram buckets, bucket i counts samples of
+    [2^i, 2^(i+1)) usec, the first one also takes anything shorter
+    and the last one anything longer. */
+#define LOC_MSG_PROFILE_BUCKETS 24
+#define LOC_MSG_PROFILE_NAME_LEN 48
+
+/** Queue dwell and proc() time of one msg type of a MsgTask. */
+typedef struct {
+    /** msg type name, see LocMsg::name(), or its type id if it has none */
+    char            name[LOC_MSG_PROFILE_NAME_LEN];
+    /** number of msgs processed */
+    uint32_t        count;
+    /** time between sendMsg() and proc(), in usec */
+    uint64_t        dwell_total;
+    uint32_t        dwell_max;
+    uint32_t        dwell_hist[LOC_MSG_PROFILE_BUCKETS];
+    /** time spent in proc(), in usec */
+    uint64_t        proc_total;
+    uint32_t        proc_max;
+    uint32_t        proc_hist[LOC_MSG_PROFILE_BUCKETS];
+} LocMsgProfileStats;
+
+/** Extended interface for querying the MsgTask profile. */
+typedef struct {
+    /** set to sizeof(LocMsgProfileInterface) */
+    size_t          size;
+    /** Fills in up to max_cnt stats, one per msg type seen so far,
+        and returns how many were filled in; or -1 if profiling is off. */
+    int (*get_stats)(LocMsgProfileStats* stats, int max_cnt);
+    /** Logs the profile right away. */
+    void (*dump)();
+} LocMsgProfileInterface;
+
+/** Name of the parsed NMEA extension, see LocNmeaParsedInterface */
+#define LOC_NMEA_PARSED_INTERFACE "loc-nmea-parsed"
+
+/** Sentences the modem provided NMEA is parsed into */
+typedef enum {
+    LOC_NMEA_SENTENCE_GGA = 0,
+    LOC_NMEA_SENTENCE_RMC,
+    LOC_NMEA_SENTENCE_GSA,
+    LOC_NMEA_SENTENCE_GSV,
+    LOC_NMEA_SENTENCE_GNS
+} LocNmeaSentenceType;
+
+/** Fields that were present in the sentence; empty ones leave their
+    flag clear and their value 0. */
+#define LOC_NMEA_HAS_TIME           0x0001
+#define LOC_NMEA_HAS_LAT_LONG       0x0002
+#define LOC_NMEA_HAS_ALTITUDE       0x0004
+#define LOC_NMEA_HAS_GEOID_SEP      0x0008
+#define LOC_NMEA_HAS_HDOP           0x0010
+#define LOC_NMEA_HAS_PDOP           0x0020
+#define LOC_NMEA_HAS_VDOP           0x0040
+#define LOC_NMEA_HAS_SPEED          0x0080
+#define LOC_NMEA_HAS_COURSE         0x0100
+#define LOC_NMEA_HAS_DATE           0x0200
+#define LOC_NMEA_HAS_MAG_VARIATION  0x0400
+#define LOC_NMEA_HAS_SV_USED        0x0800
+
+#define LOC_NMEA_GSA_MAX_SVS 12
+#define LOC_NMEA_GSV_MAX_SVS 4
+#define LOC_NMEA_GNS_MAX_MODES 8
+
+typedef struct {
+    /** UTC milliseconds into the day */
+    uint32_t        time_ms;
+    /** degrees, negative south and west */
+    double          latitude;
+    double          longitude;
+    /** 0 no fix, 1 GPS, 2 DGPS, ... */
+    uint8_t         quality;
+    uint8_t         sv_used;
+    float           hdop;
+    /** meters above mean sea level */
+    float           altitude;
+    float           geoid_separation;
+} LocNmeaGga;
+
+typedef struct {
+    uint32_t        time_ms;
+    /** 'A' valid, 'V' warning */
+    char            status;
+    double          latitude;
+    double          longitude;
+    float           speed_knots;
+    /** degrees true */
+    float           course;
+    uint16_t        year;
+    uint8_t         month;
+    uint8_t         day;
+    /** degrees, negative west */
+    float           mag_variation;
+    /** 'A' autonomous, 'D' differential, 'N' no fix, ..., 0 if absent */
+    char            mode;
+} LocNmeaRmc;
+
+typedef struct {
+    /** 'A' automatic, 'M' manual */
+    char            selection;
+    /** 1 no fix, 2 2D, 3 3D */
+    uint8_t         fix_type;
+    uint8_t         prn_cnt;
+    uint16_t        prns[LOC_NMEA_GSA_MAX_SVS];
+    float           pdop;
+    float           hdop;
+    float           vdop;
+} LocNmeaGsa;
+
+typedef struct {
+    uint16_t        prn;
+    /** degrees, -1 if absent */
+    int16_t         elevation;
+    int16_t         azimuth;
+    /** dB-Hz, -1 if not tracked */
+    int16_t         snr;
+} LocNmeaGsvSv;
+
+typedef struct {
+    uint8_t         sentence_cnt;
+    uint8_t         sentence_num;
+    uint16_t        sv_in_view;
+    uint8_t         sv_cnt;
+    LocNmeaGsvSv    svs[LOC_NMEA_GSV_MAX_SVS];
+} LocNmeaGsv;
+
+typedef struct {
+    uint32_t        time_ms;
+    double          latitude;
+    double          longitude;
+    /** one mode character per constellation, NUL terminated */
+    char            modes[LOC_NMEA_GNS_MAX_MODES + 1];
+    uint8_t         sv_used;
+    float           hdop;
+    float           altitude;
+    float           geoid_separation;
+} LocNmeaGns;
+
+/** One sentence from the modem, parsed. */
+typedef struct {
+    /** set to sizeof(LocNmeaParsed) */
+    size_t              size;
+    LocNmeaSentenceType type;
+    /** "GP", "GL", "GN", ... */
+    char                talker[3];
+    /** LOC_NMEA_HAS_* */
+    uint32_t            flags;
+    union {
+        LocNmeaGga      gga;
+        LocNmeaRmc      rmc;
+        LocNmeaGsa      gsa;
+        LocNmeaGsv      gsv;
+        LocNmeaGns      gns;
+    } u;
+} LocNmeaParsed;
+
+/** Called on the MsgTask thread for each modem provided sentence that
+    passed its checksum and is of a LocNmeaSentenceType; the pointer is
+    only valid during the call. */
+typedef void (*loc_nmea_parsed_callback)(const LocNmeaParsed* parsed);
+
+/** Extended interface for modem provided NMEA (NMEA_PROVIDER=1) parsed
+    into fields. */
+typedef struct {
+    /** set to sizeof(LocNmeaParsedInterface) */
+    size_t          size;
+    /** Starts delivering parsed sentences to cb, or stops if NULL. */
+    void (*init)(loc_nmea_parsed_callback cb);
+} LocNmeaParsedInterface;
+
+/** Name of the NMEA demand extension, see LocNmeaDemandInterface */
+#define LOC_NMEA_DEMAND_INTERFACE "loc-nmea-demand"
+
+/** Extended interface to stop NMEA generation (NMEA_PROVIDER=0) while
+    no one takes it. NMEA is generated while the framework listens
+    through nmea_cb, or any listener is added. */
+typedef struct {
+    /** set to sizeof(LocNmeaDemandInterface) */
+    size_t          size;
+    /** Whether the framework has NMEA listeners, assumed 1 until set. */
+    void (*set_listening)(int listening);
+    /** Count in / out a consumer of the generated NMEA other than the
+        framework. */
+    void (*add_listener)();
+    void (*remove_listener)();
+} LocNmeaDemandInterface;
+
 typedef uint32_t LOC_GPS_LOCK_MASK;
 #define isGpsLockNone(lock) ((lock) == 0)
 #define isGpsLockMO(lock) ((lock) & ((LOC_GPS_LOCK_MASK)1))
@@ -0,0 +1,229 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Latency of msgs queued behind bulk work on one MsgTask worker. A
+   producer keeps a backlog of busy msgs of one key in the Q while probe
+   msgs are sent every msec, and the time from send to proc() of the
+   probes is reported as p50 / p99, for:
+     - probes of another key in the normal lane, waiting out the backlog
+     - probes of another key in the high lane, overtaking it
+     - probes of the bulk key in the high lane, which must not overtake
+       it; the order every msg of that key is processed in is checked.
+     - probes of the bulk key in the high lane, with overtakable bulk
+       msgs, as an adapter sends XTRA data and then a fix start; they
+       overtake it, while the bulk msgs are checked to stay in order.
+   Usage: loc_msg_latency_bench [probes] [backlog] [busy usec] */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_msg_latency_bench"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <log_util.h>
+#include <MsgTask.h>
+
+using namespace loc_core;
+
+static const char bench_bulk_key = 0;
+static const char bench_probe_key = 0;
+
+static MsgTask* bench_task;
+static uint32_t bench_backlog = 64;
+static uint32_t bench_busy_usec = 50;
+static uint32_t bench_probes = 1000;
+
+// per case
+static uint32_t bench_probe_cnt;
+static uint64_t* bench_latency;
+static uint32_t bench_seq;
+static uint32_t bench_sent;
+static uint32_t bench_done;
+static uint32_t bench_stop;
+static uint32_t bench_next_seq;
+static uint32_t bench_out_of_order;
+static bool bench_overtakable;
+static pthread_mutex_t bench_send_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// msgs of the bulk key carry the order they were sent in
+static void bench_check_seq(uint32_t seq)
+{
+    if (seq != bench_next_seq) {
+        bench_out_of_order++;
+    }
+    bench_next_seq = seq + 1;
+}
+
+struct BenchBusyMsg : public LocMsg {
+    uint32_t mSeq;
+    inline BenchBusyMsg(uint32_t seq) : LocMsg(), mSeq(seq) {}
+    virtual void proc() const {
+        bench_check_seq(mSeq);
+        uint64_t end = bench_usec() + bench_busy_usec;
+        while (bench_usec() < end) {
+        }
+        __atomic_add_fetch(&bench_done, 1, __ATOMIC_RELEASE);
+    }
+    inline virtual bool overtakable() const { return bench_overtakable; }
+};
+
+struct BenchProbeMsg : public LocMsg {
+    const uint64_t mSendTime;
+    const msg_q_prio_type mPrio;
+    const uint32_t mSeq;
+    inline BenchProbeMsg(msg_q_prio_type prio, uint32_t seq) :
+        LocMsg(), mSendTime(bench_usec()), mPrio(prio), mSeq(seq) {}
+    virtual void proc() const {
+        if (0 != mSeq) {
+            bench_check_seq(mSeq);
+        }
+        bench_latency[bench_probe_cnt] = bench_usec() - mSendTime;
+        __atomic_add_fetch(&bench_probe_cnt, 1, __ATOMIC_RELEASE);
+    }
+    inline virtual msg_q_prio_type priority() const { return mPrio; }
+};
+
+// sends busy msgs, keeping bench_backlog of them in the Q
+static void* bench_producer(void*)
+{
+    while (!__atomic_load_n(&bench_stop, __ATOMIC_ACQUIRE)) {
+        if (bench_sent - __atomic_load_n(&bench_done, __ATOMIC_ACQUIRE) >=
+            bench_backlog) {
+            usleep(bench_busy_usec);
+            continue;
+        }
+        // the sequence numbers are drawn in the order msgs are sent
+        pthread_mutex_lock(&bench_send_mutex);
+        bench_task->sendMsg(new BenchBusyMsg(++bench_seq), &bench_bulk_key);
+        pthread_mutex_unlock(&bench_send_mutex);
+        bench_sent++;
+    }
+    return NULL;
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    uint64_t l = *(const uint64_t*)a;
+    uint64_t r = *(const uint64_t*)b;
+    return l < r ? -1 : l > r;
+}
+
+// returns the number of msgs of the bulk key processed out of order
+static uint32_t bench_run(const char* name, msg_q_prio_type prio,
+                          const void* key, bool overtakable)
+{
+    pthread_t producer;
+    uint32_t i;
+
+    bench_probe_cnt = 0;
+    bench_seq = 0;
+    bench_sent = 0;
+    bench_done = 0;
+    bench_stop = 0;
+    bench_next_seq = 1;
+    bench_out_of_order = 0;
+    bench_overtakable = overtakable;
+    pthread_create(&producer, NULL, bench_producer, NULL);
+    while (__atomic_load_n(&bench_done, __ATOMIC_ACQUIRE) < bench_backlog) {
+        usleep(1000);
+    }
+
+    for (i = 0; i < bench_probes; i++) {
+        usleep(1000);
+        pthread_mutex_lock(&bench_send_mutex);
+        // probes overtaking the bulk msgs are not in their sequence
+        bench_task->sendMsg(new BenchProbeMsg(prio, &bench_bulk_key == key &&
+                                              !overtakable ?
+                                              ++bench_seq : 0), key);
+        pthread_mutex_unlock(&bench_send_mutex);
+    }
+
+    __atomic_store_n(&bench_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(producer, NULL);
+    while (__atomic_load_n(&bench_probe_cnt, __ATOMIC_ACQUIRE) < bench_probes ||
+           __atomic_load_n(&bench_done, __ATOMIC_ACQUIRE) < bench_sent) {
+        usleep(1000);
+    }
+
+    qsort(bench_latency, bench_probes, sizeof(uint64_t), bench_compare);
+    printf("%-22s backlog %u x %u usec: p50 %llu usec, p99 %llu usec, "
+           "max %llu usec, %u out of order\n", name, bench_backlog,
+           bench_busy_usec,
+           (unsigned long long)bench_latency[bench_probes / 2],
+           (unsigned long long)bench_latency[bench_probes * 99 / 100],
+           (unsigned long long)bench_latency[bench_probes - 1],
+           bench_out_of_order);
+    return bench_out_of_order;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        bench_probes = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        bench_backlog = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        bench_busy_usec = atoi(argv[3]);
+    }
+    if (bench_probes < 1 || bench_backlog < 1) {
+        fprintf(stderr, "usage: %s [probes] [backlog] [busy usec]\n",
+                argv[0]);
+        return 1;
+    }
+
+    loc_logger_init(2, 0);
+    bench_latency = (uint64_t*)calloc(bench_probes, sizeof(uint64_t));
+    bench_task = new MsgTask((MsgTask::tAssociate)NULL, "latency_bench");
+    if (NULL == bench_latency) {
+        return 1;
+    }
+
+    uint32_t errors = bench_run("other key, normal lane", eMSG_Q_PRIO_NORMAL,
+                                &bench_probe_key, false);
+    errors += bench_run("other key, high lane", eMSG_Q_PRIO_HIGH,
+                        &bench_probe_key, false);
+    errors += bench_run("same key, high lane", eMSG_Q_PRIO_HIGH,
+                        &bench_bulk_key, false);
+    errors += bench_run("same key, overtakable", eMSG_Q_PRIO_HIGH,
+                        &bench_bulk_key, true);
+
+    free(bench_latency);
+    return errors != 0;
+}
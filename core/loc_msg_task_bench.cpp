@@ -0,0 +1,106 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* MsgTask throughput with logging on. Sends msgs that log a line each
+   when processed, as reports do, on top of what the Q logs per msg, and
+   reports msgs per second, with the messages formatted where they are
+   logged (ring 0) or through the log ring. The time to flush the ring
+   afterwards is reported on its own.
+   Usage: loc_msg_task_bench [msgs] [workers] [debug level] [ring size]
+                             [log file] */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_msg_task_bench"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <log_util.h>
+#include <MsgTask.h>
+
+using namespace loc_core;
+
+static uint32_t bench_done = 0;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct BenchReportMsg : public LocMsg {
+    uint32_t mSeq;
+    double mLatitude;
+    double mLongitude;
+    inline BenchReportMsg(uint32_t seq) :
+        LocMsg(), mSeq(seq),
+        mLatitude(37.0 + seq * 1e-7), mLongitude(-122.0 - seq * 1e-7) {}
+    virtual void proc() const {
+        LOC_LOGD("%s] report %u: lat %.7f lon %.7f from %s, flags 0x%04X",
+                 __func__, mSeq, mLatitude, mLongitude, "bench", mSeq & 0xFFFF);
+        __atomic_add_fetch(&bench_done, 1, __ATOMIC_RELAXED);
+    }
+};
+
+int main(int argc, char** argv)
+{
+    uint32_t msgs = argc > 1 ? atoi(argv[1]) : 200000;
+    uint32_t workers = argc > 2 ? atoi(argv[2]) : 2;
+    unsigned long level = argc > 3 ? atoi(argv[3]) : 4;
+    unsigned long ringSize = argc > 4 ? atoi(argv[4]) : 0;
+    const char* file = argc > 5 ? argv[5] : NULL;
+
+    loc_logger_init(level, 0);
+    loc_log_ring_init(ringSize, file);
+
+    MsgTask* task = new MsgTask((MsgTask::tAssociate)NULL, "bench", workers);
+    static const char keys[MAX_MSG_TASK_WORKERS] = { 0 };
+
+    uint64_t start = bench_usec();
+    for (uint32_t i = 0; i < msgs; i++) {
+        task->sendMsg(new BenchReportMsg(i), &keys[i % MAX_MSG_TASK_WORKERS]);
+    }
+    while (__atomic_load_n(&bench_done, __ATOMIC_RELAXED) < msgs) {
+        usleep(1000);
+    }
+    uint64_t usec = bench_usec() - start;
+
+    start = bench_usec();
+    loc_log_ring_flush();
+    uint64_t flushUsec = bench_usec() - start;
+
+    printf("%u msgs, %u workers, DEBUG_LEVEL %lu, ring %lu: %llu usec, "
+           "%llu msgs/sec, flush %llu usec\n", msgs, workers, level, ringSize,
+           (unsigned long long)usec,
+           (unsigned long long)(usec > 0 ? (uint64_t)msgs * 1000000 / usec : 0),
+           (unsigned long long)flushUsec);
+    return 0;
+}
@@ -856,6 +856,16 @@ void LocApiRpc::reportSv(const rpc_loc_gnss_info_s_type *gnss_report_ptr)
                 else if (sv_info_ptr->system == RPC_LOC_SV_SYSTEM_GLONASS)
                 {
                     SvStatus.sv_list[SvStatus.num_svs].prn = sv_info_ptr->prn + (65-1);
+
+                    // used_in_fix_mask is GPS only, GLONASS goes in the extended report
+                    if ((sv_info_ptr->valid_mask & RPC_LOC_SV_INFO_VALID_PROCESS_STATUS) &&
+                        (sv_info_ptr->process_status == RPC_LOC_SV_STATUS_TRACK) &&
+                        sv_info_ptr->prn >= 1 && sv_info_ptr->prn <= 64)
+                    {
+                        locationExtended.flags |= GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA;
+                        locationExtended.gnss_sv_used_ids.glo_sv_used_ids_mask |=
+                            1ULL << (sv_info_ptr->prn-1);
+                    }
                 }
                 // Unsupported SV system
                 else
@@ -25,6 +25,11 @@ LOCAL_SRC_FILES += \
     loc_eng_ni.cpp \
     loc_eng_log.cpp \
     loc_eng_nmea.cpp \
+    loc_eng_nmea_writer.cpp \
+    loc_eng_nmea_parser.cpp \
+    loc_eng_nmea_server.cpp \
+    loc_eng_conf.cpp \
+    loc_eng_conf_watcher.cpp \
     LocEngAdapter.cpp
 
 LOCAL_SRC_FILES += \
@@ -114,4 +119,160 @@ LOCAL_MODULE_RELATIVE_PATH := hw
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    loc_eng_nmea_bench.cpp \
+    loc_eng_nmea_writer.cpp
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    hardware/qcom/gps/loc_api/libloc_api_50001
+
+LOCAL_MODULE := loc_eng_nmea_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    loc_eng_nmea_parse_bench.cpp \
+    loc_eng_nmea_parser.cpp \
+    loc_eng_nmea_writer.cpp
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    hardware/qcom/gps/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/libloc_core
+
+LOCAL_MODULE := loc_eng_nmea_parse_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libgps.utils
+
+LOCAL_SRC_FILES := \
+    loc_eng_nmea_server_bench.cpp \
+    loc_eng_nmea_server.cpp \
+    loc_eng_nmea_writer.cpp \
+    loc_eng_dmn_conn_thread_helper.c
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    hardware/qcom/gps/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+LOCAL_MODULE := loc_eng_nmea_server_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libgps.utils \
+    libloc_core
+
+LOCAL_SRC_FILES := \
+    loc_eng_conf_stress.cpp \
+    loc_eng_conf.cpp
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    hardware/qcom/gps/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_core
+
+LOCAL_MODULE := loc_eng_conf_stress
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libdl \
+    libloc_eng \
+    libloc_core \
+    libgps.utils
+
+LOCAL_SRC_FILES := \
+    loc_eng_ni_stress.cpp
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+# for ContextBase to find the getLBSProxy of the stress test
+LOCAL_LDFLAGS += -Wl,--export-dynamic
+
+LOCAL_C_INCLUDES:= \
+    hardware/qcom/gps/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_core
+
+LOCAL_MODULE := loc_eng_ni_stress
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libdl \
+    libloc_eng \
+    libloc_core \
+    libgps.utils
+
+LOCAL_SRC_FILES := \
+    loc_eng_nmea_golden.cpp
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+# for ContextBase to find the getLBSProxy of the check
+LOCAL_LDFLAGS += -Wl,--export-dynamic
+
+LOCAL_C_INCLUDES:= \
+    hardware/qcom/gps/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_core
+
+LOCAL_MODULE := loc_eng_nmea_golden
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
 endif # not BUILD_TINY_ANDROID
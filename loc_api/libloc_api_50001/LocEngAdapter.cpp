@@ -41,20 +41,20 @@ LocInternalAdapter::LocInternalAdapter(LocEngAdapter* adapter) :
 {
 }
 void LocInternalAdapter::setPositionModeInt(LocPosMode& posMode) {
-    sendMsg(new LocEngPositionMode(mLocEngAdapter, posMode));
+    mLocEngAdapter->sendMsg(new LocEngPositionMode(mLocEngAdapter, posMode));
 }
 void LocInternalAdapter::startFixInt() {
-    sendMsg(new LocEngStartFix(mLocEngAdapter));
+    mLocEngAdapter->sendMsg(new LocEngStartFix(mLocEngAdapter));
 }
 void LocInternalAdapter::stopFixInt() {
-    sendMsg(new LocEngStopFix(mLocEngAdapter));
+    mLocEngAdapter->sendMsg(new LocEngStopFix(mLocEngAdapter));
 }
 void LocInternalAdapter::getZppInt() {
-    sendMsg(new LocEngGetZpp(mLocEngAdapter));
+    mLocEngAdapter->sendMsg(new LocEngGetZpp(mLocEngAdapter));
 }
 
 void LocInternalAdapter::shutdown() {
-    sendMsg(new LocEngShutdown(mLocEngAdapter));
+    mLocEngAdapter->sendMsg(new LocEngShutdown(mLocEngAdapter));
 }
 
 LocEngAdapter::LocEngAdapter(LOC_API_ADAPTER_EVENT_MASK_T mask,
@@ -93,6 +93,7 @@ void LocInternalAdapter::setUlpProxy(UlpProxyBase* ulp) {
         inline LocSetUlpProxy(LocAdapterBase* adapter, UlpProxyBase* ulp) :
             LocMsg(), mAdapter(adapter), mUlp(ulp) {
         }
+        inline virtual const char* name() const { return "LocSetUlpProxy"; }
         virtual void proc() const {
             LOC_LOGV("%s] ulp %p adapter %p", __func__,
                      mUlp, mAdapter);
@@ -100,7 +101,7 @@ void LocInternalAdapter::setUlpProxy(UlpProxyBase* ulp) {
         }
     };
 
-    sendMsg(new LocSetUlpProxy(mLocEngAdapter, ulp));
+    mLocEngAdapter->sendMsg(new LocSetUlpProxy(mLocEngAdapter, ulp));
 }
 
 void LocEngAdapter::setUlpProxy(UlpProxyBase* ulp)
@@ -140,6 +141,9 @@ int LocEngAdapter::setGpsLockMsg(LOC_GPS_LOCK_MASK lockMask)
         {
             locallog();
         }
+        inline virtual const char* name() const {
+            return "LocEngAdapterGpsLock";
+        }
         inline virtual void proc() const {
             mAdapter->setGpsLock(mLockMask);
         }
@@ -175,12 +179,12 @@ void LocInternalAdapter::reportPosition(UlpLocation &location,
                                         enum loc_sess_status status,
                                         LocPosTechMask loc_technology_mask)
 {
-    sendMsg(new LocEngReportPosition(mLocEngAdapter,
-                                     location,
-                                     locationExtended,
-                                     locationExt,
-                                     status,
-                                     loc_technology_mask));
+    mLocEngAdapter->sendMsg(new LocEngReportPosition(mLocEngAdapter,
+                                                     location,
+                                                     locationExtended,
+                                                     locationExt,
+                                                     status,
+                                                     loc_technology_mask));
 }
 
 
@@ -206,8 +210,8 @@ void LocEngAdapter::reportPosition(UlpLocation &location,
 void LocInternalAdapter::reportSv(GpsSvStatus &svStatus,
                                   GpsLocationExtended &locationExtended,
                                   void* svExt){
-    sendMsg(new LocEngReportSv(mLocEngAdapter, svStatus,
-                               locationExtended, svExt));
+    mLocEngAdapter->sendMsg(new LocEngReportSv(mLocEngAdapter, svStatus,
+                                               locationExtended, svExt));
 }
 
 void LocEngAdapter::reportSv(GpsSvStatus &svStatus,
@@ -234,7 +238,7 @@ void LocEngAdapter::setInSession(bool inSession)
 
 void LocInternalAdapter::reportStatus(GpsStatusValue status)
 {
-    sendMsg(new LocEngReportStatus(mLocEngAdapter, status));
+    mLocEngAdapter->sendMsg(new LocEngReportStatus(mLocEngAdapter, status));
 }
 
 void LocEngAdapter::reportStatus(GpsStatusValue status)
@@ -81,6 +81,10 @@ class LocEngAdapter : public LocAdapterBase {
     unsigned int mPowerVote;
     static const unsigned int POWER_VOTE_RIGHT = 0x20;
     static const unsigned int POWER_VOTE_VALUE = 0x10;
+    // latest value slots, so a backed up Q holds at most one
+    // stale position / SV report at a time
+    LocMsgSlot mPositionSlot;
+    LocMsgSlot mSvSlot;
 
 public:
     bool mSupportsAgpsRequests;
@@ -106,6 +110,8 @@ public:
         return mContext->hasCPIExtendedCapabilities();
     }
     inline const MsgTask* getMsgTask() { return mMsgTask; }
+    inline LocMsgSlot* getPositionSlot() { return &mPositionSlot; }
+    inline LocMsgSlot* getSvSlot() { return &mSvSlot; }
 
     inline enum loc_api_adapter_err
         startFix()
@@ -200,6 +200,36 @@ static const GnssConfigurationInterface sLocEngConfigInterface =
     loc_configuration_update
 };
 
+static int  loc_msg_profile_get_stats(LocMsgProfileStats* stats, int max_cnt);
+static void loc_msg_profile_dump();
+
+static const LocMsgProfileInterface sLocEngMsgProfileInterface =
+{
+    sizeof(LocMsgProfileInterface),
+    loc_msg_profile_get_stats,
+    loc_msg_profile_dump
+};
+
+static void loc_nmea_parsed_init(loc_nmea_parsed_callback callback);
+
+static const LocNmeaParsedInterface sLocEngNmeaParsedInterface =
+{
+    sizeof(LocNmeaParsedInterface),
+    loc_nmea_parsed_init
+};
+
+static void loc_nmea_set_listening(int listening);
+static void loc_nmea_add_listener();
+static void loc_nmea_remove_listener();
+
+static const LocNmeaDemandInterface sLocEngNmeaDemandInterface =
+{
+    sizeof(LocNmeaDemandInterface),
+    loc_nmea_set_listening,
+    loc_nmea_add_listener,
+    loc_nmea_remove_listener
+};
+
 static loc_eng_data_s_type loc_afw_data;
 static int gss_fd = -1;
 
@@ -260,7 +290,9 @@ extern "C" const GpsInterface* get_gps_interface()
     case GNSS_GSS:
     case GNSS_AUTO:
         //APQ8064
+        loc_eng_conf_lock();
         gps_conf.CAPABILITIES &= ~(GPS_CAPABILITY_MSA | GPS_CAPABILITY_MSB);
+        loc_eng_conf_publish();
         gss_fd = open("/dev/gss", O_RDONLY);
         if (gss_fd < 0) {
             LOC_LOGE("GSS open failed: %s\n", strerror(errno));
@@ -276,7 +308,9 @@ extern "C" const GpsInterface* get_gps_interface()
         return NULL;
     case GNSS_QCA1530:
         // qca1530 chip is present
+        loc_eng_conf_lock();
         gps_conf.CAPABILITIES &= ~(GPS_CAPABILITY_MSA | GPS_CAPABILITY_MSB);
+        loc_eng_conf_publish();
         LOC_LOGD("qca1530 present: CAPABILITIES %0lx\n", gps_conf.CAPABILITIES);
         break;
     }
@@ -506,7 +540,10 @@ static void loc_cleanup()
     ENTRY_LOG();
 
     loc_afw_data.adapter->setPowerVote(false);
-    loc_afw_data.adapter->setGpsLockMsg(gps_conf.GPS_LOCK);
+    loc_eng_conf_lock();
+    LOC_GPS_LOCK_MASK gpsLock = gps_conf.GPS_LOCK;
+    loc_eng_conf_unlock();
+    loc_afw_data.adapter->setGpsLockMsg(gpsLock);
 
     loc_eng_cleanup(loc_afw_data);
     loc_close_mdm_node();
@@ -775,7 +812,10 @@ const void* loc_get_extension(const char* name)
    }
    else if (strcmp(name, GPS_GEOFENCING_INTERFACE) == 0)
    {
-       if ((gps_conf.CAPABILITIES | GPS_CAPABILITY_GEOFENCING) == gps_conf.CAPABILITIES ){
+       loc_eng_conf_lock();
+       bool geofencing = (gps_conf.CAPABILITIES & GPS_CAPABILITY_GEOFENCING) != 0;
+       loc_eng_conf_unlock();
+       if (geofencing) {
            ret_val = get_geofence_interface();
        }
    }
@@ -791,6 +831,18 @@ const void* loc_get_extension(const char* name)
    {
        ret_val = &sLocEngGpsMeasurementInterface;
    }
+   else if (strcmp(name, LOC_MSG_PROFILE_INTERFACE) == 0)
+   {
+       ret_val = &sLocEngMsgProfileInterface;
+   }
+   else if (strcmp(name, LOC_NMEA_PARSED_INTERFACE) == 0)
+   {
+       ret_val = &sLocEngNmeaParsedInterface;
+   }
+   else if (strcmp(name, LOC_NMEA_DEMAND_INTERFACE) == 0)
+   {
+       ret_val = &sLocEngNmeaDemandInterface;
+   }
    else
    {
       LOC_LOGE ("get_extension: Invalid interface passed in\n");
@@ -1150,6 +1202,49 @@ static void loc_configuration_update(const char* config_data, int32_t length)
     EXIT_LOG(%s, VOID_RET);
 }
 
+static int loc_msg_profile_get_stats(LocMsgProfileStats* stats, int max_cnt)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_msg_profile_get_stats(loc_afw_data, stats, max_cnt);
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+static void loc_msg_profile_dump()
+{
+    ENTRY_LOG();
+    loc_eng_msg_profile_dump(loc_afw_data);
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_nmea_parsed_init(loc_nmea_parsed_callback callback)
+{
+    ENTRY_LOG();
+    loc_eng_nmea_parsed_init(loc_afw_data, callback);
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_nmea_set_listening(int listening)
+{
+    ENTRY_LOG();
+    loc_eng_nmea_set_listening(loc_afw_data, listening);
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_nmea_add_listener()
+{
+    ENTRY_LOG();
+    loc_eng_nmea_add_listener(loc_afw_data);
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_nmea_remove_listener()
+{
+    ENTRY_LOG();
+    loc_eng_nmea_remove_listener(loc_afw_data);
+    EXIT_LOG(%s, VOID_RET);
+}
+
 static void local_loc_cb(UlpLocation* location, void* locExt)
 {
     ENTRY_LOG();
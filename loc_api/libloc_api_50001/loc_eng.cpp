@@ -37,6 +37,7 @@
 #include <dlfcn.h>
 #include <ctype.h>
 #include <math.h>
+#include <float.h>
 #include <pthread.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>         /* struct sockaddr_in */
@@ -44,6 +45,7 @@
 #include <sys/time.h>
 #include <netdb.h>
 #include <time.h>
+#include <errno.h>
 #include <new>
 #include <LocEngAdapter.h>
 
@@ -66,6 +68,9 @@
 #include <loc_eng_dmn_conn_handler.h>
 #include <loc_eng_msg.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_nmea_server.h>
+#include <loc_eng_conf_watcher.h>
+#include <loc_eng_nmea_parser.h>
 #include <msg_q.h>
 #include <loc.h>
 #include "log_util.h"
@@ -93,96 +98,95 @@ unsigned int agpsStatus = 0;
 loc_gps_cfg_s_type gps_conf;
 loc_sap_cfg_s_type sap_conf;
 
-/* Parameter spec table */
-static loc_param_s_type gps_conf_table[] =
-{
-  {"GPS_LOCK",                       &gps_conf.GPS_LOCK,                       NULL, 'n'},
-  {"SUPL_VER",                       &gps_conf.SUPL_VER,                       NULL, 'n'},
-  {"LPP_PROFILE",                    &gps_conf.LPP_PROFILE,                    NULL, 'n'},
-  {"A_GLONASS_POS_PROTOCOL_SELECT",  &gps_conf.A_GLONASS_POS_PROTOCOL_SELECT,  NULL, 'n'},
-  {"AGPS_CERT_WRITABLE_MASK",        &gps_conf.AGPS_CERT_WRITABLE_MASK,        NULL, 'n'},
-  {"SUPL_MODE",                      &gps_conf.SUPL_MODE,                      NULL, 'n'},
-  {"INTERMEDIATE_POS",               &gps_conf.INTERMEDIATE_POS,               NULL, 'n'},
-  {"ACCURACY_THRES",                 &gps_conf.ACCURACY_THRES,                 NULL, 'n'},
-  {"NMEA_PROVIDER",                  &gps_conf.NMEA_PROVIDER,                  NULL, 'n'},
-  {"CAPABILITIES",                   &gps_conf.CAPABILITIES,                   NULL, 'n'},
-  {"XTRA_VERSION_CHECK",             &gps_conf.XTRA_VERSION_CHECK,             NULL, 'n'},
-  {"XTRA_SERVER_1",                  &gps_conf.XTRA_SERVER_1,                  NULL, 's'},
-  {"XTRA_SERVER_2",                  &gps_conf.XTRA_SERVER_2,                  NULL, 's'},
-  {"XTRA_SERVER_3",                  &gps_conf.XTRA_SERVER_3,                  NULL, 's'},
-  {"USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL",  &gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL,          NULL, 'n'},
+/* Parameter schemas, with the defaults the configuration files override */
+static const loc_param_schema_s_type gps_conf_params[] =
+{
+  /*Nothing is locked when the user turns GPS off; 0x1 locks MO, 0x2 NI*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, GPS_LOCK,                       0,       0, 0x3),
+  LOC_PARAM(loc_gps_cfg_s_type,       SUPL_VER,                       0x10000),
+  /* LTE Positioning Profile configuration is disable by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, LPP_PROFILE,                    0,       0, 3),
+  /*By default no positioning protocol is selected on A-GLONASS system*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, A_GLONASS_POS_PROTOCOL_SELECT,  0,       0, 0x7),
+  /* None of the 10 slots for agps certificates are writable by default */
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, AGPS_CERT_WRITABLE_MASK,        0,       0, 0x3FF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, SUPL_MODE,                      0x3,     0, 0x3),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, INTERMEDIATE_POS,               0,       0, 1),
+  LOC_PARAM(loc_gps_cfg_s_type,       ACCURACY_THRES,                 0),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_PROVIDER,                  0,       0, 1),
+  LOC_PARAM(loc_gps_cfg_s_type,       CAPABILITIES,                   0x7),
+  /*XTRA version check is disabled by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, XTRA_VERSION_CHECK,             0,       0, 3),
+  LOC_PARAM_STRING(loc_gps_cfg_s_type, XTRA_SERVER_1,                 ""),
+  LOC_PARAM_STRING(loc_gps_cfg_s_type, XTRA_SERVER_2,                 ""),
+  LOC_PARAM_STRING(loc_gps_cfg_s_type, XTRA_SERVER_3,                 ""),
+  /*Use emergency PDN by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL, 1, 0, 1),
+  /*MsgTask profiling is off by default, and dumped every minute if on*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, MSG_PROFILING,                  0,       0, 1),
+  LOC_PARAM(loc_gps_cfg_s_type,       MSG_PROFILING_DUMP_INTERVAL,    60),
+  /*A single MsgTask worker thread by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, MSG_TASK_WORKERS,               1,       1, MAX_MSG_TASK_WORKERS),
+  /*MsgTask queues are unbounded by default*/
+  LOC_PARAM(loc_gps_cfg_s_type,       MSG_Q_CAPACITY,                 0),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, MSG_Q_OVERFLOW_POLICY,          eMSG_Q_OVERFLOW_BLOCK,
+                  eMSG_Q_OVERFLOW_BLOCK, eMSG_Q_OVERFLOW_REJECT),
+  /*Each NMEA sentence goes out in its own nmea_cb by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_EPOCH_BATCH,               0,       0, 1),
+  /*All NMEA sentences, every epoch, by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_SENTENCE_MASK,             LOC_NMEA_MASK_ALL, 0, LOC_NMEA_MASK_ALL),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_GSA_DECIMATION,            1,       1, 0xFFFFFFFF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_VTG_DECIMATION,            1,       1, 0xFFFFFFFF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_RMC_DECIMATION,            1,       1, 0xFFFFFFFF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_GGA_DECIMATION,            1,       1, 0xFFFFFFFF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_GSV_DECIMATION,            1,       1, 0xFFFFFFFF),
+  /*No NMEA socket server by default*/
+  LOC_PARAM_STRING(loc_gps_cfg_s_type, NMEA_SERVER_SOCKET,            ""),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_SERVER_MAX_CLIENTS,        16,      1, 0xFFFFFFFF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_SERVER_CLIENT_BUFFER,      16384,   1, 0xFFFFFFFF),
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, NMEA_SERVER_SLOW_CLIENT,        NMEA_SERVER_SLOW_CLIENT_DROP,
+                  NMEA_SERVER_SLOW_CLIENT_DROP, NMEA_SERVER_SLOW_CLIENT_DISCONNECT),
+  /*Configuration files are only read at start up by default*/
+  LOC_PARAM_RANGE(loc_gps_cfg_s_type, CONF_HOT_RELOAD,                0,       0, 1),
+  LOC_PARAM(loc_gps_cfg_s_type,       CONF_RELOAD_DEBOUNCE_MS,        500),
 };
 
-static loc_param_s_type sap_conf_table[] =
-{
-  {"GYRO_BIAS_RANDOM_WALK",          &sap_conf.GYRO_BIAS_RANDOM_WALK,          &sap_conf.GYRO_BIAS_RANDOM_WALK_VALID, 'f'},
-  {"ACCEL_RANDOM_WALK_SPECTRAL_DENSITY",     &sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,    &sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"ANGLE_RANDOM_WALK_SPECTRAL_DENSITY",     &sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,    &sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"RATE_RANDOM_WALK_SPECTRAL_DENSITY",      &sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,     &sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY",  &sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY, &sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"SENSOR_ACCEL_BATCHES_PER_SEC",   &sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC,   NULL, 'n'},
-  {"SENSOR_ACCEL_SAMPLES_PER_BATCH", &sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH, NULL, 'n'},
-  {"SENSOR_GYRO_BATCHES_PER_SEC",    &sap_conf.SENSOR_GYRO_BATCHES_PER_SEC,    NULL, 'n'},
-  {"SENSOR_GYRO_SAMPLES_PER_BATCH",  &sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH,  NULL, 'n'},
-  {"SENSOR_ACCEL_BATCHES_PER_SEC_HIGH",   &sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,   NULL, 'n'},
-  {"SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH", &sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH, NULL, 'n'},
-  {"SENSOR_GYRO_BATCHES_PER_SEC_HIGH",    &sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,    NULL, 'n'},
-  {"SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH",  &sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,  NULL, 'n'},
-  {"SENSOR_CONTROL_MODE",            &sap_conf.SENSOR_CONTROL_MODE,            NULL, 'n'},
-  {"SENSOR_USAGE",                   &sap_conf.SENSOR_USAGE,                   NULL, 'n'},
-  {"SENSOR_ALGORITHM_CONFIG_MASK",   &sap_conf.SENSOR_ALGORITHM_CONFIG_MASK,   NULL, 'n'},
-  {"SENSOR_PROVIDER",                &sap_conf.SENSOR_PROVIDER,                NULL, 'n'}
+static const loc_param_schema_s_type sap_conf_params[] =
+{
+  /* Values MUST be set by OEMs in configuration for sensor-assisted
+     navigation to work. There are NO default values */
+  LOC_PARAM_VALID(loc_sap_cfg_s_type, GYRO_BIAS_RANDOM_WALK,
+                  GYRO_BIAS_RANDOM_WALK_VALID,                        0,       0, DBL_MAX),
+  LOC_PARAM_VALID(loc_sap_cfg_s_type, ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
+                  ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,           0,       0, DBL_MAX),
+  LOC_PARAM_VALID(loc_sap_cfg_s_type, ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
+                  ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,           0,       0, DBL_MAX),
+  LOC_PARAM_VALID(loc_sap_cfg_s_type, RATE_RANDOM_WALK_SPECTRAL_DENSITY,
+                  RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,            0,       0, DBL_MAX),
+  LOC_PARAM_VALID(loc_sap_cfg_s_type, VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY,
+                  VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,        0,       0, DBL_MAX),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_ACCEL_BATCHES_PER_SEC,   2),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_ACCEL_SAMPLES_PER_BATCH, 5),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_GYRO_BATCHES_PER_SEC,    2),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_GYRO_SAMPLES_PER_BATCH,  5),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,   4),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH, 25),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_GYRO_BATCHES_PER_SEC_HIGH,    4),
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,  25),
+  /* AUTO */
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_CONTROL_MODE,            0),
+  /* Enabled */
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_USAGE,                   0),
+  /* INS Disabled = FALSE*/
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_ALGORITHM_CONFIG_MASK,   0),
+  /* default provider is SSC */
+  LOC_PARAM(loc_sap_cfg_s_type,       SENSOR_PROVIDER,                1),
 };
 
-static void loc_default_parameters(void)
-{
-   /*Defaults for gps.conf*/
-   gps_conf.INTERMEDIATE_POS = 0;
-   gps_conf.ACCURACY_THRES = 0;
-   gps_conf.NMEA_PROVIDER = 0;
-   gps_conf.GPS_LOCK = 0;
-   gps_conf.SUPL_VER = 0x10000;
-   gps_conf.SUPL_MODE = 0x3;
-   gps_conf.CAPABILITIES = 0x7;
-   /* LTE Positioning Profile configuration is disable by default*/
-   gps_conf.LPP_PROFILE = 0;
-   /*By default no positioning protocol is selected on A-GLONASS system*/
-   gps_conf.A_GLONASS_POS_PROTOCOL_SELECT = 0;
-   /*XTRA version check is disabled by default*/
-   gps_conf.XTRA_VERSION_CHECK=0;
-   /*Use emergency PDN by default*/
-   gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL = 1;
-
-   /*Defaults for sap.conf*/
-   sap_conf.GYRO_BIAS_RANDOM_WALK = 0;
-   sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC = 2;
-   sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH = 5;
-   sap_conf.SENSOR_GYRO_BATCHES_PER_SEC = 2;
-   sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH = 5;
-   sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH = 4;
-   sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH = 25;
-   sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH = 4;
-   sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH = 25;
-   sap_conf.SENSOR_CONTROL_MODE = 0; /* AUTO */
-   sap_conf.SENSOR_USAGE = 0; /* Enabled */
-   sap_conf.SENSOR_ALGORITHM_CONFIG_MASK = 0; /* INS Disabled = FALSE*/
-   /* Values MUST be set by OEMs in configuration for sensor-assisted
-      navigation to work. There are NO default values */
-   sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.GYRO_BIAS_RANDOM_WALK_VALID = 0;
-   sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   /* default provider is SSC */
-   sap_conf.SENSOR_PROVIDER = 1;
-
-   /* None of the 10 slots for agps certificates are writable by default */
-   gps_conf.AGPS_CERT_WRITABLE_MASK = 0;
-}
+static const LocConfSchema gps_conf_schema(
+    gps_conf_params, sizeof(gps_conf_params) / sizeof(gps_conf_params[0]));
+static const LocConfSchema sap_conf_schema(
+    sap_conf_params, sizeof(sap_conf_params) / sizeof(sap_conf_params[0]));
 
 // 2nd half of init(), singled out for
 // modem restart to use.
@@ -210,6 +214,7 @@ static void deleteAidingData(loc_eng_data_s_type &logEng);
 static AgpsStateMachine*
 getAgpsStateMachine(loc_eng_data_s_type& logEng, AGpsExtType agpsType);
 static int dataCallCb(void *cb_data);
+static void loc_eng_nmea_server_demand(void* context, int listening);
 static void update_aiding_data_for_deletion(loc_eng_data_s_type& loc_eng_data) {
     if (loc_eng_data.engine_status != GPS_STATUS_ENGINE_ON &&
         loc_eng_data.aiding_data_for_deletion != 0)
@@ -379,6 +384,7 @@ struct LocEngSetTime : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngSetTime"; }
     inline virtual void proc() const {
         mAdapter->setTime(mTime, mTimeReference, mUncertainty);
     }
@@ -404,6 +410,7 @@ struct LocEngInjectLocation : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngInjectLocation"; }
     inline virtual void proc() const {
         mAdapter->injectPosition(mLatitude, mLongitude, mAccuracy);
     }
@@ -431,6 +438,7 @@ struct LocEngSetServerIpv4 : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngSetServerIpv4"; }
     inline virtual void proc() const {
         mAdapter->setServer(mNlAddr, mPort, mServerType);
     }
@@ -462,6 +470,7 @@ struct LocEngSetServerUrl : public LocMsg {
     {
         delete[] mUrl;
     }
+    inline virtual const char* name() const { return "LocEngSetServerUrl"; }
     inline virtual void proc() const {
         mAdapter->setServer(mUrl, mLen);
     }
@@ -483,6 +492,7 @@ struct LocEngAGlonassProtocol : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngAGlonassProtocol"; }
     inline virtual void proc() const {
         mAdapter->setAGLONASSProtocol(mAGlonassProtocl);
     }
@@ -504,6 +514,7 @@ struct LocEngSuplVer : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngSuplVer"; }
     inline virtual void proc() const {
         mAdapter->setSUPLVersion(mSuplVer);
     }
@@ -515,6 +526,117 @@ struct LocEngSuplVer : public LocMsg {
     }
 };
 
+struct LocEngNmeaConfig : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const uint32_t mSentenceMask;
+    uint32_t mDecimation[LOC_NMEA_SENTENCE_TYPES];
+    inline LocEngNmeaConfig(loc_eng_data_s_type* locEng,
+                            const loc_gps_cfg_s_type& conf) :
+        LocMsg(), mLocEng(locEng), mSentenceMask(conf.NMEA_SENTENCE_MASK)
+    {
+        mDecimation[0] = conf.NMEA_GSA_DECIMATION;
+        mDecimation[1] = conf.NMEA_VTG_DECIMATION;
+        mDecimation[2] = conf.NMEA_RMC_DECIMATION;
+        mDecimation[3] = conf.NMEA_GGA_DECIMATION;
+        mDecimation[4] = conf.NMEA_GSV_DECIMATION;
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngNmeaConfig"; }
+    inline virtual void proc() const {
+        loc_eng_nmea_config(mLocEng, mSentenceMask, mDecimation);
+    }
+    inline  void locallog() const {
+        LOC_LOGV("NMEA sentence mask: 0x%X", mSentenceMask);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+struct LocEngNmeaDemand : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int mListenerDelta;
+    const int mFrameworkListening;
+    inline LocEngNmeaDemand(loc_eng_data_s_type* locEng,
+                            int listenerDelta, int frameworkListening) :
+        LocMsg(), mLocEng(locEng), mListenerDelta(listenerDelta),
+        mFrameworkListening(frameworkListening)
+    {
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngNmeaDemand"; }
+    inline virtual void proc() const {
+        loc_eng_nmea_demand(mLocEng, mListenerDelta, mFrameworkListening);
+    }
+    inline  void locallog() const {
+        LOC_LOGV("NMEA listeners %+d, framework listening: %d",
+                 mListenerDelta, mFrameworkListening);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+// nmea_parsed_cb is read on the MsgTask as each NMEA report comes in
+struct LocEngNmeaParsed : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const loc_nmea_parsed_callback mCallback;
+    inline LocEngNmeaParsed(loc_eng_data_s_type* locEng,
+                            loc_nmea_parsed_callback callback) :
+        LocMsg(), mLocEng(locEng), mCallback(callback)
+    {
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngNmeaParsed"; }
+    inline virtual void proc() const {
+        mLocEng->nmea_parsed_cb = mCallback;
+    }
+    inline  void locallog() const {
+        LOC_LOGV("NMEA parsed callback %s", NULL != mCallback ? "set" : "cleared");
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+// the NMEA server is started and stopped on the MsgTask, where NMEA is
+// published to it, so no publish is ever under way as it stops
+struct LocEngNmeaServer : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const bool mStart;
+    const gps_create_thread mCreateThread;
+    inline LocEngNmeaServer(loc_eng_data_s_type* locEng, bool start,
+                            gps_create_thread createThread) :
+        LocMsg(), mLocEng(locEng), mStart(start), mCreateThread(createThread)
+    {
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngNmeaServer"; }
+    inline virtual void proc() const {
+        const loc_gps_cfg_s_type* conf = &loc_eng_conf_get()->gps;
+        if (mStart && NULL == mLocEng->nmea_server &&
+            conf->NMEA_SERVER_SOCKET[0] != '\0') {
+            mLocEng->nmea_server =
+                loc_eng_nmea_server_start(conf->NMEA_SERVER_SOCKET,
+                                          conf->NMEA_SERVER_MAX_CLIENTS,
+                                          conf->NMEA_SERVER_CLIENT_BUFFER,
+                                          conf->NMEA_SERVER_SLOW_CLIENT,
+                                          mCreateThread,
+                                          loc_eng_nmea_server_demand,
+                                          mLocEng);
+        } else if (!mStart && NULL != mLocEng->nmea_server) {
+            loc_eng_nmea_server_stop(mLocEng->nmea_server);
+            mLocEng->nmea_server = NULL;
+        }
+    }
+    inline  void locallog() const {
+        LOC_LOGV("NMEA server %s", mStart ? "start" : "stop");
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
 struct LocEngSuplMode : public LocMsg {
     UlpProxyBase* mUlp;
 
@@ -523,6 +645,7 @@ struct LocEngSuplMode : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngSuplMode"; }
     inline virtual void proc() const {
         mUlp->setCapabilities(getCarrierCapabilities());
     }
@@ -543,6 +666,7 @@ struct LocEngLppConfig : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngLppConfig"; }
     inline virtual void proc() const {
         mAdapter->setLPPConfig(mLppConfig);
     }
@@ -566,6 +690,9 @@ struct LocEngSensorControlConfig : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const {
+        return "LocEngSensorControlConfig";
+    }
     inline virtual void proc() const {
         mAdapter->setSensorControlConfig(mSensorsDisabled, mSensorProvider);
     }
@@ -616,6 +743,7 @@ struct LocEngSensorProperties : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngSensorProperties"; }
     inline virtual void proc() const {
         mAdapter->setSensorProperties(mGyroBiasVarianceRandomWalkValid,
                                       mGyroBiasVarianceRandomWalk,
@@ -692,6 +820,9 @@ struct LocEngSensorPerfControlConfig : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const {
+        return "LocEngSensorPerfControlConfig";
+    }
     inline virtual void proc() const {
         mAdapter->setSensorPerfControlConfig(mControlMode,
                                              mAccelSamplesPerBatch,
@@ -723,6 +854,241 @@ struct LocEngSensorPerfControlConfig : public LocMsg {
     }
 };
 
+// gps.conf parameters a reload applies to the running engine. All of
+// sap.conf is. The others, e.g. CAPABILITIES or the MsgTask and NMEA
+// server set up, are only heeded at start up.
+static const void* const sConfHotParams[] = {
+    &gps_conf.SUPL_VER,
+    &gps_conf.LPP_PROFILE,
+    &gps_conf.A_GLONASS_POS_PROTOCOL_SELECT,
+    &gps_conf.SUPL_MODE,
+    &gps_conf.INTERMEDIATE_POS,
+    &gps_conf.ACCURACY_THRES,
+    &gps_conf.AGPS_CERT_WRITABLE_MASK,
+    &gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL,
+    &gps_conf.NMEA_SENTENCE_MASK,
+    &gps_conf.NMEA_GSA_DECIMATION,
+    &gps_conf.NMEA_VTG_DECIMATION,
+    &gps_conf.NMEA_RMC_DECIMATION,
+    &gps_conf.NMEA_GGA_DECIMATION,
+    &gps_conf.NMEA_GSV_DECIMATION,
+};
+
+// CAPABILITIES as gps.conf had it at start up. The engine adjusts the
+// live value to the target and modem, so a reload compares against this.
+static uint32_t sConfFileCapabilities = 0;
+
+static bool loc_eng_conf_is_hot(const void* param)
+{
+    if (param >= (const void*)&sap_conf && param < (const void*)(&sap_conf + 1)) {
+        return true;
+    }
+    for (unsigned int i = 0; i < sizeof(sConfHotParams) / sizeof(sConfHotParams[0]); i++) {
+        if (sConfHotParams[i] == param) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_merge
+
+DESCRIPTION
+   Compare each parameter of schema in live against its copy in fresh, and
+   take over the new values of those that can change at run time. Changes
+   to the others are only logged; they wait for the next restart, and
+   keep being logged on every reload until then.
+
+DEPENDENCIES
+   live is gps_conf or sap_conf, and schema is its schema
+
+RETURN VALUE
+   Number of parameters that differ, taken over or not
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_conf_merge(const LocConfSchema& schema, void* live, const void* fresh)
+{
+    int changed = 0;
+
+    for (uint32_t i = 0; i < schema.count(); i++) {
+        const loc_param_schema_s_type& param = schema.param(i);
+        void* livePtr = (char*)live + param.param_offset;
+        const void* freshPtr = (const char*)fresh + param.param_offset;
+        uint8_t* liveSet = NULL;
+        const uint8_t* freshSet = NULL;
+
+        if (LOC_PARAM_NO_SET != param.set_offset) {
+            liveSet = (uint8_t*)live + param.set_offset;
+            freshSet = (const uint8_t*)fresh + param.set_offset;
+        }
+        if (param.param_ops->equal(livePtr, freshPtr) &&
+            (NULL == liveSet || *liveSet == *freshSet)) {
+            continue;
+        }
+
+        changed++;
+        if (!loc_eng_conf_is_hot(livePtr)) {
+            LOC_LOGW("%s: %s changed, takes effect after restart",
+                     __func__, param.param_name);
+            continue;
+        }
+        LOC_LOGI("%s: %s changed", __func__, param.param_name);
+        param.param_ops->copy(livePtr, freshPtr);
+        if (NULL != liveSet) {
+            *liveSet = *freshSet;
+        }
+    }
+    return changed;
+}
+
+// gps.conf and sap.conf as they were read again after a change. Whatever
+// the change asks of the modem is sent from proc() as one batch, in the
+// order loc_eng_reinit sends it, so no other msg lands in between.
+struct LocEngConfReload : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    loc_gps_cfg_s_type mGpsConf;
+    loc_sap_cfg_s_type mSapConf;
+    inline LocEngConfReload(loc_eng_data_s_type* locEng) :
+        LocMsg(), mLocEng(locEng)
+    {
+        memset(&mGpsConf, 0, sizeof(mGpsConf));
+        memset(&mSapConf, 0, sizeof(mSapConf));
+        gps_conf_schema.reset(&mGpsConf);
+        sap_conf_schema.reset(&mSapConf);
+        loc_conf_schema_file_s_type conf_files[] = {
+            UTIL_CONF_SCHEMA_FILE(GPS_CONF_FILE, gps_conf_schema, mGpsConf),
+            UTIL_CONF_SCHEMA_FILE(SAP_CONF_FILE, sap_conf_schema, mSapConf)
+        };
+        UTIL_READ_CONF_FILES(conf_files);
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngConfReload"; }
+    // a fix start or stop overtaking it goes by the configuration as
+    // it was before the reload, as if sent before it
+    inline virtual bool overtakable() const { return true; }
+    virtual void proc() const {
+        LocEngAdapter* adapter = mLocEng->adapter;
+        LocMsg* batch[8];
+        int cnt = 0;
+
+        loc_eng_conf_lock();
+        // both snapshots stay around until this msg is done
+        const loc_eng_conf_snapshot* old = loc_eng_conf_get();
+        // the adjusted CAPABILITIES stand while the file keeps its value
+        loc_gps_cfg_s_type freshGps = mGpsConf;
+        if (sConfFileCapabilities == freshGps.CAPABILITIES) {
+            freshGps.CAPABILITIES = gps_conf.CAPABILITIES;
+        }
+        int changed = loc_eng_conf_merge(gps_conf_schema, &gps_conf, &freshGps) +
+                      loc_eng_conf_merge(sap_conf_schema, &sap_conf, &mSapConf);
+        if (0 == changed) {
+            loc_eng_conf_unlock();
+            LOC_LOGD("%s: nothing changed", __func__);
+            return;
+        }
+        loc_eng_conf_publish();
+        const loc_eng_conf_snapshot* conf = loc_eng_conf_get();
+        const loc_gps_cfg_s_type& oldGps = old->gps;
+        const loc_sap_cfg_s_type& oldSap = old->sap;
+
+        mLocEng->intermediateFix = conf->gps.INTERMEDIATE_POS;
+        if (oldGps.SUPL_VER != conf->gps.SUPL_VER) {
+            batch[cnt++] = new LocEngSuplVer(adapter, conf->gps.SUPL_VER);
+        }
+        if (oldGps.LPP_PROFILE != conf->gps.LPP_PROFILE) {
+            batch[cnt++] = new LocEngLppConfig(adapter, conf->gps.LPP_PROFILE);
+        }
+        if (oldSap.SENSOR_USAGE != conf->sap.SENSOR_USAGE ||
+            oldSap.SENSOR_PROVIDER != conf->sap.SENSOR_PROVIDER) {
+            batch[cnt++] = new LocEngSensorControlConfig(adapter, conf->sap.SENSOR_USAGE,
+                                                         conf->sap.SENSOR_PROVIDER);
+        }
+        if (oldGps.A_GLONASS_POS_PROTOCOL_SELECT != conf->gps.A_GLONASS_POS_PROTOCOL_SELECT) {
+            batch[cnt++] = new LocEngAGlonassProtocol(adapter,
+                                                      conf->gps.A_GLONASS_POS_PROTOCOL_SELECT);
+        }
+        if (oldSap.GYRO_BIAS_RANDOM_WALK_VALID != conf->sap.GYRO_BIAS_RANDOM_WALK_VALID ||
+            oldSap.GYRO_BIAS_RANDOM_WALK != conf->sap.GYRO_BIAS_RANDOM_WALK ||
+            oldSap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID !=
+            conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            oldSap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY != conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY ||
+            oldSap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID !=
+            conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            oldSap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY != conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY ||
+            oldSap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID !=
+            conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            oldSap.RATE_RANDOM_WALK_SPECTRAL_DENSITY != conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY ||
+            oldSap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID !=
+            conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+            oldSap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY !=
+            conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY) {
+            batch[cnt++] = new LocEngSensorProperties(adapter,
+                                                      conf->sap.GYRO_BIAS_RANDOM_WALK_VALID,
+                                                      conf->sap.GYRO_BIAS_RANDOM_WALK,
+                                                      conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                      conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                      conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                      conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                      conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                      conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                      conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                      conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY);
+        }
+        if (oldSap.SENSOR_CONTROL_MODE != conf->sap.SENSOR_CONTROL_MODE ||
+            oldSap.SENSOR_ACCEL_SAMPLES_PER_BATCH != conf->sap.SENSOR_ACCEL_SAMPLES_PER_BATCH ||
+            oldSap.SENSOR_ACCEL_BATCHES_PER_SEC != conf->sap.SENSOR_ACCEL_BATCHES_PER_SEC ||
+            oldSap.SENSOR_GYRO_SAMPLES_PER_BATCH != conf->sap.SENSOR_GYRO_SAMPLES_PER_BATCH ||
+            oldSap.SENSOR_GYRO_BATCHES_PER_SEC != conf->sap.SENSOR_GYRO_BATCHES_PER_SEC ||
+            oldSap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH != conf->sap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH ||
+            oldSap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH != conf->sap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH ||
+            oldSap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH != conf->sap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH ||
+            oldSap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH != conf->sap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH ||
+            oldSap.SENSOR_ALGORITHM_CONFIG_MASK != conf->sap.SENSOR_ALGORITHM_CONFIG_MASK) {
+            batch[cnt++] = new LocEngSensorPerfControlConfig(adapter,
+                                                             conf->sap.SENSOR_CONTROL_MODE,
+                                                             conf->sap.SENSOR_ACCEL_SAMPLES_PER_BATCH,
+                                                             conf->sap.SENSOR_ACCEL_BATCHES_PER_SEC,
+                                                             conf->sap.SENSOR_GYRO_SAMPLES_PER_BATCH,
+                                                             conf->sap.SENSOR_GYRO_BATCHES_PER_SEC,
+                                                             conf->sap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
+                                                             conf->sap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
+                                                             conf->sap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
+                                                             conf->sap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
+                                                             conf->sap.SENSOR_ALGORITHM_CONFIG_MASK);
+        }
+        if (oldGps.SUPL_MODE != conf->gps.SUPL_MODE) {
+            batch[cnt++] = new LocEngSuplMode(adapter->getUlpProxy());
+        }
+        if (oldGps.NMEA_SENTENCE_MASK != conf->gps.NMEA_SENTENCE_MASK ||
+            oldGps.NMEA_GSA_DECIMATION != conf->gps.NMEA_GSA_DECIMATION ||
+            oldGps.NMEA_VTG_DECIMATION != conf->gps.NMEA_VTG_DECIMATION ||
+            oldGps.NMEA_RMC_DECIMATION != conf->gps.NMEA_RMC_DECIMATION ||
+            oldGps.NMEA_GGA_DECIMATION != conf->gps.NMEA_GGA_DECIMATION ||
+            oldGps.NMEA_GSV_DECIMATION != conf->gps.NMEA_GSV_DECIMATION) {
+            batch[cnt++] = new LocEngNmeaConfig(mLocEng, conf->gps);
+        }
+
+        for (int i = 0; i < cnt; i++) {
+            batch[i]->log();
+            batch[i]->proc();
+            batch[i]->dispose();
+        }
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngConfReload - SUPL_VER: 0x%X, LPP_PROFILE: %u, "
+                 "SENSOR_USAGE: %u, SENSOR_CONTROL_MODE: %u",
+                 mGpsConf.SUPL_VER, mGpsConf.LPP_PROFILE,
+                 mSapConf.SENSOR_USAGE, mSapConf.SENSOR_CONTROL_MODE);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
 //        case LOC_ENG_MSG_EXT_POWER_CONFIG:
 struct LocEngExtPowerConfig : public LocMsg {
     LocEngAdapter* mAdapter;
@@ -734,6 +1100,7 @@ struct LocEngExtPowerConfig : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngExtPowerConfig"; }
     inline virtual void proc() const {
         mAdapter->setExtPowerConfig(mIsBatteryCharging);
     }
@@ -765,6 +1132,7 @@ LocEngReportPosition::LocEngReportPosition(LocAdapterBase* adapter,
 void LocEngReportPosition::proc() const {
     LocEngAdapter* adapter = (LocEngAdapter*)mAdapter;
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)adapter->getOwner();
+    const loc_eng_conf_snapshot* conf = loc_eng_conf_get();
 
     if (locEng->mute_session_state != LOC_MUTE_SESS_IN_SESSION) {
         bool reported = false;
@@ -792,9 +1160,9 @@ void LocEngReportPosition::proc() const {
                      (LOC_SESS_INTERMEDIATE == locEng->intermediateFix &&
                       !((mLocation.gpsLocation.flags &
                          GPS_LOCATION_HAS_ACCURACY) &&
-                        (gps_conf.ACCURACY_THRES != 0) &&
+                        (conf->gps.ACCURACY_THRES != 0) &&
                         (mLocation.gpsLocation.accuracy >
-                         gps_conf.ACCURACY_THRES)))) {
+                         conf->gps.ACCURACY_THRES)))) {
                 locEng->location_cb((UlpLocation*)&(mLocation),
                                     (void*)mLocationExt);
                 reported = true;
@@ -815,7 +1183,7 @@ void LocEngReportPosition::proc() const {
             locEng->adapter->setInSession(false);
         }
 
-        if (locEng->generateNmea &&
+        if (locEng->generateNmea && loc_eng_nmea_wanted(locEng) &&
             mLocation.position_source == ULP_LOCATION_IS_FROM_GNSS &&
             mTechMask & (LOC_POS_TECH_MASK_SATELLITE |
                          LOC_POS_TECH_MASK_SENSORS |
@@ -826,15 +1194,17 @@ void LocEngReportPosition::proc() const {
             loc_eng_nmea_generate_pos(locEng, mLocation, mLocationExtended,
                                       generate_nmea);
         }
-
-        // Free the allocated memory for rawData
-        UlpLocation* gp = (UlpLocation*)&(mLocation);
-        if (gp != NULL && gp->rawData != NULL)
-        {
-            delete (char*)gp->rawData;
-            gp->rawData = NULL;
-            gp->rawDataSize = 0;
-        }
+    }
+}
+LocEngReportPosition::~LocEngReportPosition() {
+    // Free the allocated memory for rawData, also when the
+    // report got superseded or muted and was never delivered
+    UlpLocation* gp = (UlpLocation*)&(mLocation);
+    if (gp->rawData != NULL)
+    {
+        delete (char*)gp->rawData;
+        gp->rawData = NULL;
+        gp->rawDataSize = 0;
     }
 }
 void LocEngReportPosition::locallog() const {
@@ -872,7 +1242,7 @@ void LocEngReportSv::proc() const {
                                  (void*)mSvExt);
         }
 
-        if (locEng->generateNmea)
+        if (locEng->generateNmea && loc_eng_nmea_wanted(locEng))
         {
             loc_eng_nmea_generate_sv(locEng, mSvStatus, mLocationExtended);
         }
@@ -928,6 +1298,13 @@ void LocEngReportNmea::proc() const {
 
     if (locEng->nmea_cb != NULL)
         locEng->nmea_cb(now, mNmea, mLen);
+
+    if (locEng->nmea_server != NULL)
+        loc_eng_nmea_server_publish(locEng->nmea_server, mNmea, strnlen(mNmea, mLen));
+
+    // parsed where it lies, this copy of the sentences is ours till we return
+    if (locEng->nmea_parsed_cb != NULL)
+        loc_eng_nmea_parse_buffer(mNmea, mLen, locEng->nmea_parsed_cb);
 }
 inline void LocEngReportNmea::locallog() const {
     LOC_LOGV("LocEngReportNmea");
@@ -949,6 +1326,7 @@ LocEngReportXtraServer::LocEngReportXtraServer(void* locEng,
     memset(mServers, 0, 3*(mMaxLen+1));
 
     // Override modem URLs with uncommented gps.conf urls
+    loc_eng_conf_lock();
     if( gps_conf.XTRA_SERVER_1[0] != '\0' ) {
         url1 = &gps_conf.XTRA_SERVER_1[0];
     }
@@ -970,6 +1348,7 @@ LocEngReportXtraServer::LocEngReportXtraServer(void* locEng,
     if( NULL == strcasestr(url3, XTRA1_GPSONEXTRA) ) {
         strlcpy(cptr, url3, mMaxLen + 1);
     }
+    loc_eng_conf_unlock();
     locallog();
 }
 
@@ -1048,6 +1427,7 @@ struct LocEngReleaseBIT : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngReleaseBIT"; }
     inline virtual void proc() const
     {
         AgpsStateMachine* sm = (AgpsStateMachine*)mSubscriber.mStateMachine;
@@ -1294,7 +1674,7 @@ LocEngRequestTime::LocEngRequestTime(void* locEng) :
 }
 void LocEngRequestTime::proc() const {
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)mLocEng;
-    if (gps_conf.CAPABILITIES & GPS_CAPABILITY_ON_DEMAND_TIME) {
+    if (loc_eng_conf_get()->gps.CAPABILITIES & GPS_CAPABILITY_ON_DEMAND_TIME) {
         if (locEng->request_utc_time_cb != NULL) {
             locEng->request_utc_time_cb();
         } else {
@@ -1319,6 +1699,7 @@ struct LocEngDelAidData : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngDelAidData"; }
     inline virtual void proc() const {
         mLocEng->aiding_data_for_deletion = mType;
         update_aiding_data_for_deletion(*mLocEng);
@@ -1354,6 +1735,7 @@ struct LocEngEnableData : public LocMsg {
             delete[] mAPN;
         }
     }
+    inline virtual const char* name() const { return "LocEngEnableData"; }
     inline virtual void proc() const {
         mAdapter->enableData(mEnable);
         if (NULL != mAPN) {
@@ -1380,11 +1762,12 @@ struct LocEngSetCapabilities : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngSetCapabilities"; }
     inline virtual void proc() const {
         if (NULL != mLocEng->set_capabilities_cb) {
-            LOC_LOGV("calling set_capabilities_cb 0x%x",
-                     gps_conf.CAPABILITIES);
-            mLocEng->set_capabilities_cb(gps_conf.CAPABILITIES);
+            uint32_t capabilities = loc_eng_conf_get()->gps.CAPABILITIES;
+            LOC_LOGV("calling set_capabilities_cb 0x%x", capabilities);
+            mLocEng->set_capabilities_cb(capabilities);
         } else {
             LOC_LOGV("set_capabilities_cb is NULL.\n");
         }
@@ -1407,6 +1790,7 @@ struct LocEngInit : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngInit"; }
     inline virtual void proc() const {
         loc_eng_reinit(*mLocEng);
         // set the capabilities
@@ -1447,6 +1831,7 @@ struct LocEngAtlOpenSuccess : public LocMsg {
     {
         delete[] mAPN;
     }
+    inline virtual const char* name() const { return "LocEngAtlOpenSuccess"; }
     inline virtual void proc() const {
         mStateMachine->setBearer(mBearerType);
         mStateMachine->setAPN(mAPN, mLen);
@@ -1471,6 +1856,7 @@ struct LocEngAtlClosed : public LocMsg {
         LocMsg(), mStateMachine(statemachine) {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngAtlClosed"; }
     inline virtual void proc() const {
         mStateMachine->onRsrcEvent(RSRC_RELEASED);
     }
@@ -1489,6 +1875,7 @@ struct LocEngAtlOpenFailed : public LocMsg {
         LocMsg(), mStateMachine(statemachine) {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngAtlOpenFailed"; }
     inline virtual void proc() const {
         mStateMachine->onRsrcEvent(RSRC_DENIED);
     }
@@ -1538,6 +1925,7 @@ struct LocEngDataClientInit : public LocMsg {
         LocMsg(), mLocEng(locEng) {
         locallog();
     }
+    inline virtual const char* name() const { return "LocEngDataClientInit"; }
     virtual void proc() const {
         loc_eng_data_s_type *locEng = (loc_eng_data_s_type *)mLocEng;
         if(!locEng->adapter->initDataServiceClient()) {
@@ -1588,6 +1976,8 @@ struct LocEngInstallAGpsCert : public LocMsg {
         }
         delete[] mpData;
     }
+    inline virtual const char* name() const { return "LocEngInstallAGpsCert"; }
+    inline virtual bool overtakable() const { return true; }
     inline virtual void proc() const {
         mpAdapter->installAGpsCert(mpData, mNumberOfCerts, mSlotBitMask);
     }
@@ -1610,6 +2000,9 @@ struct LocEngUpdateRegistrationMask : public LocMsg {
         LocMsg(), mLocEng(locEng), mMask(mask), mIsEnabled(isEnabled) {
         locallog();
     }
+    inline virtual const char* name() const {
+        return "LocEngUpdateRegistrationMask";
+    }
     inline virtual void proc() const {
         loc_eng_data_s_type *locEng = (loc_eng_data_s_type *)mLocEng;
         locEng->adapter->updateRegistrationMask(mMask,
@@ -1629,10 +2022,15 @@ struct LocEngGnssConstellationConfig : public LocMsg {
         LocMsg(), mAdapter(adapter) {
         locallog();
     }
+    inline virtual const char* name() const {
+        return "LocEngGnssConstellationConfig";
+    }
     inline virtual void proc() const {
         if (mAdapter->gnssConstellationConfig()) {
             LOC_LOGV("Modem supports GNSS measurements\n");
+            loc_eng_conf_lock();
             gps_conf.CAPABILITIES |= GPS_CAPABILITY_MEASUREMENTS;
+            loc_eng_conf_publish();
         } else {
             LOC_LOGV("Modem does not support GNSS measurements\n");
         }
@@ -1711,19 +2109,66 @@ uint32_t getCarrierCapabilities() {
     #define carrierMSB (uint32_t)0x1
     #define gpsConfMSA (uint32_t)0x4
     #define gpsConfMSB (uint32_t)0x2
-    uint32_t capabilities = gps_conf.CAPABILITIES;
-    if ((gps_conf.SUPL_MODE & carrierMSA) != carrierMSA) {
+    loc_eng_conf_lock();
+    uint32_t confCapabilities = gps_conf.CAPABILITIES;
+    uint32_t suplMode = gps_conf.SUPL_MODE;
+    loc_eng_conf_unlock();
+    uint32_t capabilities = confCapabilities;
+    if ((suplMode & carrierMSA) != carrierMSA) {
         capabilities &= ~gpsConfMSA;
     }
-    if ((gps_conf.SUPL_MODE & carrierMSB) != carrierMSB) {
+    if ((suplMode & carrierMSB) != carrierMSB) {
         capabilities &= ~gpsConfMSB;
     }
 
     LOC_LOGV("getCarrierCapabilities: CAPABILITIES %x, SUPL_MODE %x, carrier capabilities %x",
-             gps_conf.CAPABILITIES, gps_conf.SUPL_MODE, capabilities);
+             confCapabilities, suplMode, capabilities);
     return capabilities;
 }
 
+// NMEA socket server clients count as one NMEA listener while connected
+static void loc_eng_nmea_server_demand(void* context, int listening)
+{
+    loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)context;
+    if (listening) {
+        loc_eng_nmea_add_listener(*locEng);
+    } else {
+        loc_eng_nmea_remove_listener(*locEng);
+    }
+}
+
+// gps.conf or sap.conf changed on disk and has been left alone since
+static void loc_eng_conf_changed(void* context)
+{
+    loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)context;
+    if (access(GPS_CONF_FILE, R_OK) != 0) {
+        // half way through being replaced, the rename is still to come
+        LOC_LOGW("%s: %s: %s, not reloaded", __func__, GPS_CONF_FILE, strerror(errno));
+        return;
+    }
+    locEng->adapter->sendMsg(new LocEngConfReload(locEng));
+}
+
+// watches gps.conf and sap.conf if CONF_HOT_RELOAD is set and they are
+// not watched yet; runs on the thread loc_eng_init and cleanup run on
+static void loc_eng_conf_watch(loc_eng_data_s_type &loc_eng_data,
+                               gps_create_thread create_thread_cb)
+{
+    loc_eng_conf_lock();
+    uint32_t hotReload = gps_conf.CONF_HOT_RELOAD;
+    uint32_t debounceMs = gps_conf.CONF_RELOAD_DEBOUNCE_MS;
+    loc_eng_conf_unlock();
+
+    if (hotReload && NULL == loc_eng_data.conf_watcher) {
+        const char* const conf_paths[] = { GPS_CONF_FILE, SAP_CONF_FILE };
+        loc_eng_data.conf_watcher =
+            loc_eng_conf_watcher_start(conf_paths, 2, debounceMs,
+                                       create_thread_cb,
+                                       loc_eng_conf_changed,
+                                       &loc_eng_data);
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_init
 
@@ -1755,6 +2200,12 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
         return ret_val;
     }
 
+    if (NULL != loc_eng_data.adapter) {
+        // the adapter outlives loc_eng_cleanup, what that stopped starts again
+        loc_eng_data.adapter->sendMsg(new LocEngNmeaServer(&loc_eng_data, true,
+                                                           callbacks->create_thread_cb));
+        loc_eng_conf_watch(loc_eng_data, callbacks->create_thread_cb);
+    }
     STATE_CHECK((NULL == loc_eng_data.adapter),
                 "instance already initialized", return 0);
 
@@ -1789,15 +2240,42 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
     {
         loc_eng_data.generateNmea = false;
     }
+    loc_eng_data.nmeaEpochBatch = (gps_conf.NMEA_EPOCH_BATCH != 0);
 
+    // The FG and BG contexts both work on loc_eng_data, the static conf
+    // state and what their ContextBase holds, none of which is locked,
+    // so their msgs must not run in parallel: one worker for them
+    if (gps_conf.MSG_TASK_WORKERS > 1) {
+        LOC_LOGW("%s: MSG_TASK_WORKERS=%u ignored, the location contexts "
+                 "share state and run on a single worker", __func__,
+                 gps_conf.MSG_TASK_WORKERS);
+    }
+    // only heeded if no context has been created yet
+    LocDualContext::setMsgTaskWorkers(1);
     loc_eng_data.adapter =
         new LocEngAdapter(event, &loc_eng_data, context,
                           (MsgTask::tCreate)callbacks->create_thread_cb);
 
     LOC_LOGD("loc_eng_init created client, id = %p\n",
              loc_eng_data.adapter);
+    loc_eng_conf_attach(loc_eng_data.adapter->getMsgTask());
+    if (gps_conf.MSG_PROFILING) {
+        loc_eng_data.adapter->getMsgTask()->enableProfiling(
+            gps_conf.MSG_PROFILING_DUMP_INTERVAL);
+    }
+    if (gps_conf.MSG_Q_CAPACITY) {
+        loc_eng_data.adapter->getMsgTask()->setQueueCapacity(
+            gps_conf.MSG_Q_CAPACITY,
+            (msg_q_overflow_type)gps_conf.MSG_Q_OVERFLOW_POLICY);
+    }
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaConfig(&loc_eng_data, gps_conf));
     loc_eng_data.adapter->sendMsg(new LocEngInit(&loc_eng_data));
 
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaServer(&loc_eng_data, true,
+                                                       callbacks->create_thread_cb));
+
+    loc_eng_conf_watch(loc_eng_data, callbacks->create_thread_cb);
+
     EXIT_LOG(%d, ret_val);
     return ret_val;
 }
@@ -1807,48 +2285,49 @@ static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
     ENTRY_LOG();
     int ret_val = LOC_API_ADAPTER_ERR_SUCCESS;
     LocEngAdapter* adapter = loc_eng_data.adapter;
+    const loc_eng_conf_snapshot* conf = loc_eng_conf_get();
 
     adapter->sendMsg(new LocEngGnssConstellationConfig(adapter));
-    adapter->sendMsg(new LocEngSuplVer(adapter, gps_conf.SUPL_VER));
-    adapter->sendMsg(new LocEngLppConfig(adapter, gps_conf.LPP_PROFILE));
-    adapter->sendMsg(new LocEngSensorControlConfig(adapter, sap_conf.SENSOR_USAGE,
-                                                   sap_conf.SENSOR_PROVIDER));
-    adapter->sendMsg(new LocEngAGlonassProtocol(adapter, gps_conf.A_GLONASS_POS_PROTOCOL_SELECT));
+    adapter->sendMsg(new LocEngSuplVer(adapter, conf->gps.SUPL_VER));
+    adapter->sendMsg(new LocEngLppConfig(adapter, conf->gps.LPP_PROFILE));
+    adapter->sendMsg(new LocEngSensorControlConfig(adapter, conf->sap.SENSOR_USAGE,
+                                                   conf->sap.SENSOR_PROVIDER));
+    adapter->sendMsg(new LocEngAGlonassProtocol(adapter, conf->gps.A_GLONASS_POS_PROTOCOL_SELECT));
 
     /* Make sure at least one of the sensor property is specified by the user in the gps.conf file. */
-    if( sap_conf.GYRO_BIAS_RANDOM_WALK_VALID ||
-        sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
-        sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
-        sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
-        sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID ) {
+    if( conf->sap.GYRO_BIAS_RANDOM_WALK_VALID ||
+        conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID ) {
         adapter->sendMsg(new LocEngSensorProperties(adapter,
-                                                    sap_conf.GYRO_BIAS_RANDOM_WALK_VALID,
-                                                    sap_conf.GYRO_BIAS_RANDOM_WALK,
-                                                    sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                    sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
-                                                    sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                    sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
-                                                    sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                    sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
-                                                    sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
-                                                    sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
+                                                    conf->sap.GYRO_BIAS_RANDOM_WALK_VALID,
+                                                    conf->sap.GYRO_BIAS_RANDOM_WALK,
+                                                    conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    conf->sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                    conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    conf->sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                    conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    conf->sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                    conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    conf->sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
     }
 
     adapter->sendMsg(new LocEngSensorPerfControlConfig(adapter,
-                                                       sap_conf.SENSOR_CONTROL_MODE,
-                                                       sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH,
-                                                       sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC,
-                                                       sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH,
-                                                       sap_conf.SENSOR_GYRO_BATCHES_PER_SEC,
-                                                       sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
-                                                       sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
-                                                       sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
-                                                       sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
-                                                       sap_conf.SENSOR_ALGORITHM_CONFIG_MASK));
+                                                       conf->sap.SENSOR_CONTROL_MODE,
+                                                       conf->sap.SENSOR_ACCEL_SAMPLES_PER_BATCH,
+                                                       conf->sap.SENSOR_ACCEL_BATCHES_PER_SEC,
+                                                       conf->sap.SENSOR_GYRO_SAMPLES_PER_BATCH,
+                                                       conf->sap.SENSOR_GYRO_BATCHES_PER_SEC,
+                                                       conf->sap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
+                                                       conf->sap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
+                                                       conf->sap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
+                                                       conf->sap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
+                                                       conf->sap.SENSOR_ALGORITHM_CONFIG_MASK));
 
     adapter->sendMsg(new LocEngEnableData(adapter, NULL, 0, (agpsStatus ? 1:0)));
 
-    loc_eng_xtra_version_check(loc_eng_data, gps_conf.XTRA_VERSION_CHECK);
+    loc_eng_xtra_version_check(loc_eng_data, conf->gps.XTRA_VERSION_CHECK);
 
     LOC_LOGD("loc_eng_reinit reinit() successful");
     EXIT_LOG(%d, ret_val);
@@ -1896,6 +2375,14 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
         loc_eng_stop(loc_eng_data);
     }
 
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaServer(&loc_eng_data, false, NULL));
+
+    // a reload it may still send is harmless, the adapter stays
+    if (NULL != loc_eng_data.conf_watcher) {
+        loc_eng_conf_watcher_stop(loc_eng_data.conf_watcher);
+        loc_eng_data.conf_watcher = NULL;
+    }
+
 #if 0 // can't afford to actually clean up, for many reason.
 
     LOC_LOGD("loc_eng_init: client opened. close it now.");
@@ -2690,7 +3177,9 @@ int loc_eng_agps_install_certificates(loc_eng_data_s_type &loc_eng_data,
     ENTRY_LOG_CALLFLOW();
     int ret_val = AGPS_CERTIFICATE_OPERATION_SUCCESS;
 
+    loc_eng_conf_lock();
     uint32_t slotBitMask = gps_conf.AGPS_CERT_WRITABLE_MASK;
+    loc_eng_conf_unlock();
     uint32_t slotCount = 0;
     for (uint32_t slotBitMaskCounter=slotBitMask; slotBitMaskCounter; slotCount++) {
         slotBitMaskCounter &= slotBitMaskCounter - 1;
@@ -2739,32 +3228,52 @@ void loc_eng_configuration_update (loc_eng_data_s_type &loc_eng_data,
     ENTRY_LOG_CALLFLOW();
 
     if (config_data && length > 0) {
-        loc_gps_cfg_s_type gps_conf_tmp = gps_conf;
-        UTIL_UPDATE_CONF(config_data, length, gps_conf_table);
+        loc_gps_cfg_s_type update;
         LocEngAdapter* adapter = loc_eng_data.adapter;
 
+        loc_eng_conf_lock();
+        // parsed into a copy, so that what is not taken over from it
+        // never shows in gps_conf
+        update = gps_conf;
+        loc_update_conf(config_data, length, gps_conf_schema, &update);
+        const loc_gps_cfg_s_type old = gps_conf;
+        gps_conf.SUPL_VER = update.SUPL_VER;
+        gps_conf.LPP_PROFILE = update.LPP_PROFILE;
+        gps_conf.A_GLONASS_POS_PROTOCOL_SELECT = update.A_GLONASS_POS_PROTOCOL_SELECT;
+        gps_conf.SUPL_MODE = update.SUPL_MODE;
+        gps_conf.GPS_LOCK = update.GPS_LOCK;
+        gps_conf.NMEA_SENTENCE_MASK = update.NMEA_SENTENCE_MASK;
+        gps_conf.NMEA_GSA_DECIMATION = update.NMEA_GSA_DECIMATION;
+        gps_conf.NMEA_VTG_DECIMATION = update.NMEA_VTG_DECIMATION;
+        gps_conf.NMEA_RMC_DECIMATION = update.NMEA_RMC_DECIMATION;
+        gps_conf.NMEA_GGA_DECIMATION = update.NMEA_GGA_DECIMATION;
+        gps_conf.NMEA_GSV_DECIMATION = update.NMEA_GSV_DECIMATION;
+        loc_eng_conf_publish();
+
         // it is possible that HAL is not init'ed at this time
         if (adapter) {
-            if (gps_conf_tmp.SUPL_VER != gps_conf.SUPL_VER) {
-                adapter->sendMsg(new LocEngSuplVer(adapter, gps_conf.SUPL_VER));
+            if (old.SUPL_VER != update.SUPL_VER) {
+                adapter->sendMsg(new LocEngSuplVer(adapter, update.SUPL_VER));
             }
-            if (gps_conf_tmp.LPP_PROFILE != gps_conf.LPP_PROFILE) {
-                adapter->sendMsg(new LocEngLppConfig(adapter, gps_conf.LPP_PROFILE));
+            if (old.LPP_PROFILE != update.LPP_PROFILE) {
+                adapter->sendMsg(new LocEngLppConfig(adapter, update.LPP_PROFILE));
             }
-            if (gps_conf_tmp.A_GLONASS_POS_PROTOCOL_SELECT != gps_conf.A_GLONASS_POS_PROTOCOL_SELECT) {
+            if (old.A_GLONASS_POS_PROTOCOL_SELECT != update.A_GLONASS_POS_PROTOCOL_SELECT) {
                 adapter->sendMsg(new LocEngAGlonassProtocol(adapter,
-                                                            gps_conf.A_GLONASS_POS_PROTOCOL_SELECT));
+                                                            update.A_GLONASS_POS_PROTOCOL_SELECT));
             }
-            if (gps_conf_tmp.SUPL_MODE != gps_conf.SUPL_MODE) {
+            if (old.SUPL_MODE != update.SUPL_MODE) {
                 adapter->sendMsg(new LocEngSuplMode(adapter->getUlpProxy()));
             }
+            if (old.NMEA_SENTENCE_MASK != update.NMEA_SENTENCE_MASK ||
+                old.NMEA_GSA_DECIMATION != update.NMEA_GSA_DECIMATION ||
+                old.NMEA_VTG_DECIMATION != update.NMEA_VTG_DECIMATION ||
+                old.NMEA_RMC_DECIMATION != update.NMEA_RMC_DECIMATION ||
+                old.NMEA_GGA_DECIMATION != update.NMEA_GGA_DECIMATION ||
+                old.NMEA_GSV_DECIMATION != update.NMEA_GSV_DECIMATION) {
+                adapter->sendMsg(new LocEngNmeaConfig(&loc_eng_data, update));
+            }
         }
-
-        gps_conf_tmp.SUPL_VER = gps_conf.SUPL_VER;
-        gps_conf_tmp.LPP_PROFILE = gps_conf.LPP_PROFILE;
-        gps_conf_tmp.A_GLONASS_POS_PROTOCOL_SELECT = gps_conf.A_GLONASS_POS_PROTOCOL_SELECT;
-        gps_conf_tmp.GPS_LOCK = gps_conf.GPS_LOCK;
-        gps_conf = gps_conf_tmp;
     }
 
     EXIT_LOG(%s, VOID_RET);
@@ -2834,6 +3343,12 @@ static void loc_eng_report_status (loc_eng_data_s_type &loc_eng_data, GpsStatusV
     {
         loc_eng_data.fix_session_status = status;
     }
+
+    // Don't hold on to the sentences of an epoch that won't complete
+    if (status == GPS_STATUS_SESSION_END || status == GPS_STATUS_ENGINE_OFF)
+    {
+        loc_eng_nmea_flush(&loc_eng_data);
+    }
     EXIT_LOG(%s, VOID_RET);
 }
 
@@ -2934,12 +3449,19 @@ int loc_eng_read_config(void)
     ENTRY_LOG_CALLFLOW();
     if(configAlreadyRead == false)
     {
+      loc_eng_conf_lock();
       // Initialize our defaults before reading of configuration file overwrites them.
-      loc_default_parameters();
+      gps_conf_schema.reset(&gps_conf);
+      sap_conf_schema.reset(&sap_conf);
       // We only want to parse the conf file once. This is a good place to ensure that.
       // In fact one day the conf file should go into context.
-      UTIL_READ_CONF(GPS_CONF_FILE, gps_conf_table);
-      UTIL_READ_CONF(SAP_CONF_FILE, sap_conf_table);
+      loc_conf_schema_file_s_type conf_files[] = {
+          UTIL_CONF_SCHEMA_FILE(GPS_CONF_FILE, gps_conf_schema, gps_conf),
+          UTIL_CONF_SCHEMA_FILE(SAP_CONF_FILE, sap_conf_schema, sap_conf)
+      };
+      UTIL_READ_CONF_FILES(conf_files);
+      sConfFileCapabilities = gps_conf.CAPABILITIES;
+      loc_eng_conf_publish();
       configAlreadyRead = true;
     } else {
       LOC_LOGV("GPS Config file has already been read\n");
@@ -3049,3 +3571,158 @@ void loc_eng_gps_measurement_close(loc_eng_data_s_type &loc_eng_data)
     loc_eng_data.gps_measurement_cb = NULL;
     EXIT_LOG(%d, 0);
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_msg_profile_get_stats
+
+DESCRIPTION
+   Get the queue dwell and processing time profile of the loc_eng MsgTask,
+   one LocMsgProfileStats per msg type.
+
+DEPENDENCIES
+   MSG_PROFILING in gps.conf
+
+RETURN VALUE
+   number of stats filled in; -1 if profiling is off or not initialized
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_msg_profile_get_stats(loc_eng_data_s_type &loc_eng_data,
+                                  LocMsgProfileStats* stats, int max_cnt)
+{
+    ENTRY_LOG();
+    int ret_val = -1;
+
+    INIT_CHECK(loc_eng_data.adapter, return ret_val);
+    if (NULL != stats && max_cnt > 0) {
+        ret_val = loc_eng_data.adapter->getMsgTask()->getProfile(stats, max_cnt);
+    }
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_msg_profile_dump
+
+DESCRIPTION
+   Log the loc_eng MsgTask profile right away.
+
+DEPENDENCIES
+   MSG_PROFILING in gps.conf
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_msg_profile_dump(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.adapter, return);
+    loc_eng_data.adapter->getMsgTask()->dumpProfile();
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_parsed_init
+
+DESCRIPTION
+   Start, or with a NULL callback stop, handing the modem provided NMEA
+   sentences out parsed as well as raw.
+
+DEPENDENCIES
+   NMEA_PROVIDER=1 in gps.conf, otherwise nothing is ever parsed
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_parsed_init(loc_eng_data_s_type &loc_eng_data,
+                              loc_nmea_parsed_callback callback)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.adapter, return);
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaParsed(&loc_eng_data, callback));
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_set_listening
+
+DESCRIPTION
+   Tell whether the framework has NMEA listeners; if it has none nmea_cb
+   no longer counts as one. Assumed listening until told otherwise.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_set_listening(loc_eng_data_s_type &loc_eng_data, int listening)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.adapter, return);
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaDemand(&loc_eng_data, 0, listening ? 1 : 0));
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_add_listener
+
+DESCRIPTION
+   Count in one more taker of the generated NMEA, besides nmea_cb
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_add_listener(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.adapter, return);
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaDemand(&loc_eng_data, 1, -1));
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_remove_listener
+
+DESCRIPTION
+   Count out a taker added with loc_eng_nmea_add_listener
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_remove_listener(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    INIT_CHECK(loc_eng_data.adapter, return);
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaDemand(&loc_eng_data, -1, -1));
+    EXIT_LOG(%s, VOID_RET);
+}
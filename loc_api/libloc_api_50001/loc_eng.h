@@ -58,6 +58,11 @@ typedef unsigned char boolean;
 #include <loc_eng_agps.h>
 #include <LocEngAdapter.h>
 
+// Only held by pointer here, loc_eng_nmea_server.h and
+// loc_eng_conf_watcher.h are not exported
+struct loc_eng_nmea_server;
+struct loc_eng_conf_watcher;
+
 // The data connection minimal open time
 #define DATA_OPEN_MIN_TIME        1  /* sec */
 
@@ -80,6 +85,31 @@ enum loc_mute_session_e_type {
    LOC_MUTE_SESS_IN_SESSION
 };
 
+// Room for all sentences of one NMEA epoch when they are batched
+#define NMEA_EPOCH_MAX_LENGTH 4096
+
+// NMEA sentences generated on the AP, as in NMEA_SENTENCE_MASK of gps.conf.
+// Bit n is also the index of the sentence's decimation factor.
+#define LOC_NMEA_MASK_GSA   0x01
+#define LOC_NMEA_MASK_VTG   0x02
+#define LOC_NMEA_MASK_RMC   0x04
+#define LOC_NMEA_MASK_GGA   0x08
+#define LOC_NMEA_MASK_GSV   0x10
+#define LOC_NMEA_MASK_POS   (LOC_NMEA_MASK_GSA | LOC_NMEA_MASK_VTG | \
+                             LOC_NMEA_MASK_RMC | LOC_NMEA_MASK_GGA)
+#define LOC_NMEA_MASK_ALL   (LOC_NMEA_MASK_POS | LOC_NMEA_MASK_GSV)
+#define LOC_NMEA_SENTENCE_TYPES 5
+
+// Constellations with a talker of their own in GSV, and a GNGSA of their
+// own when more than one is used in the fix
+enum loc_nmea_system_e_type {
+    LOC_NMEA_SYSTEM_GPS = 0,    // GP, QZSS included
+    LOC_NMEA_SYSTEM_GLONASS,    // GL
+    LOC_NMEA_SYSTEM_GALILEO,    // GA
+    LOC_NMEA_SYSTEM_BDS,        // GB
+    LOC_NMEA_SYSTEMS
+};
+
 // Module data
 typedef struct loc_eng_data_s
 {
@@ -95,6 +125,7 @@ typedef struct loc_eng_data_s
     gps_release_wakelock           release_wakelock_cb;
     gps_request_utc_time           request_utc_time_cb;
     gps_measurement_callback       gps_measurement_cb;
+    loc_nmea_parsed_callback       nmea_parsed_cb;
     boolean                        intermediateFix;
     AGpsStatusValue                agps_status;
     loc_eng_xtra_data_s_type       xtra_module_data;
@@ -119,10 +150,28 @@ typedef struct loc_eng_data_s
 
     // For nmea generation
     boolean generateNmea;
-    uint32_t sv_used_mask;
+    // SVs used in the fix, a word per system with the bits of
+    // GnssSvUsedInPosition; QZSS from bit 32 of the GPS word
+    uint64_t sv_used_mask[LOC_NMEA_SYSTEMS];
     float hdop;
     float pdop;
     float vdop;
+    // Sentences of the current epoch, if they go out in one nmea_cb
+    boolean nmeaEpochBatch;
+    int nmea_epoch_length;
+    char nmea_epoch[NMEA_EPOCH_MAX_LENGTH];
+    // Sentences wanted, and how many more epochs each sits out
+    uint32_t nmea_sentence_mask;
+    uint32_t nmea_decimation[LOC_NMEA_SENTENCE_TYPES];
+    uint32_t nmea_countdown[LOC_NMEA_SENTENCE_TYPES];
+    // Listeners registered in the HAL, and whether the framework said it
+    // has none; nothing is generated while no one listens
+    int nmea_listener_cnt;
+    boolean nmeaFrameworkIdle;
+    // Local socket the NMEA is also served on, if gps.conf asks for it
+    loc_eng_nmea_server* nmea_server;
+    // Watches gps.conf and sap.conf, if gps.conf asks for it
+    loc_eng_conf_watcher* conf_watcher;
 
     // Address buffers, for addressing setting before init
     int    supl_host_set;
@@ -141,9 +190,9 @@ typedef struct loc_eng_data_s
 } loc_eng_data_s_type;
 
 /* GPS.conf support */
-/* NOTE: the implementaiton of the parser casts number
-   fields to 32 bit. To ensure all 'n' fields working,
-   they must all be 32 bit fields. */
+/* The parameters, their defaults and ranges are in the
+   schema in loc_eng.cpp. A field can be of any type
+   LocParamType is there for. */
 typedef struct loc_gps_cfg_s
 {
     uint32_t       INTERMEDIATE_POS;
@@ -161,15 +210,28 @@ typedef struct loc_gps_cfg_s
     uint32_t       GPS_LOCK;
     uint32_t       A_GLONASS_POS_PROTOCOL_SELECT;
     uint32_t       AGPS_CERT_WRITABLE_MASK;
+    uint32_t       MSG_PROFILING;
+    uint32_t       MSG_PROFILING_DUMP_INTERVAL;
+    uint32_t       MSG_TASK_WORKERS;
+    uint32_t       MSG_Q_CAPACITY;
+    uint32_t       MSG_Q_OVERFLOW_POLICY;
+    uint32_t       NMEA_EPOCH_BATCH;
+    uint32_t       NMEA_SENTENCE_MASK;
+    uint32_t       NMEA_GSA_DECIMATION;
+    uint32_t       NMEA_VTG_DECIMATION;
+    uint32_t       NMEA_RMC_DECIMATION;
+    uint32_t       NMEA_GGA_DECIMATION;
+    uint32_t       NMEA_GSV_DECIMATION;
+    char           NMEA_SERVER_SOCKET[LOC_MAX_PARAM_STRING + 1];
+    uint32_t       NMEA_SERVER_MAX_CLIENTS;
+    uint32_t       NMEA_SERVER_CLIENT_BUFFER;
+    uint32_t       NMEA_SERVER_SLOW_CLIENT;
+    uint32_t       CONF_HOT_RELOAD;
+    uint32_t       CONF_RELOAD_DEBOUNCE_MS;
 } loc_gps_cfg_s_type;
 
-/* NOTE: the implementaiton of the parser casts number
-   fields to 32 bit. To ensure all 'n' fields working,
-   they must all be 32 bit fields. */
-/* Meanwhile, *_valid fields are 8 bit fields, and 'f'
-   fields are double. Rigid as they are, it is the
-   the status quo, until the parsing mechanism is
-   change, that is. */
+/* *_VALID fields, set if sap.conf sets the value, are
+   8 bit fields. */
 typedef struct
 {
     uint8_t        GYRO_BIAS_RANDOM_WALK_VALID;
@@ -199,6 +261,28 @@ typedef struct
 extern loc_gps_cfg_s_type gps_conf;
 extern loc_sap_cfg_s_type sap_conf;
 
+/* gps_conf and sap_conf are the master copy of the configuration. Once
+   it has been read, they are only changed between loc_eng_conf_lock()
+   and loc_eng_conf_publish(), and, past start up, read off the MsgTask
+   workers while holding the lock. Msgs read the latest published
+   snapshot instead, which takes a single load, and stays as it is
+   until the msg is done with it. */
+typedef struct {
+    uint32_t           version;
+    loc_gps_cfg_s_type gps;
+    loc_sap_cfg_s_type sap;
+} loc_eng_conf_snapshot;
+
+// only to be held on to by a msg, until its proc() returns
+const loc_eng_conf_snapshot* loc_eng_conf_get();
+void loc_eng_conf_lock();
+void loc_eng_conf_unlock();
+// makes gps_conf and sap_conf the next snapshot, and unlocks
+void loc_eng_conf_publish();
+// the MsgTask whose msgs read snapshots; until there is one, a
+// replaced snapshot is freed as soon as it is replaced
+void loc_eng_conf_attach(const loc_core::MsgTask* msgTask);
+
 
 uint32_t getCarrierCapabilities();
 
@@ -263,6 +347,14 @@ void loc_eng_configuration_update (loc_eng_data_s_type &loc_eng_data,
 int loc_eng_gps_measurement_init(loc_eng_data_s_type &loc_eng_data,
                                  GpsMeasurementCallbacks* callbacks);
 void loc_eng_gps_measurement_close(loc_eng_data_s_type &loc_eng_data);
+int loc_eng_msg_profile_get_stats(loc_eng_data_s_type &loc_eng_data,
+                                  LocMsgProfileStats* stats, int max_cnt);
+void loc_eng_msg_profile_dump(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_nmea_parsed_init(loc_eng_data_s_type &loc_eng_data,
+                              loc_nmea_parsed_callback callback);
+void loc_eng_nmea_set_listening(loc_eng_data_s_type &loc_eng_data, int listening);
+void loc_eng_nmea_add_listener(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_nmea_remove_listener(loc_eng_data_s_type &loc_eng_data);
 
 #ifdef __cplusplus
 }
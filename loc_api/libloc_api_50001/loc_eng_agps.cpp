@@ -812,19 +812,15 @@ bool AgpsStateMachine::hasActiveSubscribers() const
 //======================================================================
 // DSStateMachine
 //======================================================================
-void delay_callback(void *callbackData, int result)
-{
-    if(callbackData) {
-        DSStateMachine *DSSMInstance = (DSStateMachine *)callbackData;
-        DSSMInstance->retryCallback();
-    }
-    else {
-        LOC_LOGE(" NULL argument received. Failing.\n");
-        goto err;
+struct DSRetryMsg : public LocMsg {
+    DSStateMachine* mDSStateMachine;
+    inline DSRetryMsg(DSStateMachine* stateMachine) :
+        LocMsg(), mDSStateMachine(stateMachine) {}
+    inline virtual const char* name() const { return "DSRetryMsg"; }
+    inline virtual void proc() const {
+        mDSStateMachine->retryCallback();
     }
-err:
-    return;
-}
+};
 
 DSStateMachine :: DSStateMachine(servicerType type, void *cb_func,
                                  LocEngAdapter* adapterHandle):
@@ -882,11 +878,9 @@ int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
             informStatus(RSRC_DENIED, connHandle);
         }
         else {
-            if(loc_timer_start(DATA_CALL_RETRY_DELAY_MSEC, delay_callback, (void *)this)) {
-                LOC_LOGE("Error: Could not start delay thread\n");
-                ret = -1;
-                goto err;
-            }
+            // retried on the MsgTask, instead of a thread of its own
+            mLocAdapter->sendMsgDelayed(new DSRetryMsg((DSStateMachine*)this),
+                                        DATA_CALL_RETRY_DELAY_MSEC);
         }
         break;
     case LOC_API_ADAPTER_ERR_UNSUPPORTED:
@@ -905,7 +899,6 @@ int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
     default:
         LOC_LOGE("%s:%d]: Unrecognized return value\n", __func__, __LINE__);
     }
-err:
     LOC_LOGD("EXIT DSStateMachine :: sendRsrcRequest; ret = %d\n", ret);
     return ret;
 }
@@ -0,0 +1,188 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <pthread.h>
+#include <loc_eng.h>
+#include "log_util.h"
+
+using namespace loc_core;
+
+// what msgs read before the configuration has been published
+static const loc_eng_conf_snapshot sConfNone = {};
+static const loc_eng_conf_snapshot* sConf = &sConfNone;
+// serializes the writers, and the readers of the master copy
+static pthread_mutex_t sConfLock = PTHREAD_MUTEX_INITIALIZER;
+static const MsgTask* sConfMsgTask = NULL;
+
+// Replaced snapshots whose reclaim msg was disposed unprocessed, as when
+// its fence got flushed with a Q; the next reclaim msg frees them too
+struct LocEngConfRetired {
+    const loc_eng_conf_snapshot* conf;
+    LocEngConfRetired* next;
+};
+static LocEngConfRetired* sConfRetired = NULL;
+
+// Frees a replaced snapshot, and those retired before it was replaced,
+// once no msg can still be reading them
+struct LocEngConfReclaim : public LocMsg {
+    LocEngConfRetired* mConfs;
+    mutable bool mDone;
+    inline LocEngConfReclaim(const loc_eng_conf_snapshot* conf,
+                             LocEngConfRetired* retired) :
+        LocMsg(), mConfs(new LocEngConfRetired), mDone(false)
+    {
+        mConfs->conf = conf;
+        mConfs->next = retired;
+        locallog();
+    }
+    // not processed, so msgs may still read them; left to the next one
+    inline virtual ~LocEngConfReclaim() {
+        if (!mDone) {
+            LOC_LOGW("LocEngConfReclaim - version %u not reclaimed, retired",
+                     mConfs->conf->version);
+            LocEngConfRetired* last = mConfs;
+            pthread_mutex_lock(&sConfLock);
+            while (NULL != last->next) {
+                last = last->next;
+            }
+            last->next = sConfRetired;
+            sConfRetired = mConfs;
+            pthread_mutex_unlock(&sConfLock);
+        }
+    }
+    inline virtual const char* name() const { return "LocEngConfReclaim"; }
+    inline virtual void proc() const {
+        LocEngConfRetired* confs = mConfs;
+        mDone = true;
+        while (NULL != confs) {
+            LocEngConfRetired* next = confs->next;
+            delete confs->conf;
+            delete confs;
+            confs = next;
+        }
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngConfReclaim - version %u", mConfs->conf->version);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_get
+
+DESCRIPTION
+   The latest published configuration snapshot. A msg may keep using it
+   until its proc() returns, however many snapshots get published in
+   the meantime.
+
+DEPENDENCIES
+   Called from a msg on the MsgTask attached by loc_eng_conf_attach(), or
+   before there is one
+
+RETURN VALUE
+   The snapshot, never NULL
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+const loc_eng_conf_snapshot* loc_eng_conf_get()
+{
+    return __atomic_load_n(&sConf, __ATOMIC_ACQUIRE);
+}
+
+void loc_eng_conf_lock()
+{
+    pthread_mutex_lock(&sConfLock);
+}
+
+void loc_eng_conf_unlock()
+{
+    pthread_mutex_unlock(&sConfLock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_publish
+
+DESCRIPTION
+   Publish a copy of gps_conf and sap_conf as the next snapshot, and hand
+   the one it replaces to the attached MsgTask, to be freed once the msgs
+   in flight are done. Snapshots retired since, their reclaim msg having
+   been disposed unprocessed, are freed along with it.
+
+DEPENDENCIES
+   Called with the lock held, which it releases
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_conf_publish()
+{
+    const loc_eng_conf_snapshot* old = sConf;
+    loc_eng_conf_snapshot* conf = new loc_eng_conf_snapshot;
+
+    conf->version = old->version + 1;
+    conf->gps = gps_conf;
+    conf->sap = sap_conf;
+    __atomic_store_n(&sConf, conf, __ATOMIC_RELEASE);
+    const MsgTask* msgTask = sConfMsgTask;
+    // retired before this one was replaced, so the fence covers them too
+    LocEngConfRetired* retired = NULL;
+    if (NULL != msgTask && &sConfNone != old) {
+        retired = sConfRetired;
+        sConfRetired = NULL;
+    }
+    pthread_mutex_unlock(&sConfLock);
+
+    LOC_LOGD("%s: configuration version %u", __func__, conf->version);
+    if (&sConfNone == old) {
+        return;
+    }
+    if (NULL != msgTask) {
+        msgTask->sendMsgAfterInFlight(new LocEngConfReclaim(old, retired));
+    } else {
+        delete old;
+    }
+}
+
+void loc_eng_conf_attach(const MsgTask* msgTask)
+{
+    pthread_mutex_lock(&sConfLock);
+    sConfMsgTask = msgTask;
+    pthread_mutex_unlock(&sConfLock);
+}
@@ -0,0 +1,159 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stress test of the configuration snapshots. Writer threads keep
+   changing gps_conf and sap_conf and publishing them, while msgs on a
+   sharded MsgTask read the latest snapshot twice, a while apart, and
+   check that every field still tells of the same change. A torn
+   snapshot, one freed or reused under a reader, or a version going
+   backwards fails the run. Best run under ASan too, which catches
+   reads of freed snapshots that the field checks can miss.
+   Usage: loc_eng_conf_stress [workers] [writers] [publishes] [keys] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <loc_eng.h>
+
+using namespace loc_core;
+
+// loc_eng.cpp, which has the real ones, is not built in
+loc_gps_cfg_s_type gps_conf;
+loc_sap_cfg_s_type sap_conf;
+
+#define STRESS_MAX_KEYS 64
+
+static uint32_t sSeq = 0;
+static uint32_t sPublishes = 0;
+static uint32_t sReads = 0;
+static uint32_t sErrors = 0;
+// last version a key's msgs saw; msgs of one key run in order
+static uint32_t sLastVersion[STRESS_MAX_KEYS];
+
+// every field a writer changes is derived from the same seq
+static void stress_write(uint32_t seq)
+{
+    loc_eng_conf_lock();
+    gps_conf.ACCURACY_THRES = seq;
+    gps_conf.SUPL_VER = seq * 3;
+    gps_conf.NMEA_GSV_DECIMATION = seq ^ 0x5A5A5A5A;
+    sap_conf.SENSOR_USAGE = seq + 7;
+    sap_conf.GYRO_BIAS_RANDOM_WALK = seq * 0.5;
+    loc_eng_conf_publish();
+}
+
+static bool stress_consistent(const loc_eng_conf_snapshot* conf)
+{
+    uint32_t seq = conf->gps.ACCURACY_THRES;
+    return conf->gps.SUPL_VER == seq * 3 &&
+           conf->gps.NMEA_GSV_DECIMATION == (seq ^ 0x5A5A5A5A) &&
+           conf->sap.SENSOR_USAGE == seq + 7 &&
+           conf->sap.GYRO_BIAS_RANDOM_WALK == seq * 0.5;
+}
+
+struct StressRead : public LocMsg {
+    uint32_t* mLastVersion;
+    inline StressRead(uint32_t* lastVersion) :
+        LocMsg(), mLastVersion(lastVersion) {}
+    inline virtual void proc() const {
+        const loc_eng_conf_snapshot* conf = loc_eng_conf_get();
+        uint32_t version = conf->version;
+        bool ok = stress_consistent(conf) && version >= *mLastVersion;
+
+        // let the writers publish a few more in the meantime
+        for (volatile int i = 0; i < 2000; i++) {
+        }
+        ok = ok && stress_consistent(conf) && conf->version == version;
+
+        *mLastVersion = version;
+        __atomic_add_fetch(&sReads, 1, __ATOMIC_RELAXED);
+        if (!ok) {
+            __atomic_add_fetch(&sErrors, 1, __ATOMIC_RELAXED);
+        }
+    }
+};
+
+static void* stress_writer(void* arg)
+{
+    uint32_t publishes = *(uint32_t*)arg;
+    for (uint32_t i = 0; i < publishes; i++) {
+        stress_write(__atomic_add_fetch(&sSeq, 1, __ATOMIC_RELAXED));
+        __atomic_add_fetch(&sPublishes, 1, __ATOMIC_RELAXED);
+        if (0 == i % 64) {
+            usleep(100);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t workers = argc > 1 ? atoi(argv[1]) : 4;
+    uint32_t writers = argc > 2 ? atoi(argv[2]) : 2;
+    uint32_t publishes = argc > 3 ? atoi(argv[3]) : 20000;
+    uint32_t keys = argc > 4 ? atoi(argv[4]) : 16;
+    pthread_t threads[16];
+
+    if (workers < 1 || workers > MAX_MSG_TASK_WORKERS || writers < 1 || writers > 16 ||
+        keys < 1 || keys > STRESS_MAX_KEYS) {
+        printf("bad arguments\n");
+        return 1;
+    }
+
+    MsgTask* msgTask = new MsgTask((MsgTask::tCreate)NULL, "conf_stress", workers);
+    msgTask->setQueueCapacity(1024, eMSG_Q_OVERFLOW_BLOCK);
+    stress_write(0);
+    loc_eng_conf_attach(msgTask);
+
+    for (uint32_t i = 0; i < writers; i++) {
+        pthread_create(&threads[i], NULL, stress_writer, &publishes);
+    }
+    // readers are sent for as long as the writers go on
+    uint32_t sent = 0;
+    while (__atomic_load_n(&sPublishes, __ATOMIC_RELAXED) < writers * publishes) {
+        msgTask->sendMsg(new StressRead(&sLastVersion[sent % keys]),
+                         &sLastVersion[sent % keys]);
+        sent++;
+    }
+    for (uint32_t i = 0; i < writers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    while (__atomic_load_n(&sReads, __ATOMIC_RELAXED) < sent) {
+        usleep(1000);
+    }
+    // and the last snapshots replaced get freed
+    usleep(100000);
+
+    printf("%u workers, %u writers: %u publishes, %u reads, %u errors, "
+           "last version %u\n", workers, writers, sPublishes, sReads, sErrors,
+           loc_eng_conf_get()->version);
+    return sErrors != 0;
+}
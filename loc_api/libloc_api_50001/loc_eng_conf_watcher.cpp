@@ -0,0 +1,302 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <loc_eng_conf_watcher.h>
+#include "log_util.h"
+
+// a file being written, replaced, or removed and put back
+#define CONF_WATCHER_EVENTS (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | \
+                             IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+typedef struct {
+    int wd;             // watch of the directory, -1 if it has none
+    char name[NAME_MAX + 1];
+} loc_eng_conf_watcher_file;
+
+struct loc_eng_conf_watcher {
+    struct loc_eng_dmn_conn_thelper thelper;
+    int inotify_fd;
+    int wake_fd[2];
+    int debounce_ms;
+    // a change is waiting for the files to settle until deadline
+    bool pending;
+    uint64_t deadline;
+    loc_eng_conf_watcher_cb changed_cb;
+    void *context;
+    int file_cnt;
+    loc_eng_conf_watcher_file *files;
+};
+
+static uint64_t loc_eng_conf_watcher_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watcher_read
+
+DESCRIPTION
+   Read the pending inotify events and look for one about a watched file.
+   Other files in the same directories come and go unnoticed.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   true if a watched file changed, or events were lost
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_conf_watcher_read(loc_eng_conf_watcher *watcher)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t length;
+
+    while ((length = read(watcher->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + length; ) {
+            const struct inotify_event *event = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                LOC_LOGW("%s: inotify queue overflowed", __func__);
+                changed = true;
+                continue;
+            }
+            for (int i = 0; event->len > 0 && i < watcher->file_cnt; i++) {
+                if (watcher->files[i].wd == event->wd &&
+                    strcmp(watcher->files[i].name, event->name) == 0) {
+                    LOC_LOGD("%s: %s event 0x%x", __func__, event->name, event->mask);
+                    changed = true;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watcher_proc
+
+DESCRIPTION
+   One round of the watcher thread: wait for inotify events, or for the
+   files to settle after a change, and report the change once they have
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0, the thread carries on until the thelper is unblocked
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_conf_watcher_proc(void *context)
+{
+    loc_eng_conf_watcher *watcher = (loc_eng_conf_watcher*)context;
+    struct pollfd fds[2];
+    int timeout = -1;
+
+    fds[0].fd = watcher->wake_fd[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = watcher->inotify_fd;
+    fds[1].events = POLLIN;
+
+    if (watcher->pending) {
+        uint64_t now = loc_eng_conf_watcher_now();
+        timeout = watcher->deadline > now ? (int)(watcher->deadline - now) : 0;
+    }
+    if (poll(fds, 2, timeout) < 0) {
+        if (errno != EINTR) {
+            LOC_LOGE("%s: poll: %s", __func__, strerror(errno));
+        }
+        return 0;
+    }
+    if (watcher->thelper.thread_exit) {
+        return 0;
+    }
+
+    // every further event puts the deadline off again
+    if ((fds[1].revents & POLLIN) && loc_eng_conf_watcher_read(watcher)) {
+        watcher->pending = true;
+        watcher->deadline = loc_eng_conf_watcher_now() + watcher->debounce_ms;
+    }
+    if (watcher->pending && loc_eng_conf_watcher_now() >= watcher->deadline) {
+        watcher->pending = false;
+        watcher->changed_cb(watcher->context);
+    }
+    return 0;
+}
+
+static void loc_eng_conf_watcher_free(loc_eng_conf_watcher *watcher)
+{
+    if (watcher->inotify_fd >= 0) {
+        close(watcher->inotify_fd);
+    }
+    if (watcher->wake_fd[0] >= 0) {
+        close(watcher->wake_fd[0]);
+        close(watcher->wake_fd[1]);
+    }
+    free(watcher->files);
+    free(watcher);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watcher_start
+
+DESCRIPTION
+   Watch the directories of the given files and start the watcher thread
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   The watcher, NULL on failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_conf_watcher* loc_eng_conf_watcher_start(const char * const *paths, int pathCnt,
+                                                 int debounceMs,
+                                                 thelper_create_thread create_thread_cb,
+                                                 loc_eng_conf_watcher_cb changed_cb,
+                                                 void *context)
+{
+    int watched = 0;
+
+    if (NULL == paths || pathCnt < 1 || NULL == changed_cb) {
+        return NULL;
+    }
+    loc_eng_conf_watcher *watcher =
+        (loc_eng_conf_watcher*)calloc(1, sizeof(loc_eng_conf_watcher));
+    if (NULL == watcher) {
+        return NULL;
+    }
+    watcher->wake_fd[0] = watcher->wake_fd[1] = -1;
+    watcher->debounce_ms = debounceMs > 0 ? debounceMs : 0;
+    watcher->changed_cb = changed_cb;
+    watcher->context = context;
+    watcher->file_cnt = pathCnt;
+    watcher->files = (loc_eng_conf_watcher_file*)
+        calloc(pathCnt, sizeof(loc_eng_conf_watcher_file));
+    watcher->inotify_fd = inotify_init();
+    if (NULL == watcher->files || watcher->inotify_fd < 0 || pipe(watcher->wake_fd) < 0) {
+        LOC_LOGE("%s: %s", __func__, strerror(errno));
+        loc_eng_conf_watcher_free(watcher);
+        return NULL;
+    }
+    fcntl(watcher->inotify_fd, F_SETFL, O_NONBLOCK);
+
+    for (int i = 0; i < pathCnt; i++) {
+        char dir[PATH_MAX];
+        const char *slash = strrchr(paths[i], '/');
+        const char *name = (NULL == slash) ? paths[i] : slash + 1;
+        size_t dirLength = (NULL == slash) ? 0 : (size_t)(slash - paths[i]);
+
+        watcher->files[i].wd = -1;
+        if (strlen(name) > NAME_MAX || dirLength >= sizeof(dir)) {
+            LOC_LOGE("%s: %s: path too long", __func__, paths[i]);
+            continue;
+        }
+        if (NULL == slash) {
+            memcpy(dir, ".", 2);
+        } else if (0 == dirLength) {
+            memcpy(dir, "/", 2);
+        } else {
+            memcpy(dir, paths[i], dirLength);
+            dir[dirLength] = '\0';
+        }
+        memcpy(watcher->files[i].name, name, strlen(name) + 1);
+
+        // a directory watched twice gets the same wd
+        watcher->files[i].wd = inotify_add_watch(watcher->inotify_fd, dir, CONF_WATCHER_EVENTS);
+        if (watcher->files[i].wd < 0) {
+            LOC_LOGE("%s: %s: %s", __func__, dir, strerror(errno));
+        } else {
+            watched++;
+        }
+    }
+    if (0 == watched) {
+        loc_eng_conf_watcher_free(watcher);
+        return NULL;
+    }
+
+    if (loc_eng_dmn_conn_launch_thelper(&watcher->thelper, NULL, NULL,
+                                        loc_eng_conf_watcher_proc, NULL,
+                                        create_thread_cb, watcher) != 0) {
+        LOC_LOGE("%s: could not start the watcher thread", __func__);
+        loc_eng_conf_watcher_free(watcher);
+        return NULL;
+    }
+
+    LOC_LOGI("%s: watching %d of %d files, %d ms debounce",
+             __func__, watched, pathCnt, watcher->debounce_ms);
+    return watcher;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_conf_watcher_stop
+
+DESCRIPTION
+   Stop the watcher thread and free the watcher. A change that is still
+   settling is not reported.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_conf_watcher_stop(loc_eng_conf_watcher *watcher)
+{
+    loc_eng_dmn_conn_unblock_thelper(&watcher->thelper);
+    if (write(watcher->wake_fd[1], "", 1) < 0) {
+        LOC_LOGE("%s: %s", __func__, strerror(errno));
+    }
+    loc_eng_dmn_conn_join_thelper(&watcher->thelper);
+    loc_eng_conf_watcher_free(watcher);
+}
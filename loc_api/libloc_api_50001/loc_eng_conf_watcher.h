@@ -0,0 +1,63 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_CONF_WATCHER_H
+#define LOC_ENG_CONF_WATCHER_H
+
+#include <loc_eng_dmn_conn_thread_helper.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Watches configuration files for changes with inotify. The directories
+   are watched rather than the files, so files replaced by a rename, as
+   most editors save them, keep being watched. Editors also tend to write
+   a file in several steps; the callback only comes once the files have
+   been left alone for the debounce time. */
+typedef struct loc_eng_conf_watcher loc_eng_conf_watcher;
+
+/* Called from the watcher thread after one or more of the files changed */
+typedef void (*loc_eng_conf_watcher_cb)(void *context);
+
+/* Returns NULL if none of the files can be watched */
+loc_eng_conf_watcher* loc_eng_conf_watcher_start(const char * const *paths, int pathCnt,
+                                                 int debounceMs,
+                                                 thelper_create_thread create_thread_cb,
+                                                 loc_eng_conf_watcher_cb changed_cb,
+                                                 void *context);
+
+/* Stops the watcher thread and frees the watcher */
+void loc_eng_conf_watcher_stop(loc_eng_conf_watcher *watcher);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // LOC_ENG_CONF_WATCHER_H
@@ -60,8 +60,12 @@ struct LocEngPositionMode : public LocMsg {
     LocEngAdapter* mAdapter;
     const LocPosMode mPosMode;
     LocEngPositionMode(LocEngAdapter* adapter, LocPosMode &mode);
+    inline virtual const char* name() const { return "LocEngPositionMode"; }
     virtual void proc() const;
     virtual void log() const;
+    inline virtual msg_q_prio_type priority() const {
+        return eMSG_Q_PRIO_HIGH;
+    }
     void send() const;
 };
 
@@ -69,18 +73,26 @@ struct LocEngPositionMode : public LocMsg {
 struct LocEngStartFix : public LocMsg {
     LocEngAdapter* mAdapter;
     LocEngStartFix(LocEngAdapter* adapter);
+    inline virtual const char* name() const { return "LocEngStartFix"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    inline virtual msg_q_prio_type priority() const {
+        return eMSG_Q_PRIO_HIGH;
+    }
     void send() const;
 };
 
 struct LocEngStopFix : public LocMsg {
     LocEngAdapter* mAdapter;
     LocEngStopFix(LocEngAdapter* adapter);
+    inline virtual const char* name() const { return "LocEngStopFix"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    inline virtual msg_q_prio_type priority() const {
+        return eMSG_Q_PRIO_HIGH;
+    }
     void send() const;
 };
 
@@ -97,9 +109,21 @@ struct LocEngReportPosition : public LocMsg {
                          void* locExt,
                          enum loc_sess_status st,
                          LocPosTechMask technology);
+    virtual ~LocEngReportPosition();
+    inline virtual const char* name() const { return "LocEngReportPosition"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    inline virtual msg_q_prio_type priority() const {
+        return eMSG_Q_PRIO_HIGH;
+    }
+    inline virtual LocMsgSlot* supersedeKey() const {
+        return ((LocEngAdapter*)mAdapter)->getPositionSlot();
+    }
+    // final fixes and session failures must always be delivered
+    inline virtual bool supersedable() const {
+        return LOC_SESS_INTERMEDIATE == mStatus;
+    }
     void send() const;
 };
 
@@ -112,9 +136,13 @@ struct LocEngReportSv : public LocMsg {
                    GpsSvStatus &sv,
                    GpsLocationExtended &locExtended,
                    void* svExtended);
+    inline virtual const char* name() const { return "LocEngReportSv"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    inline virtual LocMsgSlot* supersedeKey() const {
+        return ((LocEngAdapter*)mAdapter)->getSvSlot();
+    }
     void send() const;
 };
 
@@ -123,9 +151,13 @@ struct LocEngReportStatus : public LocMsg {
     const GpsStatusValue mStatus;
     LocEngReportStatus(LocAdapterBase* adapter,
                        GpsStatusValue engineStatus);
+    inline virtual const char* name() const { return "LocEngReportStatus"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    inline virtual msg_q_prio_type priority() const {
+        return eMSG_Q_PRIO_HIGH;
+    }
 };
 
 struct LocEngReportNmea : public LocMsg {
@@ -138,9 +170,13 @@ struct LocEngReportNmea : public LocMsg {
     {
         delete[] mNmea;
     }
+    inline virtual const char* name() const { return "LocEngReportNmea"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    // never superseded: the sentences of an epoch go out together and
+    // in order, or a client could mix them with those of the next one
+    inline virtual bool droppable() const { return true; }
 };
 
 struct LocEngReportXtraServer : public LocMsg {
@@ -154,6 +190,7 @@ struct LocEngReportXtraServer : public LocMsg {
     {
         delete[] mServers;
     }
+    inline virtual const char* name() const { return "LocEngReportXtraServer"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -162,6 +199,7 @@ struct LocEngReportXtraServer : public LocMsg {
 struct LocEngSuplEsOpened : public LocMsg {
     void* mLocEng;
     LocEngSuplEsOpened(void* locEng);
+    inline virtual const char* name() const { return "LocEngSuplEsOpened"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -170,6 +208,7 @@ struct LocEngSuplEsOpened : public LocMsg {
 struct LocEngSuplEsClosed : public LocMsg {
     void* mLocEng;
     LocEngSuplEsClosed(void* locEng);
+    inline virtual const char* name() const { return "LocEngSuplEsClosed"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -179,6 +218,7 @@ struct LocEngRequestSuplEs : public LocMsg {
     void* mLocEng;
     const int mID;
     LocEngRequestSuplEs(void* locEng, int id);
+    inline virtual const char* name() const { return "LocEngRequestSuplEs"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -190,6 +230,7 @@ struct LocEngRequestATL : public LocMsg {
     const AGpsExtType mType;
     LocEngRequestATL(void* locEng, int id,
                      AGpsExtType agps_type);
+    inline virtual const char* name() const { return "LocEngRequestATL"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -199,6 +240,7 @@ struct LocEngReleaseATL : public LocMsg {
     void* mLocEng;
     const int mID;
     LocEngReleaseATL(void* locEng, int id);
+    inline virtual const char* name() const { return "LocEngReleaseATL"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -213,6 +255,7 @@ struct LocEngReqRelBIT : public LocMsg {
     LocEngReqRelBIT(void* instance, AGpsExtType type,
                     int ipv4, char* ipv6, bool isReq);
     virtual ~LocEngReqRelBIT();
+    inline virtual const char* name() const { return "LocEngReqRelBIT"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -230,6 +273,7 @@ struct LocEngReqRelWifi : public LocMsg {
                      loc_if_req_sender_id_e_type sender_id,
                      char* s, char* p, bool isReq);
     virtual ~LocEngReqRelWifi();
+    inline virtual const char* name() const { return "LocEngReqRelWifi"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -239,6 +283,7 @@ struct LocEngReqRelWifi : public LocMsg {
 struct LocEngRequestXtra : public LocMsg {
     void* mLocEng;
     LocEngRequestXtra(void* locEng);
+    inline virtual const char* name() const { return "LocEngRequestXtra"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -247,6 +292,7 @@ struct LocEngRequestXtra : public LocMsg {
 struct LocEngRequestTime : public LocMsg {
     void* mLocEng;
     LocEngRequestTime(void* locEng);
+    inline virtual const char* name() const { return "LocEngRequestTime"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -259,6 +305,7 @@ struct LocEngRequestNi : public LocMsg {
     LocEngRequestNi(void* locEng,
                     GpsNiNotification &notif,
                     const void* data);
+    inline virtual const char* name() const { return "LocEngRequestNi"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -267,6 +314,7 @@ struct LocEngRequestNi : public LocMsg {
 struct LocEngDown : public LocMsg {
     void* mLocEng;
     LocEngDown(void* locEng);
+    inline virtual const char* name() const { return "LocEngDown"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -275,6 +323,7 @@ struct LocEngDown : public LocMsg {
 struct LocEngUp : public LocMsg {
     void* mLocEng;
     LocEngUp(void* locEng);
+    inline virtual const char* name() const { return "LocEngUp"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -283,6 +332,7 @@ struct LocEngUp : public LocMsg {
 struct LocEngGetZpp : public LocMsg {
     LocEngAdapter* mAdapter;
     LocEngGetZpp(LocEngAdapter* adapter);
+    inline virtual const char* name() const { return "LocEngGetZpp"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -294,14 +344,19 @@ struct LocEngReportGpsMeasurement : public LocMsg {
     const GpsData mGpsData;
     LocEngReportGpsMeasurement(void* locEng,
                                GpsData &gpsData);
+    inline virtual const char* name() const {
+        return "LocEngReportGpsMeasurement";
+    }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
+    inline virtual bool droppable() const { return true; }
 };
 
 struct LocEngShutdown : public LocMsg {
     LocEngAdapter* mAdapter;
     LocEngShutdown(LocEngAdapter* adapter);
+    inline virtual const char* name() const { return "LocEngShutdown"; }
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
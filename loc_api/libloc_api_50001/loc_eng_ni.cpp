@@ -59,7 +59,11 @@ using namespace loc_core;
  *                             FUNCTION DECLARATIONS
  *
  *============================================================================*/
-static void* ni_thread_proc(void *args);
+static void loc_eng_ni_session_end(loc_eng_ni_data_s_type* loc_eng_ni_data_p,
+                                   int reqID, GpsUserResponseType resp);
+static void loc_eng_ni_handle_response(loc_eng_data_s_type &loc_eng_data,
+                                       int notif_id,
+                                       GpsUserResponseType user_response);
 
 struct LocEngInformNiResponse : public LocMsg {
     LocEngAdapter* mAdapter;
@@ -80,6 +84,7 @@ struct LocEngInformNiResponse : public LocMsg {
         // mPayload actually won't be NULL here.
         free((void*)mPayload);
     }
+    inline virtual const char* name() const { return "LocEngInformNiResponse"; }
     inline virtual void proc() const
     {
         mAdapter->informNiResponse(mResponse, mPayload);
@@ -97,13 +102,64 @@ struct LocEngInformNiResponse : public LocMsg {
     }
 };
 
+// sends 'no response' once the user has not answered in time
+struct LocEngNiTimeout : public LocMsg {
+    loc_eng_ni_data_s_type* mNiData;
+    const int mReqID;
+    inline LocEngNiTimeout(loc_eng_ni_data_s_type* niData, int reqID) :
+        LocMsg(), mNiData(niData), mReqID(reqID)
+    {
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngNiTimeout"; }
+    inline virtual void proc() const
+    {
+        loc_eng_ni_session_end(mNiData, mReqID, GPS_NI_RESPONSE_NORESP);
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNiTimeout - reqID: %d", mReqID);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+// carries a user response over to the MsgTask, where the sessions live
+struct LocEngNiRespond : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int mNotifId;
+    const GpsUserResponseType mResponse;
+    inline LocEngNiRespond(loc_eng_data_s_type* locEng, int notifId,
+                           GpsUserResponseType resp) :
+        LocMsg(), mLocEng(locEng), mNotifId(notifId), mResponse(resp)
+    {
+        locallog();
+    }
+    inline virtual const char* name() const { return "LocEngNiRespond"; }
+    inline virtual void proc() const
+    {
+        loc_eng_ni_handle_response(*mLocEng, mNotifId, mResponse);
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNiRespond - notif_id: %d response: %s",
+                 mNotifId, loc_get_ni_response_name(mResponse));
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
 /*===========================================================================
 
 FUNCTION loc_eng_ni_request_handler
 
 DESCRIPTION
-   Displays the NI request and awaits user input. If a previous request is
-   in session, it is ignored.
+   Displays the NI request and awaits user input. If there is no free
+   session for it, it is ignored. Runs on the MsgTask.
 
 RETURN VALUE
    none
@@ -133,16 +189,24 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
         } else {
             pSession = &loc_eng_ni_data_p->sessionEs;
         }
+    } else if (NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
+        LOC_LOGW("loc_eng_ni_request_handler, supl es NI in progress, new supl NI ignored, type: %d",
+                 notif->ni_type);
+        if (NULL != passThrough) {
+            free((void*)passThrough);
+        }
     } else {
-        if (NULL != loc_eng_ni_data_p->session.rawRequest ||
-            NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-            LOC_LOGW("loc_eng_ni_request_handler, supl NI in progress, new supl NI ignored, type: %d",
-                     notif->ni_type);
+        for (int i = 0; i < LOC_NI_MAX_SESSIONS && NULL == pSession; i++) {
+            if (NULL == loc_eng_ni_data_p->sessions[i].rawRequest) {
+                pSession = &loc_eng_ni_data_p->sessions[i];
+            }
+        }
+        if (NULL == pSession) {
+            LOC_LOGW("loc_eng_ni_request_handler, %d supl NI in progress, new supl NI ignored, type: %d",
+                     LOC_NI_MAX_SESSIONS, notif->ni_type);
             if (NULL != passThrough) {
                 free((void*)passThrough);
             }
-        } else {
-            pSession = &loc_eng_ni_data_p->session;
         }
     }
 
@@ -170,23 +234,15 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
             LOC_LOGI("              extras: %s", notif->extras);
         }
 
-        /* For robustness, spawn a thread at this point to timeout to clear up the notification status, even though
-         * the OEM layer in java does not do so.
+        /* For robustness, time the session out to clear up the notification status, even though
+         * the OEM layer in java does not do so. The timer runs on the MsgTask, like the session.
          **/
-        pSession->respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
-        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", pSession->respTimeLeft);
+        int respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
+        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", respTimeLeft);
 
-        int rc = 0;
-        rc = pthread_create(&pSession->thread, NULL, ni_thread_proc, pSession);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not created.\n");
-        }
-        rc = pthread_detach(pSession->thread);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not detached.\n");
-        }
+        pSession->timer = pSession->adapter->sendMsgDelayed(
+            new LocEngNiTimeout(loc_eng_ni_data_p, pSession->reqID),
+            respTimeLeft * 1000);
 
         CALLBACK_LOG_CALLFLOW("ni_notify_cb - id", %d, notif->notification_id);
         loc_eng_data.ni_notify_cb((GpsNiNotification*)notif);
@@ -196,76 +252,74 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
 
 /*===========================================================================
 
-FUNCTION ni_thread_proc
+FUNCTION loc_eng_ni_find_session
+
+DESCRIPTION
+   Finds the session in progress with the given request ID.
+
+RETURN VALUE
+   the session; NULL if there is none
 
 ===========================================================================*/
-static void* ni_thread_proc(void *args)
+static loc_eng_ni_session_s_type*
+loc_eng_ni_find_session(loc_eng_ni_data_s_type* loc_eng_ni_data_p, int reqID)
 {
-    ENTRY_LOG();
+    if (reqID == loc_eng_ni_data_p->sessionEs.reqID &&
+        NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
+        return &loc_eng_ni_data_p->sessionEs;
+    }
+    for (int i = 0; i < LOC_NI_MAX_SESSIONS; i++) {
+        if (reqID == loc_eng_ni_data_p->sessions[i].reqID &&
+            NULL != loc_eng_ni_data_p->sessions[i].rawRequest) {
+            return &loc_eng_ni_data_p->sessions[i];
+        }
+    }
+    return NULL;
+}
 
-    loc_eng_ni_session_s_type* pSession = (loc_eng_ni_session_s_type*)args;
-    int rc = 0;          /* return code from pthread calls */
+/*===========================================================================
 
-    struct timeval present_time;
-    struct timespec expire_time;
+FUNCTION loc_eng_ni_session_end
 
-    LOC_LOGD("Starting Loc NI thread...\n");
-    pthread_mutex_lock(&pSession->tLock);
-    /* Calculate absolute expire time */
-    gettimeofday(&present_time, NULL);
-    expire_time.tv_sec  = present_time.tv_sec + pSession->respTimeLeft;
-    expire_time.tv_nsec = present_time.tv_usec * 1000;
-    LOC_LOGD("ni_thread_proc-Time out set for abs time %ld with delay %d sec\n",
-             (long) expire_time.tv_sec, pSession->respTimeLeft );
+DESCRIPTION
+   Ends the session with the given request ID, if it is still in progress,
+   sending resp to the engine unless it is GPS_NI_RESPONSE_IGNORE.
 
-    while (!pSession->respRecvd)
-    {
-        rc = pthread_cond_timedwait(&pSession->tCond,
-                                    &pSession->tLock,
-                                    &expire_time);
-        if (rc == ETIMEDOUT)
-        {
-            pSession->resp = GPS_NI_RESPONSE_NORESP;
-            LOC_LOGD("ni_thread_proc-Thread time out after valting for specified time. Ret Val %d\n",rc );
-            break;
-        }
+RETURN VALUE
+   none
+
+===========================================================================*/
+static void loc_eng_ni_session_end(loc_eng_ni_data_s_type* loc_eng_ni_data_p,
+                                   int reqID, GpsUserResponseType resp)
+{
+    ENTRY_LOG();
+    loc_eng_ni_session_s_type* pSession =
+        loc_eng_ni_find_session(loc_eng_ni_data_p, reqID);
+
+    if (NULL == pSession) {
+        EXIT_LOG(%s, "session already ended");
+        return;
     }
-    LOC_LOGD("ni_thread_proc-Java layer has sent us a user response and return value from "
-             "pthread_cond_timedwait = %d\n",rc );
-    pSession->respRecvd = FALSE; /* Reset the user response flag for the next session*/
 
-    LOC_LOGD("pSession->resp is %d\n",pSession->resp);
+    LOC_LOGD("pSession->resp is %d\n", resp);
 
-    // adding this check to support modem restart, in which case, we need the thread
-    // to exit without calling sending data. We made sure that rawRequest is NULL in
-    // loc_eng_ni_reset_on_engine_restart()
     LocEngAdapter* adapter = pSession->adapter;
-    LocEngInformNiResponse *msg = NULL;
-
-    if (NULL != pSession->rawRequest) {
-        if (pSession->resp != GPS_NI_RESPONSE_IGNORE) {
-            LOC_LOGD("pSession->resp != GPS_NI_RESPONSE_IGNORE \n");
-            msg = new LocEngInformNiResponse(adapter,
-                                             pSession->resp,
-                                             pSession->rawRequest);
-        } else {
-            LOC_LOGD("this is the ignore reply for SUPL ES\n");
-            free(pSession->rawRequest);
-        }
-        pSession->rawRequest = NULL;
+    if (resp != GPS_NI_RESPONSE_IGNORE) {
+        LOC_LOGD("pSession->resp != GPS_NI_RESPONSE_IGNORE \n");
+        adapter->sendMsg(new LocEngInformNiResponse(adapter, resp,
+                                                    pSession->rawRequest));
+    } else {
+        LOC_LOGD("this is the ignore reply for SUPL ES\n");
+        free(pSession->rawRequest);
     }
-    pthread_mutex_unlock(&pSession->tLock);
 
-    pSession->respTimeLeft = 0;
+    // a no-op if this is the timeout itself
+    adapter->cancelMsg(pSession->timer);
+    pSession->rawRequest = NULL;
     pSession->reqID = 0;
-
-    if (NULL != msg) {
-        LOC_LOGD("ni_thread_proc: adapter->sendMsg(msg)\n");
-        adapter->sendMsg(msg);
-    }
+    pSession->timer = 0;
 
     EXIT_LOG(%s, VOID_RET);
-    return NULL;
 }
 
 void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
@@ -278,29 +332,15 @@ void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
         return;
     }
 
-    // only if modem has requested but then died.
-    if (NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-        free(loc_eng_ni_data_p->sessionEs.rawRequest);
-        loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
-
-        pthread_mutex_lock(&loc_eng_ni_data_p->sessionEs.tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->sessionEs.respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->sessionEs.tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->sessionEs.tLock);
-    }
-
-    if (NULL != loc_eng_ni_data_p->session.rawRequest) {
-        free(loc_eng_ni_data_p->session.rawRequest);
-        loc_eng_ni_data_p->session.rawRequest = NULL;
-
-        pthread_mutex_lock(&loc_eng_ni_data_p->session.tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->session.respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->session.tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->session.tLock);
+    // only if modem has requested but then died, the sessions just
+    // end, as there is no one to respond to any more.
+    for (int i = -1; i < LOC_NI_MAX_SESSIONS; i++) {
+        loc_eng_ni_session_s_type* pSession = i < 0 ?
+            &loc_eng_ni_data_p->sessionEs : &loc_eng_ni_data_p->sessions[i];
+        if (NULL != pSession->rawRequest) {
+            loc_eng_ni_session_end(loc_eng_ni_data_p, pSession->reqID,
+                                   (GpsUserResponseType)GPS_NI_RESPONSE_IGNORE);
+        }
     }
 
     EXIT_LOG(%s, VOID_RET);
@@ -334,19 +374,7 @@ void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiExtCallbacks *callb
         EXIT_LOG(%s, "loc_eng_ni_init: already inited.");
     } else {
         loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-        loc_eng_ni_data_p->sessionEs.respTimeLeft = 0;
-        loc_eng_ni_data_p->sessionEs.respRecvd = FALSE;
-        loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
-        loc_eng_ni_data_p->sessionEs.reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->sessionEs.tCond, NULL);
-        pthread_mutex_init(&loc_eng_ni_data_p->sessionEs.tLock, NULL);
-
-        loc_eng_ni_data_p->session.respTimeLeft = 0;
-        loc_eng_ni_data_p->session.respRecvd = FALSE;
-        loc_eng_ni_data_p->session.rawRequest = NULL;
-        loc_eng_ni_data_p->session.reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->session.tCond, NULL);
-        pthread_mutex_init(&loc_eng_ni_data_p->session.tLock, NULL);
+        memset(loc_eng_ni_data_p, 0, sizeof(*loc_eng_ni_data_p));
 
         loc_eng_data.ni_notify_cb = callbacks->notify_cb;
         EXIT_LOG(%s, VOID_RET);
@@ -357,7 +385,8 @@ void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiExtCallbacks *callb
 FUNCTION    loc_eng_ni_respond
 
 DESCRIPTION
-   This function receives user response from upper layer framework
+   This function receives user response from upper layer framework, and
+   hands it over to the MsgTask
 
 DEPENDENCIES
    NONE
@@ -373,42 +402,61 @@ void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
                         int notif_id, GpsUserResponseType user_response)
 {
     ENTRY_LOG_CALLFLOW();
-    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-    loc_eng_ni_session_s_type* pSession = NULL;
 
     if (NULL == loc_eng_data.ni_notify_cb) {
         EXIT_LOG(%s, "loc_eng_ni_init hasn't happened yet.");
         return;
     }
 
+    loc_eng_data.adapter->sendMsg(
+        new LocEngNiRespond(&loc_eng_data, notif_id, user_response));
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_ni_handle_response
+
+DESCRIPTION
+   Ends the session the user responded to, on the MsgTask
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_ni_handle_response(loc_eng_data_s_type &loc_eng_data,
+                                       int notif_id,
+                                       GpsUserResponseType user_response)
+{
+    ENTRY_LOG();
+    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
+
+    if (NULL == loc_eng_ni_find_session(loc_eng_ni_data_p, notif_id)) {
+        LOC_LOGE("loc_eng_ni_respond: notif_id %d not an active session", notif_id);
+        EXIT_LOG(%s, VOID_RET);
+        return;
+    }
+
+    // ignore any SUPL NI non-Es session if a SUPL NI ES is accepted
     if (notif_id == loc_eng_ni_data_p->sessionEs.reqID &&
-        NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
-        pSession = &loc_eng_ni_data_p->sessionEs;
-        // ignore any SUPL NI non-Es session if a SUPL NI ES is accepted
-        if (user_response == GPS_NI_RESPONSE_ACCEPT &&
-            NULL != loc_eng_ni_data_p->session.rawRequest) {
-                pthread_mutex_lock(&loc_eng_ni_data_p->session.tLock);
-                loc_eng_ni_data_p->session.resp = GPS_NI_RESPONSE_IGNORE;
-                loc_eng_ni_data_p->session.respRecvd = TRUE;
-                pthread_cond_signal(&loc_eng_ni_data_p->session.tCond);
-                pthread_mutex_unlock(&loc_eng_ni_data_p->session.tLock);
+        user_response == GPS_NI_RESPONSE_ACCEPT) {
+        for (int i = 0; i < LOC_NI_MAX_SESSIONS; i++) {
+            if (NULL != loc_eng_ni_data_p->sessions[i].rawRequest) {
+                loc_eng_ni_session_end(loc_eng_ni_data_p,
+                                       loc_eng_ni_data_p->sessions[i].reqID,
+                                       (GpsUserResponseType)GPS_NI_RESPONSE_IGNORE);
+            }
         }
-    } else if (notif_id == loc_eng_ni_data_p->session.reqID &&
-        NULL != loc_eng_ni_data_p->session.rawRequest) {
-        pSession = &loc_eng_ni_data_p->session;
     }
 
-    if (pSession) {
-        LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", user_response, notif_id);
-        pthread_mutex_lock(&pSession->tLock);
-        pSession->resp = user_response;
-        pSession->respRecvd = TRUE;
-        pthread_cond_signal(&pSession->tCond);
-        pthread_mutex_unlock(&pSession->tLock);
-    }
-    else {
-        LOC_LOGE("loc_eng_ni_respond: notif_id %d not an active session", notif_id);
-    }
+    LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", user_response, notif_id);
+    loc_eng_ni_session_end(loc_eng_ni_data_p, notif_id, user_response);
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -36,21 +36,18 @@
 #define LOC_NI_NO_RESPONSE_TIME            20                      /* secs */
 #define LOC_NI_NOTIF_KEY_ADDRESS           "Address"
 #define GPS_NI_RESPONSE_IGNORE             4
+#define LOC_NI_MAX_SESSIONS                4     /* concurrent SUPL NI sessions */
 
+/* Sessions are only ever touched on the MsgTask, so they need no locking */
 typedef struct {
-    pthread_t               thread;            /* NI thread */
-    int                     respTimeLeft;       /* examine time for NI response */
-    bool                    respRecvd;   /* NI User reponse received or not from Java layer*/
-    void*                   rawRequest;
+    void*                   rawRequest;    /* NULL if the session is free */
     int                     reqID;         /* ID to check against response */
-    GpsUserResponseType     resp;
-    pthread_cond_t          tCond;
-    pthread_mutex_t         tLock;
+    MsgTask::tTimerId       timer;         /* sends no response on expiry */
     LocEngAdapter*          adapter;
 } loc_eng_ni_session_s_type;
 
 typedef struct {
-    loc_eng_ni_session_s_type session;    /* SUPL NI Session */
+    loc_eng_ni_session_s_type sessions[LOC_NI_MAX_SESSIONS]; /* SUPL NI Sessions */
     loc_eng_ni_session_s_type sessionEs;  /* Emergency SUPL NI Session */
     int reqIDCounter;
 } loc_eng_ni_data_s_type;
@@ -0,0 +1,259 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stress test of the NI sessions. Thousands of NI requests, every so
+   many of them an emergency one, are handled on the MsgTask the way
+   LocEngRequestNi does, one after the other, while the main thread
+   answers the notifications, some of them at once, some a few requests
+   later and a few of them twice. The last sessions are left to time
+   out. Once they have, every session must be free again and no request
+   may have been answered to the LocApi more than once. The LocApi is a
+   stub, handed to the ContextBase by the LBS proxy this program
+   exports, so nothing reaches the modem. Best run under ASan too, which
+   catches payloads leaked or freed twice.
+   Usage: loc_eng_ni_stress [requests] [answer percent] [timeout secs] */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_ni_stress"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <LBSProxyBase.h>
+
+using namespace loc_core;
+
+#define STRESS_ES_EVERY 500
+#define STRESS_MAX_PENDING 64
+#define STRESS_PAYLOAD_MAGIC 0x4E495354
+
+static loc_eng_data_s_type sLocEng;
+static bool sStubLoaded = false;
+static uint32_t sProcessed = 0;
+static uint32_t sNotified = 0;
+static uint32_t sResponded = 0;
+static uint32_t sInformed[GPS_NI_RESPONSE_NORESP + 1];
+static uint32_t sErrors = 0;
+// notifications not answered yet, as the UI would hold them
+static int sPending[STRESS_MAX_PENDING];
+static uint32_t sPendingCnt = 0;
+static pthread_mutex_t sPendingMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// stands in for the modem; every payload must come back here once
+struct StressLocApi : public LocApiBase {
+    inline StressLocApi(const MsgTask* msgTask,
+                        LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                        ContextBase* context) :
+        LocApiBase(msgTask, exMask, context) {
+        sStubLoaded = true;
+    }
+    virtual enum loc_api_adapter_err
+        informNiResponse(GpsUserResponseType userResponse,
+                         const void* passThroughData) {
+        uint32_t* magic = (uint32_t*)passThroughData;
+        if (NULL == magic || STRESS_PAYLOAD_MAGIC != *magic ||
+            userResponse < GPS_NI_RESPONSE_ACCEPT ||
+            userResponse > GPS_NI_RESPONSE_NORESP) {
+            LOC_LOGE("%s] bad response %d, payload %p", __func__,
+                     userResponse, passThroughData);
+            __atomic_add_fetch(&sErrors, 1, __ATOMIC_RELAXED);
+        } else {
+            // a second answer for it would find 0 here, if ASan does
+            // not catch it reading the freed payload first
+            *magic = 0;
+            __atomic_add_fetch(&sInformed[userResponse], 1, __ATOMIC_RELAXED);
+        }
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+};
+
+struct StressLBSProxy : public LBSProxyBase {
+    inline virtual LocApiBase*
+        getLocApi(const MsgTask* msgTask,
+                  LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                  ContextBase* context) const {
+        return new StressLocApi(msgTask, exMask, context);
+    }
+};
+
+// found by ContextBase::getLBSProxy(NULL) in this program
+extern "C" LBSProxyBase* getLBSProxy()
+{
+    return new StressLBSProxy();
+}
+
+// what LocEngRequestNi carries over from the LocApi
+struct StressNiRequest : public LocMsg {
+    GpsNiNotification mNotify;
+    const void* mPayload;
+    inline StressNiRequest(GpsNiType type, int timeout) :
+        LocMsg(), mPayload(NULL) {
+        memset(&mNotify, 0, sizeof(mNotify));
+        mNotify.size = sizeof(mNotify);
+        mNotify.ni_type = type;
+        mNotify.timeout = timeout;
+        mNotify.default_response = GPS_NI_RESPONSE_NORESP;
+        uint32_t* magic = (uint32_t*)malloc(sizeof(uint32_t));
+        if (NULL != magic) {
+            *magic = STRESS_PAYLOAD_MAGIC;
+        }
+        mPayload = magic;
+    }
+    inline virtual void proc() const {
+        loc_eng_ni_request_handler(sLocEng, &mNotify, mPayload);
+        __atomic_add_fetch(&sProcessed, 1, __ATOMIC_RELEASE);
+    }
+};
+
+// counts the sessions still held, on the MsgTask where they live
+struct StressNiCheck : public LocMsg {
+    uint32_t* mBusy;
+    inline StressNiCheck(uint32_t* busy) : LocMsg(), mBusy(busy) {}
+    inline virtual void proc() const {
+        const loc_eng_ni_data_s_type* ni = &sLocEng.loc_eng_ni_data;
+        uint32_t busy = NULL != ni->sessionEs.rawRequest;
+        for (int i = 0; i < LOC_NI_MAX_SESSIONS; i++) {
+            busy += NULL != ni->sessions[i].rawRequest;
+        }
+        __atomic_store_n(mBusy, busy, __ATOMIC_RELEASE);
+    }
+};
+
+static void stress_notify(GpsNiNotification* notif)
+{
+    __atomic_add_fetch(&sNotified, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&sPendingMutex);
+    // the ones that do not fit are left to time out
+    if (sPendingCnt < STRESS_MAX_PENDING) {
+        sPending[sPendingCnt++] = notif->notification_id;
+    }
+    pthread_mutex_unlock(&sPendingMutex);
+}
+
+// answers each notification held with a chance of percent, the rest
+// are held on to for a later round
+static void stress_respond(uint32_t percent)
+{
+    pthread_mutex_lock(&sPendingMutex);
+    for (uint32_t i = 0; i < sPendingCnt; ) {
+        if ((uint32_t)(rand() % 100) >= percent) {
+            i++;
+            continue;
+        }
+        int id = sPending[i];
+        sPending[i] = sPending[--sPendingCnt];
+        GpsUserResponseType resp = rand() % 2 ?
+            GPS_NI_RESPONSE_ACCEPT : GPS_NI_RESPONSE_DENY;
+        loc_eng_ni_respond(sLocEng, id, resp);
+        sResponded++;
+        // the second answer must be dropped
+        if (0 == rand() % 10) {
+            loc_eng_ni_respond(sLocEng, id, resp);
+        }
+    }
+    pthread_mutex_unlock(&sPendingMutex);
+}
+
+// sends a request and waits for the MsgTask to have handled it
+static void stress_request(GpsNiType type, int timeout)
+{
+    uint32_t processed = __atomic_load_n(&sProcessed, __ATOMIC_ACQUIRE);
+    sLocEng.adapter->sendMsg(new StressNiRequest(type, timeout));
+    while (processed == __atomic_load_n(&sProcessed, __ATOMIC_ACQUIRE)) {
+        usleep(10);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t requests = argc > 1 ? atoi(argv[1]) : 5000;
+    uint32_t percent = argc > 2 ? atoi(argv[2]) : 50;
+    int timeout = argc > 3 ? atoi(argv[3]) : 1;
+
+    if (requests < 1 || percent > 100 || timeout < 1) {
+        printf("bad arguments\n");
+        return 1;
+    }
+
+    MsgTask* msgTask = new MsgTask((MsgTask::tCreate)NULL, "ni_stress");
+    ContextBase* context = new ContextBase(msgTask, 0, NULL);
+    if (!sStubLoaded) {
+        printf("stub LocApi not loaded, link with -rdynamic\n");
+        return 1;
+    }
+    sLocEng.adapter = new LocEngAdapter(0, &sLocEng, context,
+                                        (MsgTask::tCreate)NULL);
+    GpsNiExtCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.notify_cb = stress_notify;
+    loc_eng_ni_init(sLocEng, &callbacks);
+
+    for (uint32_t i = 0; i < requests; i++) {
+        stress_request(STRESS_ES_EVERY - 1 == i % STRESS_ES_EVERY ?
+                       GPS_NI_TYPE_EMERGENCY_SUPL : GPS_NI_TYPE_UMTS_SUPL,
+                       timeout);
+        stress_respond(percent);
+    }
+    // an id that never was
+    loc_eng_ni_respond(sLocEng, -1, GPS_NI_RESPONSE_ACCEPT);
+    stress_respond(100);
+
+    // and sessions no one answers
+    uint32_t notified = __atomic_load_n(&sNotified, __ATOMIC_RELAXED);
+    for (int i = 0; i < LOC_NI_MAX_SESSIONS; i++) {
+        stress_request(GPS_NI_TYPE_UMTS_SUPL, timeout);
+    }
+    uint32_t unanswered = __atomic_load_n(&sNotified, __ATOMIC_RELAXED) - notified;
+    // which time out 5 secs after their own timeout
+    sleep(timeout + 6);
+
+    uint32_t busy = (uint32_t)-1;
+    sLocEng.adapter->sendMsg(new StressNiCheck(&busy));
+    while ((uint32_t)-1 == __atomic_load_n(&busy, __ATOMIC_ACQUIRE)) {
+        usleep(1000);
+    }
+
+    uint32_t informed = sInformed[GPS_NI_RESPONSE_ACCEPT] +
+                        sInformed[GPS_NI_RESPONSE_DENY] +
+                        sInformed[GPS_NI_RESPONSE_NORESP];
+    // sessions ended to make way for an emergency one are not answered
+    if (busy > 0 || informed > sNotified || 0 == unanswered ||
+        sInformed[GPS_NI_RESPONSE_NORESP] < unanswered) {
+        sErrors++;
+    }
+    printf("%u requests: %u notified, %u responded, %u accepted, "
+           "%u denied, %u timed out, %u sessions held, %u errors\n",
+           requests, sNotified, sResponded,
+           sInformed[GPS_NI_RESPONSE_ACCEPT], sInformed[GPS_NI_RESPONSE_DENY],
+           sInformed[GPS_NI_RESPONSE_NORESP], busy, sErrors);
+    return sErrors != 0;
+}
@@ -29,32 +29,52 @@
 
 #define LOG_NDDEBUG 0
 #define LOG_TAG "LocSvc_eng_nmea"
-#define GPS_PRN_START 1
-#define GPS_PRN_END   32
-#define GLONASS_PRN_START 65
-#define GLONASS_PRN_END   96
 #include <loc_eng.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_nmea_writer.h>
+#include <loc_eng_nmea_server.h>
 #include <math.h>
 #include "log_util.h"
 
+// prn ranges of each constellation, where they sit in its used in fix
+// word and the SV id NMEA gives them
+static const struct {
+    int system;
+    int prnFirst;
+    int prnLast;
+    int bitFirst;
+    int idFirst;
+} sNmeaSvRanges[] = {
+    { LOC_NMEA_SYSTEM_GPS,       1,  32,  0,   1 },
+    { LOC_NMEA_SYSTEM_GPS,     193, 200, 32, 193 }, // QZSS
+    { LOC_NMEA_SYSTEM_GLONASS,  65,  96,  0,  65 },
+    { LOC_NMEA_SYSTEM_GALILEO, 301, 336,  0,   1 },
+    { LOC_NMEA_SYSTEM_BDS,     201, 237,  0,   1 }
+};
+#define NMEA_SV_RANGES (int)(sizeof(sNmeaSvRanges) / sizeof(sNmeaSvRanges[0]))
+
+static const char *sNmeaGsvTalker[LOC_NMEA_SYSTEMS] = {
+    "GPGSV,", "GLGSV,", "GAGSV,", "GBGSV,"
+};
+
 /*===========================================================================
-FUNCTION    loc_eng_nmea_send
+FUNCTION    loc_eng_nmea_deliver
 
 DESCRIPTION
-   send out NMEA sentence
+   hand NMEA text to nmea_cb, stamped with the current time, and to the
+   NMEA socket server
 
 DEPENDENCIES
    NONE
 
 RETURN VALUE
-   Total length of the nmea sentence
+   NONE
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p)
+static void loc_eng_nmea_deliver(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p)
 {
     struct timeval tv;
     gettimeofday(&tv, (struct timezone *) NULL);
@@ -62,14 +82,17 @@ void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_dat
     CALLBACK_LOG_CALLFLOW("nmea_cb", %p, pNmea);
     if (loc_eng_data_p->nmea_cb != NULL)
         loc_eng_data_p->nmea_cb(now, pNmea, length);
+    // length is one short for a single sentence, as nmea_cb always had it
+    if (loc_eng_data_p->nmea_server != NULL)
+        loc_eng_nmea_server_publish(loc_eng_data_p->nmea_server, pNmea, strlen(pNmea));
     LOC_LOGD("NMEA <%s", pNmea);
 }
 
 /*===========================================================================
-FUNCTION    loc_eng_nmea_put_checksum
+FUNCTION    loc_eng_nmea_send
 
 DESCRIPTION
-   Generate NMEA sentences generated based on position report
+   send out NMEA sentence, or add it to the epoch if sentences are batched
 
 DEPENDENCIES
    NONE
@@ -81,20 +104,425 @@ SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-int loc_eng_nmea_put_checksum(char *pNmea, int maxSize)
+void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p)
+{
+    if (!loc_eng_data_p->nmeaEpochBatch)
+    {
+        loc_eng_nmea_deliver(pNmea, length, loc_eng_data_p);
+        return;
+    }
+
+    int size = strlen(pNmea);
+    if (loc_eng_data_p->nmea_epoch_length + size >= NMEA_EPOCH_MAX_LENGTH)
+    {
+        LOC_LOGW("NMEA epoch exceeds %d bytes, sending it in parts",
+                 NMEA_EPOCH_MAX_LENGTH);
+        loc_eng_nmea_flush(loc_eng_data_p);
+    }
+    memcpy(loc_eng_data_p->nmea_epoch + loc_eng_data_p->nmea_epoch_length,
+           pNmea, size + 1);
+    loc_eng_data_p->nmea_epoch_length += size;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_flush
+
+DESCRIPTION
+   send out the sentences batched for the current epoch, all in one nmea_cb
+   with the length of the whole batch
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_flush(loc_eng_data_s_type *loc_eng_data_p)
+{
+    if (loc_eng_data_p->nmea_epoch_length > 0)
+    {
+        loc_eng_nmea_deliver(loc_eng_data_p->nmea_epoch,
+                             loc_eng_data_p->nmea_epoch_length,
+                             loc_eng_data_p);
+        loc_eng_data_p->nmea_epoch_length = 0;
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_config
+
+DESCRIPTION
+   Set which sentences are generated, and for each the number of epochs
+   it is generated once in. Takes effect with the next epoch, which gets
+   all enabled sentences.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_config(loc_eng_data_s_type *loc_eng_data_p, uint32_t sentenceMask,
+                         const uint32_t decimation[LOC_NMEA_SENTENCE_TYPES])
+{
+    loc_eng_data_p->nmea_sentence_mask = sentenceMask & LOC_NMEA_MASK_ALL;
+    for (int i = 0; i < LOC_NMEA_SENTENCE_TYPES; i++)
+    {
+        loc_eng_data_p->nmea_decimation[i] = decimation[i] ? decimation[i] : 1;
+        loc_eng_data_p->nmea_countdown[i] = 0;
+    }
+    LOC_LOGD("NMEA sentence mask 0x%X, decimation %u/%u/%u/%u/%u",
+             loc_eng_data_p->nmea_sentence_mask,
+             loc_eng_data_p->nmea_decimation[0], loc_eng_data_p->nmea_decimation[1],
+             loc_eng_data_p->nmea_decimation[2], loc_eng_data_p->nmea_decimation[3],
+             loc_eng_data_p->nmea_decimation[4]);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_wanted
+
+DESCRIPTION
+   Whether anyone takes the generated NMEA: nmea_cb, unless the framework
+   said it has no NMEA listeners, or a listener registered in the HAL
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   true if NMEA is to be generated
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+bool loc_eng_nmea_wanted(const loc_eng_data_s_type *loc_eng_data_p)
+{
+    return (loc_eng_data_p->nmea_cb != NULL && !loc_eng_data_p->nmeaFrameworkIdle) ||
+           loc_eng_data_p->nmea_listener_cnt > 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_demand
+
+DESCRIPTION
+   Count listeners in or out, and/or record whether the framework has NMEA
+   listeners (frameworkListening 1 or 0, -1 leaves it as is).
+   Going idle drops the half built epoch and the used in fix mask cached
+   for $GPGSA, which would be stale by the time anyone listens again.
+   Sentence selection and decimation are kept; the first epoch after
+   resuming carries all enabled sentences.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_demand(loc_eng_data_s_type *loc_eng_data_p, int listenerDelta,
+                         int frameworkListening)
+{
+    bool wasWanted = loc_eng_nmea_wanted(loc_eng_data_p);
+
+    loc_eng_data_p->nmea_listener_cnt += listenerDelta;
+    if (loc_eng_data_p->nmea_listener_cnt < 0)
+    {
+        LOC_LOGE("NMEA listener removed more often than added");
+        loc_eng_data_p->nmea_listener_cnt = 0;
+    }
+    if (frameworkListening >= 0)
+    {
+        loc_eng_data_p->nmeaFrameworkIdle = !frameworkListening;
+    }
+
+    bool wanted = loc_eng_nmea_wanted(loc_eng_data_p);
+    if (wasWanted && !wanted)
+    {
+        loc_eng_data_p->nmea_epoch_length = 0;
+        memset(loc_eng_data_p->sv_used_mask, 0, sizeof(loc_eng_data_p->sv_used_mask));
+    }
+    else if (!wasWanted && wanted)
+    {
+        memset(loc_eng_data_p->nmea_countdown, 0, sizeof(loc_eng_data_p->nmea_countdown));
+    }
+    LOC_LOGD("NMEA listeners %d, framework %s, generation %s",
+             loc_eng_data_p->nmea_listener_cnt,
+             loc_eng_data_p->nmeaFrameworkIdle ? "idle" : "listening",
+             wanted ? "on" : "off");
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_due
+
+DESCRIPTION
+   Count an epoch for the given sentences
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Those of the given sentences that are enabled and due this epoch
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static uint32_t loc_eng_nmea_due(loc_eng_data_s_type *loc_eng_data_p, uint32_t sentences)
+{
+    uint32_t due = 0;
+    sentences &= loc_eng_data_p->nmea_sentence_mask;
+
+    for (int i = 0; i < LOC_NMEA_SENTENCE_TYPES; i++)
+    {
+        if (sentences & (1 << i))
+        {
+            if (loc_eng_data_p->nmea_countdown[i] == 0)
+            {
+                loc_eng_data_p->nmea_countdown[i] = loc_eng_data_p->nmea_decimation[i] - 1;
+                due |= (1 << i);
+            }
+            else
+            {
+                loc_eng_data_p->nmea_countdown[i]--;
+            }
+        }
+    }
+    return due;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_finish
+
+DESCRIPTION
+   Close the sentence held by the writer and send it out
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if the sentence did not fit its buffer
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_nmea_finish(loc_eng_nmea_writer *w, loc_eng_data_s_type *loc_eng_data_p)
 {
-    uint8_t checksum = 0;
-    int length = 0;
+    int length = loc_eng_nmea_writer_end(w);
+    if (length < 0)
+    {
+        LOC_LOGE("NMEA Error in string formatting");
+        return false;
+    }
+    loc_eng_nmea_send(w->buf, length, loc_eng_data_p);
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_send_blank
+
+DESCRIPTION
+   Send a fixed sentence, fields holds everything between '$' and '*'
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_send_blank(const char *fields, loc_eng_data_s_type *loc_eng_data_p)
+{
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    loc_eng_nmea_writer w;
+    loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+    loc_eng_nmea_put_str(&w, fields);
+    loc_eng_nmea_finish(&w, loc_eng_data_p);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_send_blank_pos
+
+DESCRIPTION
+   Send the blank position sentences that are due, for epochs without a
+   final fix
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_send_blank_pos(loc_eng_data_s_type *loc_eng_data_p, uint32_t due)
+{
+    if (due & LOC_NMEA_MASK_GSA)
+        loc_eng_nmea_send_blank("GPGSA,A,1,,,,,,,,,,,,,,,", loc_eng_data_p);
+    if (due & LOC_NMEA_MASK_VTG)
+        loc_eng_nmea_send_blank("GPVTG,,T,,M,,N,,K,N", loc_eng_data_p);
+    if (due & LOC_NMEA_MASK_RMC)
+        loc_eng_nmea_send_blank("GPRMC,,V,,,,,,,,,,N", loc_eng_data_p);
+    if (due & LOC_NMEA_MASK_GGA)
+        loc_eng_nmea_send_blank("GPGGA,,,,,,0,,,,,,,,", loc_eng_data_p);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_lat_long
+
+DESCRIPTION
+   Append latitude and longitude as ddmm.mmmmmm,N,dddmm.mmmmmm,E,
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_put_lat_long(loc_eng_nmea_writer *w, double latitude, double longitude)
+{
+    char latHemisphere;
+    char lonHemisphere;
+
+    if (latitude > 0)
+    {
+        latHemisphere = 'N';
+    }
+    else
+    {
+        latHemisphere = 'S';
+        latitude *= -1.0;
+    }
+
+    if (longitude < 0)
+    {
+        lonHemisphere = 'W';
+        longitude *= -1.0;
+    }
+    else
+    {
+        lonHemisphere = 'E';
+    }
+
+    loc_eng_nmea_put_int(w, (uint8_t)latitude, 2);
+    loc_eng_nmea_put_fixed(w, loc_eng_nmea_minutes(latitude), 6, 9);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_char(w, latHemisphere);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, (uint8_t)longitude, 3);
+    loc_eng_nmea_put_fixed(w, loc_eng_nmea_minutes(longitude), 6, 9);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_char(w, lonHemisphere);
+    loc_eng_nmea_put_char(w, ',');
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_sv_id
+
+DESCRIPTION
+   NMEA SV id of the satellite in the given bit of a system's used in fix
+   word
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   SV id, 0 if the bit belongs to no satellite
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_nmea_sv_id(int system, int bit)
+{
+    for (int i = 0; i < NMEA_SV_RANGES; i++)
+    {
+        if (sNmeaSvRanges[i].system == system &&
+            bit >= sNmeaSvRanges[i].bitFirst &&
+            bit <= sNmeaSvRanges[i].bitFirst +
+                   sNmeaSvRanges[i].prnLast - sNmeaSvRanges[i].prnFirst)
+        {
+            return sNmeaSvRanges[i].idFirst + bit - sNmeaSvRanges[i].bitFirst;
+        }
+    }
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_gsa
 
-    pNmea++; //skip the $
-    while (*pNmea != '\0')
+DESCRIPTION
+   Append the SV ids of a GSA sentence, the first 12 set bits of the used
+   in fix word, followed by the DOPs
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_put_gsa(loc_eng_nmea_writer *w,
+                                 const loc_eng_data_s_type *loc_eng_data_p,
+                                 const GpsLocationExtended &locationExtended,
+                                 int system, uint64_t used)
+{
+    for (int i = 0; i < 12; i++) // only the first 12 sv go in sentence
     {
-        checksum ^= *pNmea++;
-        length++;
+        int svId = 0;
+        while (used != 0 && svId == 0)
+        {
+            svId = loc_eng_nmea_sv_id(system, __builtin_ctzll(used));
+            used &= used - 1;
+        }
+        if (svId != 0)
+            loc_eng_nmea_put_int(w, svId, 2);
+        loc_eng_nmea_put_char(w, ',');
     }
 
-    int checksumLength = snprintf(pNmea,(maxSize-length-1),"*%02X\r\n", checksum);
-    return (length + checksumLength);
+    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
+    {   // dop is in locationExtended, (QMI)
+        loc_eng_nmea_put_fixed(w, locationExtended.pdop, 1, 0);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_fixed(w, locationExtended.hdop, 1, 0);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_fixed(w, locationExtended.vdop, 1, 0);
+    }
+    else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
+    {   // dop was cached from sv report (RPC)
+        loc_eng_nmea_put_fixed(w, loc_eng_data_p->pdop, 1, 0);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_fixed(w, loc_eng_data_p->hdop, 1, 0);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_fixed(w, loc_eng_data_p->vdop, 1, 0);
+    }
+    else
+    {   // no dop
+        loc_eng_nmea_put_str(w, ",,");
+    }
 }
 
 /*===========================================================================
@@ -127,465 +555,320 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
     }
 
     char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
+    loc_eng_nmea_writer w;
     int utcYear = pTm->tm_year % 100; // 2 digit year
     int utcMonth = pTm->tm_mon + 1; // tm_mon starts at zero
     int utcDay = pTm->tm_mday;
     int utcHours = pTm->tm_hour;
     int utcMinutes = pTm->tm_min;
     int utcSeconds = pTm->tm_sec;
+    uint32_t due = loc_eng_nmea_due(loc_eng_data_p, LOC_NMEA_MASK_POS);
 
     if (generate_nmea) {
         // ------------------
         // ------$GPGSA------
         // ------------------
 
+        uint64_t used[LOC_NMEA_SYSTEMS];
         uint32_t svUsedCount = 0;
-        uint32_t svUsedList[32] = {0};
-        uint32_t mask = loc_eng_data_p->sv_used_mask;
-        for (uint8_t i = 1; mask > 0 && svUsedCount < 32; i++)
+        int systemsUsed = 0;
+        memcpy(used, loc_eng_data_p->sv_used_mask, sizeof(used));
+        for (int i = 0; i < LOC_NMEA_SYSTEMS; i++)
         {
-            if (mask & 1)
-                svUsedList[svUsedCount++] = i;
-            mask = mask >> 1;
+            svUsedCount += __builtin_popcountll(used[i]);
+            systemsUsed += (used[i] != 0);
         }
         // clear the cache so they can't be used again
-        loc_eng_data_p->sv_used_mask = 0;
-
-        char fixType;
-        if (svUsedCount == 0)
-            fixType = '1'; // no fix
-        else if (svUsedCount <= 3)
-            fixType = '2'; // 2D fix
-        else
-            fixType = '3'; // 3D fix
-
-        length = snprintf(pMarker, lengthRemaining, "$GPGSA,A,%c,", fixType);
+        memset(loc_eng_data_p->sv_used_mask, 0, sizeof(loc_eng_data_p->sv_used_mask));
 
-        if (length < 0 || length >= lengthRemaining)
+        if (due & LOC_NMEA_MASK_GSA)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
-        {
-            if (i < svUsedCount)
-                length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
+            char fixType;
+            if (svUsedCount == 0)
+                fixType = '1'; // no fix
+            else if (svUsedCount <= 3)
+                fixType = '2'; // 2D fix
             else
-                length = snprintf(pMarker, lengthRemaining, ",");
+                fixType = '3'; // 3D fix
 
-            if (length < 0 || length >= lengthRemaining)
+            if (systemsUsed == 0 || (systemsUsed == 1 && used[LOC_NMEA_SYSTEM_GPS] != 0))
             {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
+                // GPS alone goes out as it always has
+                loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+                loc_eng_nmea_put_str(&w, "GPGSA,A,");
+                loc_eng_nmea_put_char(&w, fixType);
+                loc_eng_nmea_put_char(&w, ',');
+                loc_eng_nmea_put_gsa(&w, loc_eng_data_p, locationExtended,
+                                     LOC_NMEA_SYSTEM_GPS, used[LOC_NMEA_SYSTEM_GPS]);
+                if (!loc_eng_nmea_finish(&w, loc_eng_data_p))
+                    return;
+            }
+            else
+            {
+                // a $GNGSA per system, tagged with the NMEA 4.10 system id
+                for (int i = 0; i < LOC_NMEA_SYSTEMS; i++)
+                {
+                    if (used[i] == 0)
+                        continue;
+                    loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+                    loc_eng_nmea_put_str(&w, "GNGSA,A,");
+                    loc_eng_nmea_put_char(&w, fixType);
+                    loc_eng_nmea_put_char(&w, ',');
+                    loc_eng_nmea_put_gsa(&w, loc_eng_data_p, locationExtended, i, used[i]);
+                    loc_eng_nmea_put_char(&w, ',');
+                    loc_eng_nmea_put_int(&w, i + 1, 0);
+                    if (!loc_eng_nmea_finish(&w, loc_eng_data_p))
+                        return;
+                }
             }
-            pMarker += length;
-            lengthRemaining -= length;
-        }
-
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-        {   // dop is in locationExtended, (QMI)
-            length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                              locationExtended.pdop,
-                              locationExtended.hdop,
-                              locationExtended.vdop);
-        }
-        else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-        {   // dop was cached from sv report (RPC)
-            length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                              loc_eng_data_p->pdop,
-                              loc_eng_data_p->hdop,
-                              loc_eng_data_p->vdop);
-        }
-        else
-        {   // no dop
-            length = snprintf(pMarker, lengthRemaining, ",,");
         }
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
         // ------------------
         // ------$GPVTG------
         // ------------------
 
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
-
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_BEARING)
+        if (due & LOC_NMEA_MASK_VTG)
         {
-            float magTrack = location.gpsLocation.bearing;
-            if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
+            loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+
+            if (location.gpsLocation.flags & GPS_LOCATION_HAS_BEARING)
             {
-                float magTrack = location.gpsLocation.bearing - locationExtended.magneticDeviation;
-                if (magTrack < 0.0)
-                    magTrack += 360.0;
-                else if (magTrack > 360.0)
-                    magTrack -= 360.0;
+                // the magnetic track has always gone out equal to the true
+                // track, keep it that way
+                float magTrack = location.gpsLocation.bearing;
+
+                loc_eng_nmea_put_str(&w, "GPVTG,");
+                loc_eng_nmea_put_fixed(&w, location.gpsLocation.bearing, 1, 0);
+                loc_eng_nmea_put_str(&w, ",T,");
+                loc_eng_nmea_put_fixed(&w, magTrack, 1, 0);
+                loc_eng_nmea_put_str(&w, ",M,");
+            }
+            else
+            {
+                loc_eng_nmea_put_str(&w, "GPVTG,,T,,M,");
             }
 
-            length = snprintf(pMarker, lengthRemaining, "$GPVTG,%.1lf,T,%.1lf,M,", location.gpsLocation.bearing, magTrack);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, "$GPVTG,,T,,M,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            if (location.gpsLocation.flags & GPS_LOCATION_HAS_SPEED)
+            {
+                float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
+                float speedKmPerHour = location.gpsLocation.speed * 3.6;
 
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_SPEED)
-        {
-            float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
-            float speedKmPerHour = location.gpsLocation.speed * 3.6;
+                loc_eng_nmea_put_fixed(&w, speedKnots, 1, 0);
+                loc_eng_nmea_put_str(&w, ",N,");
+                loc_eng_nmea_put_fixed(&w, speedKmPerHour, 1, 0);
+                loc_eng_nmea_put_str(&w, ",K,");
+            }
+            else
+            {
+                loc_eng_nmea_put_str(&w, ",N,,K,");
+            }
 
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,N,%.1lf,K,", speedKnots, speedKmPerHour);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",N,,K,");
-        }
+            if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
+                loc_eng_nmea_put_char(&w, 'N'); // N means no fix
+            else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
+                loc_eng_nmea_put_char(&w, 'A'); // A means autonomous
+            else
+                loc_eng_nmea_put_char(&w, 'D'); // D means differential
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            if (!loc_eng_nmea_finish(&w, loc_eng_data_p))
+                return;
         }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
-            length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
-            length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
-        else
-            length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
-
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
 
         // ------------------
         // ------$GPRMC------
         // ------------------
 
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
-
-        length = snprintf(pMarker, lengthRemaining, "$GPRMC,%02d%02d%02d,A," ,
-                          utcHours, utcMinutes, utcSeconds);
-
-        if (length < 0 || length >= lengthRemaining)
+        if (due & LOC_NMEA_MASK_RMC)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+            loc_eng_nmea_put_str(&w, "GPRMC,");
+            loc_eng_nmea_put_int(&w, utcHours, 2);
+            loc_eng_nmea_put_int(&w, utcMinutes, 2);
+            loc_eng_nmea_put_int(&w, utcSeconds, 2);
+            loc_eng_nmea_put_str(&w, ",A,");
 
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = location.gpsLocation.latitude;
-            double longitude = location.gpsLocation.longitude;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
+            if (location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)
             {
-                latHemisphere = 'N';
+                loc_eng_nmea_put_lat_long(&w, location.gpsLocation.latitude,
+                                          location.gpsLocation.longitude);
             }
             else
             {
-                latHemisphere = 'S';
-                latitude *= -1.0;
+                loc_eng_nmea_put_str(&w, ",,,,");
             }
 
-            if (longitude < 0)
+            if (location.gpsLocation.flags & GPS_LOCATION_HAS_SPEED)
             {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
+                float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
+                loc_eng_nmea_put_fixed(&w, speedKnots, 1, 0);
             }
-            else
+            loc_eng_nmea_put_char(&w, ',');
+
+            if (location.gpsLocation.flags & GPS_LOCATION_HAS_BEARING)
             {
-                lonHemisphere = 'E';
+                loc_eng_nmea_put_fixed(&w, location.gpsLocation.bearing, 1, 0);
             }
+            loc_eng_nmea_put_char(&w, ',');
 
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
-
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            loc_eng_nmea_put_int(&w, utcDay, 2);
+            loc_eng_nmea_put_int(&w, utcMonth, 2);
+            loc_eng_nmea_put_int(&w, utcYear, 2);
+            loc_eng_nmea_put_char(&w, ',');
 
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_SPEED)
-        {
-            float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,", speedKnots);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",");
-        }
+            if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
+            {
+                float magneticVariation = locationExtended.magneticDeviation;
+                char direction;
+                if (magneticVariation < 0.0)
+                {
+                    direction = 'W';
+                    magneticVariation *= -1.0;
+                }
+                else
+                {
+                    direction = 'E';
+                }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+                loc_eng_nmea_put_fixed(&w, magneticVariation, 1, 0);
+                loc_eng_nmea_put_char(&w, ',');
+                loc_eng_nmea_put_char(&w, direction);
+                loc_eng_nmea_put_char(&w, ',');
+            }
+            else
+            {
+                loc_eng_nmea_put_str(&w, ",,");
+            }
 
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_BEARING)
-        {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,", location.gpsLocation.bearing);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",");
-        }
+            if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
+                loc_eng_nmea_put_char(&w, 'N'); // N means no fix
+            else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
+                loc_eng_nmea_put_char(&w, 'A'); // A means autonomous
+            else
+                loc_eng_nmea_put_char(&w, 'D'); // D means differential
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            if (!loc_eng_nmea_finish(&w, loc_eng_data_p))
+                return;
         }
-        pMarker += length;
-        lengthRemaining -= length;
 
-        length = snprintf(pMarker, lengthRemaining, "%2.2d%2.2d%2.2d,",
-                          utcDay, utcMonth, utcYear);
+        // ------------------
+        // ------$GPGGA------
+        // ------------------
 
-        if (length < 0 || length >= lengthRemaining)
+        if (due & LOC_NMEA_MASK_GGA)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+            loc_eng_nmea_put_str(&w, "GPGGA,");
+            loc_eng_nmea_put_int(&w, utcHours, 2);
+            loc_eng_nmea_put_int(&w, utcMinutes, 2);
+            loc_eng_nmea_put_int(&w, utcSeconds, 2);
+            loc_eng_nmea_put_char(&w, ',');
 
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
-        {
-            float magneticVariation = locationExtended.magneticDeviation;
-            char direction;
-            if (magneticVariation < 0.0)
+            if (location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)
             {
-                direction = 'W';
-                magneticVariation *= -1.0;
+                loc_eng_nmea_put_lat_long(&w, location.gpsLocation.latitude,
+                                          location.gpsLocation.longitude);
             }
             else
             {
-                direction = 'E';
+                loc_eng_nmea_put_str(&w, ",,,,");
             }
 
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,%c,",
-                              magneticVariation, direction);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
-            length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
-            length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
-        else
-            length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
-
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        // ------------------
-        // ------$GPGGA------
-        // ------------------
-
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
+            char gpsQuality;
+            if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
+                gpsQuality = '0'; // 0 means no fix
+            else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
+                gpsQuality = '1'; // 1 means GPS fix
+            else
+                gpsQuality = '2'; // 2 means DGPS fix
 
-        length = snprintf(pMarker, lengthRemaining, "$GPGGA,%02d%02d%02d," ,
-                          utcHours, utcMinutes, utcSeconds);
+            loc_eng_nmea_put_char(&w, gpsQuality);
+            loc_eng_nmea_put_char(&w, ',');
+            loc_eng_nmea_put_int(&w, svUsedCount, 2);
+            loc_eng_nmea_put_char(&w, ',');
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
+            {   // dop is in locationExtended, (QMI)
+                loc_eng_nmea_put_fixed(&w, locationExtended.hdop, 1, 0);
+            }
+            else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
+            {   // dop was cached from sv report (RPC)
+                loc_eng_nmea_put_fixed(&w, loc_eng_data_p->hdop, 1, 0);
+            }
+            // else no hdop
+            loc_eng_nmea_put_char(&w, ',');
 
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = location.gpsLocation.latitude;
-            double longitude = location.gpsLocation.longitude;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
+            if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
             {
-                latHemisphere = 'N';
+                loc_eng_nmea_put_fixed(&w, locationExtended.altitudeMeanSeaLevel, 1, 0);
+                loc_eng_nmea_put_str(&w, ",M,");
             }
             else
             {
-                latHemisphere = 'S';
-                latitude *= -1.0;
+                loc_eng_nmea_put_str(&w, ",,");
             }
 
-            if (longitude < 0)
+            if ((location.gpsLocation.flags & GPS_LOCATION_HAS_ALTITUDE) &&
+                (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
             {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
+                loc_eng_nmea_put_fixed(&w, location.gpsLocation.altitude - locationExtended.altitudeMeanSeaLevel, 1, 0);
+                loc_eng_nmea_put_str(&w, ",M,,");
             }
             else
             {
-                lonHemisphere = 'E';
+                loc_eng_nmea_put_str(&w, ",,,");
             }
 
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
-
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        char gpsQuality;
-        if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
-            gpsQuality = '0'; // 0 means no fix
-        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
-            gpsQuality = '1'; // 1 means GPS fix
-        else
-            gpsQuality = '2'; // 2 means DGPS fix
-
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-        {   // dop is in locationExtended, (QMI)
-            length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                              gpsQuality, svUsedCount, locationExtended.hdop);
-        }
-        else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-        {   // dop was cached from sv report (RPC)
-            length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                              gpsQuality, svUsedCount, loc_eng_data_p->hdop);
-        }
-        else
-        {   // no hdop
-            length = snprintf(pMarker, lengthRemaining, "%c,%02d,,",
-                              gpsQuality, svUsedCount);
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
-        {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,M,",
-                              locationExtended.altitudeMeanSeaLevel);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if ((location.gpsLocation.flags & GPS_LOCATION_HAS_ALTITUDE) &&
-            (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
-        {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,M,,",
-                              location.gpsLocation.altitude - locationExtended.altitudeMeanSeaLevel);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,");
+            if (!loc_eng_nmea_finish(&w, loc_eng_data_p))
+                return;
         }
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
     }
     //Send blank NMEA reports for non-final fixes
     else {
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        loc_eng_nmea_send_blank_pos(loc_eng_data_p, due);
     }
     // clear the dop cache so they can't be used again
     loc_eng_data_p->pdop = 0;
     loc_eng_data_p->hdop = 0;
     loc_eng_data_p->vdop = 0;
 
+    // the position report closes the epoch
+    loc_eng_nmea_flush(loc_eng_data_p);
+
     EXIT_LOG(%d, 0);
 }
 
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_sv
 
+DESCRIPTION
+   Append one satellite block of a GSV sentence
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_put_sv(loc_eng_nmea_writer *w, const GpsSvInfo &sv, int svId)
+{
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, svId, 2);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, (int)(0.5 + sv.elevation), 2); //float to int
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, (int)(0.5 + sv.azimuth), 3); //float to int
+    loc_eng_nmea_put_char(w, ',');
+
+    if (sv.snr > 0)
+    {
+        loc_eng_nmea_put_int(w, (int)(0.5 + sv.snr), 2); //float to int
+    }
+}
 
 /*===========================================================================
 FUNCTION    loc_eng_nmea_generate_sv
@@ -609,210 +892,107 @@ void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
     ENTRY_LOG();
 
     char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
-    int svCount = svStatus.num_svs;
-    int sentenceCount = 0;
-    int sentenceNumber = 1;
-    int svNumber = 1;
-    int gpsCount = 0;
-    int glnCount = 0;
-
-    //Count GPS SVs for saparating GPS from GLONASS and throw others
-
-    for(svNumber=1; svNumber <= svCount; svNumber++) {
-        if( (svStatus.sv_list[svNumber-1].prn >= GPS_PRN_START)&&
-            (svStatus.sv_list[svNumber-1].prn <= GPS_PRN_END) )
-        {
-            gpsCount++;
-        }
-        else if( (svStatus.sv_list[svNumber-1].prn >= GLONASS_PRN_START) &&
-                 (svStatus.sv_list[svNumber-1].prn <= GLONASS_PRN_END) )
-        {
-            glnCount++;
-        }
-    }
+    loc_eng_nmea_writer w;
+    int svCount = svStatus.num_svs < GPS_MAX_SVS ? svStatus.num_svs : GPS_MAX_SVS;
 
-    // ------------------
-    // ------$GPGSV------
-    // ------------------
+    // whatever is batched belongs to an epoch that got no position report
+    loc_eng_nmea_flush(loc_eng_data_p);
 
-    if (gpsCount <= 0)
-    {
-        // no svs in view, so just send a blank $GPGSV sentence
-        strlcpy(sentence, "$GPGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-    }
-    else
+    if (loc_eng_nmea_due(loc_eng_data_p, LOC_NMEA_MASK_GSV))
     {
-        svNumber = 1;
-        sentenceNumber = 1;
-        sentenceCount = gpsCount/4 + (gpsCount % 4 != 0);
+        // one pass sorts the SVs in view by system, others are thrown away
+        struct {
+            const GpsSvInfo *sv;
+            int id;
+        } inView[LOC_NMEA_SYSTEMS][GPS_MAX_SVS];
+        int viewCount[LOC_NMEA_SYSTEMS] = {0};
 
-        while (sentenceNumber <= sentenceCount)
+        for (int i = 0; i < svCount; i++)
         {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
-
-            length = snprintf(pMarker, lengthRemaining, "$GPGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, gpsCount);
-
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
-
-            for (int i=0; (svNumber <= svCount) && (i < 4);  svNumber++)
+            int prn = svStatus.sv_list[i].prn;
+            for (int r = 0; r < NMEA_SV_RANGES; r++)
             {
-                if( (svStatus.sv_list[svNumber-1].prn >= GPS_PRN_START) &&
-                    (svStatus.sv_list[svNumber-1].prn <= GPS_PRN_END) )
+                if (prn >= sNmeaSvRanges[r].prnFirst && prn <= sNmeaSvRanges[r].prnLast)
                 {
-                    length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-
-                    if (svStatus.sv_list[svNumber-1].snr > 0)
-                    {
-                        length = snprintf(pMarker, lengthRemaining,"%02d",
-                                         (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                        if (length < 0 || length >= lengthRemaining)
-                        {
-                            LOC_LOGE("NMEA Error in string formatting");
-                            return;
-                        }
-                        pMarker += length;
-                        lengthRemaining -= length;
-                    }
-
-                    i++;
-               }
-
+                    int system = sNmeaSvRanges[r].system;
+                    inView[system][viewCount[system]].sv = &svStatus.sv_list[i];
+                    inView[system][viewCount[system]].id =
+                        sNmeaSvRanges[r].idFirst + prn - sNmeaSvRanges[r].prnFirst;
+                    viewCount[system]++;
+                    break;
+                }
             }
+        }
 
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
-
-        }  //while
-
-    } //if
-
-    // ------------------
-    // ------$GLGSV------
-    // ------------------
-
-    if (glnCount <= 0)
-    {
-        // no svs in view, so just send a blank $GLGSV sentence
-        strlcpy(sentence, "$GLGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-    }
-    else
-    {
-        svNumber = 1;
-        sentenceNumber = 1;
-        sentenceCount = glnCount/4 + (glnCount % 4 != 0);
+        // ------------------------------
+        // ---$GPGSV/GLGSV/GAGSV/GBGSV---
+        // ------------------------------
 
-        while (sentenceNumber <= sentenceCount)
+        for (int system = 0; system < LOC_NMEA_SYSTEMS; system++)
         {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
-
-            length = snprintf(pMarker, lengthRemaining, "$GLGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, glnCount);
+            int count = viewCount[system];
 
-            if (length < 0 || length >= lengthRemaining)
+            if (count <= 0)
             {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
+                // no svs in view, so just send a blank sentence; GPS and
+                // GLONASS always had one, the newer systems stay quiet
+                if (system == LOC_NMEA_SYSTEM_GPS)
+                    loc_eng_nmea_send_blank("GPGSV,1,1,0,", loc_eng_data_p);
+                else if (system == LOC_NMEA_SYSTEM_GLONASS)
+                    loc_eng_nmea_send_blank("GLGSV,1,1,0,", loc_eng_data_p);
+                continue;
             }
-            pMarker += length;
-            lengthRemaining -= length;
 
-            for (int i=0; (svNumber <= svCount) && (i < 4);  svNumber++)
-            {
-                if( (svStatus.sv_list[svNumber-1].prn >= GLONASS_PRN_START) &&
-                    (svStatus.sv_list[svNumber-1].prn <= GLONASS_PRN_END) )      {
-
-                    length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
+            int sentenceCount = count/4 + (count % 4 != 0);
+            int svNumber = 0;
 
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-
-                    if (svStatus.sv_list[svNumber-1].snr > 0)
-                    {
-                        length = snprintf(pMarker, lengthRemaining,"%02d",
-                                         (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                        if (length < 0 || length >= lengthRemaining)
-                        {
-                            LOC_LOGE("NMEA Error in string formatting");
-                            return;
-                        }
-                        pMarker += length;
-                        lengthRemaining -= length;
-                    }
-
-                    i++;
-               }
+            for (int sentenceNumber = 1; sentenceNumber <= sentenceCount; sentenceNumber++)
+            {
+                loc_eng_nmea_writer_begin(&w, sentence, sizeof(sentence));
+                loc_eng_nmea_put_str(&w, sNmeaGsvTalker[system]);
+                loc_eng_nmea_put_int(&w, sentenceCount, 0);
+                loc_eng_nmea_put_char(&w, ',');
+                loc_eng_nmea_put_int(&w, sentenceNumber, 0);
+                loc_eng_nmea_put_char(&w, ',');
+                loc_eng_nmea_put_int(&w, count, 2);
+
+                for (int i = 0; (svNumber < count) && (i < 4); i++, svNumber++)
+                {
+                    loc_eng_nmea_put_sv(&w, *inView[system][svNumber].sv,
+                                        inView[system][svNumber].id);
+                }
 
+                if (!loc_eng_nmea_finish(&w, loc_eng_data_p))
+                    return;
             }
+        }
+    }
 
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
-
-        }  //while
-
-    }//if
+    // the GPS word carries QZSS from bit 32; the other systems are only
+    // known through the extended report
+    uint64_t used[LOC_NMEA_SYSTEMS] = { svStatus.used_in_fix_mask, 0, 0, 0 };
+    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA)
+    {
+        const GnssSvUsedInPosition &svUsed = locationExtended.gnss_sv_used_ids;
+        used[LOC_NMEA_SYSTEM_GPS] |= (svUsed.gps_sv_used_ids_mask & 0xFFFFFFFFULL) |
+                                     ((svUsed.qzss_sv_used_ids_mask & 0xFFULL) << 32);
+        used[LOC_NMEA_SYSTEM_GLONASS] = svUsed.glo_sv_used_ids_mask & 0xFFFFFFFFULL;
+        used[LOC_NMEA_SYSTEM_GALILEO] = svUsed.gal_sv_used_ids_mask & 0xFFFFFFFFFULL;
+        used[LOC_NMEA_SYSTEM_BDS] = svUsed.bds_sv_used_ids_mask & 0x1FFFFFFFFFULL;
+    }
 
-    if (svStatus.used_in_fix_mask == 0)
+    if ((used[LOC_NMEA_SYSTEM_GPS] | used[LOC_NMEA_SYSTEM_GLONASS] |
+         used[LOC_NMEA_SYSTEM_GALILEO] | used[LOC_NMEA_SYSTEM_BDS]) == 0)
     {   // No sv used, so there will be no position report, so send
         // blank NMEA sentences
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        loc_eng_nmea_send_blank_pos(loc_eng_data_p,
+                                    loc_eng_nmea_due(loc_eng_data_p, LOC_NMEA_MASK_POS));
+        loc_eng_nmea_flush(loc_eng_data_p);
     }
     else
-    {   // cache the used in fix mask, as it will be needed to send $GPGSA
-        // during the position report
-        loc_eng_data_p->sv_used_mask = svStatus.used_in_fix_mask;
+    {   // cache the used in fix masks, as they will be needed to send
+        // $GPGSA/$GNGSA during the position report
+        memcpy(loc_eng_data_p->sv_used_mask, used, sizeof(used));
 
         // For RPC, the DOP are sent during sv report, so cache them
         // now to be sent during position report.
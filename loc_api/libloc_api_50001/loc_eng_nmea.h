@@ -35,7 +35,10 @@
 #define NMEA_SENTENCE_MAX_LENGTH 200
 
 void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p);
-int loc_eng_nmea_put_checksum(char *pNmea, int maxSize);
+void loc_eng_nmea_flush(loc_eng_data_s_type *loc_eng_data_p);
+void loc_eng_nmea_config(loc_eng_data_s_type *loc_eng_data_p, uint32_t sentenceMask, const uint32_t decimation[LOC_NMEA_SENTENCE_TYPES]);
+bool loc_eng_nmea_wanted(const loc_eng_data_s_type *loc_eng_data_p);
+void loc_eng_nmea_demand(loc_eng_data_s_type *loc_eng_data_p, int listenerDelta, int frameworkListening);
 void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended);
 void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p, const UlpLocation &location, const GpsLocationExtended &locationExtended, unsigned char generate_nmea);
 
@@ -0,0 +1,269 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Formats GGA and RMC bodies for a seeded set of fixes twice, once with
+   the snprintf format strings loc_eng_nmea used to build them from and
+   once with loc_eng_nmea_writer, checks that both come out byte for byte
+   the same and reports how long each took.
+   Usage: loc_eng_nmea_bench [fixes] [seed] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <loc_eng_nmea_writer.h>
+
+#define BENCH_SENTENCE_LENGTH 200
+
+typedef struct {
+    int hours, minutes, seconds;
+    int day, month, year;
+    double latitude, longitude;
+    float speed, bearing;
+    float hdop;
+    double altitude, altitudeMsl;
+    int svUsed;
+} bench_fix;
+
+static unsigned int bench_seed = 1;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static double bench_uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * (rand_r(&bench_seed) / (RAND_MAX + 1.0));
+}
+
+/* mostly plain values, some sitting right on or next to a rounding tie */
+static double bench_value(double lo, double hi, double unit)
+{
+    double v = bench_uniform(lo, hi);
+    switch (rand_r(&bench_seed) % 4) {
+    case 1:
+        return floor(v / unit) * unit + unit / 2;
+    case 2:
+        return nextafter(floor(v / unit) * unit + unit / 2, v);
+    default:
+        return v;
+    }
+}
+
+static void bench_make_fix(bench_fix *f)
+{
+    f->hours = rand_r(&bench_seed) % 24;
+    f->minutes = rand_r(&bench_seed) % 60;
+    f->seconds = rand_r(&bench_seed) % 60;
+    f->day = 1 + rand_r(&bench_seed) % 31;
+    f->month = 1 + rand_r(&bench_seed) % 12;
+    f->year = rand_r(&bench_seed) % 100;
+    f->latitude = bench_value(-90, 90, 1e-6 / 60);
+    f->longitude = bench_value(-180, 180, 1e-6 / 60);
+    f->speed = bench_value(0, 100, 0.1);
+    f->bearing = bench_value(0, 360, 0.1);
+    f->hdop = bench_value(0.5, 20, 0.1);
+    f->altitude = bench_value(-100, 3000, 0.1);
+    f->altitudeMsl = bench_value(-100, 3000, 0.1);
+    f->svUsed = rand_r(&bench_seed) % 13;
+}
+
+static int bench_checksum(char *sentence, int size)
+{
+    uint8_t checksum = 0;
+    int length = 0;
+    char *p = sentence + 1;
+    while (*p != '\0') {
+        checksum ^= *p++;
+        length++;
+    }
+    return length + snprintf(p, size - length - 1, "*%02X\r\n", checksum);
+}
+
+static int bench_printf(const bench_fix *f, char *sentence, int size)
+{
+    double latitude = f->latitude, longitude = f->longitude;
+    char latHemisphere = 'N', lonHemisphere = 'E';
+    if (!(latitude > 0)) {
+        latHemisphere = 'S';
+        latitude *= -1.0;
+    }
+    if (longitude < 0) {
+        lonHemisphere = 'W';
+        longitude *= -1.0;
+    }
+    float speedKnots = f->speed * (3600.0/1852.0);
+
+    int length = snprintf(sentence, size,
+        "$GPRMC,%02d%02d%02d,A,%02d%09.6lf,%c,%03d%09.6lf,%c,%.1lf,%.1lf,%2.2d%2.2d%2.2d,,,A",
+        f->hours, f->minutes, f->seconds,
+        (uint8_t)floor(latitude), fmod(latitude * 60.0, 60.0), latHemisphere,
+        (uint8_t)floor(longitude), fmod(longitude * 60.0, 60.0), lonHemisphere,
+        speedKnots, f->bearing, f->day, f->month, f->year);
+    length = bench_checksum(sentence, size);
+
+    char *gga = sentence + length + 1;
+    size -= length + 1;
+    snprintf(gga, size,
+        "$GPGGA,%02d%02d%02d,%02d%09.6lf,%c,%03d%09.6lf,%c,1,%02d,%.1f,%.1lf,M,%.1lf,M,,",
+        f->hours, f->minutes, f->seconds,
+        (uint8_t)floor(latitude), fmod(latitude * 60.0, 60.0), latHemisphere,
+        (uint8_t)floor(longitude), fmod(longitude * 60.0, 60.0), lonHemisphere,
+        f->svUsed, f->hdop, f->altitudeMsl, f->altitude - f->altitudeMsl);
+    return length + 1 + bench_checksum(gga, size);
+}
+
+static void bench_put_lat_long(loc_eng_nmea_writer *w, const bench_fix *f)
+{
+    double latitude = f->latitude, longitude = f->longitude;
+    char latHemisphere = 'N', lonHemisphere = 'E';
+    if (!(latitude > 0)) {
+        latHemisphere = 'S';
+        latitude *= -1.0;
+    }
+    if (longitude < 0) {
+        lonHemisphere = 'W';
+        longitude *= -1.0;
+    }
+    loc_eng_nmea_put_int(w, (uint8_t)latitude, 2);
+    loc_eng_nmea_put_fixed(w, loc_eng_nmea_minutes(latitude), 6, 9);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_char(w, latHemisphere);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, (uint8_t)longitude, 3);
+    loc_eng_nmea_put_fixed(w, loc_eng_nmea_minutes(longitude), 6, 9);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_char(w, lonHemisphere);
+    loc_eng_nmea_put_char(w, ',');
+}
+
+static int bench_writer(const bench_fix *f, char *sentence, int size)
+{
+    loc_eng_nmea_writer w;
+    float speedKnots = f->speed * (3600.0/1852.0);
+
+    loc_eng_nmea_writer_begin(&w, sentence, size);
+    loc_eng_nmea_put_str(&w, "GPRMC,");
+    loc_eng_nmea_put_int(&w, f->hours, 2);
+    loc_eng_nmea_put_int(&w, f->minutes, 2);
+    loc_eng_nmea_put_int(&w, f->seconds, 2);
+    loc_eng_nmea_put_str(&w, ",A,");
+    bench_put_lat_long(&w, f);
+    loc_eng_nmea_put_fixed(&w, speedKnots, 1, 0);
+    loc_eng_nmea_put_char(&w, ',');
+    loc_eng_nmea_put_fixed(&w, f->bearing, 1, 0);
+    loc_eng_nmea_put_char(&w, ',');
+    loc_eng_nmea_put_int(&w, f->day, 2);
+    loc_eng_nmea_put_int(&w, f->month, 2);
+    loc_eng_nmea_put_int(&w, f->year, 2);
+    loc_eng_nmea_put_str(&w, ",,,A");
+    int length = loc_eng_nmea_writer_end(&w);
+    if (length < 0) {
+        return -1;
+    }
+
+    char *gga = sentence + length + 1;
+    loc_eng_nmea_writer_begin(&w, gga, size - length - 1);
+    loc_eng_nmea_put_str(&w, "GPGGA,");
+    loc_eng_nmea_put_int(&w, f->hours, 2);
+    loc_eng_nmea_put_int(&w, f->minutes, 2);
+    loc_eng_nmea_put_int(&w, f->seconds, 2);
+    loc_eng_nmea_put_char(&w, ',');
+    bench_put_lat_long(&w, f);
+    loc_eng_nmea_put_str(&w, "1,");
+    loc_eng_nmea_put_int(&w, f->svUsed, 2);
+    loc_eng_nmea_put_char(&w, ',');
+    loc_eng_nmea_put_fixed(&w, f->hdop, 1, 0);
+    loc_eng_nmea_put_char(&w, ',');
+    loc_eng_nmea_put_fixed(&w, f->altitudeMsl, 1, 0);
+    loc_eng_nmea_put_str(&w, ",M,");
+    loc_eng_nmea_put_fixed(&w, f->altitude - f->altitudeMsl, 1, 0);
+    loc_eng_nmea_put_str(&w, ",M,,");
+    int ggaLength = loc_eng_nmea_writer_end(&w);
+    return ggaLength < 0 ? -1 : length + 1 + ggaLength;
+}
+
+int main(int argc, char *argv[])
+{
+    int fix_cnt = argc > 1 ? atoi(argv[1]) : 100000;
+    bench_seed = argc > 2 ? (unsigned int)atoi(argv[2]) : 1;
+
+    if (fix_cnt < 1) {
+        fprintf(stderr, "usage: %s [fixes] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    bench_fix *fixes = (bench_fix*)malloc(fix_cnt * sizeof(bench_fix));
+    if (NULL == fixes) {
+        return 1;
+    }
+    for (int i = 0; i < fix_cnt; i++) {
+        bench_make_fix(&fixes[i]);
+    }
+
+    char expected[2 * BENCH_SENTENCE_LENGTH];
+    char actual[2 * BENCH_SENTENCE_LENGTH];
+    int mismatches = 0;
+    for (int i = 0; i < fix_cnt; i++) {
+        int expectedLength = bench_printf(&fixes[i], expected, sizeof(expected));
+        int actualLength = bench_writer(&fixes[i], actual, sizeof(actual));
+        if (expectedLength != actualLength ||
+            memcmp(expected, actual, expectedLength + 1) != 0) {
+            if (mismatches++ < 10) {
+                printf("mismatch on fix %d:\n%s%s", i, expected, actual);
+            }
+        }
+    }
+
+    volatile int sink = 0;
+    uint64_t start = bench_usec();
+    for (int i = 0; i < fix_cnt; i++) {
+        sink += bench_printf(&fixes[i], expected, sizeof(expected));
+    }
+    uint64_t printfUsec = bench_usec() - start;
+
+    start = bench_usec();
+    for (int i = 0; i < fix_cnt; i++) {
+        sink += bench_writer(&fixes[i], actual, sizeof(actual));
+    }
+    uint64_t writerUsec = bench_usec() - start;
+
+    printf("%d RMC+GGA pairs, %d mismatches\n", fix_cnt, mismatches);
+    printf("snprintf: %llu usec, %.0f ns per pair\n",
+           (unsigned long long)printfUsec, printfUsec * 1000.0 / fix_cnt);
+    printf("writer:   %llu usec, %.0f ns per pair\n",
+           (unsigned long long)writerUsec, writerUsec * 1000.0 / fix_cnt);
+
+    free(fixes);
+    return mismatches ? 2 : 0;
+}
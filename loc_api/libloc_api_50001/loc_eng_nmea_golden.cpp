@@ -0,0 +1,288 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Checks the NMEA generators against a corpus of position and SV reports
+   together with the sentences loc_eng_nmea produced for them when it was
+   still built on snprintf. Every report is run through the real
+   loc_eng_nmea_generate_sv() / loc_eng_nmea_generate_pos(), with all
+   sentences enabled and not batched, and every sentence handed to nmea_cb
+   must match the corpus byte for byte, the length nmea_cb gets included.
+   Given "write", the corpus is printed with the sentences produced now
+   instead, which is how it was made, from a build of the snprintf one.
+   Corpus lines, numbers in hex where marked 0x, the rest in decimal:
+     mode <LocPositionMode>
+     sv <used_in_fix_mask 0x> <extended flags 0x> <pdop> <hdop> <vdop>
+        [<prn> <snr> <elevation> <azimuth>]...
+     pos <generate_nmea> <flags 0x> <timestamp> <latitude> <longitude>
+         <altitude> <speed> <bearing> <extended flags 0x> <pdop> <hdop>
+         <vdop> <magneticDeviation> <altitudeMeanSeaLevel>
+     $<sentence>, each one expected from the report above, without CR LF
+   and # for comments. The corpus is loc_eng_nmea_golden.txt next to this.
+   Usage: loc_eng_nmea_golden <corpus> [write] */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_nmea_golden"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+#include <LBSProxyBase.h>
+
+using namespace loc_core;
+
+#define GOLDEN_LINE_LENGTH 1024
+#define GOLDEN_MAX_SENTENCES 64
+
+static loc_eng_data_s_type sLocEng;
+static bool sStubLoaded = false;
+// what nmea_cb got for the report being run
+static char sSentences[GOLDEN_MAX_SENTENCES][NMEA_SENTENCE_MAX_LENGTH];
+static int sLengths[GOLDEN_MAX_SENTENCES];
+static int sCount = 0;
+
+// the generators only ever ask the adapter for the position mode
+struct GoldenLocApi : public LocApiBase {
+    inline GoldenLocApi(const MsgTask* msgTask,
+                        LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                        ContextBase* context) :
+        LocApiBase(msgTask, exMask, context) {
+        sStubLoaded = true;
+    }
+};
+
+struct GoldenLBSProxy : public LBSProxyBase {
+    inline virtual LocApiBase*
+        getLocApi(const MsgTask* msgTask,
+                  LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                  ContextBase* context) const {
+        return new GoldenLocApi(msgTask, exMask, context);
+    }
+};
+
+// found by ContextBase::getLBSProxy(NULL) in this program
+extern "C" LBSProxyBase* getLBSProxy()
+{
+    return new GoldenLBSProxy();
+}
+
+static void golden_nmea_cb(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    if (sCount >= GOLDEN_MAX_SENTENCES) {
+        LOC_LOGE("%s] more than %d sentences from one report", __func__,
+                 GOLDEN_MAX_SENTENCES);
+        return;
+    }
+    strlcpy(sSentences[sCount], nmea, sizeof(sSentences[sCount]));
+    sLengths[sCount++] = length;
+}
+
+// runs the report on a corpus line, returns false if it does not parse
+static bool golden_run(const char* line)
+{
+    GpsLocationExtended ext;
+    memset(&ext, 0, sizeof(ext));
+    ext.size = sizeof(ext);
+    unsigned int extFlags;
+    double pdop, hdop, vdop;
+    int used;
+    sCount = 0;
+
+    int mode;
+    if (1 == sscanf(line, "mode %d", &mode)) {
+        LocPosMode posMode;
+        posMode.mode = (LocPositionMode)mode;
+        sLocEng.adapter->setPositionMode(&posMode);
+        return true;
+    }
+
+    GpsSvStatus svStatus;
+    memset(&svStatus, 0, sizeof(svStatus));
+    svStatus.size = sizeof(svStatus);
+    if (5 == sscanf(line, "sv %x %x %lf %lf %lf%n", &svStatus.used_in_fix_mask,
+                    &extFlags, &pdop, &hdop, &vdop, &used)) {
+        ext.flags = extFlags;
+        ext.pdop = pdop;
+        ext.hdop = hdop;
+        ext.vdop = vdop;
+        int prn, length;
+        double snr, elevation, azimuth;
+        while (svStatus.num_svs < GPS_MAX_SVS &&
+               4 == sscanf(line + used, "%d %lf %lf %lf%n", &prn, &snr,
+                           &elevation, &azimuth, &length)) {
+            GpsSvInfo& sv = svStatus.sv_list[svStatus.num_svs++];
+            sv.size = sizeof(sv);
+            sv.prn = prn;
+            sv.snr = snr;
+            sv.elevation = elevation;
+            sv.azimuth = azimuth;
+            used += length;
+        }
+        if ('\0' != line[used + strspn(line + used, " \t\r\n")]) {
+            return false;
+        }
+        loc_eng_nmea_generate_sv(&sLocEng, svStatus, ext);
+        return true;
+    }
+
+    UlpLocation location;
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+    location.gpsLocation.size = sizeof(location.gpsLocation);
+    GpsLocation& fix = location.gpsLocation;
+    int generate;
+    unsigned int flags;
+    long long timestamp;
+    double speed, bearing, magneticDeviation, altitudeMeanSeaLevel;
+    if (14 == sscanf(line, "pos %d %x %lld %lf %lf %lf %lf %lf %x %lf %lf %lf "
+                     "%lf %lf", &generate, &flags, &timestamp, &fix.latitude,
+                     &fix.longitude, &fix.altitude, &speed, &bearing,
+                     &extFlags, &pdop, &hdop, &vdop, &magneticDeviation,
+                     &altitudeMeanSeaLevel)) {
+        fix.flags = flags;
+        ext.flags = extFlags;
+        fix.timestamp = timestamp;
+        fix.speed = speed;
+        fix.bearing = bearing;
+        ext.pdop = pdop;
+        ext.hdop = hdop;
+        ext.vdop = vdop;
+        ext.magneticDeviation = magneticDeviation;
+        ext.altitudeMeanSeaLevel = altitudeMeanSeaLevel;
+        loc_eng_nmea_generate_pos(&sLocEng, location, ext, generate);
+        return true;
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    bool write = argc > 2 && 0 == strcmp(argv[2], "write");
+    FILE* corpus = argc > 1 ? fopen(argv[1], "r") : NULL;
+    if (NULL == corpus) {
+        printf("usage: %s <corpus> [write]\n", argv[0]);
+        return 1;
+    }
+
+    MsgTask* msgTask = new MsgTask((MsgTask::tCreate)NULL, "nmea_golden");
+    ContextBase* context = new ContextBase(msgTask, 0, NULL);
+    if (!sStubLoaded) {
+        printf("stub LocApi not loaded, link with -rdynamic\n");
+        return 1;
+    }
+    sLocEng.adapter = new LocEngAdapter(0, &sLocEng, context,
+                                        (MsgTask::tCreate)NULL);
+    sLocEng.nmea_cb = golden_nmea_cb;
+    // every sentence every epoch, as it always was
+    uint32_t decimation[LOC_NMEA_SENTENCE_TYPES] = { 0 };
+    loc_eng_nmea_config(&sLocEng, LOC_NMEA_MASK_ALL, decimation);
+
+    char line[GOLDEN_LINE_LENGTH];
+    int lineNumber = 0;
+    int reports = 0;
+    int checked = 0;
+    int errors = 0;
+    // sentences of the current report matched so far
+    int matched = 0;
+    int reportLine = 0;
+
+    while (NULL != fgets(line, sizeof(line), corpus)) {
+        lineNumber++;
+        if ('$' == line[0]) {
+            if (write) {
+                continue;
+            }
+            // the corpus leaves the CR LF of each sentence out, and
+            // nmea_cb has always been given one short of the sentence
+            int length = strcspn(line, "\r\n");
+            line[length] = '\0';
+            if (matched >= sCount) {
+                printf("line %d: expected %s, nothing more came from line %d\n",
+                       lineNumber, line, reportLine);
+                errors++;
+            } else if (0 != strncmp(line, sSentences[matched], length) ||
+                       0 != strcmp(sSentences[matched] + length, "\r\n") ||
+                       length + 1 != sLengths[matched]) {
+                printf("line %d: expected %s, got length %d %s", lineNumber,
+                       line, sLengths[matched], sSentences[matched]);
+                errors++;
+            }
+            matched++;
+            checked++;
+            continue;
+        }
+
+        if (write) {
+            fputs(line, stdout);
+        }
+        if ('#' == line[0] || '\0' == line[strspn(line, " \t\r\n")]) {
+            continue;
+        }
+
+        // the sentences of the last report must all have been expected
+        if (!write && matched < sCount) {
+            printf("line %d: %d more sentences than expected, the first %s",
+                   reportLine, sCount - matched, sSentences[matched]);
+            errors++;
+        }
+        if (!golden_run(line)) {
+            printf("line %d: cannot parse %s", lineNumber, line);
+            fclose(corpus);
+            return 1;
+        }
+        reports++;
+        reportLine = lineNumber;
+        matched = 0;
+        if (write) {
+            for (int i = 0; i < sCount; i++) {
+                // nmea_cb has always been given one short of the sentence
+                if ((int)strlen(sSentences[i]) - 1 != sLengths[i]) {
+                    fprintf(stderr, "line %d: length %d for %s", lineNumber,
+                            sLengths[i], sSentences[i]);
+                }
+                sSentences[i][strcspn(sSentences[i], "\r\n")] = '\0';
+                printf("%s\n", sSentences[i]);
+            }
+        }
+    }
+    if (!write && matched < sCount) {
+        printf("line %d: %d more sentences than expected\n", reportLine,
+               sCount - matched);
+        errors++;
+    }
+    fclose(corpus);
+
+    if (!write) {
+        printf("%d reports, %d sentences checked, %d mismatches\n", reports,
+               checked, errors);
+    }
+    return errors != 0;
+}
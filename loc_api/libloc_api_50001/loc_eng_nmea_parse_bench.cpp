@@ -0,0 +1,487 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Writes a seeded corpus of GGA, RMC, GSA, GSV and GNS sentences from
+   several talkers with loc_eng_nmea_writer, parses it back and checks
+   every field. Then mutates each sentence (a flipped byte, a truncation)
+   to check that damaged ones are rejected, and reports parser throughput
+   in sentences per second next to a strtok/strtod split of the same
+   corpus. Run it under ASan/valgrind to catch reads past a sentence.
+   Usage: loc_eng_nmea_parse_bench [sentences] [seed] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <loc_eng_nmea_writer.h>
+#include <loc_eng_nmea_parser.h>
+
+#define BENCH_SENTENCE_LENGTH 200
+
+static const char *sTalkers[] = { "GP", "GL", "GA", "GN" };
+
+typedef struct {
+    LocNmeaParsed expected;
+    int offset;
+    int length;
+} bench_sentence;
+
+static unsigned int bench_seed = 1;
+static int bench_failures = 0;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static double bench_uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * (rand_r(&bench_seed) / (RAND_MAX + 1.0));
+}
+
+static int bench_int(int lo, int hi)
+{
+    return lo + rand_r(&bench_seed) % (hi - lo + 1);
+}
+
+/* values are rounded to what the sentence carries, so they parse back
+   to within a rounding error of the double they were written from */
+static float bench_tenths(double lo, double hi)
+{
+    return (float)(floor(bench_uniform(lo, hi) * 10 + 0.5) / 10);
+}
+
+static void bench_put_time(loc_eng_nmea_writer *w, uint32_t &timeMs)
+{
+    int hours = bench_int(0, 23), minutes = bench_int(0, 59);
+    int seconds = bench_int(0, 59), centis = bench_int(0, 99);
+    timeMs = ((hours * 60 + minutes) * 60 + seconds) * 1000 + centis * 10;
+    loc_eng_nmea_put_int(w, hours, 2);
+    loc_eng_nmea_put_int(w, minutes, 2);
+    loc_eng_nmea_put_int(w, seconds, 2);
+    loc_eng_nmea_put_char(w, '.');
+    loc_eng_nmea_put_int(w, centis, 2);
+    loc_eng_nmea_put_char(w, ',');
+}
+
+static void bench_put_coordinate(loc_eng_nmea_writer *w, double &degrees,
+                                 int degreeDigits, double max, const char *hemispheres)
+{
+    degrees = bench_uniform(-max, max);
+    double magnitude = fabs(degrees);
+    loc_eng_nmea_put_int(w, (int)magnitude, degreeDigits);
+    loc_eng_nmea_put_fixed(w, loc_eng_nmea_minutes(magnitude), 6, 9);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_char(w, hemispheres[degrees < 0 ? 1 : 0]);
+    loc_eng_nmea_put_char(w, ',');
+}
+
+static void bench_put_tenths(loc_eng_nmea_writer *w, float &value, double lo, double hi,
+                             uint32_t flag, uint32_t &flags)
+{
+    // one in eight left empty
+    if (bench_int(0, 7) != 0) {
+        value = bench_tenths(lo, hi);
+        loc_eng_nmea_put_fixed(w, value, 1, 0);
+        flags |= flag;
+    }
+}
+
+static void bench_make_gga(loc_eng_nmea_writer *w, LocNmeaParsed *p)
+{
+    LocNmeaGga &gga = p->u.gga;
+    loc_eng_nmea_put_str(w, "GGA,");
+    bench_put_time(w, gga.time_ms);
+    bench_put_coordinate(w, gga.latitude, 2, 90, "NS");
+    bench_put_coordinate(w, gga.longitude, 3, 180, "EW");
+    gga.quality = (uint8_t)bench_int(0, 2);
+    gga.sv_used = (uint8_t)bench_int(0, 12);
+    loc_eng_nmea_put_int(w, gga.quality, 1);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, gga.sv_used, 2);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gga.hdop, 0.5, 20, LOC_NMEA_HAS_HDOP, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gga.altitude, -100, 3000, LOC_NMEA_HAS_ALTITUDE, p->flags);
+    loc_eng_nmea_put_str(w, ",M,");
+    bench_put_tenths(w, gga.geoid_separation, -50, 50, LOC_NMEA_HAS_GEOID_SEP, p->flags);
+    loc_eng_nmea_put_str(w, ",M,,");
+    p->flags |= LOC_NMEA_HAS_TIME | LOC_NMEA_HAS_LAT_LONG | LOC_NMEA_HAS_SV_USED;
+}
+
+static void bench_make_rmc(loc_eng_nmea_writer *w, LocNmeaParsed *p)
+{
+    LocNmeaRmc &rmc = p->u.rmc;
+    loc_eng_nmea_put_str(w, "RMC,");
+    bench_put_time(w, rmc.time_ms);
+    rmc.status = bench_int(0, 3) ? 'A' : 'V';
+    loc_eng_nmea_put_char(w, rmc.status);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_coordinate(w, rmc.latitude, 2, 90, "NS");
+    bench_put_coordinate(w, rmc.longitude, 3, 180, "EW");
+    bench_put_tenths(w, rmc.speed_knots, 0, 200, LOC_NMEA_HAS_SPEED, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, rmc.course, 0, 359.9, LOC_NMEA_HAS_COURSE, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    rmc.day = (uint8_t)bench_int(1, 31);
+    rmc.month = (uint8_t)bench_int(1, 12);
+    rmc.year = (uint16_t)bench_int(2000, 2099);
+    loc_eng_nmea_put_int(w, rmc.day, 2);
+    loc_eng_nmea_put_int(w, rmc.month, 2);
+    loc_eng_nmea_put_int(w, rmc.year - 2000, 2);
+    loc_eng_nmea_put_char(w, ',');
+    if (bench_int(0, 1)) {
+        rmc.mag_variation = bench_tenths(0, 30);
+        loc_eng_nmea_put_fixed(w, rmc.mag_variation, 1, 0);
+        loc_eng_nmea_put_char(w, ',');
+        if (bench_int(0, 1)) {
+            loc_eng_nmea_put_char(w, 'W');
+            rmc.mag_variation = -rmc.mag_variation;
+        } else {
+            loc_eng_nmea_put_char(w, 'E');
+        }
+        p->flags |= LOC_NMEA_HAS_MAG_VARIATION;
+    } else {
+        loc_eng_nmea_put_char(w, ',');
+    }
+    rmc.mode = "ADN"[bench_int(0, 2)];
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_char(w, rmc.mode);
+    p->flags |= LOC_NMEA_HAS_TIME | LOC_NMEA_HAS_LAT_LONG | LOC_NMEA_HAS_DATE;
+}
+
+static void bench_make_gsa(loc_eng_nmea_writer *w, LocNmeaParsed *p)
+{
+    LocNmeaGsa &gsa = p->u.gsa;
+    loc_eng_nmea_put_str(w, "GSA,");
+    gsa.selection = bench_int(0, 1) ? 'A' : 'M';
+    gsa.fix_type = (uint8_t)bench_int(1, 3);
+    loc_eng_nmea_put_char(w, gsa.selection);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, gsa.fix_type, 1);
+    loc_eng_nmea_put_char(w, ',');
+    gsa.prn_cnt = (uint8_t)bench_int(0, LOC_NMEA_GSA_MAX_SVS);
+    for (int i = 0; i < LOC_NMEA_GSA_MAX_SVS; i++) {
+        if (i < gsa.prn_cnt) {
+            gsa.prns[i] = (uint16_t)bench_int(1, 96);
+            loc_eng_nmea_put_int(w, gsa.prns[i], 2);
+        }
+        loc_eng_nmea_put_char(w, ',');
+    }
+    bench_put_tenths(w, gsa.pdop, 0.5, 20, LOC_NMEA_HAS_PDOP, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gsa.hdop, 0.5, 20, LOC_NMEA_HAS_HDOP, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gsa.vdop, 0.5, 20, LOC_NMEA_HAS_VDOP, p->flags);
+}
+
+static void bench_make_gsv(loc_eng_nmea_writer *w, LocNmeaParsed *p)
+{
+    LocNmeaGsv &gsv = p->u.gsv;
+    loc_eng_nmea_put_str(w, "GSV,");
+    gsv.sentence_cnt = (uint8_t)bench_int(1, 4);
+    gsv.sentence_num = (uint8_t)bench_int(1, gsv.sentence_cnt);
+    gsv.sv_in_view = (uint16_t)bench_int(0, 16);
+    gsv.sv_cnt = (uint8_t)bench_int(0, LOC_NMEA_GSV_MAX_SVS);
+    loc_eng_nmea_put_int(w, gsv.sentence_cnt, 1);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, gsv.sentence_num, 1);
+    loc_eng_nmea_put_char(w, ',');
+    loc_eng_nmea_put_int(w, gsv.sv_in_view, 2);
+    for (int i = 0; i < gsv.sv_cnt; i++) {
+        LocNmeaGsvSv &sv = gsv.svs[i];
+        sv.prn = (uint16_t)bench_int(1, 96);
+        sv.elevation = (int16_t)bench_int(0, 90);
+        sv.azimuth = (int16_t)bench_int(0, 359);
+        sv.snr = (int16_t)(bench_int(0, 3) ? bench_int(0, 55) : -1);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_int(w, sv.prn, 2);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_int(w, sv.elevation, 2);
+        loc_eng_nmea_put_char(w, ',');
+        loc_eng_nmea_put_int(w, sv.azimuth, 3);
+        loc_eng_nmea_put_char(w, ',');
+        if (sv.snr >= 0) {
+            loc_eng_nmea_put_int(w, sv.snr, 2);
+        }
+    }
+}
+
+static void bench_make_gns(loc_eng_nmea_writer *w, LocNmeaParsed *p)
+{
+    LocNmeaGns &gns = p->u.gns;
+    loc_eng_nmea_put_str(w, "GNS,");
+    bench_put_time(w, gns.time_ms);
+    bench_put_coordinate(w, gns.latitude, 2, 90, "NS");
+    bench_put_coordinate(w, gns.longitude, 3, 180, "EW");
+    int modes = bench_int(1, 4);
+    for (int i = 0; i < modes; i++) {
+        gns.modes[i] = "ADNE"[bench_int(0, 3)];
+        loc_eng_nmea_put_char(w, gns.modes[i]);
+    }
+    loc_eng_nmea_put_char(w, ',');
+    gns.sv_used = (uint8_t)bench_int(0, 40);
+    loc_eng_nmea_put_int(w, gns.sv_used, 2);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gns.hdop, 0.5, 20, LOC_NMEA_HAS_HDOP, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gns.altitude, -100, 3000, LOC_NMEA_HAS_ALTITUDE, p->flags);
+    loc_eng_nmea_put_char(w, ',');
+    bench_put_tenths(w, gns.geoid_separation, -50, 50, LOC_NMEA_HAS_GEOID_SEP, p->flags);
+    loc_eng_nmea_put_str(w, ",,");
+    p->flags |= LOC_NMEA_HAS_TIME | LOC_NMEA_HAS_LAT_LONG | LOC_NMEA_HAS_SV_USED;
+}
+
+static int bench_make_sentence(char *buf, int size, LocNmeaParsed *p)
+{
+    loc_eng_nmea_writer w;
+    memset(p, 0, sizeof(*p));
+    p->size = sizeof(*p);
+    memcpy(p->talker, sTalkers[bench_int(0, 3)], 2);
+    p->type = (LocNmeaSentenceType)bench_int(LOC_NMEA_SENTENCE_GGA, LOC_NMEA_SENTENCE_GNS);
+
+    loc_eng_nmea_writer_begin(&w, buf, size);
+    loc_eng_nmea_put_str(&w, p->talker);
+    switch (p->type) {
+    case LOC_NMEA_SENTENCE_GGA: bench_make_gga(&w, p); break;
+    case LOC_NMEA_SENTENCE_RMC: bench_make_rmc(&w, p); break;
+    case LOC_NMEA_SENTENCE_GSA: bench_make_gsa(&w, p); break;
+    case LOC_NMEA_SENTENCE_GSV: bench_make_gsv(&w, p); break;
+    case LOC_NMEA_SENTENCE_GNS: bench_make_gns(&w, p); break;
+    }
+    int length = loc_eng_nmea_writer_end(&w);
+    // writer_end reports the historical nmea_cb length, one short
+    return length < 0 ? -1 : length + 1;
+}
+
+static bool bench_near(double a, double b, double tolerance)
+{
+    return fabs(a - b) <= tolerance;
+}
+
+static bool bench_same(const LocNmeaParsed *e, const LocNmeaParsed *a)
+{
+    if (e->type != a->type || e->flags != a->flags || memcmp(e->talker, a->talker, 3) != 0) {
+        return false;
+    }
+    switch (e->type) {
+    case LOC_NMEA_SENTENCE_GGA: {
+        const LocNmeaGga &x = e->u.gga, &y = a->u.gga;
+        return x.time_ms == y.time_ms && bench_near(x.latitude, y.latitude, 1e-8) &&
+               bench_near(x.longitude, y.longitude, 1e-8) && x.quality == y.quality &&
+               x.sv_used == y.sv_used && bench_near(x.hdop, y.hdop, 1e-4) &&
+               bench_near(x.altitude, y.altitude, 1e-3) &&
+               bench_near(x.geoid_separation, y.geoid_separation, 1e-3);
+    }
+    case LOC_NMEA_SENTENCE_RMC: {
+        const LocNmeaRmc &x = e->u.rmc, &y = a->u.rmc;
+        return x.time_ms == y.time_ms && x.status == y.status &&
+               bench_near(x.latitude, y.latitude, 1e-8) &&
+               bench_near(x.longitude, y.longitude, 1e-8) &&
+               bench_near(x.speed_knots, y.speed_knots, 1e-3) &&
+               bench_near(x.course, y.course, 1e-3) && x.year == y.year &&
+               x.month == y.month && x.day == y.day &&
+               bench_near(x.mag_variation, y.mag_variation, 1e-4) && x.mode == y.mode;
+    }
+    case LOC_NMEA_SENTENCE_GSA: {
+        const LocNmeaGsa &x = e->u.gsa, &y = a->u.gsa;
+        return x.selection == y.selection && x.fix_type == y.fix_type &&
+               x.prn_cnt == y.prn_cnt &&
+               memcmp(x.prns, y.prns, x.prn_cnt * sizeof(x.prns[0])) == 0 &&
+               bench_near(x.pdop, y.pdop, 1e-4) && bench_near(x.hdop, y.hdop, 1e-4) &&
+               bench_near(x.vdop, y.vdop, 1e-4);
+    }
+    case LOC_NMEA_SENTENCE_GSV: {
+        const LocNmeaGsv &x = e->u.gsv, &y = a->u.gsv;
+        if (x.sentence_cnt != y.sentence_cnt || x.sentence_num != y.sentence_num ||
+            x.sv_in_view != y.sv_in_view || x.sv_cnt != y.sv_cnt) {
+            return false;
+        }
+        for (int i = 0; i < x.sv_cnt; i++) {
+            if (x.svs[i].prn != y.svs[i].prn || x.svs[i].elevation != y.svs[i].elevation ||
+                x.svs[i].azimuth != y.svs[i].azimuth || x.svs[i].snr != y.svs[i].snr) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case LOC_NMEA_SENTENCE_GNS: {
+        const LocNmeaGns &x = e->u.gns, &y = a->u.gns;
+        return x.time_ms == y.time_ms && bench_near(x.latitude, y.latitude, 1e-8) &&
+               bench_near(x.longitude, y.longitude, 1e-8) &&
+               strcmp(x.modes, y.modes) == 0 && x.sv_used == y.sv_used &&
+               bench_near(x.hdop, y.hdop, 1e-4) && bench_near(x.altitude, y.altitude, 1e-3) &&
+               bench_near(x.geoid_separation, y.geoid_separation, 1e-3);
+    }
+    }
+    return false;
+}
+
+/* parses one sentence from a heap copy of exactly its length, so a read
+   past it is caught by the memory checker */
+static int bench_parse_alone(const char *sentence, int length, LocNmeaParsed *parsed)
+{
+    char *copy = (char*)malloc(length > 0 ? length : 1);
+    memcpy(copy, sentence, length);
+    const char *cursor = copy;
+    loc_nmea_tokens tokens;
+    int result, good = 0;
+    while ((result = loc_eng_nmea_next(&cursor, copy + length, &tokens)) != 0) {
+        if (result > 0 && loc_eng_nmea_parse(&tokens, parsed)) {
+            good++;
+        }
+    }
+    free(copy);
+    return good;
+}
+
+static void bench_fuzz(const char *sentence, int length)
+{
+    char mutated[BENCH_SENTENCE_LENGTH];
+    LocNmeaParsed parsed;
+
+    // any single byte change between '$' and '*' breaks the checksum,
+    // unless it makes a new delimiter that happens to close a shorter one
+    int star = (int)((const char*)memchr(sentence, '*', length) - sentence);
+    int at = bench_int(1, star - 1);
+    memcpy(mutated, sentence, length);
+    do {
+        mutated[at] = sentence[at] ^ (char)bench_int(1, 255);
+    } while (strchr("$*\r\n", mutated[at]) != NULL);
+    if (bench_parse_alone(mutated, length, &parsed) != 0) {
+        if (bench_failures++ < 10) {
+            printf("flipped byte %d accepted: %.*s", at, length, mutated);
+        }
+    }
+
+    // cut short anywhere before the checksum is complete
+    if (bench_parse_alone(sentence, bench_int(0, star + 2), &parsed) != 0) {
+        if (bench_failures++ < 10) {
+            printf("truncated sentence accepted: %.*s", length, sentence);
+        }
+    }
+
+    // random bytes must not crash it, whatever they parse to
+    for (int i = 0; i < length; i++) {
+        mutated[i] = bench_int(0, 3) ? sentence[i] : (char)bench_int(0, 255);
+    }
+    bench_parse_alone(mutated, length, &parsed);
+}
+
+static int bench_strtok(char *corpus, int length)
+{
+    char line[BENCH_SENTENCE_LENGTH];
+    volatile double sink = 0;
+    int sentences = 0;
+    char *p = corpus;
+    char *end = corpus + length;
+    while (p < end) {
+        char *eol = (char*)memchr(p, '\n', end - p);
+        int n = eol - p + 1;
+        memcpy(line, p, n);
+        line[n] = '\0';
+        char *save = NULL;
+        for (char *f = strtok_r(line, ",*", &save); f != NULL; f = strtok_r(NULL, ",*", &save)) {
+            sink += strtod(f, NULL);
+        }
+        sentences++;
+        p += n;
+    }
+    return sentences;
+}
+
+static int bench_parsed_cnt = 0;
+static void bench_parsed_cb(const LocNmeaParsed*)
+{
+    bench_parsed_cnt++;
+}
+
+int main(int argc, char *argv[])
+{
+    int sentence_cnt = argc > 1 ? atoi(argv[1]) : 100000;
+    bench_seed = argc > 2 ? (unsigned int)atoi(argv[2]) : 1;
+
+    if (sentence_cnt < 1) {
+        fprintf(stderr, "usage: %s [sentences] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    bench_sentence *sentences = (bench_sentence*)malloc(sentence_cnt * sizeof(bench_sentence));
+    char *corpus = (char*)malloc(sentence_cnt * BENCH_SENTENCE_LENGTH);
+    if (NULL == sentences || NULL == corpus) {
+        return 1;
+    }
+    int length = 0;
+    for (int i = 0; i < sentence_cnt; i++) {
+        sentences[i].offset = length;
+        sentences[i].length = bench_make_sentence(corpus + length, BENCH_SENTENCE_LENGTH,
+                                                  &sentences[i].expected);
+        length += sentences[i].length;
+    }
+
+    // round trip
+    const char *cursor = corpus;
+    loc_nmea_tokens tokens;
+    LocNmeaParsed parsed;
+    for (int i = 0; i < sentence_cnt; i++) {
+        if (loc_eng_nmea_next(&cursor, corpus + length, &tokens) != 1 ||
+            !loc_eng_nmea_parse(&tokens, &parsed) ||
+            !bench_same(&sentences[i].expected, &parsed)) {
+            if (bench_failures++ < 10) {
+                printf("sentence %d did not parse back: %.*s", i,
+                       sentences[i].length, corpus + sentences[i].offset);
+            }
+        }
+    }
+
+    for (int i = 0; i < sentence_cnt; i++) {
+        bench_fuzz(corpus + sentences[i].offset, sentences[i].length);
+    }
+
+    uint64_t start = bench_usec();
+    int delivered = loc_eng_nmea_parse_buffer(corpus, length, bench_parsed_cb);
+    uint64_t parserUsec = bench_usec() - start;
+
+    start = bench_usec();
+    int split = bench_strtok(corpus, length);
+    uint64_t strtokUsec = bench_usec() - start;
+
+    printf("%d sentences, %d failures\n", sentence_cnt, bench_failures);
+    printf("parser: %d sentences, %llu usec, %.0f sentences/s\n", delivered,
+           (unsigned long long)parserUsec, delivered * 1e6 / (parserUsec ? parserUsec : 1));
+    printf("strtok: %d sentences, %llu usec, %.0f sentences/s\n", split,
+           (unsigned long long)strtokUsec, split * 1e6 / (strtokUsec ? strtokUsec : 1));
+
+    free(corpus);
+    free(sentences);
+    return (bench_failures || delivered != sentence_cnt) ? 2 : 0;
+}
@@ -0,0 +1,538 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include <loc_eng_nmea_parser.h>
+
+#define NMEA_ONES  0x0101010101010101ULL
+#define NMEA_HIGHS 0x8080808080808080ULL
+// non zero if any byte of v equals c
+#define NMEA_HAS_BYTE(v, c) \
+    ((((v) ^ (NMEA_ONES * (c))) - NMEA_ONES) & ~((v) ^ (NMEA_ONES * (c))) & NMEA_HIGHS)
+
+static const uint32_t sPow10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static int loc_eng_nmea_hex(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_scan
+
+DESCRIPTION
+   XOR the bytes from p up to the '*' that ends the sentence, 8 bytes at a
+   time while none of them can end it
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Address of the '*', or of whatever else stopped the scan ('$', CR, LF
+   or end)
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static const char* loc_eng_nmea_scan(const char *p, const char *end, uint8_t &checksum)
+{
+    uint64_t acc = 0;
+
+    while (end - p >= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        if (NMEA_HAS_BYTE(v, '*') || NMEA_HAS_BYTE(v, '$') ||
+            NMEA_HAS_BYTE(v, '\r') || NMEA_HAS_BYTE(v, '\n'))
+        {
+            break;
+        }
+        acc ^= v;
+        p += 8;
+    }
+
+    acc ^= acc >> 32;
+    acc ^= acc >> 16;
+    acc ^= acc >> 8;
+    uint8_t x = (uint8_t)acc;
+
+    while (p < end && *p != '*' && *p != '$' && *p != '\r' && *p != '\n')
+    {
+        x ^= (uint8_t)*p++;
+    }
+    checksum = x;
+    return p;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_next
+
+DESCRIPTION
+   Find, check and split the next sentence
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   1 good sentence, -1 skipped sentence, 0 no more sentences
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_nmea_next(const char **cursor, const char *end, loc_nmea_tokens *tokens)
+{
+    const char *p = *cursor;
+
+    if (p >= end)
+        return 0;
+    p = (const char*)memchr(p, '$', end - p);
+    if (NULL == p)
+    {
+        *cursor = end;
+        return 0;
+    }
+
+    const char *body = p + 1;
+    uint8_t checksum;
+    const char *star = loc_eng_nmea_scan(body, end, checksum);
+
+    if (star + 3 > end || *star != '*')
+    {
+        *cursor = star;
+        return -1;
+    }
+    *cursor = star + 3;
+
+    int hi = loc_eng_nmea_hex(star[1]);
+    int lo = loc_eng_nmea_hex(star[2]);
+    if (hi < 0 || lo < 0 || checksum != (uint8_t)((hi << 4) | lo))
+        return -1;
+
+    int n = 0;
+    const char *field = body;
+    while (n < LOC_NMEA_MAX_FIELDS)
+    {
+        const char *comma = (const char*)memchr(field, ',', star - field);
+        tokens->field[n].ptr = field;
+        if (NULL == comma)
+        {
+            tokens->field[n++].len = star - field;
+            tokens->field_cnt = n;
+            return 1;
+        }
+        tokens->field[n++].len = comma - field;
+        field = comma + 1;
+    }
+    return -1;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_uint
+
+DESCRIPTION
+   Parse an all digit field
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if empty, not all digits or too long
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_nmea_uint(const loc_nmea_field &f, uint32_t &value)
+{
+    if (f.len <= 0 || f.len > 9)
+        return false;
+    uint32_t v = 0;
+    for (int i = 0; i < f.len; i++)
+    {
+        uint32_t digit = (uint32_t)(f.ptr[i] - '0');
+        if (digit > 9)
+            return false;
+        v = v * 10 + digit;
+    }
+    value = v;
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_decimal
+
+DESCRIPTION
+   Parse [-]digits[.digits] into whole and fraction parts, the fraction
+   as an integer count of 10^-decimals, at most 9 decimals are kept
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if empty or malformed
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_nmea_decimal(const loc_nmea_field &f, bool &negative,
+                                 uint32_t &whole, uint32_t &fraction, int &decimals)
+{
+    const char *p = f.ptr;
+    const char *end = f.ptr + f.len;
+    int wholeDigits = 0;
+
+    negative = false;
+    whole = 0;
+    fraction = 0;
+    decimals = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    for (; p < end && *p != '.'; p++)
+    {
+        uint32_t digit = (uint32_t)(*p - '0');
+        if (digit > 9 || ++wholeDigits > 9)
+            return false;
+        whole = whole * 10 + digit;
+    }
+    if (p < end)
+    {
+        for (p++; p < end; p++)
+        {
+            uint32_t digit = (uint32_t)(*p - '0');
+            if (digit > 9)
+                return false;
+            if (decimals < 9)
+            {
+                fraction = fraction * 10 + digit;
+                decimals++;
+            }
+        }
+    }
+    return wholeDigits > 0 || decimals > 0;
+}
+
+static bool loc_eng_nmea_float(const loc_nmea_field &f, float &value)
+{
+    bool negative;
+    uint32_t whole, fraction;
+    int decimals;
+    if (!loc_eng_nmea_decimal(f, negative, whole, fraction, decimals))
+        return false;
+    double v = whole + (double)fraction / sPow10[decimals];
+    value = (float)(negative ? -v : v);
+    return true;
+}
+
+/* hhmmss[.sss] into milliseconds of the day */
+static bool loc_eng_nmea_time(const loc_nmea_field &f, uint32_t &timeMs)
+{
+    bool negative;
+    uint32_t whole, fraction;
+    int decimals;
+    if (f.len < 6 || !loc_eng_nmea_decimal(f, negative, whole, fraction, decimals) ||
+        negative)
+        return false;
+    uint32_t ms = decimals > 3 ? fraction / sPow10[decimals - 3] : fraction * sPow10[3 - decimals];
+    timeMs = ((whole / 10000) * 3600 + (whole / 100 % 100) * 60 + whole % 100) * 1000 + ms;
+    return true;
+}
+
+/* ddmm.mmmm or dddmm.mmmm and its hemisphere into signed degrees */
+static bool loc_eng_nmea_coordinate(const loc_nmea_field &value, const loc_nmea_field &hemisphere,
+                                    double &degrees)
+{
+    bool negative;
+    uint32_t whole, fraction;
+    int decimals;
+    if (!loc_eng_nmea_decimal(value, negative, whole, fraction, decimals) || negative ||
+        hemisphere.len != 1)
+        return false;
+    double minutes = whole % 100 + (double)fraction / sPow10[decimals];
+    degrees = whole / 100 + minutes / 60.0;
+    switch (hemisphere.ptr[0])
+    {
+    case 'S':
+    case 'W':
+        degrees = -degrees;
+        break;
+    case 'N':
+    case 'E':
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static char loc_eng_nmea_char(const loc_nmea_field &f)
+{
+    return f.len > 0 ? f.ptr[0] : 0;
+}
+
+static void loc_eng_nmea_parse_gga(const loc_nmea_tokens *t, LocNmeaParsed *parsed)
+{
+    LocNmeaGga &gga = parsed->u.gga;
+    uint32_t v;
+
+    if (loc_eng_nmea_time(t->field[1], gga.time_ms))
+        parsed->flags |= LOC_NMEA_HAS_TIME;
+    if (loc_eng_nmea_coordinate(t->field[2], t->field[3], gga.latitude) &&
+        loc_eng_nmea_coordinate(t->field[4], t->field[5], gga.longitude))
+        parsed->flags |= LOC_NMEA_HAS_LAT_LONG;
+    if (loc_eng_nmea_uint(t->field[6], v))
+        gga.quality = (uint8_t)v;
+    if (loc_eng_nmea_uint(t->field[7], v))
+    {
+        gga.sv_used = (uint8_t)v;
+        parsed->flags |= LOC_NMEA_HAS_SV_USED;
+    }
+    if (loc_eng_nmea_float(t->field[8], gga.hdop))
+        parsed->flags |= LOC_NMEA_HAS_HDOP;
+    if (loc_eng_nmea_float(t->field[9], gga.altitude))
+        parsed->flags |= LOC_NMEA_HAS_ALTITUDE;
+    if (loc_eng_nmea_float(t->field[11], gga.geoid_separation))
+        parsed->flags |= LOC_NMEA_HAS_GEOID_SEP;
+}
+
+static void loc_eng_nmea_parse_rmc(const loc_nmea_tokens *t, LocNmeaParsed *parsed)
+{
+    LocNmeaRmc &rmc = parsed->u.rmc;
+    uint32_t v;
+
+    if (loc_eng_nmea_time(t->field[1], rmc.time_ms))
+        parsed->flags |= LOC_NMEA_HAS_TIME;
+    rmc.status = loc_eng_nmea_char(t->field[2]);
+    if (loc_eng_nmea_coordinate(t->field[3], t->field[4], rmc.latitude) &&
+        loc_eng_nmea_coordinate(t->field[5], t->field[6], rmc.longitude))
+        parsed->flags |= LOC_NMEA_HAS_LAT_LONG;
+    if (loc_eng_nmea_float(t->field[7], rmc.speed_knots))
+        parsed->flags |= LOC_NMEA_HAS_SPEED;
+    if (loc_eng_nmea_float(t->field[8], rmc.course))
+        parsed->flags |= LOC_NMEA_HAS_COURSE;
+    if (t->field[9].len == 6 && loc_eng_nmea_uint(t->field[9], v))
+    {
+        rmc.day = (uint8_t)(v / 10000);
+        rmc.month = (uint8_t)(v / 100 % 100);
+        rmc.year = (uint16_t)(2000 + v % 100);
+        parsed->flags |= LOC_NMEA_HAS_DATE;
+    }
+    if (loc_eng_nmea_float(t->field[10], rmc.mag_variation))
+    {
+        if (loc_eng_nmea_char(t->field[11]) == 'W')
+            rmc.mag_variation = -rmc.mag_variation;
+        parsed->flags |= LOC_NMEA_HAS_MAG_VARIATION;
+    }
+    if (t->field_cnt > 12)
+        rmc.mode = loc_eng_nmea_char(t->field[12]);
+}
+
+static void loc_eng_nmea_parse_gsa(const loc_nmea_tokens *t, LocNmeaParsed *parsed)
+{
+    LocNmeaGsa &gsa = parsed->u.gsa;
+    uint32_t v;
+
+    gsa.selection = loc_eng_nmea_char(t->field[1]);
+    if (loc_eng_nmea_uint(t->field[2], v))
+        gsa.fix_type = (uint8_t)v;
+    for (int i = 3; i < 3 + LOC_NMEA_GSA_MAX_SVS; i++)
+    {
+        if (loc_eng_nmea_uint(t->field[i], v))
+            gsa.prns[gsa.prn_cnt++] = (uint16_t)v;
+    }
+    if (loc_eng_nmea_float(t->field[15], gsa.pdop))
+        parsed->flags |= LOC_NMEA_HAS_PDOP;
+    if (loc_eng_nmea_float(t->field[16], gsa.hdop))
+        parsed->flags |= LOC_NMEA_HAS_HDOP;
+    if (loc_eng_nmea_float(t->field[17], gsa.vdop))
+        parsed->flags |= LOC_NMEA_HAS_VDOP;
+}
+
+static bool loc_eng_nmea_parse_gsv(const loc_nmea_tokens *t, LocNmeaParsed *parsed)
+{
+    LocNmeaGsv &gsv = parsed->u.gsv;
+    uint32_t v;
+
+    if (!loc_eng_nmea_uint(t->field[1], v))
+        return false;
+    gsv.sentence_cnt = (uint8_t)v;
+    if (!loc_eng_nmea_uint(t->field[2], v))
+        return false;
+    gsv.sentence_num = (uint8_t)v;
+    if (loc_eng_nmea_uint(t->field[3], v))
+        gsv.sv_in_view = (uint16_t)v;
+
+    for (int i = 4; i + 3 < t->field_cnt + 1 && gsv.sv_cnt < LOC_NMEA_GSV_MAX_SVS; i += 4)
+    {
+        // a block may lose its trailing empty snr, or be padded out empty
+        if (!loc_eng_nmea_uint(t->field[i], v))
+            continue;
+        LocNmeaGsvSv &sv = gsv.svs[gsv.sv_cnt++];
+        sv.prn = (uint16_t)v;
+        sv.elevation = loc_eng_nmea_uint(t->field[i + 1], v) ? (int16_t)v : -1;
+        sv.azimuth = loc_eng_nmea_uint(t->field[i + 2], v) ? (int16_t)v : -1;
+        sv.snr = (i + 3 < t->field_cnt && loc_eng_nmea_uint(t->field[i + 3], v)) ? (int16_t)v : -1;
+    }
+    return true;
+}
+
+static void loc_eng_nmea_parse_gns(const loc_nmea_tokens *t, LocNmeaParsed *parsed)
+{
+    LocNmeaGns &gns = parsed->u.gns;
+    uint32_t v;
+
+    if (loc_eng_nmea_time(t->field[1], gns.time_ms))
+        parsed->flags |= LOC_NMEA_HAS_TIME;
+    if (loc_eng_nmea_coordinate(t->field[2], t->field[3], gns.latitude) &&
+        loc_eng_nmea_coordinate(t->field[4], t->field[5], gns.longitude))
+        parsed->flags |= LOC_NMEA_HAS_LAT_LONG;
+    int modes = t->field[6].len < LOC_NMEA_GNS_MAX_MODES ?
+                t->field[6].len : LOC_NMEA_GNS_MAX_MODES;
+    memcpy(gns.modes, t->field[6].ptr, modes);
+    gns.modes[modes] = '\0';
+    if (loc_eng_nmea_uint(t->field[7], v))
+    {
+        gns.sv_used = (uint8_t)v;
+        parsed->flags |= LOC_NMEA_HAS_SV_USED;
+    }
+    if (loc_eng_nmea_float(t->field[8], gns.hdop))
+        parsed->flags |= LOC_NMEA_HAS_HDOP;
+    if (loc_eng_nmea_float(t->field[9], gns.altitude))
+        parsed->flags |= LOC_NMEA_HAS_ALTITUDE;
+    if (loc_eng_nmea_float(t->field[10], gns.geoid_separation))
+        parsed->flags |= LOC_NMEA_HAS_GEOID_SEP;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_parse
+
+DESCRIPTION
+   Extract the fields of a GGA, RMC, GSA, GSV or GNS sentence, from any
+   talker
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if not one of those, or too short to be one
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+bool loc_eng_nmea_parse(const loc_nmea_tokens *tokens, LocNmeaParsed *parsed)
+{
+    const loc_nmea_field &address = tokens->field[0];
+    if (address.len != 5)
+        return false;
+
+    memset(parsed, 0, sizeof(*parsed));
+    parsed->size = sizeof(*parsed);
+    parsed->talker[0] = address.ptr[0];
+    parsed->talker[1] = address.ptr[1];
+
+    const char *type = address.ptr + 2;
+    if (0 == memcmp(type, "GGA", 3) && tokens->field_cnt >= 12)
+    {
+        parsed->type = LOC_NMEA_SENTENCE_GGA;
+        loc_eng_nmea_parse_gga(tokens, parsed);
+    }
+    else if (0 == memcmp(type, "RMC", 3) && tokens->field_cnt >= 12)
+    {
+        parsed->type = LOC_NMEA_SENTENCE_RMC;
+        loc_eng_nmea_parse_rmc(tokens, parsed);
+    }
+    else if (0 == memcmp(type, "GSA", 3) && tokens->field_cnt >= 18)
+    {
+        parsed->type = LOC_NMEA_SENTENCE_GSA;
+        loc_eng_nmea_parse_gsa(tokens, parsed);
+    }
+    else if (0 == memcmp(type, "GSV", 3) && tokens->field_cnt >= 4)
+    {
+        parsed->type = LOC_NMEA_SENTENCE_GSV;
+        return loc_eng_nmea_parse_gsv(tokens, parsed);
+    }
+    else if (0 == memcmp(type, "GNS", 3) && tokens->field_cnt >= 11)
+    {
+        parsed->type = LOC_NMEA_SENTENCE_GNS;
+        loc_eng_nmea_parse_gns(tokens, parsed);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_parse_buffer
+
+DESCRIPTION
+   Parse all sentences in buf, in place
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Number of sentences handed to cb
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_nmea_parse_buffer(const char *buf, int length, loc_nmea_parsed_callback cb)
+{
+    const char *cursor = buf;
+    const char *end = buf + length;
+    loc_nmea_tokens tokens;
+    LocNmeaParsed parsed;
+    int delivered = 0;
+    int result;
+
+    while ((result = loc_eng_nmea_next(&cursor, end, &tokens)) != 0)
+    {
+        if (result > 0 && loc_eng_nmea_parse(&tokens, &parsed))
+        {
+            cb(&parsed);
+            delivered++;
+        }
+    }
+    return delivered;
+}
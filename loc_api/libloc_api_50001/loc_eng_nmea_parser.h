@@ -0,0 +1,64 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_NMEA_PARSER_H
+#define LOC_ENG_NMEA_PARSER_H
+
+#include <stdint.h>
+#include <gps_extended_c.h>
+
+/* Enough for the longest sentence parsed, a GSA with its 12 PRNs */
+#define LOC_NMEA_MAX_FIELDS 32
+
+/* A field is a view into the received buffer, it is not NUL terminated */
+typedef struct {
+    const char *ptr;
+    int len;
+} loc_nmea_field;
+
+/* One sentence split at its commas. field[0] is the address, e.g. "GPGGA". */
+typedef struct {
+    int field_cnt;
+    loc_nmea_field field[LOC_NMEA_MAX_FIELDS];
+} loc_nmea_tokens;
+
+/* Finds the next sentence at *cursor, checks its checksum and splits it.
+   Advances *cursor past it. Returns 1 for a good sentence, -1 for one
+   that was skipped (bad checksum, none, too many fields) and 0 once
+   there are no more. */
+int loc_eng_nmea_next(const char **cursor, const char *end, loc_nmea_tokens *tokens);
+
+/* Fills in parsed from a good sentence. Returns false for sentence types
+   not in LocNmeaSentenceType and for malformed mandatory fields. */
+bool loc_eng_nmea_parse(const loc_nmea_tokens *tokens, LocNmeaParsed *parsed);
+
+/* Parses each sentence in buf and hands it to cb. Returns how many were. */
+int loc_eng_nmea_parse_buffer(const char *buf, int length, loc_nmea_parsed_callback cb);
+
+#endif // LOC_ENG_NMEA_PARSER_H
@@ -0,0 +1,509 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <loc_eng_nmea_server.h>
+#include "log_util.h"
+
+#define NMEA_SERVER_MIN_BUFFER 1024
+
+typedef struct {
+    int fd;             // -1 while the slot is free
+    char *ring;
+    uint32_t head;      // bytes queued since connecting, wraps
+    uint32_t tail;      // bytes written out since connecting, wraps
+    bool closing;       // too slow, to be disconnected
+} loc_eng_nmea_server_client;
+
+struct loc_eng_nmea_server {
+    struct loc_eng_dmn_conn_thelper thelper;
+    // guards the clients' ring positions, closing flags, the count and
+    // the stats; only the server thread changes a client's fd and ring
+    pthread_mutex_t lock;
+    int listen_fd;
+    int wake_fd[2];
+    bool wake_pending;
+    int max_clients;
+    uint32_t ring_size;
+    int policy;
+    loc_eng_nmea_server_demand_cb demand_cb;
+    void *context;
+    loc_eng_nmea_server_stats stats;
+    loc_eng_nmea_server_client *clients;
+    // the wake pipe, the socket, then one per client slot
+    struct pollfd *fds;
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+};
+
+static void loc_eng_nmea_server_wake(loc_eng_nmea_server *server)
+{
+    // non blocking; a full pipe already holds a wake up
+    if (write(server->wake_fd[1], "", 1) < 0 && errno != EAGAIN) {
+        LOC_LOGE("%s: %s", __func__, strerror(errno));
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_server_publish
+
+DESCRIPTION
+   Append the NMEA to the ring of every connected client. A client without
+   room for all of it misses it, or is marked for disconnection, as the
+   slow client policy says; nobody ever waits on a client here.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_server_publish(loc_eng_nmea_server *server, const char *nmea, int length)
+{
+    bool wake = false;
+
+    if (length <= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    server->stats.published++;
+    for (int i = 0; i < server->max_clients; i++) {
+        loc_eng_nmea_server_client *c = &server->clients[i];
+        if (c->fd < 0 || c->closing) {
+            continue;
+        }
+        if ((uint32_t)length <= server->ring_size - (c->head - c->tail)) {
+            uint32_t start = c->head & (server->ring_size - 1);
+            uint32_t first = server->ring_size - start;
+            if (first > (uint32_t)length) {
+                first = length;
+            }
+            memcpy(c->ring + start, nmea, first);
+            memcpy(c->ring, nmea + first, length - first);
+            c->head += length;
+            wake = true;
+        } else if (NMEA_SERVER_SLOW_CLIENT_DISCONNECT == server->policy) {
+            c->closing = true;
+            server->stats.disconnects++;
+            wake = true;
+        } else {
+            server->stats.drops++;
+        }
+    }
+    // one wake up for however many publishes until the thread runs
+    if (wake && !server->wake_pending) {
+        server->wake_pending = true;
+    } else {
+        wake = false;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    if (wake) {
+        loc_eng_nmea_server_wake(server);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_server_get_stats
+
+DESCRIPTION
+   Copy out the client count and delivery counters
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_server_get_stats(loc_eng_nmea_server *server,
+                                   loc_eng_nmea_server_stats *stats)
+{
+    pthread_mutex_lock(&server->lock);
+    *stats = server->stats;
+    pthread_mutex_unlock(&server->lock);
+}
+
+static void loc_eng_nmea_server_accept(loc_eng_nmea_server *server)
+{
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        LOC_LOGW("%s: accept: %s", __func__, strerror(errno));
+        return;
+    }
+
+    int slot = 0;
+    while (slot < server->max_clients && server->clients[slot].fd >= 0) {
+        slot++;
+    }
+    char *ring = slot < server->max_clients ? (char*)malloc(server->ring_size) : NULL;
+    if (NULL == ring || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        LOC_LOGW("%s: turning away a client, %d connected", __func__, server->stats.clients);
+        free(ring);
+        close(fd);
+        return;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    loc_eng_nmea_server_client *c = &server->clients[slot];
+    c->fd = fd;
+    c->ring = ring;
+    c->head = 0;
+    c->tail = 0;
+    c->closing = false;
+    bool first = (1 == ++server->stats.clients);
+    pthread_mutex_unlock(&server->lock);
+
+    LOC_LOGD("%s: client %d connected, %d in all", __func__, fd, server->stats.clients);
+    if (first && server->demand_cb) {
+        server->demand_cb(server->context, 1);
+    }
+}
+
+static void loc_eng_nmea_server_close(loc_eng_nmea_server *server, int slot)
+{
+    loc_eng_nmea_server_client *c = &server->clients[slot];
+
+    pthread_mutex_lock(&server->lock);
+    int fd = c->fd;
+    char *ring = c->ring;
+    c->fd = -1;
+    c->ring = NULL;
+    bool last = (0 == --server->stats.clients);
+    pthread_mutex_unlock(&server->lock);
+
+    close(fd);
+    free(ring);
+    LOC_LOGD("%s: client %d gone, %d left", __func__, fd, server->stats.clients);
+    if (last && server->demand_cb) {
+        server->demand_cb(server->context, 0);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_server_flush
+
+DESCRIPTION
+   Write out as much of a client's ring as its socket takes, both parts of
+   a wrapped ring in one call. sendmsg is writev with flags here, so a
+   client that went away gives EPIPE instead of SIGPIPE.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if the client is to be closed
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_nmea_server_flush(loc_eng_nmea_server *server, int slot)
+{
+    loc_eng_nmea_server_client *c = &server->clients[slot];
+    struct iovec iov[2];
+    struct msghdr msg;
+
+    pthread_mutex_lock(&server->lock);
+    uint32_t used = c->head - c->tail;
+    uint32_t start = c->tail & (server->ring_size - 1);
+    uint32_t first = server->ring_size - start;
+    if (first > used) {
+        first = used;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    // publish only ever writes outside of tail..head, so these stay put
+    iov[0].iov_base = c->ring + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = c->ring;
+    iov[1].iov_len = used - first;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = used > first ? 2 : 1;
+
+    ssize_t sent = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent > 0) {
+        pthread_mutex_lock(&server->lock);
+        c->tail += sent;
+        pthread_mutex_unlock(&server->lock);
+    } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return false;
+    }
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_server_proc
+
+DESCRIPTION
+   One round of the server thread: wait for a wake up, a connection, or
+   a client that can take more or has gone, and deal with each
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0, the thread carries on until the thelper is unblocked
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_nmea_server_proc(void *context)
+{
+    loc_eng_nmea_server *server = (loc_eng_nmea_server*)context;
+    struct pollfd *fds = server->fds;
+
+    fds[0].fd = server->wake_fd[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = server->listen_fd;
+    fds[1].events = POLLIN;
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < server->max_clients; i++) {
+        loc_eng_nmea_server_client *c = &server->clients[i];
+        // poll skips free slots and, left out here, those to be closed
+        fds[2 + i].fd = c->closing ? -1 : c->fd;
+        fds[2 + i].events = POLLIN | (c->head != c->tail ? POLLOUT : 0);
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    // a slow client's socket is full, so it cannot wait for POLLOUT
+    for (int i = 0; i < server->max_clients; i++) {
+        if (fds[2 + i].fd < 0 && server->clients[i].fd >= 0) {
+            loc_eng_nmea_server_close(server, i);
+        }
+    }
+
+    if (poll(fds, 2 + server->max_clients, -1) < 0) {
+        if (errno != EINTR) {
+            LOC_LOGE("%s: poll: %s", __func__, strerror(errno));
+        }
+        return 0;
+    }
+    if (server->thelper.thread_exit) {
+        return 0;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        char drain[64];
+        while (read(server->wake_fd[0], drain, sizeof(drain)) > 0) {
+        }
+        pthread_mutex_lock(&server->lock);
+        server->wake_pending = false;
+        pthread_mutex_unlock(&server->lock);
+    }
+
+    for (int i = 0; i < server->max_clients; i++) {
+        short revents = fds[2 + i].revents;
+        if (fds[2 + i].fd < 0 || 0 == revents) {
+            continue;
+        }
+        bool drop = (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+        if (!drop && (revents & POLLIN)) {
+            // clients have nothing to say, this only notices them leaving
+            char scratch[64];
+            ssize_t got = recv(fds[2 + i].fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+            drop = (0 == got) ||
+                   (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+        }
+        if (!drop && (revents & POLLOUT)) {
+            drop = !loc_eng_nmea_server_flush(server, i);
+        }
+        if (drop) {
+            loc_eng_nmea_server_close(server, i);
+        }
+    }
+
+    if (fds[1].revents & POLLIN) {
+        loc_eng_nmea_server_accept(server);
+    }
+    return 0;
+}
+
+static int loc_eng_nmea_server_proc_post(void *context)
+{
+    loc_eng_nmea_server *server = (loc_eng_nmea_server*)context;
+    for (int i = 0; i < server->max_clients; i++) {
+        if (server->clients[i].fd >= 0) {
+            loc_eng_nmea_server_close(server, i);
+        }
+    }
+    return 0;
+}
+
+static void loc_eng_nmea_server_free(loc_eng_nmea_server *server)
+{
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        unlink(server->path);
+    }
+    if (server->wake_fd[0] >= 0) {
+        close(server->wake_fd[0]);
+        close(server->wake_fd[1]);
+    }
+    pthread_mutex_destroy(&server->lock);
+    free(server->fds);
+    free(server->clients);
+    free(server);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_server_start
+
+DESCRIPTION
+   Listen on the UNIX socket at path and start the server thread.
+   clientBuffer is rounded up to a power of two, and should hold a few
+   epochs. The socket is made 0660 before it listens, so only the user
+   and group the HAL runs as can connect.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   The server, NULL on failure
+
+SIDE EFFECTS
+   A stale socket file at path is replaced
+
+===========================================================================*/
+loc_eng_nmea_server* loc_eng_nmea_server_start(const char *path, int maxClients,
+                                               int clientBuffer, int slowClientPolicy,
+                                               thelper_create_thread create_thread_cb,
+                                               loc_eng_nmea_server_demand_cb demand_cb,
+                                               void *context)
+{
+    struct sockaddr_un addr;
+
+    if (NULL == path || strlen(path) >= sizeof(addr.sun_path) || maxClients < 1) {
+        LOC_LOGE("%s: bad socket path or client count", __func__);
+        return NULL;
+    }
+
+    loc_eng_nmea_server *server =
+        (loc_eng_nmea_server*)calloc(1, sizeof(loc_eng_nmea_server));
+    if (NULL == server) {
+        return NULL;
+    }
+    pthread_mutex_init(&server->lock, NULL);
+    server->listen_fd = -1;
+    server->wake_fd[0] = server->wake_fd[1] = -1;
+    server->max_clients = maxClients;
+    server->ring_size = NMEA_SERVER_MIN_BUFFER;
+    while (server->ring_size < (uint32_t)clientBuffer && server->ring_size < (1U << 30)) {
+        server->ring_size <<= 1;
+    }
+    server->policy = slowClientPolicy;
+    server->demand_cb = demand_cb;
+    server->context = context;
+    memcpy(server->path, path, strlen(path) + 1);
+
+    server->clients = (loc_eng_nmea_server_client*)
+        calloc(maxClients, sizeof(loc_eng_nmea_server_client));
+    server->fds = (struct pollfd*)calloc(2 + maxClients, sizeof(struct pollfd));
+    if (NULL == server->clients || NULL == server->fds) {
+        loc_eng_nmea_server_free(server);
+        return NULL;
+    }
+    for (int i = 0; i < maxClients; i++) {
+        server->clients[i].fd = -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    unlink(path);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listen_fd < 0 ||
+        bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        chmod(path, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) < 0 ||
+        listen(server->listen_fd, maxClients) < 0 ||
+        pipe(server->wake_fd) < 0) {
+        LOC_LOGE("%s: %s: %s", __func__, path, strerror(errno));
+        loc_eng_nmea_server_free(server);
+        return NULL;
+    }
+    fcntl(server->wake_fd[0], F_SETFL, O_NONBLOCK);
+    fcntl(server->wake_fd[1], F_SETFL, O_NONBLOCK);
+
+    if (loc_eng_dmn_conn_launch_thelper(&server->thelper, NULL, NULL,
+                                        loc_eng_nmea_server_proc,
+                                        loc_eng_nmea_server_proc_post,
+                                        create_thread_cb, server) != 0) {
+        LOC_LOGE("%s: could not start the server thread", __func__);
+        loc_eng_nmea_server_free(server);
+        return NULL;
+    }
+
+    LOC_LOGI("%s: serving NMEA on %s, up to %d clients, %u byte buffers",
+             __func__, path, maxClients, server->ring_size);
+    return server;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_server_stop
+
+DESCRIPTION
+   Stop the server thread, disconnect all clients and free the server.
+   Not to be called while a publish may be under way.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   Removes the socket file
+
+===========================================================================*/
+void loc_eng_nmea_server_stop(loc_eng_nmea_server *server)
+{
+    loc_eng_dmn_conn_unblock_thelper(&server->thelper);
+    loc_eng_nmea_server_wake(server);
+    loc_eng_dmn_conn_join_thelper(&server->thelper);
+    loc_eng_nmea_server_free(server);
+}
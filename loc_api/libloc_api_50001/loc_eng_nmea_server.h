@@ -0,0 +1,80 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_NMEA_SERVER_H
+#define LOC_ENG_NMEA_SERVER_H
+
+#include <stdint.h>
+#include <loc_eng_dmn_conn_thread_helper.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* What happens to a client whose ring has no room for the next epoch */
+#define NMEA_SERVER_SLOW_CLIENT_DROP        0 /* it misses that epoch */
+#define NMEA_SERVER_SLOW_CLIENT_DISCONNECT  1 /* it is disconnected */
+
+/* Fans NMEA out to the clients of a UNIX stream socket. Publishing only
+   copies into a ring per client and never blocks; a thread of its own
+   writes the rings out, whatever has piled up in one writev. */
+typedef struct loc_eng_nmea_server loc_eng_nmea_server;
+
+/* Called from the server thread as the first client connects (1) and
+   the last one leaves (0) */
+typedef void (*loc_eng_nmea_server_demand_cb)(void *context, int listening);
+
+typedef struct {
+    int clients;
+    uint32_t published;     /* publish calls */
+    uint32_t drops;         /* times a client missed one */
+    uint32_t disconnects;   /* slow clients disconnected */
+} loc_eng_nmea_server_stats;
+
+/* Returns NULL if the socket cannot be set up */
+loc_eng_nmea_server* loc_eng_nmea_server_start(const char *path, int maxClients,
+                                               int clientBuffer, int slowClientPolicy,
+                                               thelper_create_thread create_thread_cb,
+                                               loc_eng_nmea_server_demand_cb demand_cb,
+                                               void *context);
+
+/* Queues length bytes to every connected client */
+void loc_eng_nmea_server_publish(loc_eng_nmea_server *server, const char *nmea, int length);
+
+void loc_eng_nmea_server_get_stats(loc_eng_nmea_server *server,
+                                   loc_eng_nmea_server_stats *stats);
+
+/* Disconnects everyone, removes the socket and frees the server */
+void loc_eng_nmea_server_stop(loc_eng_nmea_server *server);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // LOC_ENG_NMEA_SERVER_H
@@ -0,0 +1,281 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Load test for loc_eng_nmea_server on a local socket. Connects fast
+   clients, which read everything, and slow clients, which never read,
+   then publishes numbered epochs of 8 sentences at a fixed pace the way
+   the MsgTask would. Checks that every fast client got every epoch
+   whole and in order, that the slow clients were dropped or
+   disconnected per the policy, and reports how long publishing took.
+   The pace is far above any real fix rate; a buffer of well under a
+   second of epochs then leaves room for scheduling hiccups only.
+   Usage: loc_eng_nmea_server_bench [fast] [slow] [epochs] [policy] [pace usec]
+                                    [buffer] [socket] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <loc_eng_nmea_writer.h>
+#include <loc_eng_nmea_server.h>
+
+#define BENCH_SENTENCES_PER_EPOCH 8
+#define BENCH_EPOCH_LENGTH 2048
+
+typedef struct {
+    pthread_t thread;
+    int fd;
+    bool slow;
+    uint32_t epochs;        // whole epochs received
+    uint32_t errors;        // sentences out of order or cut
+    bool closedEarly;       // server hung up before the end
+} bench_client;
+
+static const char *bench_path;
+static volatile int bench_done = 0;
+static volatile int bench_demand = 0;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_demand_cb(void*, int listening)
+{
+    bench_demand = listening;
+}
+
+static int bench_make_epoch(char *epoch, uint32_t seq)
+{
+    int length = 0;
+    for (int i = 0; i < BENCH_SENTENCES_PER_EPOCH; i++) {
+        loc_eng_nmea_writer w;
+        char pad[100];
+        memset(pad, 'A' + i, sizeof(pad) - 1);
+        pad[sizeof(pad) - 1] = '\0';
+        loc_eng_nmea_writer_begin(&w, epoch + length, BENCH_EPOCH_LENGTH - length);
+        loc_eng_nmea_put_str(&w, "PQBEN,");
+        loc_eng_nmea_put_int(&w, (int)seq, 0);
+        loc_eng_nmea_put_char(&w, ',');
+        loc_eng_nmea_put_int(&w, i, 0);
+        loc_eng_nmea_put_char(&w, ',');
+        loc_eng_nmea_put_str(&w, pad);
+        length += loc_eng_nmea_writer_end(&w) + 1;
+    }
+    return length;
+}
+
+static int bench_connect()
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, bench_path, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+/* reads sentences until the server hangs up; the first one it sees must
+   open an epoch, and from there on no sentence may be missing */
+static void* bench_client_main(void *arg)
+{
+    bench_client *client = (bench_client*)arg;
+    char buf[16384];
+    char line[256];
+    int lineLength = 0;
+    bool started = false;
+    uint32_t nextSeq = 0;
+    int nextIndex = 0;
+
+    if (client->slow) {
+        struct pollfd pfd;
+        pfd.fd = client->fd;
+        pfd.events = 0;
+        // only learns of the hang up, never reads what is queued for it
+        while (!bench_done) {
+            if (poll(&pfd, 1, 1) > 0 && (pfd.revents & POLLHUP)) {
+                client->closedEarly = !bench_done;
+                break;
+            }
+        }
+        return NULL;
+    }
+
+    for (;;) {
+        ssize_t got = read(client->fd, buf, sizeof(buf));
+        if (got <= 0) {
+            client->closedEarly = !bench_done;
+            break;
+        }
+        for (ssize_t k = 0; k < got; k++) {
+            if (lineLength < (int)sizeof(line) - 1) {
+                line[lineLength++] = buf[k];
+            }
+            if (buf[k] != '\n') {
+                continue;
+            }
+            line[lineLength] = '\0';
+            unsigned int seq;
+            int index;
+            if (sscanf(line, "$PQBEN,%u,%d,", &seq, &index) != 2) {
+                client->errors++;
+            } else if (!started) {
+                started = true;
+                if (index != 0) {
+                    client->errors++;
+                }
+                nextSeq = seq;
+                nextIndex = index;
+            }
+            if (started) {
+                if (seq != nextSeq || index != nextIndex) {
+                    client->errors++;
+                }
+                nextSeq = seq;
+                nextIndex = index + 1;
+                if (nextIndex == BENCH_SENTENCES_PER_EPOCH) {
+                    client->epochs++;
+                    nextSeq++;
+                    nextIndex = 0;
+                }
+            }
+            lineLength = 0;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int fast = argc > 1 ? atoi(argv[1]) : 14;
+    int slow = argc > 2 ? atoi(argv[2]) : 1;
+    int epochs = argc > 3 ? atoi(argv[3]) : 20000;
+    int policy = argc > 4 ? atoi(argv[4]) : NMEA_SERVER_SLOW_CLIENT_DROP;
+    int pace = argc > 5 ? atoi(argv[5]) : 1000;
+    int buffer = argc > 6 ? atoi(argv[6]) : 65536;
+    bench_path = argc > 7 ? argv[7] : "loc_eng_nmea_server_bench.sock";
+
+    if (fast < 0 || slow < 0 || fast + slow < 1 || epochs < 1) {
+        fprintf(stderr, "usage: %s [fast] [slow] [epochs] [policy] [pace usec] "
+                "[buffer] [socket]\n", argv[0]);
+        return 1;
+    }
+
+    loc_eng_nmea_server *server =
+        loc_eng_nmea_server_start(bench_path, fast + slow, buffer, policy,
+                                  NULL, bench_demand_cb, NULL);
+    if (NULL == server) {
+        return 1;
+    }
+
+    bench_client *clients = (bench_client*)calloc(fast + slow, sizeof(bench_client));
+    for (int i = 0; i < fast + slow; i++) {
+        clients[i].slow = (i >= fast);
+        clients[i].fd = bench_connect();
+        pthread_create(&clients[i].thread, NULL, bench_client_main, &clients[i]);
+    }
+
+    loc_eng_nmea_server_stats stats;
+    do {
+        usleep(1000);
+        loc_eng_nmea_server_get_stats(server, &stats);
+    } while (stats.clients < fast + slow);
+    bool demandSeen = bench_demand;
+
+    char epoch[BENCH_EPOCH_LENGTH];
+    uint64_t worst = 0, total = 0;
+    uint64_t start = bench_usec();
+    for (int seq = 0; seq < epochs; seq++) {
+        int length = bench_make_epoch(epoch, seq);
+        uint64_t before = bench_usec();
+        loc_eng_nmea_server_publish(server, epoch, length);
+        uint64_t took = bench_usec() - before;
+        total += took;
+        if (took > worst) {
+            worst = took;
+        }
+        uint64_t due = start + (uint64_t)(seq + 1) * pace;
+        uint64_t now = bench_usec();
+        if (due > now) {
+            usleep(due - now);
+        }
+    }
+    uint64_t elapsed = bench_usec() - start;
+
+    // let the fast clients catch up before hanging up on them
+    usleep(200000);
+    loc_eng_nmea_server_get_stats(server, &stats);
+    bench_done = 1;
+    loc_eng_nmea_server_stop(server);
+
+    int failures = 0;
+    uint32_t fewest = (uint32_t)epochs;
+    for (int i = 0; i < fast + slow; i++) {
+        pthread_join(clients[i].thread, NULL);
+        close(clients[i].fd);
+        if (!clients[i].slow) {
+            if (clients[i].errors || clients[i].closedEarly || clients[i].epochs != (uint32_t)epochs) {
+                failures++;
+            }
+            if (clients[i].epochs < fewest) {
+                fewest = clients[i].epochs;
+            }
+        } else if (clients[i].closedEarly !=
+                   (NMEA_SERVER_SLOW_CLIENT_DISCONNECT == policy)) {
+            failures++;
+        }
+    }
+    if (!demandSeen || bench_demand) {
+        failures++;
+    }
+
+    printf("%d fast + %d slow clients, %d epochs of %d bytes in %.2f s, policy %s\n",
+           fast, slow, epochs, bench_make_epoch(epoch, 0), elapsed / 1e6,
+           NMEA_SERVER_SLOW_CLIENT_DISCONNECT == policy ? "disconnect" : "drop");
+    printf("publish: %.1f usec average, %llu usec worst\n",
+           (double)total / epochs, (unsigned long long)worst);
+    printf("fast clients: fewest epochs received %u; drops %u, disconnects %u\n",
+           fewest, stats.drops, stats.disconnects);
+    printf("%d failures\n", failures);
+
+    free(clients);
+    return failures ? 2 : 0;
+}
@@ -0,0 +1,363 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <loc_eng_nmea_writer.h>
+
+static const uint32_t sPow10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000
+};
+
+static const char sHexDigits[] = "0123456789ABCDEF";
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_writer_begin
+
+DESCRIPTION
+   Start a new sentence in buf
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_writer_begin(loc_eng_nmea_writer *w, char *buf, int size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->length = 0;
+    w->checksum = 0;
+    w->overflow = (size < 2);
+    if (!w->overflow) {
+        buf[w->length++] = '$';
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_writer_end
+
+DESCRIPTION
+   Close the sentence with its checksum and line terminator
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Length of the sentence after the '$', -1 if it did not fit
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_nmea_writer_end(loc_eng_nmea_writer *w)
+{
+    if (w->overflow || w->length + 6 > w->size) {
+        if (w->size > 0) {
+            w->buf[w->length < w->size ? w->length : w->size - 1] = '\0';
+        }
+        return -1;
+    }
+
+    char *p = w->buf + w->length;
+    p[0] = '*';
+    p[1] = sHexDigits[w->checksum >> 4];
+    p[2] = sHexDigits[w->checksum & 0xF];
+    p[3] = '\r';
+    p[4] = '\n';
+    p[5] = '\0';
+    w->length += 5;
+
+    return w->length - 1;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_str
+
+DESCRIPTION
+   Append a literal
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_put_str(loc_eng_nmea_writer *w, const char *str)
+{
+    while (*str != '\0') {
+        loc_eng_nmea_put_char(w, *str++);
+    }
+}
+
+// writes value with at least minDigits digits, zero padded on the left
+static void loc_eng_nmea_put_digits(loc_eng_nmea_writer *w, uint64_t value,
+                                    int minDigits)
+{
+    char digits[24];
+    int n = 0;
+
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (minDigits-- > n) {
+        loc_eng_nmea_put_char(w, '0');
+    }
+    while (n > 0) {
+        loc_eng_nmea_put_char(w, digits[--n]);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_int
+
+DESCRIPTION
+   Append value as "%0<width>d" would. As with printf the sign counts
+   towards the width.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_put_int(loc_eng_nmea_writer *w, int value, int width)
+{
+    uint64_t magnitude;
+    if (value < 0) {
+        loc_eng_nmea_put_char(w, '-');
+        magnitude = (uint64_t)(-(int64_t)value);
+        width--;
+    } else {
+        magnitude = (uint64_t)value;
+    }
+    loc_eng_nmea_put_digits(w, magnitude, width);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_scale
+
+DESCRIPTION
+   Compute |value| * scale rounded to an integer the way printf rounds:
+   to nearest, ties to even, on the exact binary value of the double.
+   The double is taken apart into mantissa * 2^exponent and the product
+   is carried in 128 bits (hi:lo), so no intermediate rounding can move
+   a result that sits next to a .5 boundary.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if value is not finite or the result does not fit in 64 bits
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool loc_eng_nmea_scale(double value, uint32_t scale,
+                               uint64_t &result, bool &negative)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    negative = (bits >> 63) != 0;
+    int biased = (int)((bits >> 52) & 0x7FF);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+    int exponent;
+
+    if (biased == 0x7FF) {
+        return false; // inf or nan
+    } else if (biased == 0) {
+        exponent = -1074; // subnormal
+    } else {
+        mantissa |= (1ULL << 52);
+        exponent = biased - 1075;
+    }
+
+    // mantissa < 2^53 and scale < 2^20, so the product needs 73 bits
+    uint64_t lo = (mantissa & 0xFFFFFFFFULL) * scale;
+    uint64_t mid = (mantissa >> 32) * scale;
+    uint64_t pLo = lo + (mid << 32);
+    uint64_t pHi = (mid >> 32) + (pLo < lo ? 1 : 0);
+
+    if (exponent >= 0) {
+        if (pHi != 0 || exponent >= 64 ||
+            (exponent > 0 && (pLo >> (64 - exponent)) != 0)) {
+            return false;
+        }
+        result = pLo << exponent;
+        return true;
+    }
+
+    int shift = -exponent;
+    uint64_t q;
+    bool up;
+
+    if (shift >= 128) {
+        // below 2^-55, rounds to zero
+        result = 0;
+        return true;
+    } else if (shift < 64) {
+        if ((pHi >> shift) != 0) {
+            return false;
+        }
+        q = (pLo >> shift) | (pHi << (64 - shift));
+        uint64_t rem = pLo & ((1ULL << shift) - 1);
+        uint64_t half = 1ULL << (shift - 1);
+        up = rem > half || (rem == half && (q & 1));
+    } else if (shift == 64) {
+        q = pHi;
+        uint64_t half = 1ULL << 63;
+        up = pLo > half || (pLo == half && (q & 1));
+    } else {
+        int s = shift - 64;
+        q = pHi >> s;
+        uint64_t remHi = pHi & ((1ULL << s) - 1);
+        uint64_t halfHi = 1ULL << (s - 1);
+        up = remHi > halfHi ||
+             (remHi == halfHi && (pLo != 0 || (q & 1)));
+    }
+
+    result = q + (up ? 1 : 0);
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_put_fixed
+
+DESCRIPTION
+   Append value as "%0<width>.<decimals>f" would, "%.<decimals>f" when
+   width is 0. Values too large for 64 bit fixed point, infinities and
+   nans are rare enough to be left to snprintf.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_put_fixed(loc_eng_nmea_writer *w, double value,
+                            int decimals, int width)
+{
+    uint64_t scaled;
+    bool negative;
+
+    if (decimals < 1 || decimals > 6 ||
+        !loc_eng_nmea_scale(value, sPow10[decimals], scaled, negative)) {
+        if (w->overflow) {
+            return;
+        }
+        char *field = w->buf + w->length;
+        int remaining = w->size - w->length;
+        int length = snprintf(field, remaining, "%0*.*f",
+                              width, decimals, value);
+        if (length < 0 || length >= remaining) {
+            w->overflow = true;
+            return;
+        }
+        for (int i = 0; i < length; i++) {
+            w->checksum ^= (uint8_t)field[i];
+        }
+        w->length += length;
+        return;
+    }
+
+    uint64_t whole = scaled / sPow10[decimals];
+    uint32_t fraction = (uint32_t)(scaled % sPow10[decimals]);
+
+    int wholeDigits = 1;
+    for (uint64_t v = whole; v >= 10; v /= 10) {
+        wholeDigits++;
+    }
+
+    if (negative) {
+        loc_eng_nmea_put_char(w, '-');
+    }
+    int padding = width - (negative ? 1 : 0) - wholeDigits - 1 - decimals;
+    loc_eng_nmea_put_digits(w, whole, wholeDigits + padding);
+    loc_eng_nmea_put_char(w, '.');
+    loc_eng_nmea_put_digits(w, fraction, decimals);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_minutes
+
+DESCRIPTION
+   Minutes part of a non negative coordinate in degrees. fmod is exact,
+   so is this: the whole degree count k is settled with exact comparisons
+   against the product, and the difference of two doubles that close is
+   exact too.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   fmod(degrees * 60.0, 60.0)
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+double loc_eng_nmea_minutes(double degrees)
+{
+    double t = degrees * 60.0;
+
+    if (!(degrees >= 0.0 && degrees <= 360.0)) {
+        return fmod(t, 60.0);
+    }
+
+    int k = (int)degrees;
+    while (k > 0 && 60.0 * k > t) {
+        k--;
+    }
+    while (60.0 * (k + 1) <= t) {
+        k++;
+    }
+    return t - 60.0 * k;
+}
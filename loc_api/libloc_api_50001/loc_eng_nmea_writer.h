@@ -0,0 +1,79 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_NMEA_WRITER_H
+#define LOC_ENG_NMEA_WRITER_H
+
+#include <stdint.h>
+
+/* Appends the fields of one NMEA sentence straight into a caller supplied
+   buffer. The checksum is accumulated as bytes are appended, so closing the
+   sentence does not rescan it. Numbers are formatted with integer
+   arithmetic but yield exactly what the printf conversions noted on each
+   function would have produced. */
+typedef struct {
+    char *buf;
+    int size;
+    int length;
+    uint8_t checksum;
+    bool overflow;
+} loc_eng_nmea_writer;
+
+/* Starts a sentence with the leading '$', which is not part of the checksum */
+void loc_eng_nmea_writer_begin(loc_eng_nmea_writer *w, char *buf, int size);
+
+/* Appends "*XX\r\n" and NUL terminates. Returns the length the sentence has
+   always been reported with to nmea_cb (everything after the '$'), or -1
+   if any field did not fit. */
+int loc_eng_nmea_writer_end(loc_eng_nmea_writer *w);
+
+inline void loc_eng_nmea_put_char(loc_eng_nmea_writer *w, char c)
+{
+    if (w->length < w->size - 1) {
+        w->buf[w->length++] = c;
+        w->checksum ^= (uint8_t)c;
+    } else {
+        w->overflow = true;
+    }
+}
+
+void loc_eng_nmea_put_str(loc_eng_nmea_writer *w, const char *str);
+
+/* "%0<width>d" */
+void loc_eng_nmea_put_int(loc_eng_nmea_writer *w, int value, int width);
+
+/* "%0<width>.<decimals>f", decimals 1..6; width 0 means no padding */
+void loc_eng_nmea_put_fixed(loc_eng_nmea_writer *w, double value,
+                            int decimals, int width);
+
+/* The minutes part of a non negative coordinate, bit for bit what
+   fmod(degrees * 60.0, 60.0) returns */
+double loc_eng_nmea_minutes(double degrees);
+
+#endif // LOC_ENG_NMEA_WRITER_H
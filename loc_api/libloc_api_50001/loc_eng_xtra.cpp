@@ -44,6 +44,9 @@ struct LocEngRequestXtraServer : public LocMsg {
     {
         locallog();
     }
+    inline virtual const char* name() const {
+        return "LocEngRequestXtraServer";
+    }
     inline virtual void proc() const {
         mAdapter->requestXtraServer();
     }
@@ -71,6 +74,9 @@ struct LocEngInjectXtraData : public LocMsg {
     {
         delete[] mData;
     }
+    inline virtual const char* name() const { return "LocEngInjectXtraData"; }
+    // a whole XTRA file, which a fix start or stop need not wait for
+    inline virtual bool overtakable() const { return true; }
     inline virtual void proc() const {
         mAdapter->setXtraData(mData, mLen);
     }
@@ -88,6 +94,9 @@ struct LocEngSetXtraVersionCheck : public LocMsg {
     inline LocEngSetXtraVersionCheck(LocEngAdapter* adapter,
                                         int check):
         mAdapter(adapter), mCheck(check) {}
+    inline virtual const char* name() const {
+        return "LocEngSetXtraVersionCheck";
+    }
     inline virtual void proc() const {
         locallog();
         mAdapter->setXtraVersionCheck(mCheck);
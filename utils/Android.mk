@@ -14,6 +14,7 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     loc_log.cpp \
+    loc_log_ring.cpp \
     loc_cfg.cpp \
     msg_q.c \
     linked_list.c \
@@ -57,5 +58,68 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+
+## Benchmark of loc_timer starts per second, not installed by default
+LOCAL_SRC_FILES := loc_timer_bench.c
+
+LOCAL_SHARED_LIBRARIES := \
+    libgps.utils
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/platform_lib_abstractions
+
+LOCAL_MODULE := loc_timer_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+## Benchmark of msg_q throughput against a mutex/condvar queue, not installed by default
+LOCAL_SRC_FILES := msg_q_bench.c
+
+LOCAL_SHARED_LIBRARIES := \
+    libgps.utils
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/platform_lib_abstractions
+
+LOCAL_MODULE := msg_q_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+## Benchmark of reading large configuration files, not installed by default
+LOCAL_SRC_FILES := loc_cfg_bench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+    libgps.utils
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/platform_lib_abstractions
+
+LOCAL_MODULE := loc_cfg_bench
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
 endif # not BUILD_TINY_ANDROID
 endif # BOARD_VENDOR_QCOM_GPS_LOC_API_HARDWARE
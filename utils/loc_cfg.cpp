@@ -36,7 +36,11 @@
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <loc_cfg.h>
 #include <log_util.h>
 #include <loc_misc_utils.h>
@@ -51,37 +55,96 @@
  *
  *============================================================================*/
 
-/* Parameter data */
-static uint8_t DEBUG_LEVEL = 0xff;
-static uint8_t TIMESTAMP = 0;
+/* Parameter data, read from every configuration file */
+typedef struct
+{
+    uint8_t DEBUG_LEVEL;
+    uint8_t TIMESTAMP;
+    uint32_t LOG_RING_SIZE;
+    char LOG_FILE[LOC_MAX_PARAM_STRING + 1];
+} loc_logger_cfg_s_type;
+
+static loc_logger_cfg_s_type loc_logger_conf = { 0xff, 0, 0, "" };
 
-/* Parameter spec table */
-static loc_param_s_type loc_param_table[] =
+/* Parameter schema, 0xff leaves the level to Android */
+static const loc_param_schema_s_type loc_logger_params[] =
 {
-    {"DEBUG_LEVEL",    &DEBUG_LEVEL, NULL,    'n'},
-    {"TIMESTAMP",      &TIMESTAMP,   NULL,    'n'},
+    LOC_PARAM_RANGE(loc_logger_cfg_s_type, DEBUG_LEVEL,   0xff, 0, 5),
+    LOC_PARAM_RANGE(loc_logger_cfg_s_type, TIMESTAMP,     0,    0, 1),
+    LOC_PARAM_RANGE(loc_logger_cfg_s_type, LOG_RING_SIZE, 0,    0, 1 << 24),
+    LOC_PARAM_STRING(loc_logger_cfg_s_type, LOG_FILE,     ""),
+};
+static const LocConfSchema loc_logger_schema(
+    loc_logger_params, sizeof(loc_logger_params) / sizeof(loc_logger_params[0]));
+
+const loc_param_ops_s_type LocParamType<double>::ops = {
+    LocParamType<double>::store, LocParamType<double>::reset,
+    LocParamType<double>::equal, LocParamType<double>::copy
 };
-int loc_param_num = sizeof(loc_param_table) / sizeof(loc_param_s_type);
 
-typedef struct loc_param_v_type
+/* A schema and the struct a file or buffer is parsed into */
+typedef struct
 {
-    char* param_name;
-    char* param_str_value;
-    int param_int_value;
-    double param_double_value;
-}loc_param_v_type;
+    const LocConfSchema* schema;
+    void* conf;
+} loc_conf_target_type;
+
+/* The schema of a loc_param_s_type table. Its entries point at the
+   values themselves, so they are offsets from NULL. */
+class LocConfTable {
+    loc_param_schema_s_type* mParams;
+    LocConfSchema* mSchema;
+    LocConfTable(const LocConfTable&);
+    LocConfTable& operator=(const LocConfTable&);
+public:
+    LocConfTable(const loc_param_s_type* config_table, uint32_t table_length);
+    inline ~LocConfTable() {
+        delete mSchema;
+        free(mParams);
+    }
+    inline loc_conf_target_type target() const {
+        loc_conf_target_type target = { mSchema, NULL };
+        return target;
+    }
+};
+
+#define LOC_CONF_FILES_MAX 32
 
 /*===========================================================================
-FUNCTION loc_set_config_entry
+FUNCTION LocConfSchema::hash
 
 DESCRIPTION
-   Potentially sets a given configuration table entry based on the passed in
-   configuration value. This is done by using a string comparison of the
-   parameter names and those found in the configuration file.
+   FNV-1a hash of a parameter name
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   hash value
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+uint32_t LocConfSchema::hash(const char* name, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/*===========================================================================
+FUNCTION LocConfSchema::LocConfSchema
+
+DESCRIPTION
+   Builds the name index of the parameters. Parameters sharing a name all
+   stay in the index, so a line still sets every one of them. Parameters
+   with no ops are left out.
 
 PARAMETERS:
-   config_entry: configuration entry in the table to possibly set
-   config_value: value to store in the entry if the parameter names match
+   params: the parameters, which must outlive the schema
+   count: number of parameters
 
 DEPENDENCIES
    N/A
@@ -92,140 +155,420 @@ RETURN VALUE
 SIDE EFFECTS
    N/A
 ===========================================================================*/
-int loc_set_config_entry(loc_param_s_type* config_entry, loc_param_v_type* config_value)
+LocConfSchema::LocConfSchema(const loc_param_schema_s_type* params, uint32_t count) :
+    mParams(params), mCount(count), mMask(0), mSlots(NULL)
 {
-    int ret=-1;
-    if(NULL == config_entry || NULL == config_value)
+    uint32_t size = 16;
+    while (size < 2 * count) {
+        size <<= 1;
+    }
+    mSlots = (Slot*)calloc(size, sizeof(Slot));
+    if (NULL == mSlots) {
+        LOC_LOGE("%s: no memory for %u parameters", __FUNCTION__, count);
+        return;
+    }
+    mMask = size - 1;
+
+    for (uint32_t i = 0; i < count; i++)
     {
-        LOC_LOGE("%s: INVALID config entry or parameter", __FUNCTION__);
-        return ret;
+        if (NULL == params[i].param_ops) {
+            continue;
+        }
+        uint32_t h = hash(params[i].param_name,
+                          strnlen(params[i].param_name, LOC_MAX_PARAM_NAME));
+        uint32_t slot = h & mMask;
+        while (0 != mSlots[slot].param) {
+            slot = (slot + 1) & mMask;
+        }
+        mSlots[slot].hash = h;
+        mSlots[slot].param = i + 1;
     }
+}
 
-    if (strcmp(config_entry->param_name, config_value->param_name) == 0 &&
-        config_entry->param_ptr)
+LocConfSchema::~LocConfSchema()
+{
+    free(mSlots);
+}
+
+/*===========================================================================
+FUNCTION LocConfSchema::reset
+
+DESCRIPTION
+   Sets every parameter of conf to its default, and marks none of them
+   as set by a file
+
+PARAMETERS:
+   conf: struct of the schema
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void LocConfSchema::reset(void* conf) const
+{
+    for (uint32_t i = 0; i < mCount; i++) {
+        if (NULL != mParams[i].param_ops) {
+            mParams[i].param_ops->reset(&mParams[i],
+                                        (char*)conf + mParams[i].param_offset);
+        }
+    }
+    clearSet(conf);
+}
+
+void LocConfSchema::clearSet(void* conf) const
+{
+    for (uint32_t i = 0; i < mCount; i++) {
+        if (LOC_PARAM_NO_SET != mParams[i].set_offset) {
+            *((uint8_t*)conf + mParams[i].set_offset) = 0;
+        }
+    }
+}
+
+/*===========================================================================
+FUNCTION LocConfSchema::set
+
+DESCRIPTION
+   Stores value in every parameter of conf named name, each as its type
+   has it, and marks those that take it as set by a file
+
+PARAMETERS:
+   conf: struct of the schema
+   hash: hash of name
+   name: parameter name, not NUL terminated
+   nameLength: length of name
+   value: trimmed value, not NUL terminated
+   valueLength: length of value
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Number of parameters named name
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int LocConfSchema::set(void* conf, uint32_t hash, const char* name, size_t nameLength,
+                       const char* value, size_t valueLength) const
+{
+    int ret = 0;
+
+    if (NULL == mSlots) {
+        return ret;
+    }
+    for (uint32_t slot = hash & mMask; 0 != mSlots[slot].param; slot = (slot + 1) & mMask)
     {
-        switch (config_entry->param_type)
+        const loc_param_schema_s_type* param = &mParams[mSlots[slot].param - 1];
+        if (mSlots[slot].hash == hash &&
+            memcmp(param->param_name, name, nameLength) == 0 &&
+            param->param_name[nameLength] == '\0')
         {
-        case 's':
-            if (strcmp(config_value->param_str_value, "NULL") == 0)
-            {
-                *((char*)config_entry->param_ptr) = '\0';
+            if (param->param_ops->store(param, (char*)conf + param->param_offset,
+                                        value, valueLength) &&
+                LOC_PARAM_NO_SET != param->set_offset) {
+                *((uint8_t*)conf + param->set_offset) = 1;
             }
-            else {
-                strlcpy((char*) config_entry->param_ptr,
-                        config_value->param_str_value,
-                        LOC_MAX_PARAM_STRING + 1);
-            }
-            /* Log INI values */
-            LOC_LOGD("%s: PARAM %s = %s", __FUNCTION__,
-                     config_entry->param_name, (char*)config_entry->param_ptr);
+            ret++;
+        }
+    }
+    return ret;
+}
 
-            if(NULL != config_entry->param_set)
-            {
-                *(config_entry->param_set) = 1;
-            }
-            ret = 0;
+/*===========================================================================
+FUNCTION loc_param_in_range
+
+DESCRIPTION
+   Checks a value against the range of its parameter
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   true if the parameter takes the value
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static bool loc_param_in_range(const loc_param_schema_s_type* param, double number,
+                               const char* value, size_t length)
+{
+    if (param->checked && (number < param->min_value || number > param->max_value)) {
+        LOC_LOGE("%s: PARAM %s = %.*s is out of range %.15g to %.15g, ignored", __FUNCTION__,
+                 param->param_name, (int)length, value, param->min_value, param->max_value);
+        return false;
+    }
+    return true;
+}
+
+// value NUL terminated, and whether it is hex
+static bool loc_param_terminate(char* str, size_t size, const char* value, size_t length)
+{
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(str, value, length);
+    str[length] = '\0';
+    return (length >= 3 && str[0] == '0' && tolower(str[1]) == 'x');
+}
+
+/*===========================================================================
+FUNCTION loc_param_parse_integer
+
+DESCRIPTION
+   Parses a decimal or 0x prefixed hex integer value of a parameter
+
+PARAMETERS:
+   param: the parameter
+   value: trimmed value, not NUL terminated
+   length: length of value
+   number: parsed value
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   false if it is out of the range of the parameter
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+bool loc_param_parse_integer(const loc_param_schema_s_type* param,
+                             const char* value, size_t length, long long* number)
+{
+    char str[64];
+    if (loc_param_terminate(str, sizeof(str), value, length)) {
+        *number = strtoll(&str[2], (char**) NULL, 16);
+    } else {
+        *number = strtoll(str, (char**) NULL, 10);
+    }
+    if (!loc_param_in_range(param, (double)*number, value, length)) {
+        return false;
+    }
+    LOC_LOGD("%s: PARAM %s = %lld", __FUNCTION__, param->param_name, *number);
+    return true;
+}
+
+/*===========================================================================
+FUNCTION loc_param_parse_double
+
+DESCRIPTION
+   Parses a floating point value of a parameter
+
+PARAMETERS:
+   param: the parameter
+   value: trimmed value, not NUL terminated
+   length: length of value
+   number: parsed value, only stored if it is in range
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   false if it is out of the range of the parameter
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+bool loc_param_parse_double(const loc_param_schema_s_type* param,
+                            const char* value, size_t length, double* number)
+{
+    char str[64];
+    /* hex values have always left floats at 0 */
+    double parsed = loc_param_terminate(str, sizeof(str), value, length) ? 0 : atof(str);
+    if (!loc_param_in_range(param, parsed, value, length)) {
+        return false;
+    }
+    *number = parsed;
+    LOC_LOGD("%s: PARAM %s = %f", __FUNCTION__, param->param_name, parsed);
+    return true;
+}
+
+/*===========================================================================
+FUNCTION loc_param_copy_string
+
+DESCRIPTION
+   Stores a string value, cut to the size of the field. "NULL" stands
+   for the empty string.
+
+PARAMETERS:
+   param: the parameter, NULL to not log the value
+   str: the field
+   size: size of the field
+   value: value, not NUL terminated
+   length: length of value
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_param_copy_string(const loc_param_schema_s_type* param,
+                           char* str, size_t size, const char* value, size_t length)
+{
+    if (length == 4 && memcmp(value, "NULL", 4) == 0) {
+        length = 0;
+    } else if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(str, value, length);
+    str[length] = '\0';
+    if (NULL != param) {
+        LOC_LOGD("%s: PARAM %s = %s", __FUNCTION__, param->param_name, str);
+    }
+}
+
+/*===========================================================================
+FUNCTION LocConfTable::LocConfTable
+
+DESCRIPTION
+   Describes each entry of a configuration table by the type its
+   param_type stands for: 'n' a 32 bit integer, 's' a string of
+   LOC_MAX_PARAM_STRING characters and 'f' a double
+
+PARAMETERS:
+   config_table: table definition of strings to places to store information
+   table_length: length of the configuration table
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+LocConfTable::LocConfTable(const loc_param_s_type* config_table, uint32_t table_length) :
+    mParams(NULL), mSchema(NULL)
+{
+    if (NULL == config_table) {
+        table_length = 0;
+    }
+    if (table_length > 0) {
+        mParams = (loc_param_schema_s_type*)calloc(table_length,
+                                                   sizeof(loc_param_schema_s_type));
+        if (NULL == mParams) {
+            LOC_LOGE("%s: no memory for %u parameters", __FUNCTION__, table_length);
+            table_length = 0;
+        }
+    }
+    for (uint32_t i = 0; i < table_length; i++)
+    {
+        mParams[i].param_name = config_table[i].param_name;
+        mParams[i].param_offset = (size_t)config_table[i].param_ptr;
+        mParams[i].set_offset = (NULL != config_table[i].param_set) ?
+            (size_t)config_table[i].param_set : LOC_PARAM_NO_SET;
+        if (NULL == config_table[i].param_ptr) {
+            continue;
+        }
+        switch (config_table[i].param_type)
+        {
+        case 's':
+            mParams[i].param_ops = &LocParamType<char[LOC_MAX_PARAM_STRING + 1]>::ops;
             break;
         case 'n':
-            *((int *)config_entry->param_ptr) = config_value->param_int_value;
-            /* Log INI values */
-            LOC_LOGD("%s: PARAM %s = %d", __FUNCTION__,
-                     config_entry->param_name, config_value->param_int_value);
-
-            if(NULL != config_entry->param_set)
-            {
-                *(config_entry->param_set) = 1;
-            }
-            ret = 0;
+            mParams[i].param_ops = &LocParamType<int32_t>::ops;
             break;
         case 'f':
-            *((double *)config_entry->param_ptr) = config_value->param_double_value;
-            /* Log INI values */
-            LOC_LOGD("%s: PARAM %s = %f", __FUNCTION__,
-                     config_entry->param_name, config_value->param_double_value);
-
-            if(NULL != config_entry->param_set)
-            {
-                *(config_entry->param_set) = 1;
-            }
-            ret = 0;
+            mParams[i].param_ops = &LocParamType<double>::ops;
             break;
         default:
             LOC_LOGE("%s: PARAM %s parameter type must be n, f, or s",
-                     __FUNCTION__, config_entry->param_name);
+                     __FUNCTION__, config_table[i].param_name);
         }
     }
-    return ret;
+    mSchema = new LocConfSchema(mParams, table_length);
 }
 
 /*===========================================================================
-FUNCTION loc_fill_conf_item
+FUNCTION loc_parse_conf_buf
 
 DESCRIPTION
-   Takes a line of configuration item and sets defined values based on
-   the passed in configuration table. This table maps strings to values to
-   set along with the type of each of these values.
+   Parses configuration items and sets the parameters of the targets
+   they name. A line is split like this: the name runs up to the first
+   '=', the value from the next non '=' character up to the following '='
+   or the end of the line, both trimmed.
 
 PARAMETERS:
-   input_buf : buffer contanis config item
-   config_table: table definition of strings to places to store information
-   table_length: length of the configuration table
+   buf: configuration items
+   length: size of buf
+   targets: schemas and the structs to set
+   target_count: number of targets
 
 DEPENDENCIES
    N/A
 
 RETURN VALUE
-   0: Number of records in the config_table filled with input_buf
+   Number of parameters found
 
 SIDE EFFECTS
    N/A
 ===========================================================================*/
-int loc_fill_conf_item(char* input_buf,
-                       loc_param_s_type* config_table, uint32_t table_length)
+static int loc_parse_conf_buf(const char* buf, size_t length,
+                              const loc_conf_target_type* targets, uint32_t target_count)
 {
+    const char* end = buf + length;
+    const char* line = buf;
     int ret = 0;
 
-    if (input_buf && config_table) {
-        char *lasts;
-        loc_param_v_type config_value;
-        memset(&config_value, 0, sizeof(config_value));
-
-        /* Separate variable and value */
-        config_value.param_name = strtok_r(input_buf, "=", &lasts);
-        /* skip lines that do not contain "=" */
-        if (config_value.param_name) {
-            config_value.param_str_value = strtok_r(NULL, "=", &lasts);
-
-            /* skip lines that do not contain two operands */
-            if (config_value.param_str_value) {
-                /* Trim leading and trailing spaces */
-                loc_util_trim_space(config_value.param_name);
-                loc_util_trim_space(config_value.param_str_value);
-
-                /* Parse numerical value */
-                if ((strlen(config_value.param_str_value) >=3) &&
-                    (config_value.param_str_value[0] == '0') &&
-                    (tolower(config_value.param_str_value[1]) == 'x'))
-                {
-                    /* hex */
-                    config_value.param_int_value = (int) strtol(&config_value.param_str_value[2],
-                                                                (char**) NULL, 16);
-                }
-                else {
-                    config_value.param_double_value = (double) atof(config_value.param_str_value); /* float */
-                    config_value.param_int_value = atoi(config_value.param_str_value); /* dec */
-                }
+    while (line < end)
+    {
+        const char* line_end = (const char*)memchr(line, '\n', end - line);
+        if (NULL == line_end) {
+            line_end = end;
+        }
+
+        const char* name = line;
+        while (name < line_end && *name == '=') {
+            name++;
+        }
+        const char* name_end = (const char*)memchr(name, '=', line_end - name);
+        const char* value = name_end;
+        while (NULL != value && value < line_end && *value == '=') {
+            value++;
+        }
+
+        /* skip lines that do not contain a name and a value, a line
+           break after the '=' has always made for an empty value */
+        if (NULL != name_end && (value < line_end || line_end < end)) {
+            const char* value_end = (const char*)memchr(value, '=', line_end - value);
+            if (NULL == value_end) {
+                value_end = line_end;
+            }
+            while (name < name_end && isspace(*name)) {
+                name++;
+            }
+            while (name_end > name && isspace(name_end[-1])) {
+                name_end--;
+            }
+            while (value < value_end && isspace(*value)) {
+                value++;
+            }
+            while (value_end > value && isspace(value_end[-1])) {
+                value_end--;
+            }
 
-                for(uint32_t i = 0; NULL != config_table && i < table_length; i++)
-                {
-                    if(!loc_set_config_entry(&config_table[i], &config_value)) {
-                        ret += 1;
-                    }
+            size_t name_length = name_end - name;
+            if (name_length < LOC_MAX_PARAM_NAME) {
+                uint32_t hash = LocConfSchema::hash(name, name_length);
+                for (uint32_t i = 0; i < target_count; i++) {
+                    ret += targets[i].schema->set(targets[i].conf, hash, name, name_length,
+                                                  value, value_end - value);
                 }
             }
         }
-    }
 
+        line = line_end + 1;
+    }
     return ret;
 }
 
@@ -269,29 +612,77 @@ int loc_read_conf_r(FILE *conf_fp, loc_param_s_type* config_table, uint32_t tabl
         goto err;
     }
 
-    /* Clear all validity bits */
-    for(uint32_t i = 0; NULL != config_table && i < table_length; i++)
     {
-        if(NULL != config_table[i].param_set)
+        LocConfTable table(config_table, table_length);
+        loc_conf_target_type target = table.target();
+
+        /* Clear all validity bits */
+        target.schema->clearSet(target.conf);
+
+        char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
+
+        LOC_LOGD("%s:%d]: num_params: %d\n", __func__, __LINE__, num_params);
+        while(num_params)
         {
-            *(config_table[i].param_set) = 0;
+            if(!fgets(input_buf, LOC_MAX_PARAM_LINE, conf_fp)) {
+                LOC_LOGD("%s:%d]: fgets returned NULL\n", __func__, __LINE__);
+                break;
+            }
+
+            num_params -= loc_parse_conf_buf(input_buf, strlen(input_buf), &target, 1);
         }
     }
 
-    char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
+err:
+    return ret;
+}
+
+/*===========================================================================
+FUNCTION loc_update_conf_lines
+
+DESCRIPTION
+   Parses configuration items one line at a time, each line on its own
+
+PARAMETERS:
+   conf_data: configuration items in bufferas a string
+   length: size of conf_data, which ends earlier if it holds a '\0'
+   target: schema and the struct to set
+   num_params: number of parameters after which to stop
+   records: number of lines parsed
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Number of parameters found
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_update_conf_lines(const char* conf_data, int32_t length,
+                                 const loc_conf_target_type& target,
+                                 uint32_t num_params, int* records)
+{
+    const char* end = conf_data + strnlen(conf_data, length);
+    const char* line = conf_data;
+    int ret = 0;
 
+    *records = 0;
     LOC_LOGD("%s:%d]: num_params: %d\n", __func__, __LINE__, num_params);
-    while(num_params)
-    {
-        if(!fgets(input_buf, LOC_MAX_PARAM_LINE, conf_fp)) {
-            LOC_LOGD("%s:%d]: fgets returned NULL\n", __func__, __LINE__);
-            break;
+    while (num_params && line < end) {
+        const char* line_end = (const char*)memchr(line, '\n', end - line);
+        if (NULL == line_end) {
+            line_end = end;
         }
-
-        num_params -= loc_fill_conf_item(input_buf, config_table, table_length);
+        /* empty lines are no records */
+        if (line_end > line) {
+            (*records)++;
+            int found = loc_parse_conf_buf(line, line_end - line, &target, 1);
+            num_params = (uint32_t)found < num_params ? num_params - found : 0;
+            ret += found;
+        }
+        line = line_end + 1;
     }
-
-err:
     return ret;
 }
 
@@ -326,32 +717,151 @@ int loc_update_conf(const char* conf_data, int32_t length,
 {
     int ret = -1;
 
-    if (conf_data && length && config_table && table_length) {
-        // make a copy, so we do not tokenize the original data
-        char* conf_copy = (char*)malloc(length+1);
+    if (conf_data && length > 0 && config_table && table_length) {
+        LocConfTable table(config_table, table_length);
+        // start with one record off
+        loc_update_conf_lines(conf_data, length, table.target(), table_length - 1, &ret);
+    }
 
-        if(conf_copy !=NULL)
-        {
-          memcpy(conf_copy, conf_data, length);
-          // we hard NULL the end of string to be safe
-          conf_copy[length] = 0;
-        }
+    return ret;
+}
 
-        // start with one record off
-        uint32_t num_params = table_length - 1;
-        char* saveptr = NULL;
-        char* input_buf = strtok_r(conf_copy, "\n", &saveptr);
-        ret = 0;
+/*===========================================================================
+FUNCTION loc_update_conf
 
-        LOC_LOGD("%s:%d]: num_params: %d\n", __func__, __LINE__, num_params);
-        while(num_params && input_buf) {
-            ret++;
-            num_params -= loc_fill_conf_item(input_buf, config_table, table_length);
-            input_buf = strtok_r(NULL, "\n", &saveptr);
+DESCRIPTION
+   Parses the passed in buffer for configuration items, and sets them in
+   conf. Each line is taken on its own, as the other loc_update_conf takes
+   it, but all of them are read.
+
+PARAMETERS:
+   conf_data: configuration items in buffer as a string
+   length: strlen(conf_data)
+   schema: parameters of conf
+   conf: struct to set
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   number of parameters set, -1 if there was nothing to parse
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int loc_update_conf(const char* conf_data, int32_t length,
+                    const LocConfSchema& schema, void* conf)
+{
+    int records;
+    if (NULL == conf_data || length <= 0) {
+        return -1;
+    }
+    loc_conf_target_type target = { &schema, conf };
+    return loc_update_conf_lines(conf_data, length, target, 0xFFFFFFFF, &records);
+}
+
+/*===========================================================================
+FUNCTION loc_read_conf_files
+
+DESCRIPTION
+   Reads configuration files, each into the struct given with it. Every
+   file is mapped and scanned once, with the lines looked up in the name
+   index of its schema, and the logger parameters are read from every
+   file as well.
+
+PARAMETERS:
+   conf_files: files, schemas and the structs they fill
+   file_count: number of files
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_read_conf_files(const loc_conf_schema_file_s_type* conf_files, uint32_t file_count)
+{
+    for (uint32_t i = 0; i < file_count; i++)
+    {
+        int fd = open(conf_files[i].conf_file_name, O_RDONLY);
+        if (fd < 0) {
+            continue;
         }
+        LOC_LOGD("%s: using %s", __FUNCTION__, conf_files[i].conf_file_name);
+
+        /* Clear all validity bits */
+        conf_files[i].schema->clearSet(conf_files[i].conf);
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (MAP_FAILED != buf) {
+                loc_conf_target_type targets[] = {
+                    { &loc_logger_schema, &loc_logger_conf },
+                    { conf_files[i].schema, conf_files[i].conf }
+                };
+                loc_parse_conf_buf((const char*)buf, st.st_size, targets,
+                                   sizeof(targets) / sizeof(targets[0]));
+                munmap(buf, st.st_size);
+            } else {
+                LOC_LOGE("%s: mmap of %s failed, errno %d", __FUNCTION__,
+                         conf_files[i].conf_file_name, errno);
+            }
+        }
+        close(fd);
     }
 
-    return ret;
+    /* Initialize logging mechanism with parsed data */
+    loc_logger_init(loc_logger_conf.DEBUG_LEVEL, loc_logger_conf.TIMESTAMP);
+    loc_log_ring_init(loc_logger_conf.LOG_RING_SIZE, loc_logger_conf.LOG_FILE);
+}
+
+/*===========================================================================
+FUNCTION loc_read_conf_files
+
+DESCRIPTION
+   Reads configuration files, each into the table given with it, as the
+   loc_conf_schema_file_s_type loc_read_conf_files does.
+
+PARAMETERS:
+   conf_files: files and the tables they fill
+   file_count: number of files, at most LOC_CONF_FILES_MAX
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_read_conf_files(const loc_conf_file_s_type* conf_files, uint32_t file_count)
+{
+    LocConfTable* tables[LOC_CONF_FILES_MAX];
+    loc_conf_schema_file_s_type schema_files[LOC_CONF_FILES_MAX];
+
+    if (file_count > LOC_CONF_FILES_MAX) {
+        LOC_LOGE("%s: %u files, only the first %d are read",
+                 __FUNCTION__, file_count, LOC_CONF_FILES_MAX);
+        file_count = LOC_CONF_FILES_MAX;
+    }
+    for (uint32_t i = 0; i < file_count; i++) {
+        tables[i] = new LocConfTable(conf_files[i].config_table, conf_files[i].table_length);
+        loc_conf_target_type target = tables[i]->target();
+        schema_files[i].conf_file_name = conf_files[i].conf_file_name;
+        schema_files[i].schema = target.schema;
+        schema_files[i].conf = target.conf;
+    }
+
+    loc_read_conf_files(schema_files, file_count);
+
+    for (uint32_t i = 0; i < file_count; i++) {
+        delete tables[i];
+    }
 }
 
 /*===========================================================================
@@ -379,21 +889,6 @@ SIDE EFFECTS
 void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table,
                    uint32_t table_length)
 {
-    FILE *conf_fp = NULL;
-    char *lasts;
-    loc_param_v_type config_value;
-    uint32_t i;
-
-    if((conf_fp = fopen(conf_file_name, "r")) != NULL)
-    {
-        LOC_LOGD("%s: using %s", __FUNCTION__, conf_file_name);
-        if(table_length && config_table) {
-            loc_read_conf_r(conf_fp, config_table, table_length);
-            rewind(conf_fp);
-        }
-        loc_read_conf_r(conf_fp, loc_param_table, loc_param_num);
-        fclose(conf_fp);
-    }
-    /* Initialize logging mechanism with parsed data */
-    loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+    loc_conf_file_s_type conf_file = { conf_file_name, config_table, table_length };
+    loc_read_conf_files(&conf_file, 1);
 }
@@ -32,6 +32,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #define LOC_MAX_PARAM_NAME                 80
 #define LOC_MAX_PARAM_STRING               80
@@ -47,6 +48,12 @@
 #define UTIL_READ_CONF(filename, config_table) \
     loc_read_conf((filename), (config_table), sizeof(config_table) / sizeof(config_table[0]))
 
+#define UTIL_CONF_FILE(filename, config_table) \
+    { (filename), (config_table), sizeof(config_table) / sizeof(config_table[0]) }
+
+#define UTIL_READ_CONF_FILES(conf_files) \
+    loc_read_conf_files((conf_files), sizeof(conf_files) / sizeof(conf_files[0]))
+
 /*=============================================================================
  *
  *                        MODULE TYPE DECLARATION
@@ -62,6 +69,14 @@ typedef struct
                                                  'f' for float */
 } loc_param_s_type;
 
+/* A configuration file and the table it fills, see loc_read_conf_files */
+typedef struct
+{
+  const char                    *conf_file_name;
+  loc_param_s_type              *config_table;
+  uint32_t                       table_length;
+} loc_conf_file_s_type;
+
 /*=============================================================================
  *
  *                          MODULE EXTERNAL DATA
@@ -80,6 +95,8 @@ extern "C" {
 void loc_read_conf(const char* conf_file_name,
                    loc_param_s_type* config_table,
                    uint32_t table_length);
+void loc_read_conf_files(const loc_conf_file_s_type* conf_files,
+                         uint32_t file_count);
 int loc_read_conf_r(FILE *conf_fp, loc_param_s_type* config_table,
                     uint32_t table_length);
 int loc_update_conf(const char* conf_data, int32_t length,
@@ -88,4 +105,223 @@ int loc_update_conf(const char* conf_data, int32_t length,
 }
 #endif
 
+#ifdef __cplusplus
+#include <stddef.h>
+
+/* loc_eng.h includes this inside extern "C" */
+extern "C++" {
+
+/*=============================================================================
+ *
+ *                        CONFIGURATION SCHEMA
+ *
+ * A schema describes the parameters of a configuration struct: the name,
+ * offset and C++ type of each field, its default and the range of values
+ * it takes. The code that sets, resets and compares a field is picked by
+ * the compiler from the type of the field, so a table can no longer say
+ * a field is a number of one size while it is another. Each schema hashes
+ * its names once, when it is constructed, not on every read.
+ *
+ *============================================================================*/
+#define LOC_PARAM_NO_SET  ((size_t)-1)
+
+typedef struct loc_param_schema_s_type loc_param_schema_s_type;
+
+/* What is done with a field of one type, see LocParamType */
+typedef struct
+{
+  /* value is trimmed, not NUL terminated; false if it is not taken */
+  bool (*store)(const loc_param_schema_s_type* param, void* ptr,
+                const char* value, size_t length);
+  void (*reset)(const loc_param_schema_s_type* param, void* ptr);
+  bool (*equal)(const void* ptr1, const void* ptr2);
+  void (*copy)(void* to, const void* from);
+} loc_param_ops_s_type;
+
+struct loc_param_schema_s_type
+{
+  const char                    *param_name;
+  size_t                         param_offset;
+  size_t                         set_offset;  /* of the uint8_t that tells if
+                                                 the file set the value,
+                                                 LOC_PARAM_NO_SET if none */
+  const loc_param_ops_s_type    *param_ops;
+  bool                           checked;     /* values outside
+                                                 min_value..max_value are
+                                                 rejected */
+  double                         min_value;
+  double                         max_value;
+  double                         default_value;
+  const char                    *default_string;
+};
+
+/* parse value, log it and check it against the range of param */
+bool loc_param_parse_integer(const loc_param_schema_s_type* param,
+                             const char* value, size_t length, long long* number);
+bool loc_param_parse_double(const loc_param_schema_s_type* param,
+                            const char* value, size_t length, double* number);
+void loc_param_copy_string(const loc_param_schema_s_type* param,
+                           char* str, size_t size, const char* value, size_t length);
+
+template <typename T>
+struct LocParamNumber
+{
+    static bool store(const loc_param_schema_s_type* param, void* ptr,
+                      const char* value, size_t length) {
+        long long number;
+        if (!loc_param_parse_integer(param, value, length, &number)) {
+            return false;
+        }
+        *(T*)ptr = (T)number;
+        return true;
+    }
+    static void reset(const loc_param_schema_s_type* param, void* ptr) {
+        *(T*)ptr = (T)param->default_value;
+    }
+    static bool equal(const void* ptr1, const void* ptr2) {
+        return *(const T*)ptr1 == *(const T*)ptr2;
+    }
+    static void copy(void* to, const void* from) {
+        *(T*)to = *(const T*)from;
+    }
+    static const loc_param_ops_s_type ops;
+};
+
+template <typename T>
+const loc_param_ops_s_type LocParamNumber<T>::ops = {
+    LocParamNumber<T>::store, LocParamNumber<T>::reset,
+    LocParamNumber<T>::equal, LocParamNumber<T>::copy
+};
+
+/* Only fields of these types can be in a schema */
+template <typename T> struct LocParamType;
+template <> struct LocParamType<uint32_t> : LocParamNumber<uint32_t> {};
+template <> struct LocParamType<int32_t> : LocParamNumber<int32_t> {};
+template <> struct LocParamType<uint8_t> : LocParamNumber<uint8_t> {};
+
+template <>
+struct LocParamType<double>
+{
+    static bool store(const loc_param_schema_s_type* param, void* ptr,
+                      const char* value, size_t length) {
+        return loc_param_parse_double(param, value, length, (double*)ptr);
+    }
+    static void reset(const loc_param_schema_s_type* param, void* ptr) {
+        *(double*)ptr = param->default_value;
+    }
+    static bool equal(const void* ptr1, const void* ptr2) {
+        return *(const double*)ptr1 == *(const double*)ptr2;
+    }
+    static void copy(void* to, const void* from) {
+        *(double*)to = *(const double*)from;
+    }
+    static const loc_param_ops_s_type ops;
+};
+
+template <size_t N>
+struct LocParamType<char[N]>
+{
+    static bool store(const loc_param_schema_s_type* param, void* ptr,
+                      const char* value, size_t length) {
+        loc_param_copy_string(param, (char*)ptr, N, value, length);
+        return true;
+    }
+    static void reset(const loc_param_schema_s_type* param, void* ptr) {
+        const char* str = param->default_string ? param->default_string : "";
+        loc_param_copy_string(NULL, (char*)ptr, N, str, strnlen(str, N));
+    }
+    static bool equal(const void* ptr1, const void* ptr2) {
+        return strncmp((const char*)ptr1, (const char*)ptr2, N) == 0;
+    }
+    static void copy(void* to, const void* from) {
+        memcpy(to, from, N);
+    }
+    static const loc_param_ops_s_type ops;
+};
+
+template <size_t N>
+const loc_param_ops_s_type LocParamType<char[N]>::ops = {
+    LocParamType<char[N]>::store, LocParamType<char[N]>::reset,
+    LocParamType<char[N]>::equal, LocParamType<char[N]>::copy
+};
+
+/* the ops of the type of field, and the offset of a _VALID flag, which
+   has to be a uint8_t */
+template <typename S, typename T>
+inline const loc_param_ops_s_type* loc_param_ops(T S::*)
+{
+    return &LocParamType<T>::ops;
+}
+
+template <typename S>
+inline size_t loc_param_set_offset(uint8_t S::*, size_t offset)
+{
+    return offset;
+}
+
+/* Schema entries; the parameter is named after the field */
+#define LOC_PARAM(type, field, default_value) \
+    { #field, offsetof(type, field), LOC_PARAM_NO_SET, \
+      loc_param_ops(&type::field), false, 0, 0, (default_value), NULL }
+
+#define LOC_PARAM_RANGE(type, field, default_value, min_value, max_value) \
+    { #field, offsetof(type, field), LOC_PARAM_NO_SET, \
+      loc_param_ops(&type::field), true, (min_value), (max_value), (default_value), NULL }
+
+#define LOC_PARAM_VALID(type, field, set_field, default_value, min_value, max_value) \
+    { #field, offsetof(type, field), \
+      loc_param_set_offset(&type::set_field, offsetof(type, set_field)), \
+      loc_param_ops(&type::field), true, (min_value), (max_value), (default_value), NULL }
+
+#define LOC_PARAM_STRING(type, field, default_string) \
+    { #field, offsetof(type, field), LOC_PARAM_NO_SET, \
+      loc_param_ops(&type::field), false, 0, 0, 0, (default_string) }
+
+/* The parameters of a configuration struct and their name index */
+class LocConfSchema {
+    struct Slot {
+        uint32_t hash;
+        uint32_t param;   /* index in mParams + 1, 0 if the slot is free */
+    };
+    const loc_param_schema_s_type* mParams;
+    uint32_t mCount;
+    uint32_t mMask;
+    Slot* mSlots;
+    LocConfSchema(const LocConfSchema&);
+    LocConfSchema& operator=(const LocConfSchema&);
+public:
+    LocConfSchema(const loc_param_schema_s_type* params, uint32_t count);
+    ~LocConfSchema();
+    inline uint32_t count() const { return mCount; }
+    inline const loc_param_schema_s_type& param(uint32_t i) const { return mParams[i]; }
+    static uint32_t hash(const char* name, size_t length);
+    // every parameter of conf to its default, and not set by a file
+    void reset(void* conf) const;
+    // every parameter of conf to not set by a file
+    void clearSet(void* conf) const;
+    // stores value in the parameters of conf named name, which hashes
+    // to hash; returns how many there are
+    int set(void* conf, uint32_t hash, const char* name, size_t nameLength,
+            const char* value, size_t valueLength) const;
+};
+
+/* A configuration file and the struct it fills */
+typedef struct
+{
+  const char                    *conf_file_name;
+  const LocConfSchema           *schema;
+  void                          *conf;
+} loc_conf_schema_file_s_type;
+
+#define UTIL_CONF_SCHEMA_FILE(filename, schema, conf) \
+    { (filename), &(schema), &(conf) }
+
+/* UTIL_READ_CONF_FILES takes loc_conf_schema_file_s_type arrays too */
+void loc_read_conf_files(const loc_conf_schema_file_s_type* conf_files,
+                         uint32_t file_count);
+int loc_update_conf(const char* conf_data, int32_t length,
+                    const LocConfSchema& schema, void* conf);
+} /* extern "C++" */
+#endif /* __cplusplus */
+
 #endif /* LOC_CFG_H */
@@ -0,0 +1,227 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Compares the time it takes to read a large configuration file with
+   loc_read_conf, and with a schema of the same parameters, against the
+   line by line loc_read_conf_r scan it used to make, once for the table
+   and once more for the logger parameters, and checks all of them leave
+   the same values behind.
+   Usage: loc_cfg_bench [parameters] [lines] [iterations] [file] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <loc_cfg.h>
+
+typedef struct {
+    int n;
+    double f;
+    char s[LOC_MAX_PARAM_STRING + 1];
+    uint8_t set;
+} bench_value;
+
+static void bench_schema(loc_param_schema_s_type* params, const loc_param_s_type* table,
+                         unsigned int params_count)
+{
+    for (unsigned int i = 0; i < params_count; i++) {
+        memset(&params[i], 0, sizeof(params[i]));
+        params[i].param_name = table[i].param_name;
+        params[i].param_offset = i * sizeof(bench_value);
+        params[i].set_offset = i * sizeof(bench_value) + offsetof(bench_value, set);
+        switch (table[i].param_type) {
+        case 'n':
+            params[i].param_offset += offsetof(bench_value, n);
+            params[i].param_ops = &LocParamType<int>::ops;
+            break;
+        case 's':
+            params[i].param_offset += offsetof(bench_value, s);
+            params[i].param_ops = &LocParamType<char[LOC_MAX_PARAM_STRING + 1]>::ops;
+            break;
+        default:
+            params[i].param_offset += offsetof(bench_value, f);
+            params[i].param_ops = &LocParamType<double>::ops;
+            break;
+        }
+    }
+}
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_table(loc_param_s_type* table, bench_value* values,
+                        unsigned int params)
+{
+    for (unsigned int i = 0; i < params; i++) {
+        snprintf(table[i].param_name, LOC_MAX_PARAM_NAME, "BENCH_PARAM_%u", i);
+        table[i].param_set = &values[i].set;
+        table[i].param_type = "nsf"[i % 3];
+        switch (table[i].param_type) {
+        case 'n': table[i].param_ptr = &values[i].n; break;
+        case 's': table[i].param_ptr = values[i].s; break;
+        default:  table[i].param_ptr = &values[i].f; break;
+        }
+    }
+}
+
+/* every parameter once, among comments, blank lines and unknown names */
+static int bench_write(const char* file, unsigned int params, unsigned int lines)
+{
+    FILE* fp = fopen(file, "w");
+    unsigned int seed = 1;
+    unsigned int next = 0;
+
+    if (NULL == fp) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < lines || next < params; i++) {
+        if (next < params && (i >= lines || rand_r(&seed) % lines < params)) {
+            switch (next % 3) {
+            case 'n' % 3:
+                fprintf(fp, (next & 1) ? "BENCH_PARAM_%u = 0x%X\n" : "BENCH_PARAM_%u=%d\n",
+                        next, rand_r(&seed));
+                break;
+            case 's' % 3:
+                fprintf(fp, "  BENCH_PARAM_%u = bench.example.com:%u  \n",
+                        next, rand_r(&seed) % 65536);
+                break;
+            default:
+                fprintf(fp, "BENCH_PARAM_%u = %u.%u\r\n", next,
+                        rand_r(&seed) % 1000, rand_r(&seed));
+                break;
+            }
+            next++;
+        } else {
+            switch (rand_r(&seed) % 3) {
+            case 0:
+                fprintf(fp, "# BENCH_UNKNOWN_%u sets nothing, 0 means off\n", i);
+                break;
+            case 1:
+                fprintf(fp, "\n");
+                break;
+            default:
+                fprintf(fp, "BENCH_UNKNOWN_%u = %u\n", i, rand_r(&seed));
+                break;
+            }
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int params = argc > 1 ? atoi(argv[1]) : 200;
+    unsigned int lines = argc > 2 ? atoi(argv[2]) : 20000;
+    unsigned int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    const char* file = argc > 4 ? argv[4] : "/data/local/tmp/loc_cfg_bench.conf";
+
+    loc_param_s_type* scanTable = (loc_param_s_type*)calloc(params, sizeof(loc_param_s_type));
+    loc_param_s_type* indexTable = (loc_param_s_type*)calloc(params, sizeof(loc_param_s_type));
+    bench_value* scanValues = (bench_value*)calloc(params, sizeof(bench_value));
+    bench_value* indexValues = (bench_value*)calloc(params, sizeof(bench_value));
+    bench_value* schemaValues = (bench_value*)calloc(params, sizeof(bench_value));
+    loc_param_schema_s_type* schemaParams =
+        (loc_param_schema_s_type*)calloc(params, sizeof(loc_param_schema_s_type));
+    int debugLevel, timestamp;
+    loc_param_s_type loggerTable[] = {
+        {"DEBUG_LEVEL", &debugLevel, NULL, 'n'},
+        {"TIMESTAMP",   &timestamp,  NULL, 'n'},
+    };
+
+    if (NULL == scanTable || NULL == indexTable ||
+        NULL == scanValues || NULL == indexValues || NULL == schemaValues ||
+        NULL == schemaParams || params == 0 || iterations == 0) {
+        return 1;
+    }
+    bench_table(scanTable, scanValues, params);
+    bench_table(indexTable, indexValues, params);
+    bench_schema(schemaParams, indexTable, params);
+    LocConfSchema schema(schemaParams, params);
+    loc_conf_schema_file_s_type schemaFile[] = {
+        UTIL_CONF_SCHEMA_FILE(file, schema, *schemaValues)
+    };
+    if (bench_write(file, params, lines) != 0) {
+        printf("cannot write %s\n", file);
+        return 1;
+    }
+
+    uint64_t scanUsec = 0, indexUsec = 0, schemaUsec = 0;
+    for (unsigned int i = 0; i < iterations; i++) {
+        uint64_t start = bench_usec();
+        FILE* fp = fopen(file, "r");
+        if (NULL == fp) {
+            return 1;
+        }
+        loc_read_conf_r(fp, scanTable, params);
+        rewind(fp);
+        loc_read_conf_r(fp, loggerTable, sizeof(loggerTable) / sizeof(loggerTable[0]));
+        fclose(fp);
+        scanUsec += bench_usec() - start;
+
+        start = bench_usec();
+        loc_read_conf(file, indexTable, params);
+        indexUsec += bench_usec() - start;
+
+        start = bench_usec();
+        UTIL_READ_CONF_FILES(schemaFile);
+        schemaUsec += bench_usec() - start;
+    }
+
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < params; i++) {
+        if (scanValues[i].set != indexValues[i].set ||
+            scanValues[i].n != indexValues[i].n ||
+            scanValues[i].f != indexValues[i].f ||
+            strcmp(scanValues[i].s, indexValues[i].s) != 0 ||
+            memcmp(&indexValues[i], &schemaValues[i], sizeof(bench_value)) != 0) {
+            printf("BENCH_PARAM_%u differs\n", i);
+            mismatches++;
+        }
+    }
+
+    printf("%u parameters, %u lines: line scan %llu usec, indexed %llu usec, "
+           "schema %llu usec per read, %u mismatches\n", params, lines,
+           (unsigned long long)(scanUsec / iterations),
+           (unsigned long long)(indexUsec / iterations),
+           (unsigned long long)(schemaUsec / iterations), mismatches);
+    remove(file);
+    free(scanTable);
+    free(indexTable);
+    free(scanValues);
+    free(indexValues);
+    free(schemaValues);
+    free(schemaParams);
+    return mismatches != 0;
+}
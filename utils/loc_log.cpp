@@ -90,7 +90,9 @@ static loc_name_val_s_type loc_msg_q_status[] =
     NAME_VAL( eMSG_Q_INVALID_PARAMETER ),
     NAME_VAL( eMSG_Q_INVALID_HANDLE ),
     NAME_VAL( eMSG_Q_UNAVAILABLE_RESOURCE ),
-    NAME_VAL( eMSG_Q_INSUFFICIENT_BUFFER )
+    NAME_VAL( eMSG_Q_INSUFFICIENT_BUFFER ),
+    NAME_VAL( eMSG_Q_QUEUE_FULL ),
+    NAME_VAL( eMSG_Q_TIMEOUT )
 };
 static int loc_msg_q_status_num = sizeof(loc_msg_q_status) / sizeof(loc_name_val_s_type);
 
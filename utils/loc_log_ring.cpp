@@ -0,0 +1,989 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Binary log ring. With it on, a LOC_LOGx call only copies its call site,
+   the time and the raw arguments into a ring of its own thread, and a
+   drainer thread formats the messages, in the order of their time as
+   far as each drain sees them, to logcat or to a file. Each ring has one
+   writer and the drainer as its only reader, so neither side needs a
+   lock. A message that does not fit is dropped and counted, never waited
+   for. */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_log_ring"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef USE_GLIB
+#include <sys/syscall.h>
+#else
+#include <android/log.h>
+#endif /* USE_GLIB */
+#include "log_util.h"
+#include "platform_lib_includes.h"
+
+/*=============================================================================
+ *
+ *                             DATA DECLARATION
+ *
+ *============================================================================*/
+
+/* loc_log_site_s_type state */
+#define LOC_LOG_SITE_NEW       0
+#define LOC_LOG_SITE_PARSING   1
+#define LOC_LOG_SITE_READY     2
+#define LOC_LOG_SITE_INLINE    3   /* format can't be deferred */
+
+/* loc_log_site_s_type arg_types */
+enum
+{
+    LOC_LOG_ARG_INT,
+    LOC_LOG_ARG_LONG,
+    LOC_LOG_ARG_LLONG,
+    LOC_LOG_ARG_SIZE,
+    LOC_LOG_ARG_PTRDIFF,
+    LOC_LOG_ARG_INTMAX,
+    LOC_LOG_ARG_DOUBLE,
+    LOC_LOG_ARG_STRING,
+    LOC_LOG_ARG_POINTER
+};
+
+/* arg_precisions of a %s whose precision is the int argument before it */
+#define LOC_LOG_PRECISION_NONE  -1
+#define LOC_LOG_PRECISION_ARG   -2
+
+/* Records are made of 8 byte slots: the header, one slot per argument,
+   and for a string its length in one slot and its bytes, with a '\0',
+   in as many as they take. */
+typedef struct
+{
+    uint32_t size;              /* bytes, header included */
+    uint32_t pad;               /* nonzero for the filler before a wrap */
+    uint64_t time;              /* CLOCK_REALTIME, nsec */
+    uint64_t site;
+} loc_log_record_s_type;
+
+#define LOC_LOG_RECORD_MAX      2048
+#define LOC_LOG_RING_MIN        (4 * LOC_LOG_RECORD_MAX)
+#define LOC_LOG_RING_MAX        (1 << 24)
+#define LOC_LOG_TEXT_MAX        1024
+
+/* drainer wait, doubled from MIN up to MAX while there is nothing to do */
+#define LOC_LOG_DRAIN_MIN_MSEC  20
+#define LOC_LOG_DRAIN_MAX_MSEC  200
+
+typedef struct loc_log_ring_s
+{
+    char                   *buf;
+    uint32_t                size;       /* power of 2 */
+    uint32_t                head;       /* bytes written, by the thread */
+    uint32_t                tail;       /* bytes read, by the drainer */
+    uint32_t                dropped;    /* by the thread */
+    uint32_t                reported;   /* dropped the drainer has logged */
+    int                     dead;       /* the thread has exited */
+    pid_t                   tid;
+    struct loc_log_ring_s  *next;
+} loc_log_ring_s_type;
+
+static loc_log_ring_s_type* loc_log_rings = NULL;
+static uint32_t loc_log_ring_size = 0;
+static FILE* loc_log_ring_file = NULL;
+static pthread_t loc_log_ring_drainer;
+static int loc_log_ring_started = 0;
+
+static pthread_once_t loc_log_ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t loc_log_ring_key;
+
+/* held while draining, so the drainer and loc_log_ring_flush take turns */
+static pthread_mutex_t loc_log_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loc_log_ring_cond = PTHREAD_COND_INITIALIZER;
+
+/*===========================================================================
+FUNCTION    loc_log_ring_output
+
+DESCRIPTION
+   Writes one formatted message, where ALOGE would have, or to the file
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_log_ring_output(const char* tag, pid_t tid, uint64_t time,
+                                const char* text)
+{
+    time_t sec = (time_t)(time / 1000000000);
+    long usec = (long)(time % 1000000000 / 1000);
+    char stamp[32];
+
+    if (NULL != loc_log_ring_file) {
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        strftime(stamp, sizeof(stamp), "%m-%d %H:%M:%S", &tm);
+        fprintf(loc_log_ring_file, "%s.%06ld %5d %s: %s\n", stamp, usec,
+                (int)tid, NULL != tag ? tag : "", text);
+        return;
+    }
+
+    /* as get_timestamp in the LOG_ macros, which leave it to the ring */
+    stamp[0] = '\0';
+    if (loc_logger.TIMESTAMP) {
+        snprintf(stamp, sizeof(stamp), "[%02d:%02d:%02d.%06ld] ",
+                 (int)(sec / 3600 % 24), (int)(sec % 3600 / 60),
+                 (int)(sec % 60), usec);
+    }
+#ifdef USE_GLIB
+    fprintf(stdout, "%02d:%02d:%02d.%06ld]E/%s (%d): %s%s\n",
+            (int)(sec / 3600 % 24), (int)(sec % 3600 / 60), (int)(sec % 60),
+            usec, NULL != tag ? tag : "", (int)getpid(), stamp, text);
+#else
+    if (loc_logger.TIMESTAMP) {
+        __android_log_print(ANDROID_LOG_ERROR, tag, "%s%s", stamp, text);
+    } else {
+        __android_log_write(ANDROID_LOG_ERROR, tag, text);
+    }
+#endif /* USE_GLIB */
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_now
+
+DESCRIPTION
+   Time a message is logged at
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   CLOCK_REALTIME in nsec
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static uint64_t loc_log_ring_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_parse
+
+DESCRIPTION
+   Works out the argument types of fmt into site. Only what the drainer
+   can hand back to snprintf as it was passed is deferred: %n, long
+   double, wide characters and formats with more than
+   LOC_LOG_SITE_MAX_ARGS arguments are formatted where they are logged.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   LOC_LOG_SITE_READY or LOC_LOG_SITE_INLINE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_log_ring_parse(loc_log_site_s_type* site, const char* fmt)
+{
+    int count = 0;
+
+    for (const char* p = fmt; *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+        while (*p != '\0' && NULL != strchr("-+ #0'", *p)) {
+            p++;
+        }
+        if (*p == '*') {
+            if (count >= LOC_LOG_SITE_MAX_ARGS) {
+                return LOC_LOG_SITE_INLINE;
+            }
+            site->arg_types[count] = LOC_LOG_ARG_INT;
+            site->arg_precisions[count++] = LOC_LOG_PRECISION_NONE;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        int precision = LOC_LOG_PRECISION_NONE;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                if (count >= LOC_LOG_SITE_MAX_ARGS) {
+                    return LOC_LOG_SITE_INLINE;
+                }
+                site->arg_types[count] = LOC_LOG_ARG_INT;
+                site->arg_precisions[count++] = LOC_LOG_PRECISION_NONE;
+                precision = LOC_LOG_PRECISION_ARG;
+                p++;
+            } else {
+                precision = 0;
+                while (*p >= '0' && *p <= '9') {
+                    if (precision < LOC_LOG_RECORD_MAX) {
+                        precision = precision * 10 + (*p - '0');
+                    }
+                    p++;
+                }
+            }
+        }
+
+        int type = LOC_LOG_ARG_INT;
+        switch (*p) {
+        case 'h':
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            if (p[1] == 'l') {
+                type = LOC_LOG_ARG_LLONG;
+                p += 2;
+            } else {
+                type = LOC_LOG_ARG_LONG;
+                p++;
+            }
+            break;
+        case 'q':
+            type = LOC_LOG_ARG_LLONG;
+            p++;
+            break;
+        case 'z':
+            type = LOC_LOG_ARG_SIZE;
+            p++;
+            break;
+        case 't':
+            type = LOC_LOG_ARG_PTRDIFF;
+            p++;
+            break;
+        case 'j':
+            type = LOC_LOG_ARG_INTMAX;
+            p++;
+            break;
+        case 'L':
+            return LOC_LOG_SITE_INLINE;
+        }
+
+        switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            break;
+        case 'c':
+            if (type != LOC_LOG_ARG_INT) {
+                return LOC_LOG_SITE_INLINE;
+            }
+            break;
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            type = LOC_LOG_ARG_DOUBLE;
+            break;
+        case 's':
+            if (type != LOC_LOG_ARG_INT) {
+                return LOC_LOG_SITE_INLINE;
+            }
+            type = LOC_LOG_ARG_STRING;
+            break;
+        case 'p':
+            type = LOC_LOG_ARG_POINTER;
+            break;
+        default:
+            /* %n, %C, %S, %m and what is no conversion at all */
+            return LOC_LOG_SITE_INLINE;
+        }
+
+        if (count >= LOC_LOG_SITE_MAX_ARGS) {
+            return LOC_LOG_SITE_INLINE;
+        }
+        site->arg_types[count] = (unsigned char)type;
+        site->arg_precisions[count++] =
+            (type == LOC_LOG_ARG_STRING) ? (short)precision : LOC_LOG_PRECISION_NONE;
+    }
+
+    site->arg_count = (unsigned char)count;
+    site->fmt = fmt;
+    return LOC_LOG_SITE_READY;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_put_slot / loc_log_ring_get_slot
+
+DESCRIPTION
+   Copy an argument in and out of its 8 byte slot
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None / the argument
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+template <typename T>
+static inline void loc_log_ring_put_slot(char* slot, T value)
+{
+    memcpy(slot, &value, sizeof(value));
+}
+
+template <typename T>
+static inline T loc_log_ring_get_slot(const char* slot)
+{
+    T value;
+    memcpy(&value, slot, sizeof(value));
+    return value;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_encode
+
+DESCRIPTION
+   Copies the arguments of a message into a record in rec, strings cut
+   short to what fits in LOC_LOG_RECORD_MAX
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Size of the record
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static uint32_t loc_log_ring_encode(char* rec, const loc_log_site_s_type* site,
+                                    va_list args)
+{
+    uint32_t size = sizeof(loc_log_record_s_type);
+    int lastInt = -1;
+
+    for (int i = 0; i < site->arg_count; i++) {
+        char* slot = rec + size;
+        size += 8;
+        switch (site->arg_types[i]) {
+        case LOC_LOG_ARG_INT:
+            lastInt = va_arg(args, int);
+            loc_log_ring_put_slot(slot, lastInt);
+            break;
+        case LOC_LOG_ARG_LONG:
+            loc_log_ring_put_slot(slot, va_arg(args, long));
+            break;
+        case LOC_LOG_ARG_LLONG:
+            loc_log_ring_put_slot(slot, va_arg(args, long long));
+            break;
+        case LOC_LOG_ARG_SIZE:
+            loc_log_ring_put_slot(slot, va_arg(args, size_t));
+            break;
+        case LOC_LOG_ARG_PTRDIFF:
+            loc_log_ring_put_slot(slot, va_arg(args, ptrdiff_t));
+            break;
+        case LOC_LOG_ARG_INTMAX:
+            loc_log_ring_put_slot(slot, va_arg(args, intmax_t));
+            break;
+        case LOC_LOG_ARG_DOUBLE:
+            loc_log_ring_put_slot(slot, va_arg(args, double));
+            break;
+        case LOC_LOG_ARG_POINTER:
+            loc_log_ring_put_slot(slot, va_arg(args, void*));
+            break;
+        case LOC_LOG_ARG_STRING: {
+            const char* str = va_arg(args, const char*);
+            /* room for the rest of the args, 16 bytes for an empty
+               string, and the '\0' of this one */
+            uint32_t room = LOC_LOG_RECORD_MAX - size -
+                            (site->arg_count - i - 1) * 16 - 8;
+            uint32_t len = 0xFFFFFFFF;
+            if (NULL != str) {
+                uint32_t max = room;
+                if (site->arg_precisions[i] >= 0 &&
+                    (uint32_t)site->arg_precisions[i] < max) {
+                    max = site->arg_precisions[i];
+                } else if (site->arg_precisions[i] == LOC_LOG_PRECISION_ARG &&
+                           lastInt >= 0 && (uint32_t)lastInt < max) {
+                    max = lastInt;
+                }
+                len = strnlen(str, max);
+                memcpy(rec + size, str, len);
+                rec[size + len] = '\0';
+                size += (len + 8) & ~7;
+            }
+            loc_log_ring_put_slot(slot, len);
+            break;
+        }
+        }
+    }
+    return size;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_format
+
+DESCRIPTION
+   Formats a record the way snprintf would have formatted the message it
+   was made from. Each conversion is handed to snprintf on its own, with
+   any '*' width and precision put into the spec.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_log_ring_format(const char* rec, char* text, size_t textSize)
+{
+    const loc_log_site_s_type* site = (const loc_log_site_s_type*)(uintptr_t)
+        ((const loc_log_record_s_type*)rec)->site;
+    const char* slot = rec + sizeof(loc_log_record_s_type);
+    const char* p = site->fmt;
+    size_t len = 0;
+    int arg = 0;
+
+    while (*p != '\0' && len + 1 < textSize) {
+        if (*p != '%' || p[1] == '%') {
+            text[len++] = *p;
+            p += (*p == '%') ? 2 : 1;
+            continue;
+        }
+
+        /* the spec, with '*' replaced by its value */
+        char spec[48];
+        size_t specLen = 0;
+        spec[specLen++] = *p++;
+        while (*p != '\0' && NULL != strchr("-+ #0'", *p)) {
+            if (specLen < 8) {
+                spec[specLen++] = *p;
+            }
+            p++;
+        }
+        if (*p == '*') {
+            specLen += snprintf(spec + specLen, sizeof(spec) - specLen, "%d",
+                                loc_log_ring_get_slot<int>(slot));
+            slot += 8;
+            arg++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            if (specLen < 24) {
+                spec[specLen++] = *p;
+            }
+            p++;
+        }
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                int precision = loc_log_ring_get_slot<int>(slot);
+                if (precision >= 0) {
+                    specLen += snprintf(spec + specLen, sizeof(spec) - specLen,
+                                        ".%d", precision);
+                }
+                slot += 8;
+                arg++;
+                p++;
+            } else {
+                spec[specLen++] = '.';
+                while (*p >= '0' && *p <= '9') {
+                    if (specLen < 36) {
+                        spec[specLen++] = *p;
+                    }
+                    p++;
+                }
+            }
+        }
+        while (*p != '\0' && NULL != strchr("hlqztj", *p)) {
+            spec[specLen++] = *p++;
+        }
+        spec[specLen++] = *p++;
+        spec[specLen] = '\0';
+
+        char* out = text + len;
+        size_t room = textSize - len;
+        int n = 0;
+        switch (site->arg_types[arg]) {
+        case LOC_LOG_ARG_INT:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<int>(slot));
+            break;
+        case LOC_LOG_ARG_LONG:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<long>(slot));
+            break;
+        case LOC_LOG_ARG_LLONG:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<long long>(slot));
+            break;
+        case LOC_LOG_ARG_SIZE:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<size_t>(slot));
+            break;
+        case LOC_LOG_ARG_PTRDIFF:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<ptrdiff_t>(slot));
+            break;
+        case LOC_LOG_ARG_INTMAX:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<intmax_t>(slot));
+            break;
+        case LOC_LOG_ARG_DOUBLE:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<double>(slot));
+            break;
+        case LOC_LOG_ARG_POINTER:
+            n = snprintf(out, room, spec, loc_log_ring_get_slot<void*>(slot));
+            break;
+        case LOC_LOG_ARG_STRING: {
+            uint32_t strLen = loc_log_ring_get_slot<uint32_t>(slot);
+            if (strLen == 0xFFFFFFFF) {
+                n = snprintf(out, room, spec, "(null)");
+            } else {
+                n = snprintf(out, room, spec, slot + 8);
+                slot += (strLen + 8) & ~7;
+            }
+            break;
+        }
+        }
+        slot += 8;
+        arg++;
+        if (n < 0) {
+            n = 0;
+        }
+        len += ((size_t)n < room) ? (size_t)n : room - 1;
+    }
+    text[len] = '\0';
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_drain_locked
+
+DESCRIPTION
+   Formats what the rings hold, in the order of the time of the messages.
+   What is written to a ring while this runs waits for the next drain.
+   Rings of threads that have exited are freed once they are empty.
+
+DEPENDENCIES
+   loc_log_ring_mutex held
+
+RETURN VALUE
+   Number of messages formatted
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_log_ring_drain_locked()
+{
+    loc_log_ring_s_type* rings[64];
+    uint32_t heads[64];
+    int ringCount = 0;
+    int drained = 0;
+    char text[LOC_LOG_TEXT_MAX];
+
+    loc_log_ring_s_type* ring = __atomic_load_n(&loc_log_rings, __ATOMIC_ACQUIRE);
+    while (NULL != ring) {
+        /* a ring sees the drop count in the order of its messages */
+        uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "%u messages dropped",
+                     dropped - ring->reported);
+            loc_log_ring_output(LOG_TAG, ring->tid, loc_log_ring_now(), msg);
+            ring->reported = dropped;
+        }
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head != ring->tail) {
+            rings[ringCount] = ring;
+            heads[ringCount++] = head;
+        }
+        ring = ring->next;
+
+        /* as many rings as there are threads, up to 64 in one go */
+        if (ringCount == sizeof(rings) / sizeof(rings[0]) || NULL == ring) {
+            for (;;) {
+                int first = -1;
+                const loc_log_record_s_type* firstRec = NULL;
+                for (int i = 0; i < ringCount; i++) {
+                    loc_log_ring_s_type* r = rings[i];
+                    const loc_log_record_s_type* rec = NULL;
+                    while (r->tail != heads[i]) {
+                        rec = (const loc_log_record_s_type*)
+                            (r->buf + (r->tail & (r->size - 1)));
+                        if (!rec->pad) {
+                            break;
+                        }
+                        __atomic_store_n(&r->tail, r->tail + rec->size,
+                                         __ATOMIC_RELEASE);
+                        rec = NULL;
+                    }
+                    if (NULL != rec &&
+                        (NULL == firstRec || rec->time < firstRec->time)) {
+                        first = i;
+                        firstRec = rec;
+                    }
+                }
+                if (first < 0) {
+                    break;
+                }
+                loc_log_ring_format((const char*)firstRec, text, sizeof(text));
+                loc_log_ring_output(((const loc_log_site_s_type*)(uintptr_t)
+                                     firstRec->site)->tag,
+                                    rings[first]->tid, firstRec->time, text);
+                __atomic_store_n(&rings[first]->tail,
+                                 rings[first]->tail + firstRec->size,
+                                 __ATOMIC_RELEASE);
+                drained++;
+            }
+            ringCount = 0;
+        }
+    }
+
+    /* rings of exited threads: only the drainer unlinks, and threads
+       only ever push onto the list head */
+    loc_log_ring_s_type* prev = NULL;
+    ring = __atomic_load_n(&loc_log_rings, __ATOMIC_ACQUIRE);
+    while (NULL != ring) {
+        loc_log_ring_s_type* next = ring->next;
+        if (__atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail &&
+            __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) == ring->reported) {
+            if (NULL != prev) {
+                prev->next = next;
+            } else if (!__atomic_compare_exchange_n(&loc_log_rings, &ring, next, false,
+                                                    __ATOMIC_ACQ_REL,
+                                                    __ATOMIC_ACQUIRE)) {
+                /* a thread pushed a ring, leave this one to the next drain */
+                break;
+            }
+            free(ring->buf);
+            free(ring);
+        } else {
+            prev = ring;
+        }
+        ring = next;
+    }
+
+    if (NULL != loc_log_ring_file && drained > 0) {
+        fflush(loc_log_ring_file);
+    }
+    return drained;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_drainer_main
+
+DESCRIPTION
+   Drainer thread, drains the rings every LOC_LOG_DRAIN_MIN_MSEC while
+   there are messages, backing off to LOC_LOG_DRAIN_MAX_MSEC when idle,
+   or at once when a thread finds its ring half full
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void* loc_log_ring_drainer_main(void*)
+{
+    uint32_t waitMsec = LOC_LOG_DRAIN_MIN_MSEC;
+
+    pthread_mutex_lock(&loc_log_ring_mutex);
+    for (;;) {
+        if (loc_log_ring_drain_locked() > 0) {
+            waitMsec = LOC_LOG_DRAIN_MIN_MSEC;
+        } else if (waitMsec < LOC_LOG_DRAIN_MAX_MSEC) {
+            waitMsec *= 2;
+            if (waitMsec > LOC_LOG_DRAIN_MAX_MSEC) {
+                waitMsec = LOC_LOG_DRAIN_MAX_MSEC;
+            }
+        }
+
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += (long)waitMsec * 1000000;
+        if (until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&loc_log_ring_cond, &loc_log_ring_mutex, &until);
+    }
+    return NULL;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_thread_exit
+
+DESCRIPTION
+   pthread key destructor, hands the ring of an exiting thread over to
+   the drainer to free once it is empty
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_log_ring_thread_exit(void* ring)
+{
+    __atomic_store_n(&((loc_log_ring_s_type*)ring)->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void loc_log_ring_key_create()
+{
+    pthread_key_create(&loc_log_ring_key, loc_log_ring_thread_exit);
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_get
+
+DESCRIPTION
+   Ring of the calling thread, made on its first message
+
+DEPENDENCIES
+   loc_log_ring_init has started the drainer
+
+RETURN VALUE
+   The ring, NULL if there is no memory for one
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static loc_log_ring_s_type* loc_log_ring_get()
+{
+    loc_log_ring_s_type* ring =
+        (loc_log_ring_s_type*)pthread_getspecific(loc_log_ring_key);
+    if (NULL != ring) {
+        return ring;
+    }
+
+    ring = (loc_log_ring_s_type*)calloc(1, sizeof(loc_log_ring_s_type));
+    if (NULL == ring) {
+        return NULL;
+    }
+    ring->size = loc_log_ring_size;
+    ring->buf = (char*)malloc(ring->size);
+    if (NULL == ring->buf) {
+        free(ring);
+        return NULL;
+    }
+    ring->tid = GETTID_PLATFORM_LIB_ABSTRACTION;
+    pthread_setspecific(loc_log_ring_key, ring);
+
+    ring->next = __atomic_load_n(&loc_log_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&loc_log_rings, &ring->next, ring, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return ring;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_write
+
+DESCRIPTION
+   Logs a message of a LOC_LOGx call site through the ring of the calling
+   thread. The first call of a site works out the types of its arguments
+   for the ones after it; while it does, other threads logging from the
+   same site format their messages where they are, as do sites whose
+   format can't be deferred.
+
+DEPENDENCIES
+   loc_log_ring_init
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_log_ring_write(loc_log_site_s_type* site, const char* fmt, ...)
+{
+    int state = __atomic_load_n(&site->state, __ATOMIC_ACQUIRE);
+    if (state == LOC_LOG_SITE_NEW) {
+        if (__atomic_compare_exchange_n(&site->state, &state, LOC_LOG_SITE_PARSING,
+                                        false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            state = loc_log_ring_parse(site, fmt);
+            __atomic_store_n(&site->state, state, __ATOMIC_RELEASE);
+        }
+    }
+
+    loc_log_ring_s_type* ring = NULL;
+    if (state == LOC_LOG_SITE_READY && loc_log_ring_size > 0) {
+        ring = loc_log_ring_get();
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    if (NULL == ring) {
+        char text[LOC_LOG_TEXT_MAX];
+        vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        loc_log_ring_output(site->tag, GETTID_PLATFORM_LIB_ABSTRACTION,
+                            loc_log_ring_now(), text);
+        return;
+    }
+
+    uint64_t rec[LOC_LOG_RECORD_MAX / sizeof(uint64_t)];
+    loc_log_record_s_type* hdr = (loc_log_record_s_type*)rec;
+    hdr->time = loc_log_ring_now();
+    hdr->size = loc_log_ring_encode((char*)rec, site, args);
+    hdr->pad = 0;
+    hdr->site = (uintptr_t)site;
+    va_end(args);
+
+    uint32_t head = ring->head;
+    uint32_t used = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t offset = head & (ring->size - 1);
+    uint32_t toEnd = ring->size - offset;
+    uint32_t need = hdr->size + ((toEnd < hdr->size) ? toEnd : 0);
+    if (used + need > ring->size) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (toEnd < hdr->size) {
+        /* filler to the end, records never wrap */
+        loc_log_record_s_type* pad = (loc_log_record_s_type*)(ring->buf + offset);
+        pad->size = toEnd;
+        pad->pad = 1;
+        head += toEnd;
+        offset = 0;
+    }
+    memcpy(ring->buf + offset, rec, hdr->size);
+    __atomic_store_n(&ring->head, head + hdr->size, __ATOMIC_RELEASE);
+
+    if (used < ring->size / 2 && used + need >= ring->size / 2) {
+        pthread_cond_signal(&loc_log_ring_cond);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_flush
+
+DESCRIPTION
+   Formats every message logged through the ring so far, e.g. before
+   the process goes away
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_log_ring_flush(void)
+{
+    pthread_mutex_lock(&loc_log_ring_mutex);
+    if (loc_log_ring_started) {
+        loc_log_ring_drain_locked();
+    }
+    pthread_mutex_unlock(&loc_log_ring_mutex);
+}
+
+static void loc_log_ring_flush_at_exit()
+{
+    loc_log_ring_flush();
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_init
+
+DESCRIPTION
+   Turns the ring on or off, see LOG_RING_SIZE and LOG_FILE in gps.conf.
+   The size and the file are taken from the first call that turns the
+   ring on, and kept for as long as the process lives.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   Starts the drainer thread
+
+===========================================================================*/
+void loc_log_ring_init(unsigned long ring_size, const char* file)
+{
+    pthread_mutex_lock(&loc_log_ring_mutex);
+    if (ring_size > 0 && !loc_log_ring_started) {
+        uint32_t size = LOC_LOG_RING_MIN;
+        while (size < ring_size && size < LOC_LOG_RING_MAX) {
+            size <<= 1;
+        }
+        pthread_once(&loc_log_ring_once, loc_log_ring_key_create);
+        if (NULL != file && file[0] != '\0') {
+            loc_log_ring_file = fopen(file, "a");
+            if (NULL == loc_log_ring_file) {
+                LOC_LOGE("%s: cannot open %s, errno %d, logging to logcat",
+                         __FUNCTION__, file, errno);
+            }
+        }
+        loc_log_ring_size = size;
+        if (pthread_create(&loc_log_ring_drainer, NULL,
+                           loc_log_ring_drainer_main, NULL) == 0) {
+            loc_log_ring_started = 1;
+            atexit(loc_log_ring_flush_at_exit);
+            LOC_LOGI("%s: %u byte rings, to %s", __FUNCTION__, size,
+                     NULL != loc_log_ring_file ? file : "logcat");
+        } else {
+            LOC_LOGE("%s: no drainer thread, errno %d", __FUNCTION__, errno);
+            loc_log_ring_size = 0;
+            if (NULL != loc_log_ring_file) {
+                fclose(loc_log_ring_file);
+                loc_log_ring_file = NULL;
+            }
+        }
+    }
+    loc_logger.RING = (ring_size > 0 && loc_log_ring_started) ? 1 : 0;
+    pthread_mutex_unlock(&loc_log_ring_mutex);
+}
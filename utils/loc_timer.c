@@ -27,176 +27,477 @@
  *
  */
 
+/* for pthread_setname_np, which bionic declares anyway */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include<stdio.h>
 #include<stdlib.h>
-#include<sys/time.h>
+#include<stdint.h>
+#include<string.h>
+#include<limits.h>
+#include<unistd.h>
+#include<sys/syscall.h>
+#include<linux/futex.h>
 #include "loc_timer.h"
 #include<time.h>
 #include<errno.h>
 
+/* All timers are served by one thread, out of a hierarchical timing wheel
+   ticking in msec of CLOCK_MONOTONIC. Level 0 has a slot for each of the
+   next 256 ticks; each level above has 64 slots, each spanning all of the
+   level below. A timer goes into the lowest level its delay fits in, and
+   moves down a level (cascades) when the wheel gets to the start of its
+   slot, so starting and stopping a timer is O(1). The service thread only
+   wakes up for ticks with a slot to expire or cascade, found through a
+   bitmap of the non-empty slots of each level.
+
+   A timer started with slack is moved to the tick within its slack that
+   is the most round in binary, the way the kernel applies timer_slack_ns,
+   so that timers whose windows overlap end up on the same tick and fire
+   in one wakeup.
+
+   Handles carry the index of the timer record and its generation, which
+   changes every time the record is reused, so a stale handle is harmless. */
+#define WHEEL_L0_BITS 8
+#define WHEEL_LN_BITS 6
+#define WHEEL_LEVELS 4
+#define WHEEL_L0_SIZE (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE (1 << WHEEL_LN_BITS)
+/* longest delay the wheel holds in one go, about 18 hours;
+   longer ones wait in the top level until they fit */
+#define WHEEL_SPAN ((uint64_t)1 << (WHEEL_L0_BITS + (WHEEL_LEVELS - 1) * WHEEL_LN_BITS))
+#define WHEEL_NEVER UINT64_MAX
+
+#define TIMER_INDEX_BITS 18
+#define TIMER_GEN_MASK ((1u << (32 - TIMER_INDEX_BITS)) - 1)
+#define TIMER_CHUNK_BITS 8
+#define TIMER_CHUNK_SIZE (1 << TIMER_CHUNK_BITS)
+#define TIMER_MAX_CHUNKS (1 << (TIMER_INDEX_BITS - TIMER_CHUNK_BITS))
+
 enum timer_state {
-    READY = 100,
-    WAITING,
-    DONE,
-    ABORT
+    FREE = 100,
+    PENDING,
+    RUNNING
 };
 
-typedef struct {
+typedef struct timer_data {
+    struct timer_data* next;
+    struct timer_data** pprev;
     loc_timer_callback callback_func;
     void *user_data;
-    unsigned int time_msec;
-    pthread_cond_t timer_cond;
-    pthread_mutex_t timer_mutex;
+    uint64_t expires;
+    uint32_t index;
+    uint32_t gen;
+    uint16_t level;
+    uint16_t slot;
     enum timer_state state;
 }timer_data;
 
-static void *timer_thread(void *thread_data)
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t done_cond;
+    pthread_t thread;
+    int started;
+    uint64_t base_msec;
+    /* last tick processed */
+    uint64_t now;
+    /* tick the service thread sleeps until */
+    uint64_t sleep_until;
+    int wake_seq;
+    timer_data* l0[WHEEL_L0_SIZE];
+    timer_data* ln[WHEEL_LEVELS - 1][WHEEL_LN_SIZE];
+    uint64_t l0_map[WHEEL_L0_SIZE / 64];
+    uint64_t ln_map[WHEEL_LEVELS - 1];
+    /* timer records, allocated a chunk at a time and never freed */
+    timer_data* chunks[TIMER_MAX_CHUNKS];
+    uint32_t chunk_cnt;
+    timer_data* free_list;
+    loc_timer_stats_s_type stats;
+} wheel = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER
+};
+
+static pthread_once_t wheel_once = PTHREAD_ONCE_INIT;
+
+static uint64_t now_msec()
 {
-    int ret = -ETIMEDOUT;
     struct timespec ts;
-    struct timeval tv;
-    timer_data* t = (timer_data*)thread_data;
-
-    LOC_LOGD("%s:%d]: Enter. Delay = %d\n", __func__, __LINE__, t->time_msec);
-
-    gettimeofday(&tv, NULL);
-    clock_gettime(CLOCK_REALTIME, &ts);
-    if(t->time_msec >= 1000) {
-        ts.tv_sec += t->time_msec/1000;
-        t->time_msec = t->time_msec % 1000;
-    }
-    if(t->time_msec)
-        ts.tv_nsec += t->time_msec * 1000000;
-    if(ts.tv_nsec > 999999999) {
-        LOC_LOGD("%s:%d]: Large nanosecs\n", __func__, __LINE__);
-        ts.tv_sec += 1;
-        ts.tv_nsec -= 1000000000;
-    }
-    LOC_LOGD("%s:%d]: ts.tv_sec:%d; ts.tv_nsec:%d\n"
-             "\t Current time: %d sec; %d nsec",
-             __func__, __LINE__, (int)ts.tv_sec, (int)ts.tv_nsec,
-             (int)tv.tv_sec, (int)tv.tv_usec*1000);
-
-    pthread_mutex_lock(&(t->timer_mutex));
-    if (READY == t->state) {
-        t->state = WAITING;
-        ret = pthread_cond_timedwait(&t->timer_cond, &t->timer_mutex, &ts);
-        t->state = DONE;
-    }
-    pthread_mutex_unlock(&(t->timer_mutex));
-
-    switch (ret) {
-    case ETIMEDOUT:
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline uint64_t current_tick()
+{
+    return now_msec() - wheel.base_msec;
+}
+
+static inline unsigned int level_shift(int level)
+{
+    return WHEEL_L0_BITS + (level - 1) * WHEEL_LN_BITS;
+}
+
+static inline timer_data** slot_head(int level, int slot)
+{
+    return 0 == level ? &wheel.l0[slot] : &wheel.ln[level - 1][slot];
+}
+
+static inline uint64_t* slot_map(int level, int slot)
+{
+    return 0 == level ? &wheel.l0_map[slot >> 6] : &wheel.ln_map[level - 1];
+}
+
+/* distance from start to the first non-empty slot in map, going round;
+   -1 if all are empty */
+static int wheel_find(const uint64_t* map, int size, int start)
+{
+    int i;
+    for (i = 0; i < size; ) {
+        int pos = (start + i) & (size - 1);
+        uint64_t word = map[pos >> 6] >> (pos & 63);
+        if (word) {
+            return i + __builtin_ctzll(word);
+        }
+        i += 64 - (pos & 63);
+    }
+    return -1;
+}
+
+static void wheel_add(timer_data* t)
+{
+    uint64_t delta = t->expires > wheel.now ? t->expires - wheel.now : 1;
+    uint64_t expires;
+    int level = 0;
+    int slot;
+
+    if (delta >= WHEEL_SPAN) {
+        delta = WHEEL_SPAN - 1;
+    }
+    expires = wheel.now + delta;
+
+    if (delta < WHEEL_L0_SIZE) {
+        slot = expires & (WHEEL_L0_SIZE - 1);
+    } else {
+        for (level = 1; level < WHEEL_LEVELS - 1 &&
+                        delta >> level_shift(level + 1); level++);
+        slot = (expires >> level_shift(level)) & (WHEEL_LN_SIZE - 1);
+    }
+
+    timer_data** head = slot_head(level, slot);
+    t->next = *head;
+    if (NULL != t->next) {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = head;
+    *head = t;
+    t->level = level;
+    t->slot = slot;
+    *slot_map(level, slot) |= (uint64_t)1 << (slot & 63);
+}
+
+static void wheel_del(timer_data* t)
+{
+    *t->pprev = t->next;
+    if (NULL != t->next) {
+        t->next->pprev = t->pprev;
+    }
+    if (NULL == *slot_head(t->level, t->slot)) {
+        *slot_map(t->level, t->slot) &= ~((uint64_t)1 << (t->slot & 63));
+    }
+}
+
+/* the next tick with a slot to expire or cascade; WHEEL_NEVER if none */
+static uint64_t wheel_next_tick()
+{
+    uint64_t next = WHEEL_NEVER;
+    int level;
+    int d = wheel_find(wheel.l0_map, WHEEL_L0_SIZE,
+                       (wheel.now + 1) & (WHEEL_L0_SIZE - 1));
+    if (d >= 0) {
+        next = wheel.now + 1 + d;
+    }
+    for (level = 1; level < WHEEL_LEVELS; level++) {
+        unsigned int shift = level_shift(level);
+        d = wheel_find(&wheel.ln_map[level - 1], WHEEL_LN_SIZE,
+                       ((wheel.now >> shift) + 1) & (WHEEL_LN_SIZE - 1));
+        if (d >= 0 && ((wheel.now >> shift) + 1 + d) << shift < next) {
+            next = ((wheel.now >> shift) + 1 + d) << shift;
+        }
+    }
+    return next;
+}
+
+static void wheel_cascade(int level, int slot)
+{
+    timer_data* t = *slot_head(level, slot);
+    *slot_head(level, slot) = NULL;
+    *slot_map(level, slot) &= ~((uint64_t)1 << (slot & 63));
+    while (NULL != t) {
+        timer_data* next = t->next;
+        wheel_add(t);
+        t = next;
+    }
+}
+
+static timer_data* timer_alloc()
+{
+    if (NULL == wheel.free_list && wheel.chunk_cnt < TIMER_MAX_CHUNKS) {
+        timer_data* chunk = (timer_data*)calloc(TIMER_CHUNK_SIZE, sizeof(timer_data));
+        if (NULL != chunk) {
+            int i;
+            for (i = TIMER_CHUNK_SIZE - 1; i >= 0; i--) {
+                chunk[i].index = (wheel.chunk_cnt << TIMER_CHUNK_BITS) | i;
+                chunk[i].gen = 1;
+                chunk[i].state = FREE;
+                chunk[i].next = wheel.free_list;
+                wheel.free_list = &chunk[i];
+            }
+            wheel.chunks[wheel.chunk_cnt++] = chunk;
+        }
+    }
+
+    timer_data* t = wheel.free_list;
+    if (NULL != t) {
+        wheel.free_list = t->next;
+    }
+    return t;
+}
+
+static void timer_free(timer_data* t)
+{
+    /* invalidates the handles of the timer */
+    t->gen = (t->gen + 1) & TIMER_GEN_MASK;
+    if (0 == t->gen) {
+        t->gen = 1;
+    }
+    t->state = FREE;
+    t->next = wheel.free_list;
+    wheel.free_list = t;
+}
+
+static timer_data* timer_lookup(void* handle)
+{
+    uint32_t h = (uint32_t)(uintptr_t)handle;
+    uint32_t index = h & ((1 << TIMER_INDEX_BITS) - 1);
+    timer_data* t = NULL;
+
+    if (index >> TIMER_CHUNK_BITS < wheel.chunk_cnt) {
+        t = &wheel.chunks[index >> TIMER_CHUNK_BITS][index & (TIMER_CHUNK_SIZE - 1)];
+        if (t->gen != h >> TIMER_INDEX_BITS || FREE == t->state) {
+            t = NULL;
+        }
+    }
+    return t;
+}
+
+/* the tick in [expires, expires + slack] with the most trailing zeros */
+static uint64_t apply_slack(uint64_t expires, unsigned int slack)
+{
+    uint64_t limit = expires + slack;
+    uint64_t mask = expires ^ limit;
+
+    if (0 == mask) {
+        return expires;
+    }
+    /* clear the bits below the highest one that differs */
+    mask = ((uint64_t)1 << (63 - __builtin_clzll(mask))) - 1;
+    return limit & ~mask;
+}
+
+/* expires the timers due at tick now, with the mutex held */
+static void wheel_expire(int slot)
+{
+    timer_data* t;
+    while (NULL != (t = wheel.l0[slot])) {
+        wheel_del(t);
+        t->state = RUNNING;
+
+        /* loc_timer_stop waits for the callback to return */
+        pthread_mutex_unlock(&wheel.mutex);
         LOC_LOGV("%s:%d]: loc_timer timed out",  __func__, __LINE__);
-        break;
-    case 0:
-        LOC_LOGV("%s:%d]: loc_timer stopped",  __func__, __LINE__);
-        break;
-    case -ETIMEDOUT:
-        LOC_LOGV("%s:%d]: loc_timer cancelled",  __func__, __LINE__);
-        break;
-    default:
-        LOC_LOGE("%s:%d]: Call to pthread timedwait failed; ret=%d\n",
-                 __func__, __LINE__, ret);
-        break;
-    }
-
-    if(ETIMEDOUT == ret)
-        t->callback_func(t->user_data, ret);
-
-    // A (should be rare) race condition is that, when the loc_time_stop is called
-    // and acquired mutex, we reach here.  pthread_mutex_destroy will fail with
-    // error code EBUSY.  We give it 6 tries in 5 seconds.  Should be eanough time
-    // for loc_timer_stop to complete.  With the 7th try, we also perform unlock
-    // prior to destroy.
-    {
-        int i;
-        for (i = 0; EBUSY == pthread_mutex_destroy(&t->timer_mutex) && i <= 5; i++) {
-            if (i < 5) {
-                sleep(1);
-            } else {
-                // nah, forget it, something is seriously wrong.  Mutex has been
-                // held too long.  Unlock the mutext here.
-                pthread_mutex_unlock(&t->timer_mutex);
+        t->callback_func(t->user_data, ETIMEDOUT);
+        pthread_mutex_lock(&wheel.mutex);
+
+        timer_free(t);
+        wheel.stats.fired++;
+        pthread_cond_broadcast(&wheel.done_cond);
+    }
+}
+
+static void wheel_advance(uint64_t target)
+{
+    while (wheel.now < target) {
+        uint64_t next = wheel_next_tick();
+        int level;
+
+        if (next > target) {
+            /* nothing to do on the ticks in between */
+            wheel.now = target;
+            break;
+        }
+
+        wheel.now = next;
+        for (level = WHEEL_LEVELS - 1; level > 0; level--) {
+            unsigned int shift = level_shift(level);
+            if (0 == (next & (((uint64_t)1 << shift) - 1))) {
+                wheel_cascade(level, (next >> shift) & (WHEEL_LN_SIZE - 1));
             }
         }
+        wheel_expire(next & (WHEEL_L0_SIZE - 1));
     }
-    pthread_cond_destroy(&t->timer_cond);
+}
 
-    free(t);
-    LOC_LOGD("%s:%d]: Exit\n", __func__, __LINE__);
+static void *timer_thread(void *thread_data)
+{
+    struct timespec ts;
+    (void)thread_data;
+
+    pthread_mutex_lock(&wheel.mutex);
+    while (1) {
+        unsigned int fired = wheel.stats.fired;
+        wheel.stats.wakeups++;
+        wheel_advance(current_tick());
+        if (fired != wheel.stats.fired) {
+            wheel.stats.fire_wakeups++;
+        }
+
+        uint64_t next = wheel_next_tick();
+        int seq = __atomic_load_n(&wheel.wake_seq, __ATOMIC_SEQ_CST);
+        wheel.sleep_until = next;
+        pthread_mutex_unlock(&wheel.mutex);
+
+        if (WHEEL_NEVER == next) {
+            syscall(__NR_futex, &wheel.wake_seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+        } else {
+            uint64_t tick = current_tick();
+            if (next > tick) {
+                ts.tv_sec = (next - tick) / 1000;
+                ts.tv_nsec = ((next - tick) % 1000) * 1000000;
+                syscall(__NR_futex, &wheel.wake_seq, FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+            }
+        }
+
+        pthread_mutex_lock(&wheel.mutex);
+    }
     return NULL;
 }
 
+static void timer_service_init()
+{
+    pthread_attr_t tattr;
+
+    wheel.base_msec = now_msec();
+    wheel.sleep_until = WHEEL_NEVER;
+
+    if (pthread_attr_init(&tattr)) {
+        LOC_LOGE("%s:%d]: Pthread attr init failed\n", __func__, __LINE__);
+        return;
+    }
+    pthread_attr_setdetachstate(&tattr, PTHREAD_CREATE_DETACHED);
+
+    if (pthread_create(&wheel.thread, &tattr, timer_thread, NULL)) {
+        LOC_LOGE("%s:%d]: Could not create thread\n", __func__, __LINE__);
+    } else {
+        pthread_setname_np(wheel.thread, "loc_timer");
+        wheel.started = 1;
+    }
+    pthread_attr_destroy(&tattr);
+}
+
 void* loc_timer_start(unsigned int msec, loc_timer_callback cb_func,
                       void* caller_data)
+{
+    return loc_timer_start_slack(msec, 0, cb_func, caller_data);
+}
+
+void* loc_timer_start_slack(unsigned int msec, unsigned int slack_msec,
+                            loc_timer_callback cb_func, void* caller_data)
 {
     timer_data *t=NULL;
-    pthread_attr_t tattr;
-    pthread_t id;
+    void* handle = NULL;
     LOC_LOGD("%s:%d]: Enter\n", __func__, __LINE__);
     if(cb_func == NULL || msec == 0) {
         LOC_LOGE("%s:%d]: Error: Wrong parameters\n", __func__, __LINE__);
         goto _err;
     }
-    t = (timer_data *)calloc(1, sizeof(timer_data));
+
+    pthread_once(&wheel_once, timer_service_init);
+    if (!wheel.started) {
+        LOC_LOGE("%s:%d]: No timer thread\n", __func__, __LINE__);
+        goto _err;
+    }
+
+    pthread_mutex_lock(&wheel.mutex);
+    t = timer_alloc();
     if(t == NULL) {
+        pthread_mutex_unlock(&wheel.mutex);
         LOC_LOGE("%s:%d]: Could not allocate memory. Failing.\n",
                  __func__, __LINE__);
         goto _err;
     }
 
-    if(pthread_cond_init(&(t->timer_cond), NULL)) {
-        LOC_LOGE("%s:%d]: Pthread cond init failed\n", __func__, __LINE__);
-        goto t_err;
-    }
-    if(pthread_mutex_init(&(t->timer_mutex), NULL)) {
-        LOC_LOGE("%s:%d]: Pthread mutex init failed\n", __func__, __LINE__);
-        goto cond_err;
-    }
-
     t->callback_func = cb_func;
     t->user_data = caller_data;
-    t->time_msec = msec;
-    t->state = READY;
-
-    if (pthread_attr_init(&tattr)) {
-        LOC_LOGE("%s:%d]: Pthread mutex init failed\n", __func__, __LINE__);
-        goto mutex_err;
+    t->expires = current_tick() + msec;
+    if (slack_msec) {
+        uint64_t expires = apply_slack(t->expires, slack_msec);
+        if (expires != t->expires) {
+            t->expires = expires;
+            wheel.stats.slacked++;
+        }
     }
-    pthread_attr_setdetachstate(&tattr, PTHREAD_CREATE_DETACHED);
+    t->state = PENDING;
+    wheel_add(t);
+    handle = (void*)(uintptr_t)((t->gen << TIMER_INDEX_BITS) | t->index);
 
-    if(pthread_create(&(id), &tattr, timer_thread, (void *)t)) {
-        LOC_LOGE("%s:%d]: Could not create thread\n", __func__, __LINE__);
-        goto attr_err;
+    /* the service thread may sleep past the new timer */
+    if (t->expires < wheel.sleep_until) {
+        wheel.sleep_until = t->expires;
+        __atomic_add_fetch(&wheel.wake_seq, 1, __ATOMIC_SEQ_CST);
+        syscall(__NR_futex, &wheel.wake_seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
     }
+    pthread_mutex_unlock(&wheel.mutex);
 
-    LOC_LOGD("%s:%d]: Created thread with id: %d\n",
-             __func__, __LINE__, (int)id);
-    goto _err;
-
-attr_err:
-    pthread_attr_destroy(&tattr);
-mutex_err:
-    pthread_mutex_destroy(&t->timer_mutex);
-cond_err:
-    pthread_cond_destroy(&t->timer_cond);
-t_err:
-    free(t);
 _err:
     LOC_LOGD("%s:%d]: Exit\n", __func__, __LINE__);
-    return t;
+    return handle;
 }
 
 void loc_timer_stop(void* handle) {
-    timer_data* t = (timer_data*)handle;
+    timer_data* t;
 
-    if (NULL != t && (READY == t->state || WAITING == t->state) &&
-        pthread_mutex_lock(&(t->timer_mutex)) == 0) {
-        if (READY == t->state || WAITING == t->state) {
-            pthread_cond_signal(&t->timer_cond);
-            t->state = ABORT;
+    if (NULL == handle || !wheel.started) {
+        return;
+    }
+
+    pthread_mutex_lock(&wheel.mutex);
+    t = timer_lookup(handle);
+    if (NULL != t) {
+        if (PENDING == t->state) {
+            /* no need to wake the service thread, it just wakes for nothing */
+            wheel_del(t);
+            timer_free(t);
+            LOC_LOGV("%s:%d]: loc_timer stopped",  __func__, __LINE__);
+        } else if (!pthread_equal(pthread_self(), wheel.thread)) {
+            /* the callback is running; once stopped, it must be done */
+            uint32_t gen = t->gen;
+            while (gen == t->gen) {
+                pthread_cond_wait(&wheel.done_cond, &wheel.mutex);
+            }
         }
-        pthread_mutex_unlock(&(t->timer_mutex));
     }
+    pthread_mutex_unlock(&wheel.mutex);
+}
+
+void loc_timer_get_stats(loc_timer_stats_s_type* stats)
+{
+    if (NULL == stats) {
+        LOC_LOGE("%s:%d]: Error: Wrong parameters\n", __func__, __LINE__);
+        return;
+    }
+    pthread_mutex_lock(&wheel.mutex);
+    *stats = wheel.stats;
+    pthread_mutex_unlock(&wheel.mutex);
 }
@@ -51,11 +51,34 @@ void* loc_timer_start(unsigned int delay_msec,
                       loc_timer_callback,
                       void* user_data);
 
+/*
+  Same as loc_timer_start, but the timer may fire up to slack_msec late,
+  which lets timers due at about the same time share a wakeup
+*/
+void* loc_timer_start_slack(unsigned int delay_msec,
+                            unsigned int slack_msec,
+                            loc_timer_callback,
+                            void* user_data);
+
 /*
   handle becomes invalid upon the return of the callback
 */
 void loc_timer_stop(void* handle);
 
+typedef struct {
+    /* times the timer thread woke up */
+    unsigned int wakeups;
+    /* timers that fired */
+    unsigned int fired;
+    /* wakeups that fired timers; fired - fire_wakeups wakeups were saved
+       by timers firing together */
+    unsigned int fire_wakeups;
+    /* timers whose deadline was moved within their slack */
+    unsigned int slacked;
+} loc_timer_stats_s_type;
+
+void loc_timer_get_stats(loc_timer_stats_s_type* stats);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,134 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures how many timers per second loc_timer starts and stops, the
+   way AGPS retries use them: most get stopped before they are due, the
+   rest fire. Usage: loc_timer_bench [threads] [timers per thread] [slack] */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<unistd.h>
+#include<time.h>
+#include "loc_timer.h"
+
+#define BENCH_MAX_THREADS 16
+/* one in this many timers is left to fire */
+#define BENCH_FIRE_RATIO 8
+
+static unsigned int bench_timers = 10000;
+static unsigned int bench_slack = 0;
+static int bench_fired = 0;
+static int bench_failed = 0;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bench_callback(void *user_data, int result)
+{
+    (void)user_data;
+    (void)result;
+    __atomic_add_fetch(&bench_fired, 1, __ATOMIC_RELAXED);
+}
+
+static void *bench_thread(void *arg)
+{
+    void** handles = (void**)calloc(bench_timers, sizeof(void*));
+    unsigned int seed = (unsigned int)(uintptr_t)arg;
+    unsigned int i;
+
+    if (NULL == handles) {
+        return NULL;
+    }
+    for (i = 0; i < bench_timers; i++) {
+        handles[i] = loc_timer_start_slack(1 + rand_r(&seed) % 1000, bench_slack,
+                                           bench_callback, NULL);
+        if (NULL == handles[i]) {
+            __atomic_add_fetch(&bench_failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    for (i = 0; i < bench_timers; i++) {
+        if (i % BENCH_FIRE_RATIO) {
+            loc_timer_stop(handles[i]);
+        }
+    }
+    free(handles);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+    int thread_cnt = argc > 1 ? atoi(argv[1]) : 4;
+    int i;
+
+    if (argc > 2) {
+        bench_timers = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        bench_slack = atoi(argv[3]);
+    }
+    if (thread_cnt < 1 || thread_cnt > BENCH_MAX_THREADS || bench_timers < 1) {
+        fprintf(stderr, "usage: %s [threads 1..%d] [timers per thread] [slack msec]\n",
+                argv[0], BENCH_MAX_THREADS);
+        return 1;
+    }
+
+    uint64_t start = bench_usec();
+    for (i = 0; i < thread_cnt; i++) {
+        pthread_create(&threads[i], NULL, bench_thread, (void*)(uintptr_t)(i + 1));
+    }
+    for (i = 0; i < thread_cnt; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t elapsed = bench_usec() - start;
+    unsigned int total = thread_cnt * bench_timers;
+
+    printf("%u timers started and %u stopped by %d threads in %llu usec\n",
+           total, total - (total + BENCH_FIRE_RATIO - 1) / BENCH_FIRE_RATIO,
+           thread_cnt, (unsigned long long)elapsed);
+    printf("%.0f timers started per second, %d failed to start\n",
+           elapsed ? total * 1000000.0 / elapsed : 0.0,
+           __atomic_load_n(&bench_failed, __ATOMIC_RELAXED));
+
+    /* let the rest fire */
+    sleep(2);
+    printf("%d timers fired\n", __atomic_load_n(&bench_fired, __ATOMIC_RELAXED));
+
+    loc_timer_stats_s_type stats;
+    loc_timer_get_stats(&stats);
+    printf("%u wakeups, %u of them firing %u timers, %u wakeups saved, "
+           "%u timers slacked\n", stats.wakeups, stats.fire_wakeups,
+           stats.fired, stats.fired - stats.fire_wakeups, stats.slacked);
+    return 0;
+}
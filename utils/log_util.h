@@ -61,8 +61,25 @@ typedef struct loc_logger_s
 {
   unsigned long  DEBUG_LEVEL;
   unsigned long  TIMESTAMP;
+  unsigned long  RING;          /* messages go through loc_log_ring_write */
 } loc_logger_s_type;
 
+/* A LOC_LOGx call site, for loc_log_ring_write. The argument types of
+   its format are worked out on the first call. */
+#define LOC_LOG_SITE_MAX_ARGS 16
+
+typedef struct loc_log_site_s
+{
+  const char    *tag;
+  const char    *fmt;
+  int            state;         /* see loc_log_ring.cpp */
+  unsigned char  arg_count;
+  unsigned char  arg_types[LOC_LOG_SITE_MAX_ARGS];
+  short          arg_precisions[LOC_LOG_SITE_MAX_ARGS];
+} loc_log_site_s_type;
+
+#define LOC_LOG_SITE_INIT { LOG_TAG, 0, 0, 0, { 0 }, { 0 } }
+
 /*=============================================================================
  *
  *                               EXTERNAL DATA
@@ -89,6 +106,14 @@ extern const char ENTRY_TAG[];
 extern void loc_logger_init(unsigned long debug, unsigned long timestamp);
 extern char* get_timestamp(char* str, unsigned long buf_size);
 
+/* Binary log ring, see loc_log_ring.cpp. ring_size is the size of the
+   ring of each thread, 0 to format messages where they are logged, and
+   file where the drainer writes them, NULL or "" for logcat. */
+extern void loc_log_ring_init(unsigned long ring_size, const char* file);
+extern void loc_log_ring_write(loc_log_site_s_type* site, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+extern void loc_log_ring_flush(void);
+
 #ifndef DEBUG_DMN_LOC_API
 
 /* LOGGING MACROS */
@@ -106,24 +131,32 @@ extern char* get_timestamp(char* str, unsigned long buf_size);
 
 #define IF_LOC_LOGV if((loc_logger.DEBUG_LEVEL >= 5) && (loc_logger.DEBUG_LEVEL <= 5))
 
+/* With the ring on, only the format and the arguments are copied
+   where a message is logged; it is formatted by the drainer thread */
+#define LOC_LOG_OUT(...) \
+if (loc_logger.RING) { \
+    static loc_log_site_s_type loc_log_site = LOC_LOG_SITE_INIT; \
+    loc_log_ring_write(&loc_log_site, __VA_ARGS__); \
+} else { ALOGE(__VA_ARGS__); }
+
 #define LOC_LOGE(...) \
-IF_LOC_LOGE { ALOGE("E/" __VA_ARGS__); } \
+IF_LOC_LOGE { LOC_LOG_OUT("E/" __VA_ARGS__); } \
 else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGE("E/" __VA_ARGS__); }
 
 #define LOC_LOGW(...) \
-IF_LOC_LOGW { ALOGE("W/" __VA_ARGS__); }  \
+IF_LOC_LOGW { LOC_LOG_OUT("W/" __VA_ARGS__); }  \
 else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGW("W/" __VA_ARGS__); }
 
 #define LOC_LOGI(...) \
-IF_LOC_LOGI { ALOGE("I/" __VA_ARGS__); }   \
+IF_LOC_LOGI { LOC_LOG_OUT("I/" __VA_ARGS__); }   \
 else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGI("I/" __VA_ARGS__); }
 
 #define LOC_LOGD(...) \
-IF_LOC_LOGD { ALOGE("D/" __VA_ARGS__); }   \
+IF_LOC_LOGD { LOC_LOG_OUT("D/" __VA_ARGS__); }   \
 else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGD("D/" __VA_ARGS__); }
 
 #define LOC_LOGV(...) \
-IF_LOC_LOGV { ALOGE("V/" __VA_ARGS__); }   \
+IF_LOC_LOGV { LOC_LOG_OUT("V/" __VA_ARGS__); }   \
 else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGV("V/" __VA_ARGS__); }
 
 #else /* DEBUG_DMN_LOC_API */
@@ -145,9 +178,10 @@ else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGV("V/" __VA_ARGS__); }
  *                          LOGGING IMPROVEMENT MACROS
  *
  *============================================================================*/
+/* the ring stamps its messages itself */
 #define LOG_(LOC_LOG, ID, WHAT, SPEC, VAL)                                    \
     do {                                                                      \
-        if (loc_logger.TIMESTAMP) {                                           \
+        if (loc_logger.TIMESTAMP && !loc_logger.RING) {                       \
             char ts[32];                                                      \
             LOC_LOG("[%s] %s %s line %d " #SPEC,                              \
                      get_timestamp(ts, sizeof(ts)), ID, WHAT, __LINE__, VAL); \
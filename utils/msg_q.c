@@ -31,57 +31,535 @@
 #define LOG_TAG "LocSvc_utils_q"
 #include "log_util.h"
 #include "platform_lib_includes.h"
-#include "linked_list.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* The queue is an intrusive multi-producer / single-consumer list in the
+   style of D. Vyukov's MPSC queue. Producers only do an atomic exchange on
+   head and never take a lock; the consumer pops from tail. The consumer
+   side is serialized with rcv_mutex, so msg_q_rcv and msg_q_flush remain
+   safe to call from more than one thread. A consumer finding the queue
+   empty parks on the futex_seq futex, and producers only make the wake
+   syscall when waiters says somebody is parked.
+
+   Nodes are msg_q_link's. msg_q_snd_link queues a link embedded in the
+   caller's object; msg_q_snd allocates one on the caller's behalf and
+   tags it with MSG_Q_LINK_ALLOCATED so that msg_q_rcv frees it again.
+
+   There is one such list (lane) per msg_q_prio_type. The consumer serves
+   the high lane first, but after MSG_Q_HIGH_BURST high priority links in
+   a row it lets one waiting normal priority link through, so a steady
+   stream of high priority traffic cannot starve the normal lane.
+
+   Links with the same order_key must still be received in the order they
+   were sent. Each key has an entry in orders with the number of its links
+   queued and the lane they are in. A link whose key has links queued joins
+   their lane, whatever its prio, so priority only ever reorders links of
+   different keys. Entries are handed out on a key's first send and kept
+   for the life of the queue; keys beyond MSG_Q_ORDER_KEYS all go in the
+   normal lane.
+
+   A queue with a capacity counts the links it holds. Senders reserve their
+   place in count before pushing and the consumer gives it back on taking a
+   link out. A sender finding the queue full either parks on the space_seq
+   futex, fails, or makes room: it takes rcv_mutex, pops links the way the
+   consumer would and drops the first droppable one. The non-droppable links
+   popped on the way go to the stash, which the consumer serves before the
+   lanes, so their order is kept. */
+#define MSG_Q_LINK_ALLOCATED 0x1
+#define MSG_Q_LINK_ORDERED   0x10   /* counted in the entry of its order_key */
+#define MSG_Q_LINK_SENDER_FLAGS (MSG_Q_LINK_DROPPABLE | MSG_Q_LINK_NOBLOCK | \
+                                 MSG_Q_LINK_UNORDERED)
+
+#define MSG_Q_HIGH_BURST 8
+#define MSG_Q_ORDER_KEYS 16
+
+typedef struct msg_q_order {
+   const void* key;
+   unsigned int state;              /* Links queued << 1 | the lane they are in */
+} msg_q_order;
+
+typedef struct msg_q_lane {
+   msg_q_link* head;                /* Newest node, producers push here */
+   msg_q_link* tail;                /* Oldest node, consumer pops here */
+   msg_q_link stub;                 /* Placeholder keeping the list non-empty */
+} msg_q_lane;
 
 typedef struct msg_q {
-   void* msg_list;                  /* Linked list to store information */
-   pthread_cond_t  list_cond;       /* Condition variable for waiting on msg queue */
-   pthread_mutex_t list_mutex;      /* Mutex for exclusive access to message queue */
+   msg_q_lane lanes[MSG_Q_PRIO_NUM]; /* One FIFO per priority */
+   unsigned int high_burst;         /* High priority links popped in a row */
+   pthread_mutex_t rcv_mutex;       /* Serializes consumers of the queue */
+   int futex_seq;                   /* Futex word, bumped to wake parked consumers */
+   int waiters;                     /* Number of consumers parked on futex_seq */
    int unblocked;                   /* Has this message queue been unblocked? */
+   msg_q_link* stash_head;          /* Links popped to make room, served first */
+   msg_q_link* stash_tail;
+   unsigned int capacity;           /* Most links to hold, 0 for no bound */
+   int policy;                      /* msg_q_overflow_type at capacity */
+   int space_seq;                   /* Futex word, bumped to wake parked senders */
+   int space_waiters;               /* Number of senders parked on space_seq */
+   msg_q_stats_type stats;          /* Occupancy counters, count included */
+   msg_q_order orders[MSG_Q_ORDER_KEYS]; /* Order keys seen so far */
+   unsigned int order_cnt;          /* Entries of orders in use */
+   pthread_mutex_t order_mutex;     /* Serializes handing out entries */
 } msg_q;
 
+/* Returned by msg_q_pop while a producer is half way through a push */
+#define MSG_Q_LINK_BUSY ((msg_q_link*)-1)
+
+/*===========================================================================
+FUNCTION    msg_q_futex_wait / msg_q_futex_wake
+
+DESCRIPTION
+   Thin wrappers around the futex syscall on the futex_seq word of a queue.
+   A wait gives up after timeout, unless it is NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_futex_wait(int* addr, int val, const struct timespec* timeout)
+{
+   syscall(__NR_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, NULL, 0);
+}
+
+static void msg_q_futex_wake(int* addr, int cnt)
+{
+   syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, cnt, NULL, NULL, 0);
+}
+
+/*===========================================================================
+FUNCTION    msg_q_push
+
+DESCRIPTION
+   Links a node at the head of a lane. Lock free, may be called from any
+   number of threads concurrently.
+
+   lane:    Lane to push the node into.
+   node:    Node to push.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_push(msg_q_lane* lane, msg_q_link* node)
+{
+   msg_q_link* prev;
+
+   __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+   prev = __atomic_exchange_n(&lane->head, node, __ATOMIC_SEQ_CST);
+   /* Between the exchange and this store the list is momentarily
+      disconnected; msg_q_pop reports that as MSG_Q_LINK_BUSY. */
+   __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
 /*===========================================================================
-FUNCTION    convert_linked_list_err_type
+FUNCTION    msg_q_pop
 
 DESCRIPTION
-   Converts from one set of enum values to another.
+   Unlinks the oldest node of a lane. Must be called with rcv_mutex held.
 
-   linked_list_val: Value to convert to msg_q_enum_type
+   lane:    Lane to pop the node from.
 
 DEPENDENCIES
    N/A
 
 RETURN VALUE
-   Corresponding linked_list_enum_type in msg_q_enum_type
+   The oldest node; NULL if the lane is empty; MSG_Q_LINK_BUSY if a
+   producer is in the middle of a push and the caller should retry.
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-static msq_q_err_type convert_linked_list_err_type(linked_list_err_type linked_list_val)
+static msg_q_link* msg_q_pop(msg_q_lane* lane)
 {
-   switch( linked_list_val )
+   msg_q_link* tail = lane->tail;
+   msg_q_link* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+   if( tail == &lane->stub )
    {
-   case eLINKED_LIST_SUCCESS:
-      return eMSG_Q_SUCCESS;
-   case eLINKED_LIST_INVALID_PARAMETER:
-      return eMSG_Q_INVALID_PARAMETER;
-   case eLINKED_LIST_INVALID_HANDLE:
-      return eMSG_Q_INVALID_HANDLE;
-   case eLINKED_LIST_UNAVAILABLE_RESOURCE:
-      return eMSG_Q_UNAVAILABLE_RESOURCE;
-   case eLINKED_LIST_INSUFFICIENT_BUFFER:
-      return eMSG_Q_INSUFFICIENT_BUFFER;
+      if( next == NULL )
+      {
+         return __atomic_load_n(&lane->head, __ATOMIC_SEQ_CST) == tail ?
+                NULL : MSG_Q_LINK_BUSY;
+      }
+      /* Skip over the stub */
+      lane->tail = next;
+      tail = next;
+      next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+   }
 
-   case eLINKED_LIST_FAILURE_GENERAL:
-   default:
-      return eMSG_Q_FAILURE_GENERAL;
+   if( next != NULL )
+   {
+      lane->tail = next;
+      return tail;
+   }
+
+   if( tail != __atomic_load_n(&lane->head, __ATOMIC_SEQ_CST) )
+   {
+      return MSG_Q_LINK_BUSY;
+   }
+
+   /* tail is the only node left, put the stub behind it so it can go */
+   msg_q_push(lane, &lane->stub);
+
+   next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+   if( next != NULL )
+   {
+      lane->tail = next;
+      return tail;
+   }
+
+   return MSG_Q_LINK_BUSY;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_lane_empty
+
+DESCRIPTION
+   Checks whether a lane holds no node, not even one still being pushed.
+   Must be called with rcv_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if empty; 0 otherwise
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_lane_empty(msg_q_lane* lane)
+{
+   return lane->tail == &lane->stub &&
+          __atomic_load_n(&lane->head, __ATOMIC_SEQ_CST) == &lane->stub;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_pop_next
+
+DESCRIPTION
+   Unlinks the next node to be served, picking the lane by priority with
+   starvation protection for the normal lane. Must be called with
+   rcv_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Same as msg_q_pop
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_link* msg_q_pop_next(msg_q* p_msg_q)
+{
+   msg_q_lane* high = &p_msg_q->lanes[eMSG_Q_PRIO_HIGH];
+   msg_q_lane* normal = &p_msg_q->lanes[eMSG_Q_PRIO_NORMAL];
+   msg_q_link* node;
+   msg_q_link* other;
+
+   if( p_msg_q->high_burst >= MSG_Q_HIGH_BURST )
+   {
+      /* the normal lane had its turn skipped often enough */
+      node = msg_q_pop(normal);
+      if( node != NULL && node != MSG_Q_LINK_BUSY )
+      {
+         p_msg_q->high_burst = 0;
+         return node;
+      }
+   }
+
+   node = msg_q_pop(high);
+   if( node != NULL && node != MSG_Q_LINK_BUSY )
+   {
+      /* only count the burst while somebody is waiting behind it */
+      if( !msg_q_lane_empty(normal) )
+      {
+         p_msg_q->high_burst++;
+      }
+      return node;
+   }
+
+   other = msg_q_pop(normal);
+   if( other != NULL && other != MSG_Q_LINK_BUSY )
+   {
+      p_msg_q->high_burst = 0;
+      return other;
+   }
+
+   return (node == MSG_Q_LINK_BUSY || other == MSG_Q_LINK_BUSY) ?
+          MSG_Q_LINK_BUSY : NULL;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_raise_high_water
+
+DESCRIPTION
+   Records count as the high water mark if it is a new one.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_raise_high_water(msg_q* p_msg_q, unsigned int count)
+{
+   unsigned int high = __atomic_load_n(&p_msg_q->stats.high_water, __ATOMIC_RELAXED);
+   while( count > high &&
+          !__atomic_compare_exchange_n(&p_msg_q->stats.high_water, &high, count,
+                                       1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+}
+
+/*===========================================================================
+FUNCTION    msg_q_order_find
+
+DESCRIPTION
+   Looks up the entry of an order key, handing out a new one on the key's
+   first send.
+
+   p_msg_q: Message queue the key is used on.
+   key:     Order key of a link.
+   add:     Whether to hand out an entry if there is none yet.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The entry; NULL if there is none, and no more can be handed out.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_order* msg_q_order_find(msg_q* p_msg_q, const void* key, int add)
+{
+   unsigned int cnt = __atomic_load_n(&p_msg_q->order_cnt, __ATOMIC_ACQUIRE);
+   unsigned int i;
+
+   for( i = 0; i < cnt; i++ )
+   {
+      if( p_msg_q->orders[i].key == key )
+      {
+         return &p_msg_q->orders[i];
+      }
+   }
+   if( !add )
+   {
+      return NULL;
+   }
+
+   /* Only one sender at a time may add, or a key could get two entries */
+   msg_q_order* order = NULL;
+   pthread_mutex_lock(&p_msg_q->order_mutex);
+   for( cnt = p_msg_q->order_cnt; i < cnt; i++ )
+   {
+      if( p_msg_q->orders[i].key == key )
+      {
+         order = &p_msg_q->orders[i];
+         break;
+      }
+   }
+   if( order == NULL && cnt < MSG_Q_ORDER_KEYS )
+   {
+      order = &p_msg_q->orders[cnt];
+      order->key = key;
+      order->state = 0;
+      __atomic_store_n(&p_msg_q->order_cnt, cnt + 1, __ATOMIC_RELEASE);
+   }
+   pthread_mutex_unlock(&p_msg_q->order_mutex);
+
+   if( order == NULL )
+   {
+      LOC_LOGW("%s: more than %d order keys, %p queued in the normal lane\n",
+               __FUNCTION__, MSG_Q_ORDER_KEYS, key);
+   }
+   return order;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_order_lane
+
+DESCRIPTION
+   Picks the lane of a link being sent: its prio, unless links of its
+   order_key are still queued, in which case it joins them. Counts the
+   link in the entry of its key until msg_q_order_release.
+
+   p_msg_q: Message queue the link is sent to.
+   link:    Link being sent, admitted already.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The lane
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_prio_type msg_q_order_lane(msg_q* p_msg_q, msg_q_link* link)
+{
+   if( link->flags & MSG_Q_LINK_UNORDERED )
+   {
+      return link->prio;
+   }
+
+   msg_q_order* order = msg_q_order_find(p_msg_q, link->order_key, 1);
+   if( order == NULL )
+   {
+      return eMSG_Q_PRIO_NORMAL;
+   }
+
+   unsigned int state = __atomic_load_n(&order->state, __ATOMIC_ACQUIRE);
+   unsigned int lane;
+   do
+   {
+      lane = (state >> 1) == 0 ? (unsigned int)link->prio : (state & 1);
+   } while( !__atomic_compare_exchange_n(&order->state, &state,
+                                         (((state >> 1) + 1) << 1) | lane, 1,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) );
+
+   link->flags |= MSG_Q_LINK_ORDERED;
+   return (msg_q_prio_type)lane;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_order_release
+
+DESCRIPTION
+   Uncounts a link taken out of the queue from the entry of its order_key.
+
+   p_msg_q: Message queue the link was taken out of.
+   link:    Link taken out, still valid.
+
+DEPENDENCIES
+   rcv_mutex held
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_order_release(msg_q* p_msg_q, msg_q_link* link)
+{
+   if( link->flags & MSG_Q_LINK_ORDERED )
+   {
+      msg_q_order* order = msg_q_order_find(p_msg_q, link->order_key, 0);
+      if( order != NULL )
+      {
+         __atomic_sub_fetch(&order->state, 2, __ATOMIC_ACQ_REL);
+      }
    }
 }
 
+/*===========================================================================
+FUNCTION    msg_q_take
+
+DESCRIPTION
+   Takes the next link out of the queue for the consumer, the stash before
+   the lanes, and gives its place back to parked senders. Must be called
+   with rcv_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Same as msg_q_pop
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_link* msg_q_take(msg_q* p_msg_q)
+{
+   msg_q_link* node = p_msg_q->stash_head;
+
+   if( node != NULL )
+   {
+      p_msg_q->stash_head = node->next;
+      if( p_msg_q->stash_head == NULL )
+      {
+         p_msg_q->stash_tail = NULL;
+      }
+   }
+   else
+   {
+      node = msg_q_pop_next(p_msg_q);
+      if( node == NULL || node == MSG_Q_LINK_BUSY )
+      {
+         return node;
+      }
+   }
+
+   msg_q_order_release(p_msg_q, node);
+   __atomic_sub_fetch(&p_msg_q->stats.count, 1, __ATOMIC_SEQ_CST);
+   if( __atomic_load_n(&p_msg_q->space_waiters, __ATOMIC_SEQ_CST) > 0 )
+   {
+      __atomic_add_fetch(&p_msg_q->space_seq, 1, __ATOMIC_SEQ_CST);
+      msg_q_futex_wake(&p_msg_q->space_seq, 1);
+   }
+
+   return node;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_pop_wait
+
+DESCRIPTION
+   Same as msg_q_take, but rides out the short window of a producer push
+   in progress. Must be called with rcv_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The oldest node; NULL if the queue is empty.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_link* msg_q_pop_wait(msg_q* p_msg_q)
+{
+   msg_q_link* node;
+   while( (node = msg_q_take(p_msg_q)) == MSG_Q_LINK_BUSY )
+   {
+      sched_yield();
+   }
+   return node;
+}
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -105,31 +583,40 @@ msq_q_err_type msg_q_init(void** msg_q_data)
       return eMSG_Q_FAILURE_GENERAL;
    }
 
-   if( linked_list_init(&tmp_msg_q->msg_list) != 0 )
+   if( pthread_mutex_init(&tmp_msg_q->rcv_mutex, NULL) != 0 )
    {
-      LOC_LOGE("%s: Unable to initialize storage list!\n", __FUNCTION__);
+      LOC_LOGE("%s: Unable to initialize rcv mutex!\n", __FUNCTION__);
       free(tmp_msg_q);
       return eMSG_Q_FAILURE_GENERAL;
    }
 
-   if( pthread_mutex_init(&tmp_msg_q->list_mutex, NULL) != 0 )
+   if( pthread_mutex_init(&tmp_msg_q->order_mutex, NULL) != 0 )
    {
-      LOC_LOGE("%s: Unable to initialize list mutex!\n", __FUNCTION__);
-      linked_list_destroy(&tmp_msg_q->msg_list);
+      LOC_LOGE("%s: Unable to initialize order mutex!\n", __FUNCTION__);
+      pthread_mutex_destroy(&tmp_msg_q->rcv_mutex);
       free(tmp_msg_q);
       return eMSG_Q_FAILURE_GENERAL;
    }
 
-   if( pthread_cond_init(&tmp_msg_q->list_cond, NULL) != 0 )
+   int i;
+   for( i = 0; i < MSG_Q_PRIO_NUM; i++ )
    {
-      LOC_LOGE("%s: Unable to initialize msg q cond var!\n", __FUNCTION__);
-      linked_list_destroy(&tmp_msg_q->msg_list);
-      pthread_mutex_destroy(&tmp_msg_q->list_mutex);
-      free(tmp_msg_q);
-      return eMSG_Q_FAILURE_GENERAL;
+      msg_q_lane* lane = &tmp_msg_q->lanes[i];
+      lane->stub.next = NULL;
+      lane->head = &lane->stub;
+      lane->tail = &lane->stub;
    }
-
+   tmp_msg_q->high_burst = 0;
+   tmp_msg_q->futex_seq = 0;
+   tmp_msg_q->waiters = 0;
    tmp_msg_q->unblocked = 0;
+   tmp_msg_q->stash_head = NULL;
+   tmp_msg_q->stash_tail = NULL;
+   tmp_msg_q->capacity = 0;
+   tmp_msg_q->policy = eMSG_Q_OVERFLOW_BLOCK;
+   tmp_msg_q->space_seq = 0;
+   tmp_msg_q->space_waiters = 0;
+   memset(&tmp_msg_q->stats, 0, sizeof(tmp_msg_q->stats));
 
    *msg_q_data = tmp_msg_q;
 
@@ -165,9 +652,9 @@ msq_q_err_type msg_q_destroy(void** msg_q_data)
 
    msg_q* p_msg_q = (msg_q*)*msg_q_data;
 
-   linked_list_destroy(&p_msg_q->msg_list);
-   pthread_mutex_destroy(&p_msg_q->list_mutex);
-   pthread_cond_destroy(&p_msg_q->list_cond);
+   msg_q_flush(p_msg_q);
+   pthread_mutex_destroy(&p_msg_q->rcv_mutex);
+   pthread_mutex_destroy(&p_msg_q->order_mutex);
 
    p_msg_q->unblocked = 0;
 
@@ -177,6 +664,276 @@ msq_q_err_type msg_q_destroy(void** msg_q_data)
    return eMSG_Q_SUCCESS;
 }
 
+/*===========================================================================
+FUNCTION    msg_q_dealloc_link
+
+DESCRIPTION
+   Deallocates the object carried by a link that was popped from the queue,
+   followed by the link itself if it was allocated by msg_q_snd.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_dealloc_link(msg_q_link* link)
+{
+   /* the link may live inside msg_obj, so read it out before dealloc */
+   int allocated = link->flags & MSG_Q_LINK_ALLOCATED;
+   void* msg_obj = link->msg_obj;
+   void (*dealloc)(void*) = link->dealloc;
+
+   if( allocated )
+   {
+      free(link);
+   }
+
+   /* Free data pointer if told to do so. */
+   if( dealloc != NULL )
+   {
+      dealloc(msg_obj);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_overcommit
+
+DESCRIPTION
+   Lets a link into a full queue over capacity.
+
+   p_msg_q: Message queue the link is sent to.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_SUCCESS
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_overcommit(msg_q* p_msg_q)
+{
+   __atomic_add_fetch(&p_msg_q->stats.overcommitted, 1, __ATOMIC_RELAXED);
+   msg_q_raise_high_water(p_msg_q,
+                          __atomic_add_fetch(&p_msg_q->stats.count, 1, __ATOMIC_SEQ_CST));
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_make_room
+
+DESCRIPTION
+   Makes room in a full queue under eMSG_Q_OVERFLOW_DROP_OLDEST by dropping
+   the oldest droppable link, which hands its place in count over to the
+   link being sent.
+
+   p_msg_q: Message queue to make room in.
+   link:    Link being sent.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_SUCCESS if link may be pushed; eMSG_Q_QUEUE_FULL if it is dropped
+   itself.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_make_room(msg_q* p_msg_q, msg_q_link* link)
+{
+   msg_q_link* node;
+   msg_q_link* victim = NULL;
+
+   /* Act as the consumer. Links on the stash are never droppable, so only
+      the lanes need looking into. */
+   pthread_mutex_lock(&p_msg_q->rcv_mutex);
+   while( (node = msg_q_pop_next(p_msg_q)) != NULL && node != MSG_Q_LINK_BUSY )
+   {
+      if( node->flags & MSG_Q_LINK_DROPPABLE )
+      {
+         victim = node;
+         break;
+      }
+      node->next = NULL;
+      if( p_msg_q->stash_tail != NULL )
+      {
+         p_msg_q->stash_tail->next = node;
+      }
+      else
+      {
+         p_msg_q->stash_head = node;
+      }
+      p_msg_q->stash_tail = node;
+   }
+   pthread_mutex_unlock(&p_msg_q->rcv_mutex);
+
+   if( victim != NULL )
+   {
+      msg_q_order_release(p_msg_q, victim);
+      __atomic_add_fetch(&p_msg_q->stats.dropped, 1, __ATOMIC_RELAXED);
+      msg_q_dealloc_link(victim);
+      return eMSG_Q_SUCCESS;
+   }
+
+   if( link->flags & MSG_Q_LINK_DROPPABLE )
+   {
+      __atomic_add_fetch(&p_msg_q->stats.dropped, 1, __ATOMIC_RELAXED);
+      return eMSG_Q_QUEUE_FULL;
+   }
+
+   /* Nothing may go, so this one has to be let in over capacity */
+   return msg_q_overcommit(p_msg_q);
+}
+
+/*===========================================================================
+FUNCTION    msg_q_admit
+
+DESCRIPTION
+   Reserves the place of a link in the queue count, applying the overflow
+   policy if the queue is at capacity.
+
+   p_msg_q: Message queue the link is sent to.
+   link:    Link being sent.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_SUCCESS if link may be pushed; otherwise look at error codes above.
+
+SIDE EFFECTS
+   May park the calling thread under eMSG_Q_OVERFLOW_BLOCK.
+
+===========================================================================*/
+static msq_q_err_type msg_q_admit(msg_q* p_msg_q, msg_q_link* link)
+{
+   int waited = 0;
+   unsigned int count = __atomic_load_n(&p_msg_q->stats.count, __ATOMIC_SEQ_CST);
+
+   for( ;; )
+   {
+      unsigned int capacity = __atomic_load_n(&p_msg_q->capacity, __ATOMIC_ACQUIRE);
+
+      if( capacity == 0 || count < capacity )
+      {
+         if( __atomic_compare_exchange_n(&p_msg_q->stats.count, &count, count + 1, 1,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) )
+         {
+            msg_q_raise_high_water(p_msg_q, count + 1);
+            return eMSG_Q_SUCCESS;
+         }
+         continue;
+      }
+
+      switch( __atomic_load_n(&p_msg_q->policy, __ATOMIC_ACQUIRE) )
+      {
+      case eMSG_Q_OVERFLOW_REJECT:
+         /* Only what may be lost is, as under eMSG_Q_OVERFLOW_DROP_OLDEST */
+         if( !(link->flags & MSG_Q_LINK_DROPPABLE) )
+         {
+            return msg_q_overcommit(p_msg_q);
+         }
+         __atomic_add_fetch(&p_msg_q->stats.rejected, 1, __ATOMIC_RELAXED);
+         return eMSG_Q_QUEUE_FULL;
+
+      case eMSG_Q_OVERFLOW_DROP_OLDEST:
+         return msg_q_make_room(p_msg_q, link);
+
+      default:
+         if( link->flags & MSG_Q_LINK_NOBLOCK )
+         {
+            return msg_q_overcommit(p_msg_q);
+         }
+
+         if( !waited )
+         {
+            waited = 1;
+            __atomic_add_fetch(&p_msg_q->stats.blocked, 1, __ATOMIC_RELAXED);
+         }
+
+         /* Same handshake as consumers on futex_seq: msg_q_take drops
+            count before it looks at space_waiters. */
+         int seq = __atomic_load_n(&p_msg_q->space_seq, __ATOMIC_SEQ_CST);
+         __atomic_add_fetch(&p_msg_q->space_waiters, 1, __ATOMIC_SEQ_CST);
+         if( !__atomic_load_n(&p_msg_q->unblocked, __ATOMIC_SEQ_CST) &&
+             __atomic_load_n(&p_msg_q->stats.count, __ATOMIC_SEQ_CST) >= capacity )
+         {
+            msg_q_futex_wait(&p_msg_q->space_seq, seq, NULL);
+         }
+         __atomic_sub_fetch(&p_msg_q->space_waiters, 1, __ATOMIC_SEQ_CST);
+
+         if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_SEQ_CST) )
+         {
+            return eMSG_Q_UNAVAILABLE_RESOURCE;
+         }
+         break;
+      }
+
+      count = __atomic_load_n(&p_msg_q->stats.count, __ATOMIC_SEQ_CST);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_enqueue
+
+DESCRIPTION
+   Pushes a link into the queue and wakes up a parked consumer, if any.
+
+   p_msg_q: Message queue to add the link to.
+   link:    Link to add, with msg_obj, dealloc and flags already set.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_enqueue(msg_q* p_msg_q, msg_q_link* link)
+{
+   /* Once pushed, the link may be received and freed at any time */
+   void* msg_obj = link->msg_obj;
+
+   LOC_LOGD("%s: Sending message with handle = %p\n", __FUNCTION__, msg_obj);
+
+   if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   msq_q_err_type rv = msg_q_admit(p_msg_q, link);
+   if( rv != eMSG_Q_SUCCESS )
+   {
+      LOC_LOGW("%s: Message %p not queued, rv = %d\n", __FUNCTION__, msg_obj, rv);
+      return rv;
+   }
+
+   msg_q_push(&p_msg_q->lanes[msg_q_order_lane(p_msg_q, link)], link);
+
+   /* Show data is in the message queue, but only pay for the syscall if
+      a consumer is actually parked. */
+   if( __atomic_load_n(&p_msg_q->waiters, __ATOMIC_SEQ_CST) > 0 )
+   {
+      __atomic_add_fetch(&p_msg_q->futex_seq, 1, __ATOMIC_SEQ_CST);
+      msg_q_futex_wake(&p_msg_q->futex_seq, 1);
+   }
+
+   return eMSG_Q_SUCCESS;
+}
+
 /*===========================================================================
 
   FUNCTION:   msg_q_snd
@@ -196,28 +953,147 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
       return eMSG_Q_INVALID_PARAMETER;
    }
 
-   msg_q* p_msg_q = (msg_q*)msg_q_data;
+   msg_q_link* link = (msg_q_link*)malloc(sizeof(msg_q_link));
+   if( link == NULL )
+   {
+      LOC_LOGE("%s: Memory allocation failed\n", __FUNCTION__);
+      return eMSG_Q_FAILURE_GENERAL;
+   }
+   link->msg_obj = msg_obj;
+   link->dealloc = dealloc;
+   link->order_key = NULL;
+   link->prio = eMSG_Q_PRIO_NORMAL;
+   link->flags = MSG_Q_LINK_ALLOCATED;
+
+   rv = msg_q_enqueue((msg_q*)msg_q_data, link);
+   if( rv != eMSG_Q_SUCCESS )
+   {
+      free(link);
+   }
+
+   return rv;
+}
+
+/*===========================================================================
 
-   pthread_mutex_lock(&p_msg_q->list_mutex);
-   LOC_LOGD("%s: Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+  FUNCTION:   msg_q_snd_link
 
-   if( p_msg_q->unblocked )
+  ===========================================================================*/
+msq_q_err_type msg_q_snd_link(void* msg_q_data, msg_q_link* link)
+{
+   if( msg_q_data == NULL )
    {
-      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
-      pthread_mutex_unlock(&p_msg_q->list_mutex);
-      return eMSG_Q_UNAVAILABLE_RESOURCE;
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+   if( link == NULL || link->msg_obj == NULL ||
+       (unsigned int)link->prio >= MSG_Q_PRIO_NUM )
+   {
+      LOC_LOGE("%s: Invalid link parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
    }
 
-   rv = convert_linked_list_err_type(linked_list_add(p_msg_q->msg_list, msg_obj, dealloc));
+   link->flags &= MSG_Q_LINK_SENDER_FLAGS;
 
-   /* Show data is in the message queue. */
-   pthread_cond_signal(&p_msg_q->list_cond);
+   return msg_q_enqueue((msg_q*)msg_q_data, link);
+}
 
-   pthread_mutex_unlock(&p_msg_q->list_mutex);
+/*===========================================================================
+FUNCTION    msg_q_wait_link
 
-   LOC_LOGD("%s: Finished Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+DESCRIPTION
+   Pops the oldest link of the queue, parking the calling thread until one
+   is available, the queue gets unblocked or the deadline passes. Must be
+   called with rcv_mutex held; the mutex is released while parked.
 
-   return rv;
+   p_msg_q:  Message queue to pop from.
+   deadline: CLOCK_MONOTONIC time to give up at; NULL to wait for good.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The oldest link; NULL if the queue was unblocked while empty or the
+   deadline passed.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_link* msg_q_wait_link(msg_q* p_msg_q, const struct timespec* deadline)
+{
+   msg_q_link* node;
+   struct timespec timeout;
+   while( (node = msg_q_pop_wait(p_msg_q)) == NULL )
+   {
+      if( deadline != NULL )
+      {
+         /* FUTEX_WAIT takes a relative timeout */
+         clock_gettime(CLOCK_MONOTONIC, &timeout);
+         timeout.tv_sec = deadline->tv_sec - timeout.tv_sec;
+         timeout.tv_nsec = deadline->tv_nsec - timeout.tv_nsec;
+         if( timeout.tv_nsec < 0 )
+         {
+            timeout.tv_sec--;
+            timeout.tv_nsec += 1000000000;
+         }
+         if( timeout.tv_sec < 0 )
+         {
+            break;
+         }
+      }
+
+      int seq = __atomic_load_n(&p_msg_q->futex_seq, __ATOMIC_SEQ_CST);
+      __atomic_add_fetch(&p_msg_q->waiters, 1, __ATOMIC_SEQ_CST);
+
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_SEQ_CST) )
+      {
+         __atomic_sub_fetch(&p_msg_q->waiters, 1, __ATOMIC_SEQ_CST);
+         break;
+      }
+
+      /* A producer that pushed before we registered as a waiter is seen
+         here; any later one sees waiters > 0 and bumps futex_seq. */
+      if( p_msg_q->stash_head == NULL &&
+          msg_q_lane_empty(&p_msg_q->lanes[eMSG_Q_PRIO_HIGH]) &&
+          msg_q_lane_empty(&p_msg_q->lanes[eMSG_Q_PRIO_NORMAL]) )
+      {
+         pthread_mutex_unlock(&p_msg_q->rcv_mutex);
+         msg_q_futex_wait(&p_msg_q->futex_seq, seq,
+                          deadline != NULL ? &timeout : NULL);
+         pthread_mutex_lock(&p_msg_q->rcv_mutex);
+      }
+
+      __atomic_sub_fetch(&p_msg_q->waiters, 1, __ATOMIC_SEQ_CST);
+   }
+   return node;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_link_obj
+
+DESCRIPTION
+   Returns the object carried by a link popped from the queue, freeing the
+   link if it was allocated by msg_q_snd.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   msg_obj of the link
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void* msg_q_link_obj(msg_q_link* link)
+{
+   void* msg_obj = link->msg_obj;
+   if( link->flags & MSG_Q_LINK_ALLOCATED )
+   {
+      free(link);
+   }
+   return msg_obj;
 }
 
 /*===========================================================================
@@ -227,7 +1103,7 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
   ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
 {
-   msq_q_err_type rv;
+   msq_q_err_type rv = eMSG_Q_SUCCESS;
    if( msg_q_data == NULL )
    {
       LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
@@ -244,28 +1120,106 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
 
    LOC_LOGD("%s: Waiting on message\n", __FUNCTION__);
 
-   pthread_mutex_lock(&p_msg_q->list_mutex);
-
-   if( p_msg_q->unblocked )
+   if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
    {
       LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
-      pthread_mutex_unlock(&p_msg_q->list_mutex);
       return eMSG_Q_UNAVAILABLE_RESOURCE;
    }
 
+   pthread_mutex_lock(&p_msg_q->rcv_mutex);
+
    /* Wait for data in the message queue */
-   while( linked_list_empty(p_msg_q->msg_list) && !p_msg_q->unblocked )
+   msg_q_link* node = msg_q_wait_link(p_msg_q, NULL);
+
+   pthread_mutex_unlock(&p_msg_q->rcv_mutex);
+
+   if( node != NULL )
+   {
+      *msg_obj = msg_q_link_obj(node);
+      LOC_LOGD("%s: Received message %p\n", __FUNCTION__, *msg_obj);
+   }
+   else
    {
-      pthread_cond_wait(&p_msg_q->list_cond, &p_msg_q->list_mutex);
+      rv = eMSG_Q_UNAVAILABLE_RESOURCE;
+      LOC_LOGD("%s: No message received, rv = %d\n", __FUNCTION__, rv);
    }
 
-   rv = convert_linked_list_err_type(linked_list_remove(p_msg_q->msg_list, msg_obj));
+   return rv;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_rcv_all
+
+  ===========================================================================*/
+msq_q_err_type msg_q_rcv_all(void* msg_q_data, void** msg_objs,
+                             unsigned int max_cnt, unsigned int* rcv_cnt)
+{
+   return msg_q_rcv_all_timeout(msg_q_data, msg_objs, max_cnt, rcv_cnt, -1);
+}
 
-   pthread_mutex_unlock(&p_msg_q->list_mutex);
+/*===========================================================================
 
-   LOC_LOGD("%s: Received message 0x%08X rv = %d\n", __FUNCTION__, *msg_obj, rv);
+  FUNCTION:   msg_q_rcv_all_timeout
 
-   return rv;
+  ===========================================================================*/
+msq_q_err_type msg_q_rcv_all_timeout(void* msg_q_data, void** msg_objs,
+                                     unsigned int max_cnt, unsigned int* rcv_cnt,
+                                     int timeout_msec)
+{
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_objs == NULL || max_cnt == 0 || rcv_cnt == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_objs parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+   *rcv_cnt = 0;
+
+   if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   struct timespec deadline;
+   if( timeout_msec >= 0 )
+   {
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += timeout_msec / 1000;
+      deadline.tv_nsec += (timeout_msec % 1000) * 1000000L;
+      if( deadline.tv_nsec >= 1000000000L )
+      {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000L;
+      }
+   }
+
+   pthread_mutex_lock(&p_msg_q->rcv_mutex);
+
+   /* Wait for the first one, then detach whatever else is pending
+      without giving up the consumer side in between. */
+   msg_q_link* node = msg_q_wait_link(p_msg_q, timeout_msec >= 0 ? &deadline : NULL);
+   while( node != NULL && node != MSG_Q_LINK_BUSY )
+   {
+      msg_objs[(*rcv_cnt)++] = msg_q_link_obj(node);
+      node = *rcv_cnt < max_cnt ? msg_q_take(p_msg_q) : NULL;
+   }
+
+   pthread_mutex_unlock(&p_msg_q->rcv_mutex);
+
+   if( *rcv_cnt > 0 )
+   {
+      return eMSG_Q_SUCCESS;
+   }
+   return __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) ?
+      eMSG_Q_UNAVAILABLE_RESOURCE : eMSG_Q_TIMEOUT;
 }
 
 /*===========================================================================
@@ -275,7 +1229,6 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
   ===========================================================================*/
 msq_q_err_type msg_q_flush(void* msg_q_data)
 {
-   msq_q_err_type rv;
    if ( msg_q_data == NULL )
    {
       LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
@@ -286,16 +1239,20 @@ msq_q_err_type msg_q_flush(void* msg_q_data)
 
    LOC_LOGD("%s: Flushing Message Queue\n", __FUNCTION__);
 
-   pthread_mutex_lock(&p_msg_q->list_mutex);
+   pthread_mutex_lock(&p_msg_q->rcv_mutex);
 
    /* Remove all elements from the list */
-   rv = convert_linked_list_err_type(linked_list_flush(p_msg_q->msg_list));
+   msg_q_link* node;
+   while( (node = msg_q_pop_wait(p_msg_q)) != NULL )
+   {
+      msg_q_dealloc_link(node);
+   }
 
-   pthread_mutex_unlock(&p_msg_q->list_mutex);
+   pthread_mutex_unlock(&p_msg_q->rcv_mutex);
 
    LOC_LOGD("%s: Message Queue flushed\n", __FUNCTION__);
 
-   return rv;
+   return eMSG_Q_SUCCESS;
 }
 
 /*===========================================================================
@@ -312,25 +1269,93 @@ msq_q_err_type msg_q_unblock(void* msg_q_data)
    }
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
-   pthread_mutex_lock(&p_msg_q->list_mutex);
 
-   if( p_msg_q->unblocked )
+   /* The consumer may destroy the queue as soon as it sees it unblocked,
+      which it cannot do without rcv_mutex; parked consumers do not hold it */
+   pthread_mutex_lock(&p_msg_q->rcv_mutex);
+
+   if( __atomic_exchange_n(&p_msg_q->unblocked, 1, __ATOMIC_SEQ_CST) )
    {
+      pthread_mutex_unlock(&p_msg_q->rcv_mutex);
       LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
-      pthread_mutex_unlock(&p_msg_q->list_mutex);
       return eMSG_Q_UNAVAILABLE_RESOURCE;
    }
 
    LOC_LOGD("%s: Unblocking Message Queue\n", __FUNCTION__);
-   /* Unblocking message queue */
-   p_msg_q->unblocked = 1;
 
-   /* Allow all the waiters to wake up */
-   pthread_cond_broadcast(&p_msg_q->list_cond);
+   /* Allow all the waiters to wake up, senders parked on a full queue too */
+   __atomic_add_fetch(&p_msg_q->futex_seq, 1, __ATOMIC_SEQ_CST);
+   msg_q_futex_wake(&p_msg_q->futex_seq, INT_MAX);
+   __atomic_add_fetch(&p_msg_q->space_seq, 1, __ATOMIC_SEQ_CST);
+   msg_q_futex_wake(&p_msg_q->space_seq, INT_MAX);
 
-   pthread_mutex_unlock(&p_msg_q->list_mutex);
+   pthread_mutex_unlock(&p_msg_q->rcv_mutex);
 
    LOC_LOGD("%s: Message Queue unblocked\n", __FUNCTION__);
 
    return eMSG_Q_SUCCESS;
 }
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_set_capacity
+
+  ===========================================================================*/
+msq_q_err_type msg_q_set_capacity(void* msg_q_data, unsigned int capacity,
+                                  msg_q_overflow_type policy)
+{
+   if ( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+   if( policy != eMSG_Q_OVERFLOW_BLOCK && policy != eMSG_Q_OVERFLOW_DROP_OLDEST &&
+       policy != eMSG_Q_OVERFLOW_REJECT )
+   {
+      LOC_LOGE("%s: Invalid policy parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   LOC_LOGD("%s: capacity %u policy %d\n", __FUNCTION__, capacity, policy);
+
+   __atomic_store_n(&p_msg_q->policy, policy, __ATOMIC_RELEASE);
+   __atomic_store_n(&p_msg_q->capacity, capacity, __ATOMIC_RELEASE);
+
+   /* Parked senders have to look at the new bound and policy */
+   __atomic_add_fetch(&p_msg_q->space_seq, 1, __ATOMIC_SEQ_CST);
+   msg_q_futex_wake(&p_msg_q->space_seq, INT_MAX);
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_get_stats
+
+  ===========================================================================*/
+msq_q_err_type msg_q_get_stats(void* msg_q_data, msg_q_stats_type* stats)
+{
+   if ( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+   if( stats == NULL )
+   {
+      LOC_LOGE("%s: Invalid stats parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   stats->count = __atomic_load_n(&p_msg_q->stats.count, __ATOMIC_RELAXED);
+   stats->high_water = __atomic_load_n(&p_msg_q->stats.high_water, __ATOMIC_RELAXED);
+   stats->dropped = __atomic_load_n(&p_msg_q->stats.dropped, __ATOMIC_RELAXED);
+   stats->rejected = __atomic_load_n(&p_msg_q->stats.rejected, __ATOMIC_RELAXED);
+   stats->blocked = __atomic_load_n(&p_msg_q->stats.blocked, __ATOMIC_RELAXED);
+   stats->overcommitted = __atomic_load_n(&p_msg_q->stats.overcommitted, __ATOMIC_RELAXED);
+
+   return eMSG_Q_SUCCESS;
+}
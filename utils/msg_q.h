@@ -50,8 +50,86 @@ typedef enum
      /**< Failed because an there were not enough resources. */
   eMSG_Q_INSUFFICIENT_BUFFER                 = -5,
      /**< Failed because an the supplied buffer was too small. */
+  eMSG_Q_QUEUE_FULL                          = -6,
+     /**< Failed because the queue is at capacity, see msg_q_overflow_type. */
+  eMSG_Q_TIMEOUT                             = -7,
+     /**< Failed because nothing was received in time. */
 }msq_q_err_type;
 
+/** Message Queue Priorities */
+typedef enum
+{
+  eMSG_Q_PRIO_NORMAL                         = 0,
+     /**< Default lane, served in FIFO order. */
+  eMSG_Q_PRIO_HIGH                           = 1,
+     /**< Served ahead of the normal lane, in FIFO order among itself. A
+          link never overtakes links with the same order_key though: while
+          any of them are queued, it goes in their lane. */
+}msg_q_prio_type;
+
+#define MSG_Q_PRIO_NUM 2
+
+/** What sending to a queue at capacity does, see msg_q_set_capacity */
+typedef enum
+{
+  eMSG_Q_OVERFLOW_BLOCK                      = 0,
+     /**< The sender waits until the consumer makes room. */
+  eMSG_Q_OVERFLOW_DROP_OLDEST                = 1,
+     /**< The oldest queued droppable link is dropped to make room; if there
+          is none, a droppable link being sent is dropped itself with
+          eMSG_Q_QUEUE_FULL, and any other is let in over capacity. */
+  eMSG_Q_OVERFLOW_REJECT                     = 2,
+     /**< A droppable link being sent is dropped itself with
+          eMSG_Q_QUEUE_FULL, and any other is let in over capacity. */
+}msg_q_overflow_type;
+
+/** msg_q_link flags a sender may set */
+#define MSG_Q_LINK_DROPPABLE 0x2
+   /**< May be dropped under eMSG_Q_OVERFLOW_DROP_OLDEST. */
+#define MSG_Q_LINK_NOBLOCK   0x4
+   /**< Let in over capacity rather than wait under eMSG_Q_OVERFLOW_BLOCK,
+        for senders that may be the queue's own consumer. */
+#define MSG_Q_LINK_UNORDERED 0x8
+   /**< Not ordered by order_key, always queued in the lane of its prio,
+        for links that do not depend on what is queued before them. */
+
+/** Queue occupancy counters, see msg_q_get_stats */
+typedef struct
+{
+  unsigned int count;
+     /**< Links currently queued. */
+  unsigned int high_water;
+     /**< Most links ever queued at once. */
+  unsigned int dropped;
+     /**< Links dropped under eMSG_Q_OVERFLOW_DROP_OLDEST. */
+  unsigned int rejected;
+     /**< Droppable links failed under eMSG_Q_OVERFLOW_REJECT. */
+  unsigned int blocked;
+     /**< Sends that had to wait under eMSG_Q_OVERFLOW_BLOCK. */
+  unsigned int overcommitted;
+     /**< Links let in over capacity, see msg_q_overflow_type. */
+}msg_q_stats_type;
+
+/** Queue linkage that can be embedded in the objects being queued, which
+    saves msg_q from allocating a node of its own for every message. */
+typedef struct msg_q_link
+{
+  struct msg_q_link* next;
+     /**< Managed by msg_q, do not touch while queued. */
+  void* msg_obj;
+     /**< Object handed out by msg_q_rcv. */
+  void (*dealloc)(void*);
+     /**< Called on msg_obj if the queue is flushed, may be NULL. */
+  const void* order_key;
+     /**< Links with the same key are received in the order they were
+          sent, whatever their prio. */
+  msg_q_prio_type prio;
+     /**< Lane the link asks for, see eMSG_Q_PRIO_HIGH. */
+  unsigned int flags;
+     /**< MSG_Q_LINK_DROPPABLE, MSG_Q_LINK_NOBLOCK and MSG_Q_LINK_UNORDERED
+          may be set by the sender, all other bits are managed by msg_q. */
+}msg_q_link;
+
 /*===========================================================================
 FUNCTION    msg_q_init
 
@@ -135,6 +213,33 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*));
 
+/*===========================================================================
+FUNCTION    msg_q_snd_link
+
+DESCRIPTION
+   Sends data to the message queue without allocating a queue node. The
+   link is typically embedded in the message object itself; its msg_obj
+   and dealloc must be filled in by the caller, and it must stay valid and
+   not be sent again until msg_q_rcv has handed msg_obj back out (or the
+   queue has been flushed). Links are served by priority, see
+   msg_q_prio_type, but never ahead of earlier links with the same
+   order_key; msg_q_snd always uses eMSG_Q_PRIO_NORMAL and a NULL key.
+
+   msg_q_data: Message Queue to add the element to.
+   link:       Link of the object to add into message queue.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_snd_link(void* msg_q_data, msg_q_link* link);
+
 /*===========================================================================
 FUNCTION    msg_q_rcv
 
@@ -157,6 +262,60 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj);
 
+/*===========================================================================
+FUNCTION    msg_q_rcv_all
+
+DESCRIPTION
+   Retrieves a batch of data from the message queue. Blocks like msg_q_rcv
+   until at least one message is available, then detaches up to max_cnt
+   pending messages in one go. msg_objs is filled oldest first.
+
+   msg_q_data: Message Queue to copy data from into msg_objs.
+   msg_objs:   Array of at least max_cnt entries to copy msg_q contents to.
+   max_cnt:    Maximum number of messages to retrieve.
+   rcv_cnt:    Number of messages actually retrieved.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_rcv_all(void* msg_q_data, void** msg_objs,
+                             unsigned int max_cnt, unsigned int* rcv_cnt);
+
+/*===========================================================================
+FUNCTION    msg_q_rcv_all_timeout
+
+DESCRIPTION
+   Same as msg_q_rcv_all, but waits no longer than timeout_msec for the
+   first message. A negative timeout_msec waits as long as msg_q_rcv_all.
+
+   msg_q_data:   Message Queue to copy data from into msg_objs.
+   msg_objs:     Array of at least max_cnt entries to copy msg_q contents to.
+   max_cnt:      Maximum number of messages to retrieve.
+   rcv_cnt:      Number of messages actually retrieved.
+   timeout_msec: Longest time to wait, in milliseconds.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_TIMEOUT if nothing was received in time; otherwise look at error
+   codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_rcv_all_timeout(void* msg_q_data, void** msg_objs,
+                                     unsigned int max_cnt, unsigned int* rcv_cnt,
+                                     int timeout_msec);
+
 /*===========================================================================
 FUNCTION    msg_q_flush
 
@@ -200,6 +359,54 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_unblock(void* msg_q_data);
 
+/*===========================================================================
+FUNCTION    msg_q_set_capacity
+
+DESCRIPTION
+   Bounds the number of links the message queue holds. Queues start out
+   unbounded; the bound may be changed at any time.
+
+   Under eMSG_Q_OVERFLOW_BLOCK, a thread that consumes the queue must not
+   send to it without MSG_Q_LINK_NOBLOCK, or it would wait on itself.
+
+   msg_q_data: Message queue to bound.
+   capacity:   Most links to hold; 0 for no bound.
+   policy:     What a send to the full queue does.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_set_capacity(void* msg_q_data, unsigned int capacity,
+                                  msg_q_overflow_type policy);
+
+/*===========================================================================
+FUNCTION    msg_q_get_stats
+
+DESCRIPTION
+   Reads the occupancy counters of the message queue.
+
+   msg_q_data: Message queue to read the counters of.
+   stats:      Filled in with the counters.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_get_stats(void* msg_q_data, msg_q_stats_type* stats);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,208 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures msg_q throughput, producers sending to one consumer the way
+   MsgTask uses it, against the linked_list, mutex and condition variable
+   queue msg_q used to be, which is kept here as it was for reference.
+   Checks that every message arrives once, in the order of its producer.
+   Usage: msg_q_bench [producers] [msgs per producer] */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<string.h>
+#include<pthread.h>
+#include<time.h>
+#include "msg_q.h"
+#include "linked_list.h"
+
+#define BENCH_MAX_PRODUCERS 16
+
+typedef struct {
+    void* list;
+    pthread_cond_t cond;
+    pthread_mutex_t mutex;
+} bench_locked_q;
+
+typedef enum {
+    BENCH_LOCKED,       /* the queue above */
+    BENCH_SND,          /* msg_q_snd, a link allocated per message */
+    BENCH_SND_LINK      /* msg_q_snd_link, links embedded, as MsgTask sends */
+} bench_mode;
+
+static const char* const bench_mode_names[] = {
+    "mutex/condvar", "msg_q_snd", "msg_q_snd_link"
+};
+
+static bench_mode bench_current;
+static bench_locked_q bench_locked;
+static void* bench_q;
+static unsigned int bench_msgs = 200000;
+static msg_q_link* bench_links;
+
+static uint64_t bench_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* msg_obj carries producer and sequence number, never 0 */
+static void* bench_obj(unsigned int producer, unsigned int seq)
+{
+    return (void*)(uintptr_t)(((uint64_t)producer << 24) + seq + 1);
+}
+
+static void bench_send(unsigned int producer, unsigned int seq)
+{
+    void* obj = bench_obj(producer, seq);
+
+    switch (bench_current) {
+    case BENCH_LOCKED:
+        pthread_mutex_lock(&bench_locked.mutex);
+        linked_list_add(bench_locked.list, obj, NULL);
+        pthread_cond_signal(&bench_locked.cond);
+        pthread_mutex_unlock(&bench_locked.mutex);
+        break;
+    case BENCH_SND:
+        msg_q_snd(bench_q, obj, NULL);
+        break;
+    default: {
+        msg_q_link* link = &bench_links[producer * bench_msgs + seq];
+        memset(link, 0, sizeof(*link));
+        link->msg_obj = obj;
+        msg_q_snd_link(bench_q, link);
+        break;
+    }
+    }
+}
+
+static void* bench_receive()
+{
+    void* obj = NULL;
+
+    if (bench_current == BENCH_LOCKED) {
+        pthread_mutex_lock(&bench_locked.mutex);
+        while (linked_list_empty(bench_locked.list)) {
+            pthread_cond_wait(&bench_locked.cond, &bench_locked.mutex);
+        }
+        linked_list_remove(bench_locked.list, &obj);
+        pthread_mutex_unlock(&bench_locked.mutex);
+    } else {
+        msg_q_rcv(bench_q, &obj);
+    }
+    return obj;
+}
+
+static void* bench_producer(void* arg)
+{
+    unsigned int producer = (unsigned int)(uintptr_t)arg;
+    unsigned int i;
+
+    for (i = 0; i < bench_msgs; i++) {
+        bench_send(producer, i);
+    }
+    return NULL;
+}
+
+/* returns the number of messages out of order or missing */
+static unsigned int bench_run(bench_mode mode, int producers, uint64_t* usec)
+{
+    pthread_t threads[BENCH_MAX_PRODUCERS];
+    unsigned int next[BENCH_MAX_PRODUCERS];
+    unsigned int errors = 0;
+    unsigned int total = producers * bench_msgs;
+    unsigned int i;
+    int p;
+
+    bench_current = mode;
+    memset(next, 0, sizeof(next));
+
+    uint64_t start = bench_usec();
+    for (p = 0; p < producers; p++) {
+        pthread_create(&threads[p], NULL, bench_producer, (void*)(uintptr_t)p);
+    }
+    for (i = 0; i < total; i++) {
+        uint64_t obj = (uint64_t)(uintptr_t)bench_receive() - 1;
+        unsigned int producer = (unsigned int)(obj >> 24);
+        if (producer >= (unsigned int)producers ||
+            (obj & 0xFFFFFF) != next[producer]) {
+            errors++;
+        } else {
+            next[producer]++;
+        }
+    }
+    *usec = bench_usec() - start;
+    for (p = 0; p < producers; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int producers = argc > 1 ? atoi(argv[1]) : 2;
+    unsigned int errors = 0;
+    int mode;
+
+    if (argc > 2) {
+        bench_msgs = atoi(argv[2]);
+    }
+    if (producers < 1 || producers > BENCH_MAX_PRODUCERS ||
+        bench_msgs < 1 || bench_msgs >= 0xFFFFFF) {
+        fprintf(stderr, "usage: %s [producers 1..%d] [msgs per producer]\n",
+                argv[0], BENCH_MAX_PRODUCERS);
+        return 1;
+    }
+
+    bench_links = (msg_q_link*)calloc(producers * bench_msgs, sizeof(msg_q_link));
+    if (NULL == bench_links ||
+        linked_list_init(&bench_locked.list) != eLINKED_LIST_SUCCESS ||
+        msg_q_init(&bench_q) != eMSG_Q_SUCCESS) {
+        return 1;
+    }
+    pthread_mutex_init(&bench_locked.mutex, NULL);
+    pthread_cond_init(&bench_locked.cond, NULL);
+
+    for (mode = BENCH_LOCKED; mode <= BENCH_SND_LINK; mode++) {
+        uint64_t usec;
+        unsigned int modeErrors = bench_run((bench_mode)mode, producers, &usec);
+        printf("%-14s %d producers x %u msgs: %llu usec, %.0f msgs/sec, "
+               "%u lost or out of order\n", bench_mode_names[mode], producers,
+               bench_msgs, (unsigned long long)usec,
+               usec ? producers * bench_msgs * 1000000.0 / usec : 0.0,
+               modeErrors);
+        errors += modeErrors;
+    }
+
+    msg_q_destroy(&bench_q);
+    linked_list_destroy(&bench_locked.list);
+    free(bench_links);
+    return errors != 0;
+}